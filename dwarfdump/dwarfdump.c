@@ -23,6 +23,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <unistd.h>
@@ -40,6 +41,14 @@ static void loadelf(struct dwarf *dwarf, const uint8_t *data, size_t size, struc
 #include <sys/stat.h>
 #include <fcntl.h>
 
+#if !defined(HAVE_THREADS)
+#define HAVE_THREADS 1 /* -DHAVE_THREADS=0 builds the serial dwarfdump, which writes where it formats */
+#endif
+#if HAVE_THREADS
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
+
 static const uint8_t *mapfile(const char *filename, size_t *size) {
     uint8_t *data = MAP_FAILED;
     int fd = open(filename, O_RDONLY);
@@ -99,36 +108,167 @@ static void error(const char *str)
 }
 static void printusage()
 {
-    puts("USAGE: dwarfdump <object file>");
+    puts("USAGE: dwarfdump [-j <jobs>] <object file>");
 }
 
-/* Static buffer shared between all printers
- * ( To race against Gimli c: )
+/* The printers write to `buffer`, which is handed to the writer thread when full,
+ * so formatting goes on in the next buffer while the last one is written.
+ * Worker threads point `buffer` at the chunk they are filling instead.
  */
-static char buffer[4096 * 4096];
-static size_t buffersz = 0;
+#define BUFFER_SIZE (4096 * 4096)
+#define NUM_BUFFERS 2
+static _Thread_local char *buffer = NULL;
+static _Thread_local size_t buffercap = 0;
+static _Thread_local size_t buffersz = 0;
 
-#define output(data, size) do { if (buffersz >= 4096 * 4096 - 4096 * 2) flushoutput(data, size); } while (0)
+static struct {
+    char           *data[NUM_BUFFERS];
+    size_t          size[NUM_BUFFERS];
+    size_t          cap[NUM_BUFFERS];
+    size_t          filling;    /* The buffer `buffer` points into */
+    size_t          writing;    /* The next buffer to write */
+    size_t          num_queued; /* Buffers handed to the writer (including the one being written) */
+#if HAVE_THREADS
+    bool            running;
+    bool            stopping;
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;       /* Signalled when a buffer is queued or written */
+#endif
+} writer;
+
+#define output(data, size) \
+    do { \
+        ensurequota(size); \
+        memcpy(buffer + buffersz, (data), (size)); \
+        buffersz += (size); \
+    } while (0)
 static void flushoutput(const char *data, size_t size)
 {
-    do {
-        int res = write(STDOUT_FILENO, data, size);
+    while (size) {
+        ssize_t res = write(STDOUT_FILENO, data, size);
         if (res == -1) {
             if (errno == EINTR || errno == EAGAIN) continue;
             abort();
         }
         data += res;
         size -= res;
-    } while (size);
+    }
+}
+#if HAVE_THREADS
+static void *writer_main(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&writer.lock);
+    for (;;) {
+        if (writer.num_queued == 0) {
+            if (writer.stopping) break;
+            pthread_cond_wait(&writer.cond, &writer.lock);
+            continue;
+        }
+        size_t i = writer.writing;
+        pthread_mutex_unlock(&writer.lock);
+        flushoutput(writer.data[i], writer.size[i]);
+        pthread_mutex_lock(&writer.lock);
+        writer.writing = (i + 1) % NUM_BUFFERS;
+        writer.num_queued--;
+        pthread_cond_broadcast(&writer.cond);
+    }
+    pthread_mutex_unlock(&writer.lock);
+    return NULL;
+}
+#endif
+static void startoutput(void)
+{
+    size_t i;
+    for (i=0; i < NUM_BUFFERS; i++) {
+        writer.data[i] = malloc(BUFFER_SIZE);
+        if (!writer.data[i]) error("out of memory");
+        writer.cap[i] = BUFFER_SIZE;
+    }
+    buffer = writer.data[0];
+    buffercap = writer.cap[0];
+    buffersz = 0;
+#if HAVE_THREADS
+    /* Without a writer thread the buffers are written where they are handed over */
+    pthread_mutex_init(&writer.lock, NULL);
+    pthread_cond_init(&writer.cond, NULL);
+    writer.running = pthread_create(&writer.thread, NULL, writer_main, NULL) == 0;
+#endif
+}
+/* Hand the filled part of `buffer` to the writer, and continue in a buffer with room for at least `n` bytes */
+static void nextbuffer(size_t n)
+{
+    size_t i = writer.filling;
+    writer.size[i] = buffersz;
+    size_t next = (i + 1) % NUM_BUFFERS;
+#if HAVE_THREADS
+    if (writer.running) {
+        pthread_mutex_lock(&writer.lock);
+        writer.num_queued++;
+        pthread_cond_broadcast(&writer.cond);
+        while (writer.num_queued == NUM_BUFFERS)
+            pthread_cond_wait(&writer.cond, &writer.lock);
+        pthread_mutex_unlock(&writer.lock);
+    } else
+#endif
+    {
+        flushoutput(writer.data[i], writer.size[i]);
+    }
+    if (n >= writer.cap[next]) {
+        /* Grow rather than fail on huge strings, the buffer is not in use by the writer anymore */
+        char *data = realloc(writer.data[next], n + 1);
+        if (!data) error("out of memory");
+        writer.data[next] = data;
+        writer.cap[next] = n + 1;
+    }
+    writer.filling = next;
+    buffer = writer.data[next];
+    buffercap = writer.cap[next];
     buffersz = 0;
 }
+/* Returns once everything formatted so far is written */
+static void syncoutput(void)
+{
+    nextbuffer(0);
+#if HAVE_THREADS
+    if (writer.running) {
+        pthread_mutex_lock(&writer.lock);
+        while (writer.num_queued)
+            pthread_cond_wait(&writer.cond, &writer.lock);
+        pthread_mutex_unlock(&writer.lock);
+    }
+#endif
+}
+static void stopoutput(void)
+{
+    syncoutput();
+#if HAVE_THREADS
+    if (writer.running) {
+        pthread_mutex_lock(&writer.lock);
+        writer.stopping = true;
+        pthread_cond_broadcast(&writer.cond);
+        pthread_mutex_unlock(&writer.lock);
+        pthread_join(writer.thread, NULL);
+        writer.running = false;
+    }
+#endif
+    size_t i;
+    for (i=0; i < NUM_BUFFERS; i++) free(writer.data[i]);
+}
 static bool checkquota(size_t n) {
-    return n < ARRAYSIZE(buffer) - buffersz;
+    return n < buffercap - buffersz;
 }
+#if HAVE_THREADS
+static void nextchunk(size_t n);
+#endif
 static void ensurequota(size_t n) {
     if (!checkquota(n)) {
-        flushoutput(buffer, buffersz);
-        if (!checkquota(n)) error("out of memory");
+#if HAVE_THREADS
+        nextchunk(n);
+#else
+        nextbuffer(n);
+#endif
     }
 }
 
@@ -230,13 +370,28 @@ static void puturi(const char *path) {
 
 static enum dw_cb_status line_row_cb(struct dwarf *dwarf, struct dwarf_line_program *program, struct dwarf_line_program_state *state, struct dwarf_line_program_state *last_state)
 {
-    /* FIXME: Check that state->file is actually valid and not out of bounds */
-    if (program->files[state->file - 1].name.len == -1) {
-        abort(); /* TODO */
+    struct dwarf_fileinfo *pfile = dwarf_line_program_file(program, state->file);
+    size_t namelen = 0;
+    /* The name is only printed when the file changes, so it is only measured then */
+    if (pfile && state->file != last_state->file) {
+        if (pfile->name.len == (size_t)-1) {
+            dw_stream_t stream;
+            switch (pfile->name.section) {
+            case DWARF_SECTION_STR:
+                dw_stream_initfrom(&stream, DWARF_SECTION_STR, dwarf->str.section, dwarf->str.section_provider, pfile->name.off);
+                break;
+            default:
+                dw_stream_initfrom(&stream, DWARF_SECTION_LINESTR, dwarf->line_str.section, dwarf->line_str.section_provider, pfile->name.off);
+                break;
+            }
+            while (dw_stream_get8(&stream)) namelen++;
+        } else {
+            namelen = pfile->name.len;
+        }
     }
     const size_t maxn = STRLEN(
         "0xffffffffffffffff [2147483647, 2147483647] NS BB ET PE EB IS=0xffffffffffffffff DI=0xffffffffffffffff uri: \"\"\n"
-    ) + program->files[state->file - 1].name.len;
+    ) + namelen;
     ensurequota(maxn);
     putaddr(state->address);
     putlit(" [");
@@ -251,8 +406,8 @@ static enum dw_cb_status line_row_cb(struct dwarf *dwarf, struct dwarf_line_prog
     if (state->epilogue_begin) putlit(" EB");
     if (state->isa != last_state->isa) { putlit(" IS="); puthex(state->isa, 0); }
     if (state->discriminator) { putlit(" DI="); puthex(state->discriminator, 0); }
-    if (state->file != last_state->file) {
-        struct dwarf_fileinfo file = program->files[state->file - 1];
+    if (state->file != last_state->file && pfile) {
+        struct dwarf_fileinfo file = *pfile;
         dw_stream_t stream;
         switch (file.name.section) {
         case DWARF_SECTION_LINE:
@@ -269,8 +424,13 @@ static enum dw_cb_status line_row_cb(struct dwarf *dwarf, struct dwarf_line_prog
         }
         /* TODO: ensurequota */
         putlit(" uri: \"");
-        while (dw_stream_tell(&stream) < file.name.off + file.name.len)
+        if (file.name.len == (size_t)-1) {
+            while (dw_stream_peak8(&stream))
                 puturichar(dw_stream_get8(&stream));
+        } else {
+            while (dw_stream_tell(&stream) < file.name.off + file.name.len)
+                puturichar(dw_stream_get8(&stream));
+        }
         put('\"');
     }
     put('\n');
@@ -322,11 +482,16 @@ static enum dw_cb_status line_cb(struct dwarf *dwarf, struct dwarf_line_program
             }
             break;
         case DW_FORM_strp:
+        case DW_FORM_line_strp:
             {
                 dw_stroff_t stroff = info.value.stroff;
                 size_t strlength = 0;
                 dw_stream_t stream;
-                dw_stream_initfrom(&stream, DWARF_SECTION_STR, dwarf->str.section, dwarf->str.section_provider, stroff);
+                if (info.form == DW_FORM_line_strp) {
+                    dw_stream_initfrom(&stream, DWARF_SECTION_LINESTR, dwarf->line_str.section, dwarf->line_str.section_provider, stroff);
+                } else {
+                    dw_stream_initfrom(&stream, DWARF_SECTION_STR, dwarf->str.section, dwarf->str.section_provider, stroff);
+                }
                 while (dw_stream_get8(&stream)) strlength++;
                 dw_stream_seek(&stream, stroff);
                 ensurequota(strlength); /* FIXME: ensurequota + tail */
@@ -343,7 +508,7 @@ static enum dw_cb_status line_cb(struct dwarf *dwarf, struct dwarf_line_program
     for (i=0; i < program->num_files; i++) {
         struct dwarf_fileinfo *info = &program->files[i];
         putlit("  ");
-        putint(i + 1, 0);
+        putint(program->version >= 5 ? i : i + 1, 0);
         put('\t');
         putint(info->include_directory_idx, 0);
         put('\t');
@@ -383,7 +548,7 @@ static enum dw_cb_status abbrev_cb(struct dwarf *dwarf, dwarf_abbrev_t *abbrev)
         "Defining abbreviation code 0xffffffffffffffff as tag  [has children]\n"
     ) + MAX(STRLEN("<0xffffffffffffffff>"), DWARF_MAX_SYMBOL_NAME);
     if (!checkquota(maxn)) {
-        flushoutput(buffer, buffersz);
+        nextbuffer(maxn);
         /* No need to check again (maxn is constant) */
     }
     const char *tag_name = dwarf_get_symbol_name(DW_TAG, abbrev->tag);
@@ -412,7 +577,7 @@ static enum dw_cb_status abbrev_attr_cb(struct dwarf *dwarf, dwarf_abbrev_t *abb
         "  : \n"
     ) + MAX(STRLEN("<0xffffffffffffffff>"), DWARF_MAX_SYMBOL_NAME) * 2;
     if (!checkquota(maxn)) {
-        flushoutput(buffer, buffersz);
+        nextbuffer(maxn);
         /* No need to check again (maxn is constant) */
     }
     const char *attr_name = dwarf_get_symbol_name(DW_AT, attr->name);
@@ -442,7 +607,7 @@ static enum dw_cb_status arange_cb(struct dwarf *dwarf, dwarf_aranges_t *aranges
 {
     const size_t maxn = STRLEN("  [2147483647] 0xffffffffffffffff - 0xffffffffffffffff | 0xffffffffffffffff (2147483647 bytes)\n");
     if (!checkquota(maxn)) {
-        flushoutput(buffer, buffersz);
+        nextbuffer(maxn);
         /* No need to check again (maxn is constant) */
     }
     putlit("  [");
@@ -472,7 +637,7 @@ static enum dw_cb_status aranges_cb(struct dwarf *dwarf, dwarf_aranges_t *arange
         "  Seg From                 To                   Length\n"
     );
     if (!checkquota(maxn)) {
-        flushoutput(buffer, buffersz);
+        nextbuffer(maxn);
         /* No need to check again (maxn is constant) */
     }
     putlit("  Length:                   ");
@@ -544,12 +709,25 @@ static enum dw_cb_status attr_cb(struct dwarf *dwarf, dwarf_unit_t *unit, dwarf_
     case DW_FORM_ref8:
     case DW_FORM_udata:
     case DW_FORM_sdata:
+    case DW_FORM_ref_udata:
+    case DW_FORM_ref_sig8:
+    case DW_FORM_ref_sup4:
+    case DW_FORM_ref_sup8:
+    case DW_FORM_implicit_const:
         puthex2(attr->value.val, 0);
         break;
     case DW_FORM_addr:
+    case DW_FORM_addrx:
+    case DW_FORM_addrx1:
+    case DW_FORM_addrx2:
+    case DW_FORM_addrx3:
+    case DW_FORM_addrx4:
         putaddr64((uint64_t)attr->value.addr);
         break;
     case DW_FORM_sec_offset:
+    case DW_FORM_ref_addr:
+    case DW_FORM_rnglistx:
+    case DW_FORM_loclistx:
         puthex2(attr->value.off, 0);
         break;
     case DW_FORM_string:
@@ -566,11 +744,21 @@ static enum dw_cb_status attr_cb(struct dwarf *dwarf, dwarf_unit_t *unit, dwarf_
         }
         break;
     case DW_FORM_strp:
+    case DW_FORM_strx:
+    case DW_FORM_strx1:
+    case DW_FORM_strx2:
+    case DW_FORM_strx3:
+    case DW_FORM_strx4:
+    case DW_FORM_line_strp:
         {
             dw_stroff_t stroff = attr->value.stroff;
             size_t strlength = 0;
             dw_stream_t stream;
-            dw_stream_initfrom(&stream, DWARF_SECTION_STR, dwarf->str.section, dwarf->str.section_provider, stroff);
+            if (attr->form == DW_FORM_line_strp) {
+                dw_stream_initfrom(&stream, DWARF_SECTION_LINESTR, dwarf->line_str.section, dwarf->line_str.section_provider, stroff);
+            } else {
+                dw_stream_initfrom(&stream, DWARF_SECTION_STR, dwarf->str.section, dwarf->str.section_provider, stroff);
+            }
             while (dw_stream_get8(&stream)) strlength++;
             dw_stream_seek(&stream, stroff);
             ensurequota(strlength + STRLEN("'' (offset 0xffffffffffffffff)")); /* FIXME: ensurequota + tail */
@@ -641,9 +829,224 @@ static enum dw_cb_status die_cb(struct dwarf *dwarf, dwarf_unit_t *unit, dwarf_d
     return DW_CB_OK;
 }
 
+#if HAVE_THREADS
+/* With -j, the line programs and units (items) are formatted by worker threads, while the main thread writes.
+ * Every worker walks all the items with its own `struct dwarf`, and formats the ones it claims from `next_item`.
+ * Output is handed over in chunks tagged with their item, the writer picks them in item order,
+ * so the output is the same as without -j.
+ */
+#define CHUNK_SIZE (1024 * 1024)
+#define CHUNKS_PER_WORKER 4
+
+struct chunk {
+    struct chunk *next;
+    size_t        item;
+    bool          last; /* The last chunk of its item */
+    size_t        size;
+    size_t        cap;
+    char          data[];
+};
+struct worker {
+    pthread_t            thread;
+    struct dwarf        *dwarf;
+    struct dwarf_errinfo errinfo;
+    size_t               num_items; /* Items walked so far */
+    size_t               claimed;   /* The next item this worker formats */
+    struct chunk        *chunk;     /* The chunk being filled, or NULL between items */
+};
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;        /* Signalled when a chunk is queued or written, or a worker is done */
+    struct chunk   *queue;       /* Filled chunks, in the order they were queued */
+    size_t          current;     /* The item being written */
+    size_t          num_chunks;  /* Chunks being filled or queued */
+    size_t          max_chunks;
+    size_t          num_running;
+    atomic_bool     failed;
+    atomic_size_t   next_item;
+} jobs = { .lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER };
+static _Thread_local struct worker *worker = NULL;
+
+static void beginchunk(size_t item, size_t n)
+{
+    size_t cap = MAX(CHUNK_SIZE, n + 1);
+    pthread_mutex_lock(&jobs.lock);
+    /* The chunks of the item being written are always allowed, they are what frees the others */
+    while (jobs.num_chunks >= jobs.max_chunks && item != jobs.current && !jobs.failed)
+        pthread_cond_wait(&jobs.cond, &jobs.lock);
+    jobs.num_chunks++;
+    pthread_mutex_unlock(&jobs.lock);
+    struct chunk *chunk = malloc(sizeof(struct chunk) + cap);
+    if (!chunk) error("out of memory");
+    chunk->next = NULL;
+    chunk->item = item;
+    chunk->last = false;
+    chunk->size = 0;
+    chunk->cap = cap;
+    worker->chunk = chunk;
+    buffer = chunk->data;
+    buffercap = cap;
+    buffersz = 0;
+}
+static void endchunk(bool last)
+{
+    struct chunk *chunk = worker->chunk;
+    chunk->size = buffersz;
+    chunk->last = last;
+    worker->chunk = NULL;
+    buffer = NULL;
+    buffercap = 0;
+    buffersz = 0;
+    pthread_mutex_lock(&jobs.lock);
+    struct chunk **tail = &jobs.queue;
+    while (*tail) tail = &(*tail)->next;
+    *tail = chunk;
+    pthread_cond_broadcast(&jobs.cond);
+    pthread_mutex_unlock(&jobs.lock);
+}
+static void nextchunk(size_t n)
+{
+    if (!worker) {
+        nextbuffer(n);
+        return;
+    }
+    size_t item = worker->chunk->item;
+    endchunk(false);
+    beginchunk(item, n);
+}
+/* Called at the start of every item, returns whether this worker formats it */
+static bool claimitem(void)
+{
+    if (worker->chunk) endchunk(true);
+    size_t item = worker->num_items++;
+    if (item != worker->claimed || jobs.failed) return false;
+    worker->claimed = atomic_fetch_add(&jobs.next_item, 1);
+    beginchunk(item, 0);
+    return true;
+}
+static enum dw_cb_status worker_line_cb(struct dwarf *dwarf, struct dwarf_line_program *program)
+{
+    if (!claimitem()) return DW_CB_NEXT;
+    return line_cb(dwarf, program);
+}
+static enum dw_cb_status worker_cu_cb(struct dwarf *dwarf, dwarf_cu_t *cu)
+{
+    (void)dwarf;
+    (void)cu;
+    if (!claimitem()) return DW_CB_NEXT;
+    return DW_CB_OK;
+}
+static void *worker_main(void *arg)
+{
+    worker = arg;
+    worker->claimed = atomic_fetch_add(&jobs.next_item, 1);
+    /* The abbreviations are printed by the main thread, workers only need the tables */
+    if (dwarf_parse_section(worker->dwarf, DWARF_SECTION_ABBREV, &worker->errinfo)
+     && dwarf_parse_section(worker->dwarf, DWARF_SECTION_LINE, &worker->errinfo)) {
+        dwarf_parse_section(worker->dwarf, DWARF_SECTION_INFO, &worker->errinfo);
+    }
+    if (worker->chunk) endchunk(true);
+    pthread_mutex_lock(&jobs.lock);
+    if (dwarf_has_error(&worker->errinfo)) jobs.failed = true;
+    jobs.num_running--;
+    pthread_cond_broadcast(&jobs.cond);
+    pthread_mutex_unlock(&jobs.lock);
+    return NULL;
+}
+static void writechunks(void)
+{
+    pthread_mutex_lock(&jobs.lock);
+    for (;;) {
+        struct chunk **pchunk = &jobs.queue;
+        while (*pchunk && (*pchunk)->item != jobs.current) pchunk = &(*pchunk)->next;
+        struct chunk *chunk = *pchunk;
+        if (!chunk) {
+            /* Once the workers are done, the item being waited for is past the end (or its worker failed) */
+            if (jobs.num_running == 0) break;
+            pthread_cond_wait(&jobs.cond, &jobs.lock);
+            continue;
+        }
+        *pchunk = chunk->next;
+        pthread_mutex_unlock(&jobs.lock);
+        flushoutput(chunk->data, chunk->size);
+        pthread_mutex_lock(&jobs.lock);
+        if (chunk->last) jobs.current++;
+        jobs.num_chunks--;
+        free(chunk);
+        pthread_cond_broadcast(&jobs.cond);
+    }
+    while (jobs.queue) {
+        struct chunk *chunk = jobs.queue;
+        jobs.queue = chunk->next;
+        free(chunk);
+    }
+    pthread_mutex_unlock(&jobs.lock);
+}
+static void share_sections(struct dwarf *to, const struct dwarf *from, struct dwarf_errinfo *errinfo)
+{
+    dwarf_load_section(to, DWARF_SECTION_ABBREV, from->abbrev.section, errinfo);
+    dwarf_load_section(to, DWARF_SECTION_ARANGES, from->aranges.section, errinfo);
+    dwarf_load_section(to, DWARF_SECTION_INFO, from->info.section, errinfo);
+    dwarf_load_section(to, DWARF_SECTION_LINE, from->line.section, errinfo);
+    dwarf_load_section(to, DWARF_SECTION_STR, from->str.section, errinfo);
+    dwarf_load_section(to, DWARF_SECTION_LINESTR, from->line_str.section, errinfo);
+    dwarf_load_section(to, DWARF_SECTION_STROFFSETS, from->str_offsets.section, errinfo);
+    dwarf_load_section(to, DWARF_SECTION_ADDR, from->addr.section, errinfo);
+    dwarf_load_section(to, DWARF_SECTION_RANGELISTS, from->rnglists.section, errinfo);
+    dwarf_load_section(to, DWARF_SECTION_LOCATIONLISTS, from->loclists.section, errinfo);
+}
+/* Does what dwarf_parse does, with the line programs and units formatted by `num_jobs` workers */
+static bool parse_jobs(struct dwarf *dwarf, size_t num_jobs, struct dwarf_errinfo *errinfo)
+{
+    if (!dwarf_parse_section(dwarf, DWARF_SECTION_ARANGES, errinfo)) return false;
+    if (!dwarf_parse_section(dwarf, DWARF_SECTION_ABBREV, errinfo)) return false;
+    syncoutput();
+
+    struct worker *workers = calloc(num_jobs, sizeof(struct worker));
+    if (!workers) error("out of memory");
+    jobs.max_chunks = num_jobs * CHUNKS_PER_WORKER;
+    size_t i;
+    for (i=0; i < num_jobs; i++) {
+        struct worker *w = &workers[i];
+        w->errinfo = (struct dwarf_errinfo)DWARF_ERRINFO_INIT;
+        dwarf_init(&w->dwarf, dwarf->allocator, &w->errinfo);
+        share_sections(w->dwarf, dwarf, &w->errinfo);
+        w->dwarf->line_cb = worker_line_cb;
+        w->dwarf->cu_cb = worker_cu_cb;
+        w->dwarf->die_cb = die_cb;
+        pthread_mutex_lock(&jobs.lock);
+        if (pthread_create(&w->thread, NULL, worker_main, w) != 0) error("could not start worker thread");
+        jobs.num_running++;
+        pthread_mutex_unlock(&jobs.lock);
+    }
+    writechunks();
+
+    bool ok = true;
+    for (i=0; i < num_jobs; i++) {
+        struct worker *w = &workers[i];
+        pthread_join(w->thread, NULL);
+        if (ok && dwarf_has_error(&w->errinfo)) {
+            *errinfo = w->errinfo;
+            ok = false;
+        }
+        dwarf_fini(&w->dwarf, &w->errinfo);
+    }
+    free(workers);
+    if (!ok) return false;
+    return dwarf_parse_section(dwarf, DWARF_SECTION_STR, errinfo);
+}
+#endif
+
 int main(int argc, const char *argv[])
 {
-    if (argc < 2) {
+    size_t num_jobs = 1;
+    if (argc >= 3 && strncmp(argv[1], "-j", 2) == 0) {
+        int shift = argv[1][2] ? 1 : 2;
+        num_jobs = strtoul(shift == 1 ? &argv[1][2] : argv[2], NULL, 10);
+        argc -= shift;
+        argv += shift;
+    }
+    if (argc < 2 || num_jobs == 0) {
         printusage();
         exit(1);
     }
@@ -663,10 +1066,17 @@ int main(int argc, const char *argv[])
     }
     loadelf(dwarf, data, size, &errinfo);
     if (!data) goto fail;
+    startoutput();
+#if HAVE_THREADS
+    if (num_jobs > 1 && !parse_jobs(dwarf, num_jobs, &errinfo)) {
+        dwarf_write_error(&errinfo, &dweller_libc_stderr_writer);
+    } else if (num_jobs == 1 && !dwarf_parse(dwarf, &errinfo)) {
+#else
     if (!dwarf_parse(dwarf, &errinfo)) {
+#endif
         dwarf_write_error(&errinfo, &dweller_libc_stderr_writer);
     }
-    flushoutput(buffer, buffersz);
+    stopoutput();
 
 fail:
     if (!data) perror(argv[1]);
@@ -732,6 +1142,11 @@ static void add_section(struct dwarf *dwarf, const char *name, const uint8_t *ba
     else if (strcmp(name, ".debug_info") == 0) dwarf_add_section(dwarf, DWARF_SECTION_INFO, &provider->provider, errinfo);
     else if (strcmp(name, ".debug_line") == 0) dwarf_add_section(dwarf, DWARF_SECTION_LINE, &provider->provider, errinfo);
     else if (strcmp(name, ".debug_str") == 0) dwarf_add_section(dwarf, DWARF_SECTION_STR, &provider->provider, errinfo);
+    else if (strcmp(name, ".debug_line_str") == 0) dwarf_add_section(dwarf, DWARF_SECTION_LINESTR, &provider->provider, errinfo);
+    else if (strcmp(name, ".debug_str_offsets") == 0) dwarf_add_section(dwarf, DWARF_SECTION_STROFFSETS, &provider->provider, errinfo);
+    else if (strcmp(name, ".debug_addr") == 0) dwarf_add_section(dwarf, DWARF_SECTION_ADDR, &provider->provider, errinfo);
+    else if (strcmp(name, ".debug_rnglists") == 0) dwarf_add_section(dwarf, DWARF_SECTION_RANGELISTS, &provider->provider, errinfo);
+    else if (strcmp(name, ".debug_loclists") == 0) dwarf_add_section(dwarf, DWARF_SECTION_LOCATIONLISTS, &provider->provider, errinfo);
 #else
     struct dwarf_section section;
     section.base = base;
@@ -741,6 +1156,11 @@ static void add_section(struct dwarf *dwarf, const char *name, const uint8_t *ba
     else if (strcmp(name, ".debug_info") == 0) dwarf_load_section(dwarf, DWARF_SECTION_INFO, section, errinfo);
     else if (strcmp(name, ".debug_line") == 0) dwarf_load_section(dwarf, DWARF_SECTION_LINE, section, errinfo);
     else if (strcmp(name, ".debug_str") == 0) dwarf_load_section(dwarf, DWARF_SECTION_STR, section, errinfo);
+    else if (strcmp(name, ".debug_line_str") == 0) dwarf_load_section(dwarf, DWARF_SECTION_LINESTR, section, errinfo);
+    else if (strcmp(name, ".debug_str_offsets") == 0) dwarf_load_section(dwarf, DWARF_SECTION_STROFFSETS, section, errinfo);
+    else if (strcmp(name, ".debug_addr") == 0) dwarf_load_section(dwarf, DWARF_SECTION_ADDR, section, errinfo);
+    else if (strcmp(name, ".debug_rnglists") == 0) dwarf_load_section(dwarf, DWARF_SECTION_RANGELISTS, section, errinfo);
+    else if (strcmp(name, ".debug_loclists") == 0) dwarf_load_section(dwarf, DWARF_SECTION_LOCATIONLISTS, section, errinfo);
 #endif
 }
 
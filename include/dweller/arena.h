@@ -0,0 +1,58 @@
+/****************************************************************************
+ *
+ * Copyright 2020 The libdweller project contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ****************************************************************************/
+#ifndef DWELLER_ARENA_H
+#define DWELLER_ARENA_H
+#include <dweller/core.h>
+
+/* An allocator handing out memory from a fixed block that the user provides,
+ * so it never has to ask the system for memory (for example, in a signal
+ * handler).
+ * Memory is handed out in order. Freeing or growing the latest block is done
+ * in place, other blocks are only given back by `dweller_arena_release`.
+ * `DWARF_ALLOC_BUFFER` requests get the unused end of the block, and
+ * `DWARF_ALLOC_OBSTACK` requests are just the latest block.
+ * The arena is not thread-safe.
+ */
+struct dweller_arena {
+    /* @{allocator} Pass `&arena->allocator` to `dwarf_init` */
+    dw_alloc_t allocator;
+    /* @{fallback} Used when the arena is full, or `NULL` to fail instead.
+     * While it is `NULL`, requests for blocks it handed out fail too.
+     */
+    dw_alloc_t *fallback;
+    dw_u8_t *base;
+    size_t size;
+    size_t used;
+    /* @{last} Offset of the header of the latest block, or `(size_t)-1` */
+    size_t last;
+};
+
+DWAPI(void) dweller_arena_init(struct dweller_arena *arena, void *memory, size_t size, dw_alloc_t *fallback) dw_nonnull(1);
+/* Returns a mark for `dweller_arena_release`.
+ * Blocks allocated before the mark can no longer grow in place.
+ */
+DWAPI(size_t) dweller_arena_mark(struct dweller_arena *arena) dw_nonnull(1);
+/* Give back every block allocated after `mark` was taken, in constant time.
+ * Blocks that came from the fallback allocator are not affected.
+ * Nothing may still refer to the blocks that were given back, such as the
+ * tables that `dwarf_parse_section` builds in `struct dwarf`.
+ * Release to 0 to reset the arena.
+ */
+DWAPI(void) dweller_arena_release(struct dweller_arena *arena, size_t mark) dw_nonnull(1);
+
+#endif /* DWELLER_ARENA_H */
@@ -0,0 +1,176 @@
+/****************************************************************************
+ *
+ * Copyright 2020 The libdweller project contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ****************************************************************************/
+#ifndef DWELLER_CFI_H
+#define DWELLER_CFI_H
+#include <stdbool.h>
+#include <dweller/core.h>
+
+/* Call frame information, from `.eh_frame` or `.debug_frame`, for unwinding
+ * the stack without frame pointers.
+ * Finding and evaluating the rules for an address neither allocates nor
+ * locks, so a thread can unwind itself from a signal handler.
+ * Only `dweller_cfi_index` allocates, and only `dweller_cfi_fini` frees.
+ * Sections and the stack are read in the byte order and pointer size of the
+ * host, which are the ones of the code that is unwound.
+ */
+
+/* Enough for the integer registers of x86-64 (0-16, 16 is the return
+ * address) and AArch64 (0-31, 30 is the link register, 31 the stack pointer).
+ * Rules for higher (vector) registers are ignored.
+ */
+#define DWELLER_CFI_MAX_REGS   33
+/* How deep `DW_CFA_remember_state` may nest, states live on the stack */
+#define DWELLER_CFI_MAX_STATES 4
+
+/* The DWARF register number of the stack pointer */
+#define DWELLER_CFI_SP_X86_64  7
+#define DWELLER_CFI_SP_AARCH64 31
+
+/* Pointer encodings used in `.eh_frame` and `.eh_frame_hdr` */
+#define DW_EH_PE_absptr   0x00
+#define DW_EH_PE_uleb128  0x01
+#define DW_EH_PE_udata2   0x02
+#define DW_EH_PE_udata4   0x03
+#define DW_EH_PE_udata8   0x04
+#define DW_EH_PE_sleb128  0x09
+#define DW_EH_PE_sdata2   0x0a
+#define DW_EH_PE_sdata4   0x0b
+#define DW_EH_PE_sdata8   0x0c
+#define DW_EH_PE_pcrel    0x10
+#define DW_EH_PE_textrel  0x20
+#define DW_EH_PE_datarel  0x30
+#define DW_EH_PE_funcrel  0x40
+#define DW_EH_PE_aligned  0x50
+#define DW_EH_PE_indirect 0x80
+#define DW_EH_PE_omit     0xff
+
+enum dweller_cfi_rule_kind {
+    DWELLER_CFI_SAME_VALUE = 0, /* Not changed by this frame */
+    DWELLER_CFI_UNDEFINED,      /* Not recoverable, for the return address it marks the outermost frame */
+    DWELLER_CFI_OFFSET,         /* Saved at CFA + `offset` */
+    DWELLER_CFI_VAL_OFFSET,     /* The value is CFA + `offset` */
+    DWELLER_CFI_REGISTER,       /* Saved in register `reg` */
+    DWELLER_CFI_EXPRESSION,     /* Saved at the address computed by `expr`, with the CFA pushed first */
+    DWELLER_CFI_VAL_EXPRESSION, /* The value is computed by `expr`, with the CFA pushed first */
+};
+struct dweller_cfi_rule {
+    dw_u8_t kind;
+    dw_u16_t reg;
+    dw_u32_t expr_size;
+    union {
+        dw_i64_t offset;
+        const dw_u8_t *expr;
+    };
+};
+/* The rules that hold for a range of addresses in a function */
+struct dweller_cfi_row {
+    /* @{pc_begin} @{pc_end} The rules hold from `pc_begin` up to (not including) `pc_end` */
+    dw_u64_t pc_begin;
+    dw_u64_t pc_end;
+    unsigned ra_reg;
+    /* @{signal_frame} The frame was set up by the kernel for a signal handler,
+     * its return address is the interrupted instruction itself.
+     */
+    bool signal_frame;
+    /* @{cfa} `DWELLER_CFI_VAL_OFFSET` of register `reg`, or `DWELLER_CFI_VAL_EXPRESSION` */
+    struct dweller_cfi_rule cfa;
+    struct dweller_cfi_rule regs[DWELLER_CFI_MAX_REGS];
+};
+/* Register values of a frame. `dweller_cfi_step` turns them into the values of its caller. */
+struct dweller_cfi_regs {
+    dw_u64_t pc;
+    dw_u64_t cfa;
+    /* @{valid} Bit `n` is set if `regs[n]` is known */
+    dw_u64_t valid;
+    dw_u64_t regs[DWELLER_CFI_MAX_REGS];
+};
+/* A row reduced to a CFA of register + offset and a few saved registers,
+ * which is what most functions need. It is small enough to be cached for
+ * every return address, and stepping with it does not touch the section.
+ */
+#define DWELLER_CFI_COMPACT_SAVED 12
+struct dweller_cfi_compact {
+    dw_i32_t cfa_offset;
+    dw_u8_t cfa_reg;
+    dw_u8_t ra_reg;
+    dw_u8_t signal_frame;
+    dw_u8_t num_saved;
+    /* @{saved} Every register whose rule is not `DWELLER_CFI_SAME_VALUE`,
+     * only `OFFSET`, `VAL_OFFSET` and `UNDEFINED` rules are allowed
+     */
+    struct {
+        dw_u8_t reg;
+        dw_u8_t kind;
+        dw_i16_t offset;
+    } saved[DWELLER_CFI_COMPACT_SAVED];
+};
+/* Copies the `size` bytes (at most 8) at `address` to `bytes`, returns false if they can not be read */
+typedef bool (*dweller_cfi_read_t)(void *data, dw_u64_t address, void *bytes, size_t size);
+
+struct dweller_cfi_entry {
+    dw_u64_t pc;
+    dw_u64_t fde; /* Offset of the FDE in the section */
+};
+struct dweller_cfi {
+    const dw_u8_t *base;
+    size_t size;
+    /* @{address} Where the section is loaded, pc-relative pointers are relative to this */
+    dw_u64_t address;
+    bool is_eh_frame;
+    dw_u8_t address_size;
+    /* @{hdr_table} The search table of `.eh_frame_hdr`, if it can be used */
+    const dw_u8_t *hdr_table;
+    size_t hdr_count;
+    dw_u64_t hdr_address;
+    /* @{entries} The table built by `dweller_cfi_index`, sorted by `pc` */
+    size_t num_entries;
+    struct dweller_cfi_entry *entries;
+    dw_alloc_t *allocator;
+};
+
+/* Use the CFI in a section, `address` is where the section is loaded.
+ * Without an index, `dweller_cfi_find` searches the whole section.
+ */
+DWAPI(void) dweller_cfi_init(struct dweller_cfi *cfi, const void *section, size_t size, dw_u64_t address, bool is_eh_frame) dw_nonnull(1);
+/* Use the `.eh_frame` that `.eh_frame_hdr` points to, and its sorted search
+ * table to find FDEs in O(log n). `address` is where `hdr` is loaded, and
+ * `.eh_frame` is read up to `eh_frame_end` at most, the end of the segment
+ * that holds both. Returns false if `hdr` is not usable.
+ */
+DWAPI(bool) dweller_cfi_init_eh_frame_hdr(struct dweller_cfi *cfi, const void *hdr, size_t size, dw_u64_t address, dw_u64_t eh_frame_end) dw_nonnull(1, 2);
+/* Build a sorted table of FDEs, for sections that come without one */
+DWAPI(bool) dweller_cfi_index(struct dweller_cfi *cfi, dw_alloc_t *allocator) dw_nonnull(1, 2);
+DWAPI(void) dweller_cfi_fini(struct dweller_cfi *cfi) dw_nonnull(1);
+/* Find the rules for the instruction at `pc`.
+ * For a return address, which may be just past the end of the calling
+ * function, look up `pc - 1` instead (unless it belongs to a signal frame).
+ * Returns false if there is no FDE for `pc`, or its instructions are invalid.
+ */
+DWAPI(bool) dweller_cfi_find(const struct dweller_cfi *cfi, dw_u64_t pc, struct dweller_cfi_row *row) dw_nonnull(1, 3);
+/* Compute the registers of the caller, the stack pointer (`sp_reg`) becomes the CFA.
+ * Returns false if a rule could not be evaluated, or there is no caller.
+ */
+DWAPI(bool) dweller_cfi_step(const struct dweller_cfi_row *row, struct dweller_cfi_regs *regs, unsigned sp_reg, dweller_cfi_read_t read, void *data) dw_nonnull(1, 2, 4);
+/* Reduce `row` to its compact form, returns false if it uses expressions or
+ * more saved registers than fit.
+ */
+DWAPI(bool) dweller_cfi_compact(const struct dweller_cfi_row *row, struct dweller_cfi_compact *compact) dw_nonnull(1, 2);
+/* Same as `dweller_cfi_step`, for a row reduced by `dweller_cfi_compact` */
+DWAPI(bool) dweller_cfi_step_compact(const struct dweller_cfi_compact *compact, struct dweller_cfi_regs *regs, unsigned sp_reg, dweller_cfi_read_t read, void *data) dw_nonnull(1, 2, 4);
+
+#endif /* DWELLER_CFI_H */
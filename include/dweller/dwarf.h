@@ -80,6 +80,10 @@ typedef enum dw_cb_status (*dw_cu_cb_t)(struct dwarf *dwarf, dwarf_cu_t *cu) dw_
 /* Callback that gets called when a `DW_UT_type_unit` header has been parsed.
  */
 typedef enum dw_cb_status (*dw_tu_cb_t)(struct dwarf *dwarf, dwarf_tu_t *ud) dw_nonnull(1, 2);
+/* Callback that gets called for every address range in a range list, see `dwarf_read_ranges`.
+ * `high_pc` is the first address past the range.
+ */
+typedef enum dw_cb_status (*dw_range_cb_t)(struct dwarf *dwarf, const dwarf_unit_t *unit, dw_u64_t low_pc, dw_u64_t high_pc, void *data) dw_nonnull(1, 2);
 
 #define DW_NUM_DEFAULT_OPCODES 12
 
@@ -130,6 +134,13 @@ struct dwarf_string {
     dw_stroff_t off;
     size_t len;
 };
+/* A block of raw bytes (`DW_FORM_block*`, `DW_FORM_exprloc`, `DW_FORM_data16`) */
+typedef struct dwarf_block dw_block_t;
+struct dwarf_block {
+    enum dwarf_section_namespace section;
+    dw_off_t off;
+    size_t len;
+};
 struct dwarf_section {
     const dw_u8_t *base;
     size_t size;
@@ -150,6 +161,7 @@ struct dwarf_abbreviation {
 struct dwarf_abbreviation_attribute {
     dw_symval_t name;
     dw_symval_t form;
+    dw_i64_t implicit_const; /* Only valid if `form == DW_FORM_implicit_const` */
 };
 struct dwarf_abbreviation_table {
     dw_off_t debug_abbrev_offset;
@@ -205,12 +217,43 @@ struct dwarf_section_line_str {
     struct dwarf_section section;
     struct dwarf_section_provider *section_provider;
 };
+/* The DWARF5 indexed sections. Units refer into these through the
+ * `DW_AT_*_base` attributes of their unit DIE, see `struct dwarf_unit`.
+ */
+struct dwarf_section_str_offsets {
+    struct dwarf_section section;
+    struct dwarf_section_provider *section_provider;
+};
+struct dwarf_section_addr {
+    struct dwarf_section section;
+    struct dwarf_section_provider *section_provider;
+};
+struct dwarf_section_rnglists {
+    struct dwarf_section section;
+    struct dwarf_section_provider *section_provider;
+};
+/* `.debug_ranges`, used by `DW_AT_ranges` before DWARF5 */
+struct dwarf_section_ranges {
+    struct dwarf_section section;
+    struct dwarf_section_provider *section_provider;
+};
+struct dwarf_section_loclists {
+    struct dwarf_section section;
+    struct dwarf_section_provider *section_provider;
+};
 
+/* Indexed forms are resolved while reading, so their value is stored the same
+ * way as the form they index:
+ *   `DW_FORM_strx*`               -> `stroff` (into `.debug_str`)
+ *   `DW_FORM_addrx*`              -> `addr`
+ *   `DW_FORM_rnglistx`/`loclistx` -> `off` (into `.debug_rnglists`/`.debug_loclists`)
+ */
 union dwarf_attribute_value {
     void *addr;
     dw_off_t off;
     dw_stroff_t stroff;
     dw_str_t str;
+    dw_block_t block;
     dw_u64_t val;
     bool b;
     dw_u64_t file_index;
@@ -264,6 +307,18 @@ struct dwarf_unit {
     dw_u8_t address_size;
     dw_u8_t dwarf64;
     dw_u16_t version;
+    /* `dwo_id` for skeleton/split units, `type_signature` for type units */
+    dw_u64_t unit_id;
+    dw_off_t type_offset;
+    /* Cached from the unit DIE when the header is parsed, so indexed forms
+     * can be resolved with a single load from the indexed section.
+     */
+    dw_off_t str_offsets_base;
+    dw_off_t addr_base;
+    dw_off_t rnglists_base;
+    dw_off_t loclists_base;
+    /* `DW_AT_stmt_list` of the unit DIE (DWARF5 units only), or -1 */
+    dw_off_t line_offset;
     dw_die_cb_t die_cb;
     void *data;
 };
@@ -353,6 +408,11 @@ struct dwarf {
     struct dwarf_section_line     line;
     struct dwarf_section_str      str;
     struct dwarf_section_line_str line_str;
+    struct dwarf_section_str_offsets str_offsets;
+    struct dwarf_section_addr     addr;
+    struct dwarf_section_rnglists rnglists;
+    struct dwarf_section_ranges   ranges;
+    struct dwarf_section_loclists loclists;
     int                           address_size;
     struct dwarf_errinfo         *errinfo;
     dw_alloc_t                   *allocator;
@@ -453,6 +513,21 @@ DWAPI(void) dwarf_attr_iter_free(struct dwarf *dwarf, dwarf_attr_iter_t *iter);
 DWAPI(void) dwarf_line_program_iter_free(struct dwarf *dwarf, dwarf_line_program_iter_t *iter);
 DWAPI(void) dwarf_line_row_iter_free(struct dwarf *dwarf, dwarf_line_row_iter_t *iter);
 
+/* Look up the file or include directory referenced by a line program.
+ * Indices are 1-based before DWARF5 (with directory 0 being the implicit
+ * compilation directory) and 0-based since.
+ * Returns `NULL` if the index doesn't refer to an entry of the table.
+ */
+DWAPI(struct dwarf_fileinfo *) dwarf_line_program_file(struct dwarf_line_program *program, dw_u64_t index);
+DWAPI(struct dwarf_pathinfo *) dwarf_line_program_include_directory(struct dwarf_line_program *program, dw_u64_t index);
+
+/* Walk the address ranges of a `DW_AT_ranges` attribute of a DIE in `unit`.
+ * `base` is the base address of the unit (its `DW_AT_low_pc`, or 0).
+ * The ranges are read from `.debug_ranges` before DWARF5 and from `.debug_rnglists` since.
+ * Stops early if `range_cb` returns `DW_CB_DONE`.
+ */
+DWAPI(bool) dwarf_read_ranges(struct dwarf *dwarf, const dwarf_unit_t *unit, const dwarf_attr_t *attr, dw_u64_t base, dw_range_cb_t range_cb, void *data, struct dwarf_errinfo *errinfo) dw_nonnull(1, 2, 3, 5);
+
 DWAPI(bool) dwarf_aranges_at(struct dwarf *dwarf, dwarf_aranges_t *aranges, dw_u64_t off, struct dwarf_errinfo *errinfo);
 DWAPI(bool) dwarf_arange_at(struct dwarf *dwarf, dwarf_aranges_t *aranges, dwarf_arange_t *arange, dw_u64_t off, struct dwarf_errinfo *errinfo);
 DWAPI(bool) dwarf_unit_at(struct dwarf *dwarf, dwarf_unit_t *unit, dw_u64_t off, struct dwarf_errinfo *errinfo);
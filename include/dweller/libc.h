@@ -26,6 +26,7 @@ DWSTATIC(int) dw_unused
 dweller_libc_allocator_cb(dw_alloc_t *alloc, struct dwarf_alloc_req *req,
         void **pointer)
 {
+    (void)alloc;
     if (!pointer) return -1;
     if (req->req_bytesize == 0) {
         free(*pointer);
@@ -42,6 +43,7 @@ dweller_libc_allocator = &dweller_libc_allocator_cb;
 DWSTATIC(int) dw_unused
 dweller_libc_stdin_reader_cb(dw_writer_t *writer, void *data, size_t size)
 {
+    (void)writer;
     fread(data, sizeof(char), size, stdin);
     return 0;
 }
@@ -52,6 +54,7 @@ DWSTATIC(int)
 dweller_libc_stdout_writer_cb(dw_writer_t *writer, const void *data,
         size_t size)
 {
+    (void)writer;
     fwrite(data, sizeof(char), size, stdout);
     return 0;
 }
@@ -62,6 +65,7 @@ DWSTATIC(int)
 dweller_libc_stderr_writer_cb(dw_writer_t *writer, const void *data,
         size_t size)
 {
+    (void)writer;
     fwrite(data, sizeof(char), size, stderr);
     return 0;
 }
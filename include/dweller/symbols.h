@@ -54,6 +54,7 @@ enum dwarf_symbol_namespace {
     /* Introduced in DWARF5 */
     DW_UT,
     DW_LNCT,
+    DW_RLE,
 
     /* GNU Exception Handling */
     DW_EH  = 0x80,
@@ -552,6 +553,16 @@ enum dwarf_symbol_namespace {
     SYMBOL(size,            0x04) \
     SYMBOL(MD5,             0x05) \
 
+#define DW_RLE_SYMBOLS(SYMBOL) \
+    SYMBOL(end_of_list,     0x00) \
+    SYMBOL(base_addressx,   0x01) \
+    SYMBOL(startx_endx,     0x02) \
+    SYMBOL(startx_length,   0x03) \
+    SYMBOL(offset_pair,     0x04) \
+    SYMBOL(base_address,    0x05) \
+    SYMBOL(start_end,       0x06) \
+    SYMBOL(start_length,    0x07)
+
 /* DWARF1 only */
 #if 0
 #define DW_AT_RESERVED_04   0x04
@@ -691,6 +702,21 @@ enum dwarf_symbols_lnct {
 DW_LNCT_SYMBOLS(DW_DEFSYM)
 #undef DW_PREFIX
 };
+enum dwarf_symbols_rle {
+#define DW_PREFIX DW_RLE
+DW_RLE_SYMBOLS(DW_DEFSYM)
+#undef DW_PREFIX
+};
+enum dwarf_symbols_op {
+#define DW_PREFIX DW_OP
+DW_OP_SYMBOLS(DW_DEFSYM)
+#undef DW_PREFIX
+};
+enum dwarf_symbols_cfa {
+#define DW_PREFIX DW_CFA
+DW_CFA_SYMBOLS(DW_DEFSYM)
+#undef DW_PREFIX
+};
 #undef DW_DEFSYM
 
 #endif /* DWELLER_SYMBOLS_H */
@@ -10,12 +10,19 @@ typedef size_t wander_thread_id_t;
 
 typedef struct wander_handlers wander_handlers_t;
 typedef struct wander_resolver wander_resolver_t;
+typedef struct wander_query wander_query_t;
 
 typedef struct wander_backtrace wander_backtrace_t;
 typedef struct wander_frame wander_frame_t;
 typedef struct wander_source wander_source_t;
 typedef struct wander_symbol wander_symbol_t;
 typedef struct wander_resolution wander_resolution_t;
+typedef struct wander_location wander_location_t;
+typedef struct wander_batch wander_batch_t;
+typedef struct wander_snapshot wander_snapshot_t;
+typedef struct wander_crash wander_crash_t;
+typedef struct wander_stack_table wander_stack_table_t;
+typedef struct wander_symbolized_client wander_symbolized_client_t;
 
 /**
  * @{frames}    The return addresses of each frame.
@@ -74,7 +81,11 @@ struct wander_symbol {
  * @{object_base} The base object of the object file in memory.
  * @{source}  The source location that the address originates from, see `wander_source_t`.
  * @{symbol}  The symbol that the address is nearest to, see `wander_symbol_t`.
- * @{inlines} Additional source locations that have been inlined by the compiler.
+ * @{inlines} The functions that `source.function` was inlined into by the compiler, innermost first.
+ *            Each entry is the location of the call in that function.
+ *            For the `*_safe` functions these are taken from the pool of the query (or that of the calling thread,
+ *            for the functions that take the resolver itself), and stay valid until `wander_query_load` is called or
+ *            the pool is reused.
  * @{num_inlines} The number of inlined source locations.
  * @{free_fn} Function to call when destroying this resolution, or NULL.
  * @{free_inlines_fn} Function to call when destroying this resolution, or NULL.
@@ -90,6 +101,103 @@ struct wander_resolution {
     void           (*free_fn)(void *ptr);
     void           (*free_inlines_fn)(void *ptr);
 };
+/**
+ * The state of a thread that resolves addresses with a shared resolver, see `wander_query`.
+ * @{resolver}      The resolver, which is only read by the query once it has an index.
+ * @{locations}     The pool that the inlined calls of resolutions are taken from.
+ * @{num_locations} The number of locations handed out since the last `wander_query_load`.
+ * @{max_locations} The size of the pool.
+ * @{frames}        The backtrace loaded by `wander_query_load` without an index, and the debug information of its frames.
+ *                  NULL to use those of the calling thread.
+ * @{free_fn}       Function to call on `locations` and `frames` when destroying this query, or NULL.
+ */
+struct wander_query {
+    wander_resolver_t          *resolver;
+    wander_source_t            *locations;
+    size_t                      num_locations;
+    size_t                      max_locations;
+    struct wander_query_frames *frames;
+    void                      (*free_fn)(void *ptr);
+};
+/**
+ * A location resolved by `wander_resolve_batch`.
+ * Strings are stored as an index into `wander_batch_t::strings`, 0 means NULL.
+ * @{address}     The address that was resolved.
+ * @{object_base} The base address of the object file in memory.
+ * @{symbol_addr} The base address of the symbol, or 0 if not found.
+ * @{object}      The object file that the address originates from.
+ * @{symbol}      The symbol that the address is nearest to.
+ * @{function}    The name of the function.
+ * @{filename}    The name of the source file.
+ * @{directory}   The name of the source directory.
+ * @{lineno}      The line number (1-based), or 0.
+ * @{column}      The column number (1-based), or 0.
+ */
+struct wander_location {
+    uintptr_t address;
+    size_t    object_base;
+    uintptr_t symbol_addr;
+    uint32_t  object;
+    uint32_t  symbol;
+    uint32_t  function;
+    uint32_t  filename;
+    uint32_t  directory;
+    size_t    lineno;
+    size_t    column;
+};
+/**
+ * @{num_addresses} The number of addresses that were resolved.
+ * @{ids}           The index in `locations` for each address.
+ * @{num_locations} The number of distinct addresses.
+ * @{locations}     The location of each distinct address, sorted by address.
+ * @{num_strings}   The number of strings, including the NULL string.
+ * @{strings}       The strings that are referred to by `locations`, `strings[0]` is NULL.
+ */
+struct wander_batch {
+    size_t             num_addresses;
+    uint32_t          *ids;
+    size_t             num_locations;
+    wander_location_t *locations;
+    size_t             num_strings;
+    const char       **strings;
+};
+
+/**
+ * The backtraces of every thread in the process, taken by `wander_snapshot`.
+ * @{num_threads} The number of threads that were captured.
+ * @{backtraces}  The backtrace of each thread, `thread_id` tells which thread it is.
+ * @{num_missed}  The number of threads that did not respond in time.
+ * @{frames}      Storage for the frames of all backtraces.
+ */
+struct wander_snapshot {
+    size_t              num_threads;
+    wander_backtrace_t *backtraces;
+    size_t              num_missed;
+    void              **frames;
+};
+/**
+ * A crash record, written by `wander_handle_sigaction` after `wander_set_crash_fd` and read back by `wander_read_crash`.
+ * @{signo}         The signal that was caught.
+ * @{code}          The `si_code` of the signal, or 0.
+ * @{fault_address} The `si_addr` of the signal, or 0.
+ * @{pc}            The address of the interrupted instruction, or 0.
+ * @{thread_id}     The id of the thread that crashed.
+ * @{num_frames}    The number of frames.
+ * @{frames}        The return address of each frame in the crashed process, most recent first.
+ * @{addrs}         The same addresses in the object files that were added to the resolver,
+ *                  for `wander_resolve_batch`, or 0 if the object file was not found.
+ *                  Except for the first one, they are moved back by 1 from the return address into the call.
+ */
+struct wander_crash {
+    int                signo;
+    int                code;
+    uintptr_t          fault_address;
+    uintptr_t          pc;
+    wander_thread_id_t thread_id;
+    size_t             num_frames;
+    uintptr_t         *frames;
+    uintptr_t         *addrs;
+};
 
 WANDER_API(int)                  wander_init(void);
 WANDER_API(void)                 wander_fini(void);
@@ -98,6 +206,7 @@ WANDER_API(void)                 wander_handle_signal(int signo); /* AS-safe */
 WANDER_API(void)                 wander_handle_sigaction(int signo, void /* siginfo_t */ *info, void *ucontext); /* AS-safe */
 WANDER_API(wander_handlers_t*)   wander_install_handlers(const int signals[]);
 WANDER_API(void)                 wander_uninstall_handlers(wander_handlers_t *handlers);
+WANDER_API(int)                  wander_set_crash_fd(int fd);
 
 WANDER_API(int)                  wander_print_backtrace(void); /* AS-safe */
 
@@ -110,21 +219,56 @@ WANDER_API(wander_backtrace_t*)  wander_backtrace_rebase(wander_backtrace_t *bac
 WANDER_API(wander_backtrace_t*)  wander_backtrace_skip(wander_backtrace_t *backtrace, size_t n); /* AS-safe */
 WANDER_API(void)                 wander_backtrace_free(wander_backtrace_t *backtrace); /* AS-safe (if `backtrace->free_fn` is AS-safe) */
 
+WANDER_API(int)                  wander_snapshot(wander_snapshot_t *snapshot, size_t max_threads, size_t max_depth, unsigned timeout_ms);
+WANDER_API(void)                 wander_snapshot_free(wander_snapshot_t *snapshot);
+
+WANDER_API(wander_stack_table_t*) wander_stack_table_create(size_t max_stacks);
+WANDER_API(size_t)               wander_stack_table_intern(wander_stack_table_t *table, wander_backtrace_t *backtrace, size_t *count); /* AS-safe */
+WANDER_API(size_t)               wander_stack_table_count(wander_stack_table_t *table, size_t id); /* AS-safe */
+WANDER_API(void)                 wander_stack_table_free(wander_stack_table_t **table);
+
 WANDER_API(size_t)               wander_backtrace_depth(wander_backtrace_t *backtrace); /* AS-safe */
 WANDER_API(wander_thread_id_t)   wander_backtrace_thread_id(wander_backtrace_t *backtrace); /* AS-safe */
+WANDER_API(uint64_t)             wander_backtrace_fingerprint(wander_backtrace_t *backtrace); /* AS-safe */
 WANDER_API(wander_frame_t)       wander_backtrace_frame(wander_backtrace_t *backtrace, size_t frame_idx); /* AS-safe */
 
+WANDER_API(int)                  wander_add_debug_directory(const char *path);
+
 WANDER_API(wander_resolver_t*)   wander_resolver_create(size_t max_depth, size_t max_locations);
+WANDER_API(wander_resolver_t*)   wander_resolver_create_async(size_t max_depth, size_t max_locations);
+WANDER_API(wander_resolver_t*)   wander_resolver_create_client(size_t max_depth, size_t max_locations, const char *socket_path);
+WANDER_API(wander_resolver_t*)   wander_resolver_create_detached(size_t max_depth, size_t max_locations);
+WANDER_API(int)                  wander_resolver_add_file(wander_resolver_t *resolver, const char *path, const char *build_id, uintptr_t *base);
+WANDER_API(int)                  wander_resolver_ready(wander_resolver_t *resolver); /* AS-safe */
+WANDER_API(int)                  wander_resolver_refresh(wander_resolver_t *resolver);
 WANDER_API(int)                  wander_resolver_load(wander_resolver_t *resolver, wander_backtrace_t *backtrace); /* AS-safe */
 WANDER_API(void)                 wander_resolver_free(wander_resolver_t **resolver);
 
 WANDER_API(wander_resolution_t*) wander_resolve_addr(wander_resolver_t *resolver, uintptr_t addr);
 WANDER_API(wander_resolution_t*) wander_resolve_addr_safe(wander_resolver_t *resolver, uintptr_t addr, wander_resolution_t *resolution); /* AS-safe */
 
+WANDER_API(int)                  wander_resolve_batch(wander_resolver_t *resolver, const uintptr_t addrs[], size_t num_addrs, wander_batch_t *batch);
+WANDER_API(void)                 wander_batch_free(wander_batch_t *batch);
+WANDER_API(int)                  wander_resolve_snapshot(wander_resolver_t *resolver, wander_snapshot_t *snapshot, wander_batch_t *batch);
+WANDER_API(int)                  wander_symbolized_socket_path(char *path, size_t size, int create);
+WANDER_API(wander_symbolized_client_t*) wander_symbolized_accept(int listen_fd);
+WANDER_API(int)                  wander_symbolized_client_fd(wander_symbolized_client_t *client);
+WANDER_API(int)                  wander_symbolized_serve(wander_resolver_t *resolver, wander_symbolized_client_t *client);
+WANDER_API(void)                 wander_symbolized_close(wander_symbolized_client_t **client);
+WANDER_API(int)                  wander_read_crash(wander_resolver_t *resolver, int fd, const char *sysroot, wander_crash_t *crash);
+WANDER_API(void)                 wander_crash_free(wander_crash_t *crash);
+
 WANDER_API(wander_resolution_t*) wander_resolve_frame(wander_resolver_t *resolver, wander_frame_t frame);
 WANDER_API(wander_resolution_t*) wander_resolve_frame_safe(wander_resolver_t *resolver, wander_frame_t frame, wander_resolution_t *resolution); /* AS-safe */
 WANDER_API(void)                 wander_destroy_resolution(wander_resolution_t **resolution); /* AS-safe (If `resolution->free_fn` is AS-safe) */
 
+WANDER_API(wander_query_t)       wander_query(wander_resolver_t *resolver, size_t max_locations);
+WANDER_API(wander_query_t)       wander_query_safe(wander_resolver_t *resolver, wander_source_t locations[], size_t max_locations); /* AS-safe */
+WANDER_API(int)                  wander_query_load(wander_query_t *query, wander_backtrace_t *backtrace); /* AS-safe */
+WANDER_API(void)                 wander_query_free(wander_query_t *query); /* AS-safe (if `query->free_fn` is AS-safe) */
+WANDER_API(wander_resolution_t*) wander_query_resolve_addr_safe(wander_query_t *query, uintptr_t addr, wander_resolution_t *resolution); /* AS-safe */
+WANDER_API(wander_resolution_t*) wander_query_resolve_frame_safe(wander_query_t *query, wander_frame_t frame, wander_resolution_t *resolution); /* AS-safe */
+
 #ifndef WANDER_NO_MACROS
 # define wander_frame(resolution)       ((resolution)->frame) /* AS-safe */
 # define wander_object(resolution)      ((resolution)->object) /* AS-safe */
@@ -0,0 +1,16 @@
+#ifndef LIBWANDER_WANDER_PROFILER_H
+#define LIBWANDER_WANDER_PROFILER_H
+
+#include <libwander/wander.h>
+#include <libwander/wander_printer.h>
+
+typedef struct wander_profiler wander_profiler_t;
+
+WANDER_API(wander_profiler_t*) wander_profiler_start(unsigned frequency);
+WANDER_API(int)                wander_profiler_add_thread(wander_profiler_t *profiler);
+WANDER_API(void)               wander_profiler_remove_thread(wander_profiler_t *profiler);
+WANDER_API(void)               wander_profiler_stop(wander_profiler_t *profiler);
+WANDER_API(int)                wander_profiler_write_folded(wander_profiler_t *profiler, wander_resolver_t *resolver, wander_writer_t *writer);
+WANDER_API(void)               wander_profiler_free(wander_profiler_t **profiler);
+
+#endif /* !defined(LIBWANDER_WANDER_PROFILER_H) */
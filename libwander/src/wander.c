@@ -4,6 +4,8 @@
 
 #include "wander_internal.h"
 #include "wander_platform.h"
+#include "wander_crash.h"
+#include "wander_debugfile.h"
 
 #include <stdint.h>
 #include <stdlib.h> /* malloc, free */
@@ -22,7 +24,12 @@ static void wander_sigaction_handler(int signo, siginfo_t *info, void *ucontext)
 WANDER_FUN(int) wander_init(void)
 {
     int res = wander_platform_init(&wander_global.platform);
+    wander_printer_init();
+#if WANDER_CONFIG_RESOLVER_WARMUP
+    wander_global.resolver = wander_resolver_create_async(WANDER_CONFIG_MAX_STACK_DEPTH, WANDER_CONFIG_MAX_SOURCE_LOCATIONS);
+#else
     wander_global.resolver = wander_resolver_create(WANDER_CONFIG_MAX_STACK_DEPTH, WANDER_CONFIG_MAX_SOURCE_LOCATIONS);
+#endif
     wander_platform_init_root_frame(&wander_global.platform);
     return res;
 }
@@ -30,74 +37,100 @@ WANDER_FUN(void) wander_fini(void)
 {
     wander_platform_fini(&wander_global.platform);
     wander_resolver_free(&wander_global.resolver);
-    wander_uninstall_handlers(wander_global.signal_handlers);
+    if (wander_global.signal_handlers != NULL) {
+        wander_uninstall_handlers(wander_global.signal_handlers);
+    }
+    wander_debugfile_fini();
 }
 
 /**
+ * Returns the address of the instruction a signal interrupted, or NULL if unknown.
  * This function is AS-safe.
  */
-WANDER_FUN(void) wander_handle_signal(int signo)
-{
-    wander_handle_sigaction(signo, NULL, NULL);
-}
-/**
- * This function is AS-safe.
- */
-WANDER_FUN(void) wander_handle_sigaction(int signo, void *info, void *ucontext)
+WANDER_FUN(void *) wander_ucontext_pc(void *ucontext)
 {
-    void *buffer[WANDER_CONFIG_MAX_STACK_DEPTH];
-    void *error_addr = NULL;
-
+    void *pc = NULL;
 #if defined(__unix__)
     ucontext_t *uctx = (ucontext_t *)(ucontext);
 
     if (uctx) {
 #if defined(REG_RIP) /* x86_64 */
-        error_addr = (void *)(uctx->uc_mcontext.gregs[REG_RIP]);
+        pc = (void *)(uctx->uc_mcontext.gregs[REG_RIP]);
 #elif defined(REG_EIP) /* x86_32 */
-        error_addr = (void *)(uctx->uc_mcontext.gregs[REG_EIP]);
+        pc = (void *)(uctx->uc_mcontext.gregs[REG_EIP]);
 #elif defined(__arm__)
-        error_addr = (void *)(uctx->uc_mcontext.arm_pc);
+        pc = (void *)(uctx->uc_mcontext.arm_pc);
 #elif defined(__aarch64__)
-        error_addr = (void *)(uctx->uc_mcontext.pc);
+        pc = (void *)(uctx->uc_mcontext.pc);
 #elif defined(__mips__)
-        error_addr = (void *)((struct sigcontext *)(&uctx->uc_mcontext)->sc_pc);
+        pc = (void *)((struct sigcontext *)(&uctx->uc_mcontext)->sc_pc);
 #elif defined(__ppc__) || defined(__powerpc) || defined(__powerpc__) || defined(__POWERPC__)
-        error_addr = (void *)(uctx->uc_mcontext.regs->nip);
+        pc = (void *)(uctx->uc_mcontext.regs->nip);
 #elif defined(__s390x__)
-        error_addr = (void *)(uctx->uc_mcontext.psw.addr);
+        pc = (void *)(uctx->uc_mcontext.psw.addr);
 #elif defined(__APPLE__) && defined(__x86_64__)
-        error_addr = (void *)(uctx->uc_mcontext->__ss.__rip);
+        pc = (void *)(uctx->uc_mcontext->__ss.__rip);
 #elif defined(__APPLE__)
-        error_addr = (void *)(uctx->uc_mcontext->__ss.__eip);
+        pc = (void *)(uctx->uc_mcontext->__ss.__eip);
 #else
-        error_addr = NULL;
+        pc = NULL;
 #endif
     }
 #endif
-    wander_backtrace_t backtrace = wander_backtrace_safe(buffer, WANDER_CONFIG_MAX_STACK_DEPTH);
-#if 1
-    /* Skip all the signal frames */
-    if (wander_backtrace_rebase(&backtrace, error_addr) != NULL) goto print_backtrace;
+    return pc;
+}
+/**
+ * Discard the frames of the signal handler that `backtrace` was taken in,
+ * `pc` is the address of the interrupted instruction (see `wander_ucontext_pc`), or NULL.
+ * This function is AS-safe.
+ */
+WANDER_FUN(void) wander_skip_signal_frames(wander_backtrace_t *backtrace, void *pc)
+{
+    if (pc != NULL && wander_backtrace_rebase(backtrace, pc) != NULL) return;
     /* We didn't find the origin frame of the signal,
      * try to find a __restore or __restore_rt stack frame instead.
      */
-    if (wander_backtrace_rebase(&backtrace, wander_global.platform.sym_restore) != NULL) {
-        wander_backtrace_skip(&backtrace, 1);
-        goto print_backtrace;
+    if (wander_backtrace_rebase(backtrace, wander_global.platform.sym_restore) != NULL) {
+        wander_backtrace_skip(backtrace, 1);
+        return;
     }
-    if (wander_backtrace_rebase(&backtrace, wander_global.platform.sym_restore_rt) != NULL) {
-        wander_backtrace_skip(&backtrace, 1);
-        goto print_backtrace;
+    if (wander_backtrace_rebase(backtrace, wander_global.platform.sym_restore_rt) != NULL) {
+        wander_backtrace_skip(backtrace, 1);
+        return;
     }
+}
+/**
+ * This function is AS-safe.
+ */
+WANDER_FUN(void) wander_handle_signal(int signo)
+{
+    wander_handle_sigaction(signo, NULL, NULL);
+}
+/**
+ * This function is AS-safe.
+ */
+WANDER_FUN(void) wander_handle_sigaction(int signo, void *info, void *ucontext)
+{
+    void *buffer[WANDER_CONFIG_MAX_STACK_DEPTH];
+    void *error_addr = NULL;
+
+#if defined(__unix__)
+    error_addr = wander_ucontext_pc(ucontext);
 #endif
-print_backtrace:
+    wander_backtrace_t backtrace = wander_backtrace_safe(buffer, WANDER_CONFIG_MAX_STACK_DEPTH);
+    wander_skip_signal_frames(&backtrace, error_addr);
+    if (wander_crash_write(signo, info, ucontext, &backtrace) == 0) {
+        /* Symbolized later, from the crash record */
+        wander_backtrace_free(&backtrace);
+        return;
+    }
     wander_print(&wander_default_safe_printer, &backtrace);
 #if defined(__unix__)
     if (info) {
 #if _XOPEN_SOURCE >= 700 || _POSIX_C_SOURCE >= 200809L
         psiginfo(info, NULL); // FIXME: Uses printf, not AS-safe.
 #elif defined(REG_ERR)
+        ucontext_t *uctx = (ucontext_t *)(ucontext);
         siginfo_t *siginfo = info;
         if (signo == SIGSEGV || signo == SIGBUS) {
             error_addr = siginfo->si_addr;
@@ -376,6 +409,26 @@ WANDER_FUN(wander_thread_id_t) wander_backtrace_thread_id(wander_backtrace_t *ba
 {
     return backtrace->thread_id;
 }
+/**
+ * A 64-bit hash of the return addresses of the backtrace, starting at `backtrace->offset`.
+ * Backtraces of the same stack have the same fingerprint, see `wander_stack_table_intern`. It is never 0.
+ * This function is AS-safe.
+ */
+WANDER_FUN(uint64_t) wander_backtrace_fingerprint(wander_backtrace_t *backtrace)
+{
+    uint64_t hash = backtrace->depth - backtrace->offset;
+    for (size_t i=backtrace->offset; i < backtrace->depth; i++) {
+        hash = (hash ^ (uintptr_t)backtrace->frames[i]) * 0x9e3779b97f4a7c15ull;
+        hash ^= hash >> 29;
+    }
+    /* The finalizer of splitmix64, so every bit of the addresses reaches the low bits */
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ull;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebull;
+    hash ^= hash >> 31;
+    return hash != 0 ? hash : 1;
+}
 /**
  * This function is AS-safe.
  */
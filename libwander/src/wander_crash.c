@@ -0,0 +1,312 @@
+#include <libwander/wander.h>
+
+#include "wander_internal.h"
+#include "wander_crash.h"
+#include "wander_debugfile.h"
+
+#if defined(__linux__)
+# include <errno.h>
+# include <link.h> /* ElfW, struct dl_phdr_info */
+# include <sched.h> /* sched_yield */
+# include <unistd.h>
+#endif
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h> /* malloc, free */
+#include <string.h> /* memcpy */
+
+#if defined(__linux__)
+/* The record is built in `buffer` and written at once, so a crashing process does not have to allocate.
+ * Threads that crash at the same time take turns, a thread that crashes while it writes gives up.
+ */
+static struct {
+    atomic_int    fd;
+    char         *buffer;
+    atomic_size_t owner; /* The thread writing into `buffer`, or 0 */
+} crash_global = { -1, NULL, 0 };
+
+struct crash_writer {
+    char         *data;
+    size_t        used;
+    uint32_t      num_modules;
+    /* The module written last is only kept once an executable mapping of its file shows that the loader mapped it */
+    bool          pending;
+    size_t        pending_used; /* `used` before the pending module */
+    unsigned long pending_dev_major;
+    unsigned long pending_dev_minor;
+    unsigned long pending_inode;
+};
+static bool crash_put(struct crash_writer *writer, const void *data, size_t size)
+{
+    if (WANDER_CONFIG_CRASH_RECORD_SIZE - writer->used < size) return false;
+    memcpy(writer->data + writer->used, data, size);
+    writer->used += size;
+    return true;
+}
+static bool crash_same_file(const struct crash_writer *writer, const struct wander_mapping *mapping)
+{
+    return mapping->inode == writer->pending_inode && mapping->dev_major == writer->pending_dev_major && mapping->dev_minor == writer->pending_dev_minor;
+}
+/* Adds the ELF image whose headers are in `mapping`, without trusting it to be one.
+ * Files that are only mapped to be read (like the object and debug files the resolver maps) are not modules,
+ * so an image is only kept if its file also has an executable mapping, which follows the headers in /proc/self/maps.
+ */
+static bool crash_add_module(void *ud, const struct wander_mapping *mapping)
+{
+    struct crash_writer *writer = ud;
+    if (writer->pending) {
+        if (crash_same_file(writer, mapping)) {
+            if (mapping->perms[2] != 'x') return false;
+            writer->num_modules++;
+            writer->pending = false;
+            return false;
+        }
+        writer->used = writer->pending_used;
+        writer->pending = false;
+    }
+    if (mapping->perms[0] != 'r' || mapping->perms[3] != 'p' || mapping->offset != 0 || mapping->path_size == 0 || mapping->path[0] != '/') return false;
+    const ElfW(Ehdr) *ehdr = (const ElfW(Ehdr) *)mapping->begin;
+    size_t size = mapping->end - mapping->begin;
+    if (size < sizeof(ElfW(Ehdr)) || memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0) return false;
+    if (ehdr->e_phentsize != sizeof(ElfW(Phdr)) || ehdr->e_phoff > size || (size - ehdr->e_phoff) / sizeof(ElfW(Phdr)) < ehdr->e_phnum) return false;
+    const ElfW(Phdr) *phdrs = (const ElfW(Phdr) *)(mapping->begin + ehdr->e_phoff);
+    struct crash_module module = { UINT64_MAX, 0, 0, 0, mapping->path_size };
+    bool has_base = false, notes_mapped = true;
+    for (size_t i=0; i < ehdr->e_phnum; i++) {
+        if (phdrs[i].p_type == PT_LOAD && !has_base) {
+            /* `begin` is where the start of the file is mapped */
+            module.base = mapping->begin - (phdrs[i].p_vaddr - phdrs[i].p_offset);
+            has_base = true;
+        }
+    }
+    if (!has_base) return false;
+    for (size_t i=0; i < ehdr->e_phnum; i++) {
+        uint64_t begin = module.base + phdrs[i].p_vaddr, end = begin + phdrs[i].p_memsz;
+        if (phdrs[i].p_type == PT_LOAD) {
+            if (begin < module.begin) module.begin = begin;
+            if (end > module.end) module.end = end;
+        }
+        /* The notes are read in place, they must be in the mapping we know is readable */
+        if (phdrs[i].p_type == PT_NOTE && (begin < mapping->begin || end > mapping->end)) notes_mapped = false;
+    }
+    char build_id[WANDER_BUILD_ID_SIZE] = "";
+    if (notes_mapped) {
+        struct dl_phdr_info info;
+        memset(&info, 0x00, sizeof(info));
+        info.dlpi_addr = module.base;
+        info.dlpi_phdr = phdrs;
+        info.dlpi_phnum = ehdr->e_phnum;
+        module.build_id_size = wander_debugfile_build_id(&info, build_id, sizeof(build_id));
+    }
+    size_t used = writer->used;
+    if (!crash_put(writer, &module, sizeof(module)) || !crash_put(writer, build_id, module.build_id_size) || !crash_put(writer, mapping->path, mapping->path_size)) {
+        writer->used = used; /* Out of space, the table ends here */
+        return true;
+    }
+    if (mapping->perms[2] == 'x') {
+        writer->num_modules++;
+    } else {
+        writer->pending = true;
+        writer->pending_used = used;
+        writer->pending_dev_major = mapping->dev_major;
+        writer->pending_dev_minor = mapping->dev_minor;
+        writer->pending_inode = mapping->inode;
+    }
+    return false;
+}
+static bool crash_write_all(int fd, const void *data, size_t size)
+{
+    const char *ptr = data;
+    while (size > 0) {
+        ssize_t n = write(fd, ptr, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        ptr += n;
+        size -= n;
+    }
+    return true;
+}
+/* Returns 1 if all of `data` was read, 0 if the file ended before any of it, and -1 otherwise */
+static int crash_read_all(int fd, void *data, size_t size)
+{
+    char *ptr = data;
+    size_t total = size;
+    while (size > 0) {
+        ssize_t n = read(fd, ptr, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n == 0 && size == total) return 0;
+        if (n <= 0) return -1;
+        ptr += n;
+        size -= n;
+    }
+    return 1;
+}
+#endif
+
+/**
+ * Write a crash record to `fd` from `wander_handle_sigaction`, instead of symbolizing and printing the backtrace.
+ * The record only has the raw frames, the thread id, the signal and the object files that were loaded,
+ * it is read back by `wander_read_crash`, for example in `dweller-crash` on another host.
+ * The memory for the record is allocated here, pass -1 to print backtraces again.
+ * Returns 0 on success, and -1 on failure or if this is not supported on the platform.
+ */
+WANDER_FUN(int) wander_set_crash_fd(int fd)
+{
+#if defined(__linux__)
+    if (fd >= 0 && crash_global.buffer == NULL) {
+        /* Never freed, a handler might be using it */
+        crash_global.buffer = malloc(WANDER_CONFIG_CRASH_RECORD_SIZE);
+        if (crash_global.buffer == NULL) return -1;
+    }
+    atomic_store(&crash_global.fd, fd < 0 ? -1 : fd);
+    return 0;
+#else
+    return -1;
+#endif
+}
+/**
+ * Write a crash record for `backtrace` if `wander_set_crash_fd` was called.
+ * Returns 0 if the record was written, and -1 if the backtrace should be printed instead.
+ * This function is AS-safe.
+ */
+WANDER_FUN(int) wander_crash_write(int signo, void *info, void *ucontext, wander_backtrace_t *backtrace)
+{
+#if defined(__linux__)
+    int fd = atomic_load(&crash_global.fd);
+    if (fd < 0) return -1;
+    size_t self = wander_platform_thread_id(&wander_global.platform), expected = 0;
+    while (!atomic_compare_exchange_weak(&crash_global.owner, &expected, self)) {
+        if (expected == self) return -1; /* We crashed while writing the record */
+        expected = 0;
+        sched_yield();
+    }
+    int saved_errno = errno;
+
+    struct crash_header header;
+    memset(&header, 0x00, sizeof(header));
+    header.magic = CRASH_MAGIC;
+    header.version = CRASH_VERSION;
+    header.signo = signo;
+    if (info != NULL) {
+        siginfo_t *siginfo = info;
+        header.code = siginfo->si_code;
+        header.fault_address = (uintptr_t)siginfo->si_addr;
+    }
+    header.pc = (uintptr_t)wander_ucontext_pc(ucontext);
+    header.thread_id = self;
+    struct crash_writer writer;
+    memset(&writer, 0x00, sizeof(writer));
+    writer.data = crash_global.buffer;
+    writer.used = sizeof(header);
+    for (size_t i=backtrace->offset; i < backtrace->depth; i++) {
+        uint64_t frame = (uintptr_t)backtrace->frames[i];
+        if (!crash_put(&writer, &frame, sizeof(frame))) break;
+        header.num_frames++;
+    }
+    wander_platform_maps(crash_add_module, &writer);
+    if (writer.pending) writer.used = writer.pending_used;
+    header.num_modules = writer.num_modules;
+    header.size = writer.used - sizeof(header);
+    memcpy(writer.data, &header, sizeof(header));
+    bool ok = crash_write_all(fd, writer.data, writer.used);
+
+    errno = saved_errno;
+    atomic_store(&crash_global.owner, 0);
+    return ok ? 0 : -1;
+#else
+    return -1;
+#endif
+}
+
+/**
+ * Read the next crash record from `fd`, and add the object files in its module table to a resolver
+ * created with `wander_resolver_create_detached`, so `crash->addrs` can be resolved with `wander_resolve_batch`.
+ * The paths of the object files are prefixed with `sysroot`, unless it is NULL.
+ * Object files are identified by their build-id, so the resolver only indexes them once for all records.
+ * Returns 1 if a record was read, 0 at the end of the file, and -1 if the file is not a crash record or can not be read.
+ */
+WANDER_FUN(int) wander_read_crash(wander_resolver_t *resolver, int fd, const char *sysroot, wander_crash_t *crash)
+{
+    memset(crash, 0x00, sizeof(wander_crash_t));
+#if defined(__linux__)
+    struct crash_header header;
+    int res = crash_read_all(fd, &header, sizeof(header));
+    if (res <= 0) return res;
+    if (header.magic != CRASH_MAGIC || header.version != CRASH_VERSION || header.size > CRASH_MAX_SIZE) return -1;
+    if ((uint64_t)header.num_frames * sizeof(uint64_t) > header.size) return -1;
+
+    res = -1;
+    struct crash_module *modules = malloc(((size_t)header.num_modules + 1) * sizeof(struct crash_module));
+    uintptr_t *bases = malloc(((size_t)header.num_modules + 1) * sizeof(uintptr_t));
+    char *payload = malloc(header.size + 1);
+    crash->frames = malloc(((size_t)header.num_frames + 1) * sizeof(uintptr_t));
+    crash->addrs = malloc(((size_t)header.num_frames + 1) * sizeof(uintptr_t));
+    if (modules == NULL || bases == NULL || payload == NULL || crash->frames == NULL || crash->addrs == NULL) goto done;
+    if (crash_read_all(fd, payload, header.size) != 1) goto done;
+
+    size_t sysroot_size = sysroot != NULL ? strlen(sysroot) : 0;
+    char *ptr = payload + header.num_frames * sizeof(uint64_t), *end = payload + header.size;
+    for (size_t i=0; i < header.num_modules; i++) {
+        struct crash_module *module = &modules[i];
+        if ((size_t)(end - ptr) < sizeof(struct crash_module)) goto done;
+        memcpy(module, ptr, sizeof(struct crash_module));
+        ptr += sizeof(struct crash_module);
+        if ((size_t)(end - ptr) < (size_t)module->build_id_size + module->path_size || module->build_id_size >= WANDER_BUILD_ID_SIZE) goto done;
+        char build_id[WANDER_BUILD_ID_SIZE];
+        memcpy(build_id, ptr, module->build_id_size);
+        build_id[module->build_id_size] = '\0';
+        ptr += module->build_id_size;
+        char *path = malloc(sysroot_size + module->path_size + 1);
+        if (path == NULL) goto done;
+        if (sysroot != NULL) memcpy(path, sysroot, sysroot_size);
+        memcpy(path + sysroot_size, ptr, module->path_size);
+        path[sysroot_size + module->path_size] = '\0';
+        ptr += module->path_size;
+        if (wander_resolver_add_file(resolver, path, build_id, &bases[i]) != 0) bases[i] = 0;
+        free(path);
+    }
+    if (ptr != end) goto done;
+
+    for (size_t i=0; i < header.num_frames; i++) {
+        uint64_t frame;
+        memcpy(&frame, payload + i * sizeof(uint64_t), sizeof(frame));
+        crash->frames[i] = frame;
+        crash->addrs[i] = 0;
+        /* Only the first frame is the crashing instruction, the others are return addresses,
+         * which point past the call and might already belong to the next line or function
+         */
+        uint64_t addr = i > 0 && frame != 0 ? frame - 1 : frame;
+        for (size_t k=0; k < header.num_modules; k++) {
+            if (addr < modules[k].begin || addr >= modules[k].end) continue;
+            if (bases[k] != 0) crash->addrs[i] = bases[k] + (addr - modules[k].base);
+            break;
+        }
+    }
+    crash->signo = header.signo;
+    crash->code = header.code;
+    crash->fault_address = header.fault_address;
+    crash->pc = header.pc;
+    crash->thread_id = header.thread_id;
+    crash->num_frames = header.num_frames;
+    res = 1;
+
+done:
+    if (res != 1) wander_crash_free(crash);
+    free(payload);
+    free(bases);
+    free(modules);
+    return res;
+#else
+    return -1;
+#endif
+}
+/**
+ * Release the memory used by a crash record.
+ */
+WANDER_FUN(void) wander_crash_free(wander_crash_t *crash)
+{
+    free(crash->frames);
+    free(crash->addrs);
+    memset(crash, 0x00, sizeof(wander_crash_t));
+}
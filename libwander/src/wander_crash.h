@@ -0,0 +1,43 @@
+#ifndef WANDER_CRASH_H
+#define WANDER_CRASH_H
+
+#include <libwander/wander.h>
+
+#include <stdint.h>
+
+/* The crash records written by `wander_handle_sigaction` after `wander_set_crash_fd`.
+ * They are read on a host with the same byte order, everything is in native byte order.
+ *
+ * A record is a header followed by `num_frames` return addresses (each a `uint64_t`, most recent first)
+ * and `num_modules` modules (each a `struct crash_module`, its build-id and its path, without terminators).
+ * The modules are the ELF images that were mapped at the time of the crash, the module table is cut short
+ * if it does not fit `WANDER_CONFIG_CRASH_RECORD_SIZE`. Records can be appended to the same file.
+ * `size` is the number of bytes after the header.
+ */
+#define CRASH_MAGIC    0x68737243u /* "Crsh" */
+#define CRASH_VERSION  1
+#define CRASH_MAX_SIZE (64u << 20)
+
+struct crash_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t size;
+    int32_t  signo;
+    int32_t  code;
+    uint64_t fault_address;
+    uint64_t pc;
+    uint64_t thread_id;
+    uint32_t num_frames;
+    uint32_t num_modules;
+};
+struct crash_module {
+    uint64_t begin; /* The address range of its loadable segments */
+    uint64_t end;
+    uint64_t base;  /* The load address that its virtual addresses are relative to */
+    uint32_t build_id_size;
+    uint32_t path_size;
+};
+
+WANDER_INTERNAL(int) wander_crash_write(int signo, void *info, void *ucontext, wander_backtrace_t *backtrace); /* AS-safe */
+
+#endif /* !defined(WANDER_CRASH_H) */
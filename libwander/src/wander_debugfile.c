@@ -0,0 +1,321 @@
+#include <libwander/wander.h>
+
+#include "wander_debugfile.h"
+
+#if defined(__unix__)
+# include <elf.h>
+# include <fcntl.h> /* O_* */
+# include <limits.h> /* PATH_MAX */
+# include <pthread.h>
+# include <sys/mman.h> /* mmap */
+# include <sys/stat.h> /* struct stat */
+# include <unistd.h> /* pread */
+#endif
+
+#include <stdbool.h>
+#include <stdio.h> /* snprintf */
+#include <stdlib.h> /* malloc, free */
+#include <string.h> /* memcpy */
+
+/* Separate debug files are looked up the same way GDB does:
+ * first by build-id in the `.build-id` tree of each debug directory, then by the name in `.gnu_debuglink`
+ * next to the object, in its `.debug` subdirectory and mirrored under each debug directory.
+ * Every object is only searched for once, the outcome (including "there is none") is remembered by build-id
+ * or by path, so objects that are unloaded and loaded again, or seen by another resolver, cost a single `open`.
+ */
+
+#define DEBUGFILE_GLOBAL_DIR "/usr/lib/debug"
+
+struct debugfile_entry {
+    uint64_t hash;
+    char    *key; /* Hexadecimal build-id, or the path of the object if it has none */
+    char    *path; /* The debug file, or NULL if the object has to do */
+};
+
+static struct {
+#if defined(__unix__)
+    pthread_mutex_t         lock;
+#endif
+    size_t                  num_dirs;
+    char                  **dirs; /* Added by `wander_add_debug_directory` */
+    size_t                  num_entries;
+    size_t                  max_entries;
+    struct debugfile_entry *entries;
+} debugfiles = {
+#if defined(__unix__)
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+#endif
+};
+
+static uint64_t debugfile_hash(const char *key)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (; *key != '\0'; key++) hash = (hash ^ (unsigned char)*key) * 0x100000001b3ull;
+    return hash;
+}
+static struct debugfile_entry *debugfile_find(const char *key)
+{
+    uint64_t hash = debugfile_hash(key);
+    for (size_t i=0; i < debugfiles.num_entries; i++) {
+        struct debugfile_entry *entry = &debugfiles.entries[i];
+        if (entry->hash == hash && strcmp(entry->key, key) == 0) return entry;
+    }
+    return NULL;
+}
+static void debugfile_remember(const char *key, const char *path)
+{
+    if (debugfiles.num_entries + 1 > debugfiles.max_entries) {
+        size_t max_entries = debugfiles.max_entries == 0 ? 32 : debugfiles.max_entries * 2;
+        struct debugfile_entry *entries = realloc(debugfiles.entries, max_entries * sizeof(struct debugfile_entry));
+        if (entries == NULL) return; /* We will just search again next time */
+        debugfiles.entries = entries;
+        debugfiles.max_entries = max_entries;
+    }
+    struct debugfile_entry *entry = &debugfiles.entries[debugfiles.num_entries];
+    entry->hash = debugfile_hash(key);
+    entry->key = strdup(key);
+    entry->path = path != NULL ? strdup(path) : NULL;
+    if (entry->key == NULL || (path != NULL && entry->path == NULL)) {
+        free(entry->key);
+        free(entry->path);
+        return;
+    }
+    debugfiles.num_entries++;
+}
+/* Forget which objects had no debug file, a new directory might have one */
+static void debugfile_forget_misses(void)
+{
+    size_t num_entries = 0;
+    for (size_t i=0; i < debugfiles.num_entries; i++) {
+        struct debugfile_entry *entry = &debugfiles.entries[i];
+        if (entry->path == NULL) {
+            free(entry->key);
+            continue;
+        }
+        debugfiles.entries[num_entries++] = *entry;
+    }
+    debugfiles.num_entries = num_entries;
+}
+
+#if defined(__unix__)
+/* The CRC-32 (IEEE 802.3) that `.gnu_debuglink` uses */
+static uint32_t debugfile_crc32(const unsigned char *data, size_t size)
+{
+    static uint32_t table[256];
+    if (table[1] == 0) {
+        for (uint32_t i=0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int k=0; k < 8; k++) crc = (crc >> 1) ^ (0xedb88320u & -(crc & 1));
+            table[i] = crc;
+        }
+    }
+    uint32_t crc = 0xffffffffu;
+    for (size_t i=0; i < size; i++) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return crc ^ 0xffffffffu;
+}
+/**
+ * Returns the length of the hexadecimal build-id of a loaded object, read from its `PT_NOTE` segments, or 0.
+ * The build-id is stored in `hex` (which should fit `WANDER_BUILD_ID_SIZE` characters), or an empty string.
+ */
+WANDER_FUN(size_t) wander_debugfile_build_id(const struct dl_phdr_info *info, char *hex, size_t max_hex)
+{
+    hex[0] = '\0';
+    for (size_t k=0; k < info->dlpi_phnum; k++) {
+        const ElfW(Phdr) *phdr = &info->dlpi_phdr[k];
+        if (phdr->p_type != PT_NOTE) continue;
+        size_t align = phdr->p_align == 8 ? 8 : 4;
+        const unsigned char *note = (const unsigned char *)(info->dlpi_addr + phdr->p_vaddr);
+        const unsigned char *end = note + phdr->p_memsz;
+        while (note + sizeof(ElfW(Nhdr)) <= end) {
+            const ElfW(Nhdr) *nhdr = (const ElfW(Nhdr) *)note;
+            const unsigned char *name = note + sizeof(ElfW(Nhdr));
+            const unsigned char *desc = name + ((nhdr->n_namesz + align - 1) & ~(align - 1));
+            note = desc + ((nhdr->n_descsz + align - 1) & ~(align - 1));
+            if (note > end) break;
+            if (nhdr->n_type != NT_GNU_BUILD_ID || nhdr->n_namesz != 4 || memcmp(name, "GNU", 4) != 0) continue;
+            if (nhdr->n_descsz < 2 || nhdr->n_descsz * 2 + 1 > max_hex) continue;
+            for (size_t i=0; i < nhdr->n_descsz; i++) {
+                hex[i * 2 + 0] = "0123456789abcdef"[desc[i] >> 4];
+                hex[i * 2 + 1] = "0123456789abcdef"[desc[i] & 0xf];
+            }
+            hex[nhdr->n_descsz * 2] = '\0';
+            return nhdr->n_descsz * 2;
+        }
+    }
+    return 0;
+}
+/* Reads the file name and checksum of the `.gnu_debuglink` section of an object file */
+static bool debugfile_debuglink(int fd, char *name, size_t max_name, uint32_t *crc)
+{
+    bool found = false;
+    ElfW(Ehdr) ehdr;
+    if (pread(fd, &ehdr, sizeof(ehdr), 0) != sizeof(ehdr)) return false;
+    if (memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0 || ehdr.e_shentsize != sizeof(ElfW(Shdr))) return false;
+    if (ehdr.e_shnum == 0 || ehdr.e_shstrndx == SHN_UNDEF || ehdr.e_shstrndx >= ehdr.e_shnum) return false;
+    ElfW(Shdr) *shdrs = malloc(ehdr.e_shnum * sizeof(ElfW(Shdr)));
+    if (shdrs == NULL) return false;
+    char *shstrs = NULL;
+    if (pread(fd, shdrs, ehdr.e_shnum * sizeof(ElfW(Shdr)), ehdr.e_shoff) != (ssize_t)(ehdr.e_shnum * sizeof(ElfW(Shdr)))) goto done;
+    ElfW(Shdr) *shstrh = &shdrs[ehdr.e_shstrndx];
+    shstrs = malloc(shstrh->sh_size + 1);
+    if (shstrs == NULL || pread(fd, shstrs, shstrh->sh_size, shstrh->sh_offset) != (ssize_t)shstrh->sh_size) goto done;
+    shstrs[shstrh->sh_size] = '\0';
+    for (size_t i=0; i < ehdr.e_shnum; i++) {
+        ElfW(Shdr) *shdr = &shdrs[i];
+        if (shdr->sh_name >= shstrh->sh_size || strcmp(&shstrs[shdr->sh_name], ".gnu_debuglink") != 0) continue;
+        /* The name is padded to 4 bytes and followed by the checksum */
+        if (shdr->sh_size < 8 || shdr->sh_size >= max_name + 4) break;
+        if (pread(fd, name, shdr->sh_size - 4, shdr->sh_offset) != (ssize_t)(shdr->sh_size - 4)) break;
+        if (pread(fd, crc, 4, shdr->sh_offset + shdr->sh_size - 4) != 4) break;
+        name[shdr->sh_size - 4] = '\0';
+        found = name[0] != '\0' && strchr(name, '/') == NULL;
+        break;
+    }
+done:
+    free(shstrs);
+    free(shdrs);
+    return found;
+}
+/* Opens `path` if it exists and, for `.gnu_debuglink`, if its checksum matches */
+static int debugfile_try(const char *path, const uint32_t *crc)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1 || crc == NULL) return fd;
+    struct stat sb;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &sb) == 0 && sb.st_size > 0) data = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    bool matches = data != MAP_FAILED && debugfile_crc32(data, sb.st_size) == *crc;
+    if (data != MAP_FAILED) munmap(data, sb.st_size);
+    if (matches) return fd;
+    close(fd);
+    return -1;
+}
+/* Search every candidate location, returns the file descriptor of the debug file and its path in `found`.
+ * The object itself is only opened (into `*objfd`) if its build-id did not lead anywhere.
+ */
+static int debugfile_search(const char *build_id, const char *path, int *objfd, char *found, size_t max_found)
+{
+    size_t num_dirs = debugfiles.num_dirs + 1;
+    const char *dirs[num_dirs];
+    dirs[0] = DEBUGFILE_GLOBAL_DIR;
+    for (size_t i=0; i < debugfiles.num_dirs; i++) dirs[i + 1] = debugfiles.dirs[i];
+
+    int fd = -1;
+    if (build_id[0] != '\0') {
+        for (size_t i=0; fd == -1 && i < num_dirs; i++) {
+            snprintf(found, max_found, "%s/.build-id/%.2s/%s.debug", dirs[i], build_id, build_id + 2);
+            fd = debugfile_try(found, NULL);
+        }
+        if (fd != -1) return fd;
+    }
+
+    *objfd = open(path, O_RDONLY | O_CLOEXEC);
+    char name[256];
+    uint32_t crc;
+    char *realname = realpath(path, NULL);
+    if (realname == NULL) return -1;
+    char *slash = strrchr(realname, '/');
+    const char *objdir = realname;
+    if (slash != NULL) *slash = '\0'; /* `realname` is absolute, so the directory of "/x" is "" */
+    if (*objfd != -1 && debugfile_debuglink(*objfd, name, sizeof(name), &crc)) {
+        snprintf(found, max_found, "%s/%s", objdir, name);
+        if (slash == NULL || strcmp(name, slash + 1) != 0) fd = debugfile_try(found, &crc); /* Not the object itself */
+        if (fd == -1) {
+            snprintf(found, max_found, "%s/.debug/%s", objdir, name);
+            fd = debugfile_try(found, &crc);
+        }
+        for (size_t i=0; fd == -1 && i < num_dirs; i++) {
+            snprintf(found, max_found, "%s%s/%s", dirs[i], objdir, name);
+            fd = debugfile_try(found, &crc);
+            if (fd != -1 || i == 0) continue;
+            snprintf(found, max_found, "%s/%s", dirs[i], name);
+            fd = debugfile_try(found, &crc);
+        }
+    }
+    if (fd == -1) {
+        /* Some distributions mirror the object itself under the debug directory */
+        if (slash != NULL) *slash = '/';
+        snprintf(found, max_found, "%s%s", DEBUGFILE_GLOBAL_DIR, realname);
+        fd = debugfile_try(found, NULL);
+    }
+    free(realname);
+    return fd;
+}
+/**
+ * Open the file with the debug information of an object with the given build-id (an empty string if unknown).
+ * This is a separate debug file if there is one, the object itself otherwise.
+ * Returns a file descriptor, or -1 if neither can be opened.
+ */
+WANDER_FUN(int) wander_debugfile_open(const char *build_id, const char *path)
+{
+    const char *key = build_id[0] != '\0' ? build_id : path;
+
+    pthread_mutex_lock(&debugfiles.lock);
+    struct debugfile_entry *entry = debugfile_find(key);
+    if (entry != NULL) {
+        int fd = entry->path != NULL ? open(entry->path, O_RDONLY | O_CLOEXEC) : -1;
+        pthread_mutex_unlock(&debugfiles.lock);
+        return fd != -1 ? fd : open(path, O_RDONLY | O_CLOEXEC);
+    }
+    char found[PATH_MAX];
+    int objfd = -1;
+    int fd = debugfile_search(build_id, path, &objfd, found, sizeof(found));
+    debugfile_remember(key, fd != -1 ? found : NULL);
+    pthread_mutex_unlock(&debugfiles.lock);
+    if (objfd != -1 && fd != -1) close(objfd);
+    if (fd != -1) return fd;
+    return objfd != -1 ? objfd : open(path, O_RDONLY | O_CLOEXEC);
+}
+#endif
+
+/**
+ * Also search `path` for separate debug files, after `/usr/lib/debug`.
+ * Only objects that are loaded by resolvers created (or refreshed) afterwards are affected,
+ * so this should be called before `wander_init`. The directories are forgotten by `wander_fini`.
+ * Returns 0 on success and -1 if out of memory or unsupported.
+ */
+WANDER_FUN(int) wander_add_debug_directory(const char *path)
+{
+#if defined(__unix__)
+    size_t len = strlen(path);
+    while (len > 1 && path[len - 1] == '/') len--;
+    char *dir = malloc(len + 1);
+    if (dir == NULL) return -1;
+    memcpy(dir, path, len);
+    dir[len] = '\0';
+    pthread_mutex_lock(&debugfiles.lock);
+    char **dirs = realloc(debugfiles.dirs, (debugfiles.num_dirs + 1) * sizeof(char *));
+    if (dirs == NULL) {
+        pthread_mutex_unlock(&debugfiles.lock);
+        free(dir);
+        return -1;
+    }
+    debugfiles.dirs = dirs;
+    debugfiles.dirs[debugfiles.num_dirs++] = dir;
+    debugfile_forget_misses();
+    pthread_mutex_unlock(&debugfiles.lock);
+    return 0;
+#else
+    return -1; /* TODO: Windows uses PDB files */
+#endif
+}
+/* Forget the debug directories and every debug file that was found. */
+WANDER_FUN(void) wander_debugfile_fini(void)
+{
+#if defined(__unix__)
+    pthread_mutex_lock(&debugfiles.lock);
+#endif
+    for (size_t i=0; i < debugfiles.num_entries; i++) {
+        free(debugfiles.entries[i].key);
+        free(debugfiles.entries[i].path);
+    }
+    for (size_t i=0; i < debugfiles.num_dirs; i++) free(debugfiles.dirs[i]);
+    free(debugfiles.entries);
+    free(debugfiles.dirs);
+    debugfiles.entries = NULL;
+    debugfiles.dirs = NULL;
+    debugfiles.num_entries = debugfiles.max_entries = debugfiles.num_dirs = 0;
+#if defined(__unix__)
+    pthread_mutex_unlock(&debugfiles.lock);
+#endif
+}
@@ -0,0 +1,17 @@
+#ifndef WANDER_DEBUGFILE_H
+#define WANDER_DEBUGFILE_H
+
+#include <libwander/wander.h>
+
+#if defined(__unix__)
+# include <link.h> /* struct dl_phdr_info */
+
+/* Hexadecimal build-ids are at most this long, including the NUL terminator */
+# define WANDER_BUILD_ID_SIZE (2 * 64 + 1)
+
+WANDER_INTERNAL(size_t) wander_debugfile_build_id(const struct dl_phdr_info *info, char *hex, size_t max_hex); /* AS-safe */
+WANDER_INTERNAL(int)    wander_debugfile_open(const char *build_id, const char *path);
+#endif
+WANDER_INTERNAL(void)   wander_debugfile_fini(void);
+
+#endif /* !defined(WANDER_DEBUGFILE_H) */
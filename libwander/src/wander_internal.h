@@ -28,4 +28,8 @@ struct wander_global {
 
 WANDER_INTERNAL(struct wander_global) wander_global;
 
+WANDER_INTERNAL(void *) wander_ucontext_pc(void *ucontext); /* AS-safe */
+WANDER_INTERNAL(void)   wander_skip_signal_frames(wander_backtrace_t *backtrace, void *pc); /* AS-safe */
+WANDER_INTERNAL(void)   wander_printer_init(void);
+
 #endif /* !defined(WANDER_INTERNAL_H) */
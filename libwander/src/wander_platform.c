@@ -1,10 +1,117 @@
 #include "wander_platform.h"
 
+/* The CFI unwinder needs the memory map, and to know how to capture the registers */
+#if WANDER_CONFIG_UNWIND_METHOD_DWELLER && defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__))
+# define WANDER_DWELLER_UNWIND 1
+#else
+# define WANDER_DWELLER_UNWIND 0
+#endif
+
+#if defined(__linux__)
+# include <errno.h>
+# include <fcntl.h> /* open */
+# include <unistd.h> /* read, close */
+#endif
+#if (WANDER_CONFIG_UNWIND_METHOD_NAIVE || WANDER_DWELLER_UNWIND) && defined(__linux__)
+# include <stdatomic.h>
+# include <sched.h> /* sched_yield */
+# include <signal.h> /* sigaltstack */
+# include <time.h> /* clock_gettime */
+# include <ucontext.h>
+#endif
+#if WANDER_DWELLER_UNWIND
+# include <dweller/cfi.h>
+# include <link.h> /* ElfW */
+#endif
+#include <stdbool.h>
 #include <stdint.h>
+#include <string.h> /* memcmp, memchr */
 
 #define WANDER_QUOTE(x) #x
 #define WANDER_STRINGIFY(x) WANDER_QUOTE(x)
 
+#if defined(__linux__)
+static uintptr_t maps_parse_number(const char **str, const char *end, unsigned base)
+{
+    uintptr_t value = 0;
+    for (; *str < end; (*str)++) {
+        char c = **str;
+        if (c >= '0' && c <= '9') value = value * base + (c - '0');
+        else if (base == 16 && c >= 'a' && c <= 'f') value = value * base + (c - 'a' + 10);
+        else break;
+    }
+    return value;
+}
+/**
+ * Calls `fn` for every line of the maps file at `path` (e.g. /proc/self/maps), until it returns true.
+ * Returns whether `fn` did, lines with a path that does not fit in the buffer are skipped.
+ * stdio is not AS-safe, so the file is read with plain system calls.
+ * This function is AS-safe.
+ */
+WANDER_FUN(bool) wander_platform_maps_file(const char *path, bool (*fn)(void *ud, const struct wander_mapping *mapping), void *ud)
+{
+    int saved_errno = errno;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        errno = saved_errno;
+        return false;
+    }
+    char buffer[4096];
+    size_t used = 0;
+    bool done = false, skip = false;
+    while (!done) {
+        ssize_t res = read(fd, buffer + used, sizeof(buffer) - used);
+        if (res == -1 && errno == EINTR) continue;
+        if (res <= 0) break;
+        used += res;
+        const char *line = buffer, *end = buffer + used, *eol;
+        while (!done && (eol = memchr(line, '\n', end - line)) != NULL) {
+            if (!skip) {
+                /* "begin-end perms offset dev inode path" */
+                struct wander_mapping mapping;
+                const char *str = line;
+                mapping.begin = maps_parse_number(&str, eol, 16);
+                str++;
+                mapping.end = maps_parse_number(&str, eol, 16);
+                str++;
+                mapping.perms = str;
+                if (eol - str >= 5) {
+                    str += 5;
+                    mapping.offset = maps_parse_number(&str, eol, 16);
+                    while (str < eol && *str == ' ') str++;
+                    mapping.dev_major = maps_parse_number(&str, eol, 16);
+                    str++;
+                    mapping.dev_minor = maps_parse_number(&str, eol, 16);
+                    while (str < eol && *str == ' ') str++;
+                    mapping.inode = maps_parse_number(&str, eol, 10);
+                    while (str < eol && *str == ' ') str++;
+                    mapping.path = str;
+                    mapping.path_size = eol - str;
+                    done = fn(ud, &mapping);
+                }
+            }
+            skip = false;
+            line = eol + 1;
+        }
+        used = end - line;
+        if (used == sizeof(buffer)) {
+            /* Only a very long path does not fit, the part we need is already seen */
+            skip = true;
+            used = 0;
+        }
+        memmove(buffer, line, used);
+    }
+    close(fd);
+    errno = saved_errno;
+    return done;
+}
+/* Calls `fn` for every line of /proc/self/maps, see `wander_platform_maps_file`. This function is AS-safe. */
+WANDER_FUN(bool) wander_platform_maps(bool (*fn)(void *ud, const struct wander_mapping *mapping), void *ud)
+{
+    return wander_platform_maps_file("/proc/self/maps", fn, ud);
+}
+#endif
+
 struct wander_counter {
     size_t depth;
     size_t max_depth;
@@ -48,10 +155,473 @@ label:
     return &&label;
 }
 #endif
+#if WANDER_CONFIG_UNWIND_METHOD_NAIVE || WANDER_DWELLER_UNWIND
+/* The memory map, which tells both the frame pointer walker and the CFI unwinder what they may read */
+struct naive_range {
+    uintptr_t begin;
+    uintptr_t end;
+};
+static bool naive_contains(const struct naive_range *range, const void *addr, size_t size)
+{
+    return (uintptr_t)addr >= range->begin && (uintptr_t)addr < range->end && range->end - (uintptr_t)addr >= size;
+}
+#if defined(__linux__)
+#define NAIVE_MAX_CODE_RANGES 512
+#define NAIVE_REFRESH_MS      100  /* Re-read the executable mappings at most this often */
+#define NAIVE_MAX_TRIES       8    /* Lookups retried because the table was replaced meanwhile */
+#define NAIVE_MAX_WAITS       1000 /* Times a lookup yields while another thread reads the mappings */
+
+struct naive_code_range {
+    struct naive_range range;
+    unsigned long      inode;
+#if WANDER_DWELLER_UNWIND
+    bool               has_cfi;
+    struct dweller_cfi cfi; /* From the `.eh_frame_hdr` of the ELF image that holds the range */
+#endif
+};
+struct naive_code_table {
+    size_t                  num_ranges;
+    struct naive_code_range ranges[NAIVE_MAX_CODE_RANGES];
+};
+/* The executable mappings, shared by all threads.
+ * `tables[sequence % 2]` is the current one, the writer fills the other one and only publishes it when the mappings
+ * changed. Readers retry when `sequence` changed under them, as the writer may be rewriting their table by then.
+ * `sequence` is also the version of the unwind cache.
+ */
+static struct {
+    atomic_uint             sequence;
+    atomic_bool             writing;
+    atomic_llong            refreshed;
+    struct naive_code_table tables[2];
+} naive_code = { .sequence = 0, .writing = false, .refreshed = -NAIVE_REFRESH_MS };
+/* The stack of this thread, and its alternate signal stack */
+static __thread struct naive_range naive_stacks[2] __attribute__((tls_model("initial-exec")));
+
+#if WANDER_DWELLER_UNWIND
+/* Find the unwind tables of the ELF image whose headers are at `begin`, without trusting it to be one */
+static bool naive_elf_cfi(const struct naive_range *image, struct dweller_cfi *cfi)
+{
+    const ElfW(Ehdr) *ehdr = (const ElfW(Ehdr) *)image->begin;
+    size_t size = image->end - image->begin;
+    if (size < sizeof(ElfW(Ehdr)) || memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0) return false;
+    if (ehdr->e_phentsize != sizeof(ElfW(Phdr)) || ehdr->e_phoff > size || (size - ehdr->e_phoff) / sizeof(ElfW(Phdr)) < ehdr->e_phnum) return false;
+    const ElfW(Phdr) *phdrs = (const ElfW(Phdr) *)(image->begin + ehdr->e_phoff);
+    const ElfW(Phdr) *eh_frame_hdr = NULL;
+    uintptr_t bias = 0;
+    bool has_bias = false;
+    for (size_t i=0; i < ehdr->e_phnum; i++) {
+        if (phdrs[i].p_type == PT_LOAD && !has_bias) {
+            /* `begin` is where the start of the file is mapped */
+            bias = image->begin - (phdrs[i].p_vaddr - phdrs[i].p_offset);
+            has_bias = true;
+        }
+        if (phdrs[i].p_type == PT_GNU_EH_FRAME) eh_frame_hdr = &phdrs[i];
+    }
+    if (!has_bias || eh_frame_hdr == NULL) return false;
+    for (size_t i=0; i < ehdr->e_phnum; i++) {
+        const ElfW(Phdr) *load = &phdrs[i];
+        if (load->p_type != PT_LOAD || eh_frame_hdr->p_vaddr < load->p_vaddr || eh_frame_hdr->p_vaddr - load->p_vaddr >= load->p_filesz) continue;
+        uintptr_t hdr = bias + eh_frame_hdr->p_vaddr;
+        return dweller_cfi_init_eh_frame_hdr(cfi, (const void *)hdr, eh_frame_hdr->p_memsz, hdr, bias + load->p_vaddr + load->p_filesz);
+    }
+    return false;
+}
+#endif
+/* The headers of a file are in its mapping at offset 0, which comes before the executable one */
+struct naive_image {
+    struct naive_range       range;
+    unsigned long            inode;
+    struct naive_code_table *table;
+};
+static bool naive_add_code(void *ud, const struct wander_mapping *mapping)
+{
+    struct naive_image *image = ud;
+    struct naive_range range = { mapping->begin, mapping->end };
+    if (mapping->perms[0] == 'r' && mapping->offset == 0) {
+        image->range = range;
+        image->inode = mapping->inode;
+    }
+    if (mapping->perms[0] == 'r' && mapping->perms[2] == 'x' && image->table->num_ranges < NAIVE_MAX_CODE_RANGES) {
+        struct naive_code_range *code = &image->table->ranges[image->table->num_ranges++];
+        memset(code, 0x00, sizeof(*code)); /* Tables are compared with memcmp */
+        code->range = range;
+        code->inode = mapping->inode;
+#if WANDER_DWELLER_UNWIND
+        /* Anonymous mappings, such as the vDSO, are their own image */
+        code->has_cfi = image->range.end != 0 && image->inode == mapping->inode && naive_elf_cfi(&image->range, &code->cfi);
+#endif
+    }
+    return false;
+}
+/* Re-read the mappings, unless that was done recently.
+ * If another thread is at it, wait a little for it to finish instead, as the address may be in what it finds.
+ */
+static void naive_refresh_code(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    long long now_ms = (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+    bool writing = false;
+    if (!atomic_load(&naive_code.writing) && now_ms - atomic_load(&naive_code.refreshed) < NAIVE_REFRESH_MS) return;
+    if (!atomic_compare_exchange_strong(&naive_code.writing, &writing, true)) {
+        /* Bounded, as the writer may be the thread this runs in a signal handler of */
+        for (size_t i=0; i < NAIVE_MAX_WAITS && atomic_load(&naive_code.writing); i++) sched_yield();
+        return;
+    }
+    atomic_store(&naive_code.refreshed, now_ms);
+    unsigned sequence = atomic_load(&naive_code.sequence);
+    const struct naive_code_table *current = &naive_code.tables[sequence % 2];
+    struct naive_code_table *table = &naive_code.tables[(sequence + 1) % 2];
+    table->num_ranges = 0;
+    struct naive_image image = { { 0, 0 }, 0, table };
+    wander_platform_maps(naive_add_code, &image);
+    if (table->num_ranges != current->num_ranges || memcmp(table->ranges, current->ranges, table->num_ranges * sizeof(table->ranges[0])) != 0) {
+        atomic_store_explicit(&naive_code.sequence, sequence + 1, memory_order_release);
+    }
+    atomic_store(&naive_code.writing, false);
+}
+/* Copy the range that holds `addr`, returns -1 if the table was replaced meanwhile */
+static int naive_find_code(const void *addr, size_t size, struct naive_code_range *found)
+{
+    unsigned sequence = atomic_load_explicit(&naive_code.sequence, memory_order_acquire);
+    const struct naive_code_table *table = &naive_code.tables[sequence % 2];
+    int result = 0;
+    for (size_t i=0; i < table->num_ranges && i < NAIVE_MAX_CODE_RANGES; i++) {
+        if (!naive_contains(&table->ranges[i].range, addr, size)) continue;
+        *found = table->ranges[i];
+        result = 1;
+        break;
+    }
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&naive_code.sequence, memory_order_relaxed) != sequence) return -1;
+    return result;
+}
+/* Find the executable range that holds `addr`, re-reading the mappings once if it is in none */
+static bool naive_code_range(const void *addr, size_t size, struct naive_code_range *found)
+{
+    bool refreshed = false;
+    for (size_t i=0; i < NAIVE_MAX_TRIES; i++) {
+        int result = naive_find_code(addr, size, found);
+        if (result == 1) return true;
+        if (result == 0) {
+            if (refreshed) return false;
+            naive_refresh_code(); /* The address might be in a library that was loaded since */
+            refreshed = true;
+        }
+    }
+    return false;
+}
+#if WANDER_CONFIG_UNWIND_METHOD_NAIVE
+/* Only return addresses into executable mappings are believed, the chain is broken otherwise */
+static bool naive_is_code(const void *addr, size_t size)
+{
+    struct naive_code_range range;
+    return naive_code_range(addr, size, &range);
+}
+#endif
+#if WANDER_DWELLER_UNWIND
+static bool naive_cfi(uintptr_t pc, struct dweller_cfi *cfi)
+{
+    struct naive_code_range range;
+    if (!naive_code_range((const void *)pc, 1, &range) || !range.has_cfi) return false;
+    *cfi = range.cfi;
+    return true;
+}
+#endif
+/* Only the stack of the main thread and anonymous mappings (the stacks of the other threads) are believed,
+ * so that a broken chain does not make the unwinders read whatever else is mapped.
+ */
+static bool naive_find_stack(void *ud, const struct wander_mapping *mapping)
+{
+    struct naive_range *stack = ud;
+    struct naive_range range = { mapping->begin, mapping->end };
+    if (!naive_contains(&range, (void *)stack->begin, 0)) return false;
+    if (mapping->perms[0] != 'r' || mapping->perms[1] != 'w') return true; /* A guard page, or not a stack */
+    bool is_stack = mapping->path_size >= 6 && memcmp(mapping->path, "[stack", 6) == 0;
+    bool is_anonymous = mapping->inode == 0 && (mapping->path_size == 0 || (mapping->path_size >= 6 && memcmp(mapping->path, "[anon:", 6) == 0));
+    if (is_stack || is_anonymous) *stack = range;
+    return true;
+}
+/* Frames must be on the stack that holds `addr`, or on the same stack as the frame before them.
+ * The first cached range is the stack of this thread, and the second its alternate signal stack.
+ */
+static bool naive_stack(const void *addr, struct naive_range *stack)
+{
+    for (size_t i=0; i < 2; i++) {
+        if (naive_contains(&naive_stacks[i], addr, 0)) {
+            *stack = naive_stacks[i];
+            return true;
+        }
+    }
+    /* The alternate signal stack may be anywhere, such as in the heap */
+    stack_t altstack;
+    if (sigaltstack(NULL, &altstack) == 0 && !(altstack.ss_flags & SS_DISABLE)) {
+        struct naive_range range = { (uintptr_t)altstack.ss_sp, (uintptr_t)altstack.ss_sp + altstack.ss_size };
+        if (naive_contains(&range, addr, 0)) {
+            naive_stacks[1] = range;
+            *stack = range;
+            return true;
+        }
+    }
+    stack->begin = (uintptr_t)addr;
+    stack->end = 0;
+    if (!wander_platform_maps(naive_find_stack, stack) || stack->end == 0) return false;
+    naive_stacks[0] = *stack;
+    return true;
+}
+#else
+static bool naive_is_code(const void *addr, size_t size)
+{
+    (void)addr;
+    (void)size;
+    return true;
+}
+static bool naive_stack(const void *addr, struct naive_range *stack)
+{
+    stack->begin = (uintptr_t)addr;
+    stack->end = UINTPTR_MAX;
+    return true;
+}
+#endif
+#endif
+#if WANDER_CONFIG_UNWIND_METHOD_NAIVE
+#if defined(__linux__) && defined(__x86_64__)
+/* Whether a frame returns into the sigreturn trampoline, so it belongs to a signal handler.
+ * libc may be stripped of `__restore_rt`, so its code is recognized too: mov $15, %rax; syscall
+ */
+static bool naive_is_sigreturn(wander_platform_t *platform, void *return_address)
+{
+    static const unsigned char code[] = { 0x48, 0xc7, 0xc0, 0x0f, 0x00, 0x00, 0x00, 0x0f, 0x05 };
+    if (platform->sym_restore_rt != NULL) return return_address == platform->sym_restore_rt;
+    return naive_is_code(return_address, sizeof(code)) && memcmp(return_address, code, sizeof(code)) == 0;
+}
+/* Whether `return_address` follows a call to the function that `pc` is in, as far as can be told.
+ * That is the case when a leaf function without a frame of its own (-momit-leaf-frame-pointer) was interrupted.
+ */
+static bool naive_is_leaf_return(void *return_address, void *pc)
+{
+    unsigned char *call = (unsigned char *)return_address - 5; /* call rel32 */
+    if (!naive_is_code(call, 5) || call[0] != 0xe8) return false;
+    int32_t rel;
+    memcpy(&rel, &call[1], sizeof(rel));
+    uintptr_t target = (uintptr_t)return_address + rel;
+    return target <= (uintptr_t)pc && (uintptr_t)pc - target < 0x10000;
+}
+#endif
+/* Follow the chain of saved frame pointers, for code built with -fno-omit-frame-pointer.
+ * Every frame must be on the stack and above the one before it, and every return address in executable memory,
+ * so a broken chain ends the backtrace instead of crashing it.
+ * Only counts the frames if `frames` is NULL.
+ */
+static size_t naive_walk(wander_platform_t *platform, void **frames, size_t max_depth)
+{
+    struct wander_method_naive *method = &platform->methods.naive;
+    void **frame = __builtin_frame_address(0);
+    struct naive_range stack;
+    size_t depth = 0;
+    if (!naive_stack(frame, &stack)) return 0;
+    while (depth < max_depth) {
+        if ((uintptr_t)frame % sizeof(void *) != 0 || !naive_contains(&stack, frame, 2 * sizeof(void *))) break;
+        void *return_address = __builtin_extract_return_addr(frame[1]);
+        if (!naive_is_code(return_address, 1)) break;
+        if (frames != NULL) frames[depth] = return_address;
+        depth++;
+        void **next_frame = frame[0];
+#if defined(__linux__) && defined(__x86_64__)
+        if (naive_is_sigreturn(platform, return_address)) {
+            /* The kernel put the interrupted context right after the return address of the handler */
+            ucontext_t *uctx = (ucontext_t *)&frame[2];
+            if (!naive_contains(&stack, uctx, sizeof(ucontext_t))) break;
+            void *pc = (void *)uctx->uc_mcontext.gregs[REG_RIP];
+            if (depth < max_depth && naive_is_code(pc, 1)) {
+                if (frames != NULL) frames[depth] = pc;
+                depth++;
+            }
+            /* The handler may have run on an alternate signal stack */
+            void **sp = (void **)uctx->uc_mcontext.gregs[REG_RSP];
+            if (!naive_stack(sp, &stack)) break;
+            if (depth < max_depth && naive_contains(&stack, sp, sizeof(void *)) && naive_is_leaf_return(sp[0], pc)) {
+                if (frames != NULL) frames[depth] = sp[0];
+                depth++;
+            }
+            frame = (void **)uctx->uc_mcontext.gregs[REG_RBP];
+            continue;
+        }
+#endif
+        if (next_frame <= frame || next_frame == method->root_frame) break;
+        frame = next_frame;
+    }
+    return depth;
+}
+#endif
+#if WANDER_DWELLER_UNWIND
+#if defined(__x86_64__)
+# define DWELLER_SP_REG DWELLER_CFI_SP_X86_64
+#else
+# define DWELLER_SP_REG DWELLER_CFI_SP_AARCH64
+#endif
+#if WANDER_CONFIG_UNWIND_CACHE_SIZE > 0
+/* The compact unwind rules of a return address (or the pc of an interrupted frame).
+ * Entries are protected by a sequence lock like those of the resolver cache, see `cache_entry` in wander_resolver.c.
+ * `version` is the sequence of `naive_code` the rules were found with, they are stale once the mappings changed.
+ */
+struct unwind_cache_entry {
+    atomic_uint                seq;
+    atomic_uint                last_used;
+    unsigned                   version;
+    dw_u64_t                   pc;
+    struct dweller_cfi_compact compact;
+};
+# define UNWIND_CACHE_WAYS 4
+# define UNWIND_CACHE_SETS ((WANDER_CONFIG_UNWIND_CACHE_SIZE + UNWIND_CACHE_WAYS - 1) / UNWIND_CACHE_WAYS)
+static struct {
+    atomic_uint               clock;
+    struct unwind_cache_entry entries[UNWIND_CACHE_SETS * UNWIND_CACHE_WAYS];
+} unwind_cache;
+
+static struct unwind_cache_entry *unwind_cache_set(dw_u64_t pc)
+{
+    uint64_t hash = pc * 0x9e3779b97f4a7c15ull;
+    return &unwind_cache.entries[(hash >> 32) % UNWIND_CACHE_SETS * UNWIND_CACHE_WAYS];
+}
+/* This function is AS-safe. */
+static bool unwind_cache_lookup(dw_u64_t pc, struct dweller_cfi_compact *compact)
+{
+    unsigned version = atomic_load_explicit(&naive_code.sequence, memory_order_acquire);
+    struct unwind_cache_entry *set = unwind_cache_set(pc);
+    for (size_t i=0; i < UNWIND_CACHE_WAYS; i++) {
+        struct unwind_cache_entry *entry = &set[i];
+        unsigned seq = atomic_load_explicit(&entry->seq, memory_order_acquire);
+        if ((seq & 1) || entry->pc != pc || entry->version != version) continue;
+        *compact = entry->compact;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&entry->seq, memory_order_relaxed) != seq) continue;
+        atomic_store_explicit(&entry->last_used, atomic_fetch_add_explicit(&unwind_cache.clock, 1, memory_order_relaxed), memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+/* Replace the least recently used entry of the set. This function is AS-safe. */
+static void unwind_cache_insert(unsigned version, dw_u64_t pc, const struct dweller_cfi_compact *compact)
+{
+    struct unwind_cache_entry *set = unwind_cache_set(pc);
+    unsigned now = atomic_fetch_add_explicit(&unwind_cache.clock, 1, memory_order_relaxed);
+    struct unwind_cache_entry *victim = &set[0];
+    for (size_t i=1; i < UNWIND_CACHE_WAYS; i++) {
+        unsigned age = now - atomic_load_explicit(&set[i].last_used, memory_order_relaxed);
+        if (age > now - atomic_load_explicit(&victim->last_used, memory_order_relaxed)) victim = &set[i];
+    }
+    unsigned seq = atomic_load_explicit(&victim->seq, memory_order_relaxed);
+    if (seq & 1) return;
+    if (!atomic_compare_exchange_strong_explicit(&victim->seq, &seq, seq + 1, memory_order_acquire, memory_order_relaxed)) return;
+    atomic_thread_fence(memory_order_release);
+    victim->version = version;
+    victim->pc = pc;
+    victim->compact = *compact;
+    atomic_store_explicit(&victim->last_used, now, memory_order_relaxed);
+    atomic_store_explicit(&victim->seq, seq + 2, memory_order_release);
+}
+#endif
+/* Saved registers are only read from the stacks of this thread */
+static bool dweller_read(void *data, dw_u64_t address, void *bytes, size_t size)
+{
+    struct naive_range *stack = data;
+    if (!naive_contains(stack, (void *)(uintptr_t)address, size)) {
+        if (!naive_stack((void *)(uintptr_t)address, stack) || !naive_contains(stack, (void *)(uintptr_t)address, size)) return false;
+    }
+    memcpy(bytes, (void *)(uintptr_t)address, size);
+    return true;
+}
+/* Unwind with the `.eh_frame` tables of every image, interpreted by libdweller.
+ * Unlike `_Unwind_Backtrace`, this takes no locks and does not allocate, and it steps through signal frames.
+ * Only counts the frames if `frames` is NULL.
+ */
+static __attribute__((noinline)) size_t dweller_walk(void **frames, size_t max_depth)
+{
+    struct dweller_cfi_regs regs;
+    memset(&regs, 0x00, sizeof(regs));
+    /* The callee-saved registers, and where this function is now */
+#if defined(__x86_64__)
+    __asm__ volatile(
+        "leaq 0(%%rip), %0\n\t"
+        "movq %%rbx,   24(%1)\n\t"
+        "movq %%rbp,   48(%1)\n\t"
+        "movq %%rsp,   56(%1)\n\t"
+        "movq %%r12,   96(%1)\n\t"
+        "movq %%r13,  104(%1)\n\t"
+        "movq %%r14,  112(%1)\n\t"
+        "movq %%r15,  120(%1)\n\t"
+        : "=&r"(regs.pc) : "r"(regs.regs) : "memory");
+    regs.valid = (1 << 3) | (1 << 6) | (1 << 7) | (0xf << 12);
+#else
+    dw_u64_t sp;
+    __asm__ volatile(
+        "adr %0, .\n\t"
+        "mov %1, sp\n\t"
+        "stp x19, x20, [%2, #152]\n\t"
+        "stp x21, x22, [%2, #168]\n\t"
+        "stp x23, x24, [%2, #184]\n\t"
+        "stp x25, x26, [%2, #200]\n\t"
+        "stp x27, x28, [%2, #216]\n\t"
+        "stp x29, x30, [%2, #232]\n\t"
+        : "=&r"(regs.pc), "=&r"(sp) : "r"(regs.regs) : "memory");
+    regs.regs[DWELLER_SP_REG] = sp;
+    regs.valid = ((dw_u64_t)0xfff << 19) | ((dw_u64_t)1 << DWELLER_SP_REG);
+#endif
+    struct naive_range stack = { 0, 0 };
+    bool interrupted = true; /* The first pc is not a return address */
+    size_t depth = 0;
+    while (depth < max_depth) {
+        /* A return address may be just past the end of the calling function */
+        dw_u64_t pc = interrupted ? regs.pc : regs.pc - 1;
+        dw_u64_t sp = regs.regs[DWELLER_SP_REG];
+        bool signal_frame;
+#if WANDER_CONFIG_UNWIND_CACHE_SIZE > 0
+        struct dweller_cfi_compact compact;
+        if (unwind_cache_lookup(pc, &compact)) {
+            if (!dweller_cfi_step_compact(&compact, &regs, DWELLER_SP_REG, dweller_read, &stack)) break;
+            signal_frame = compact.signal_frame;
+        } else
+#endif
+        {
+#if WANDER_CONFIG_UNWIND_CACHE_SIZE > 0
+            /* Rules found while the mappings changed are remembered with the old version, so they are never used */
+            unsigned version = atomic_load_explicit(&naive_code.sequence, memory_order_acquire);
+#endif
+            struct dweller_cfi cfi;
+            struct dweller_cfi_row row;
+            if (!naive_cfi(pc, &cfi) || !dweller_cfi_find(&cfi, pc, &row)) break;
+#if WANDER_CONFIG_UNWIND_CACHE_SIZE > 0
+            if (dweller_cfi_compact(&row, &compact)) unwind_cache_insert(version, pc, &compact);
+#endif
+            if (!dweller_cfi_step(&row, &regs, DWELLER_SP_REG, dweller_read, &stack)) break;
+            signal_frame = row.signal_frame;
+        }
+        /* The stack only grows down, except towards an alternate signal stack */
+        if (!signal_frame && regs.regs[DWELLER_SP_REG] <= sp) break;
+        interrupted = signal_frame;
+        if (frames != NULL) frames[depth] = (void *)(uintptr_t)regs.pc;
+        depth++;
+    }
+    return depth;
+}
+#endif
 
 WANDER_FUN(int) wander_platform_init(wander_platform_t *platform)
 {
     wander_libhandle_t handle;
+#if WANDER_CONFIG_UNWIND_METHOD_NAIVE
+    /* Much cheaper than the other methods, which interpret unwind tables for every frame.
+     * Enabling it means the application is built with frame pointers, so it goes first.
+     */
+    platform->method = WANDER_UNWIND_METHOD_NAIVE;
+    goto success;
+#endif
+#if WANDER_DWELLER_UNWIND
+    /* Reads the same tables as libgcc, but needs neither its locks nor malloc, so it is AS-safe in every thread */
+    platform->method = WANDER_UNWIND_METHOD_DWELLER;
+    goto success;
+#endif
 #if WANDER_CONFIG_UNWIND_METHOD_DBGHELP && defined(_WIN32)
     {
         handle = wander_dlopen("DBGHELP.DLL");
@@ -135,13 +705,6 @@ WANDER_FUN(int) wander_platform_init(wander_platform_t *platform)
         }
         wander_dlclose(handle);
     }
-#endif
-#if WANDER_CONFIG_UNWIND_METHOD_NAIVE
-    {
-        struct wander_method_naive *method = &platform->methods.naive;
-        platform->method = WANDER_UNWIND_METHOD_NAIVE;
-    }
-    goto success;
 #endif
     platform->method = WANDER_UNWIND_METHOD_NONE;
     platform->sym_restore = NULL;
@@ -257,16 +820,14 @@ WANDER_FUN(size_t) wander_platform_stackdepth(wander_platform_t *platform, size_
     case WANDER_UNWIND_METHOD_NAIVE:
 #if WANDER_CONFIG_UNWIND_METHOD_NAIVE
         {
-            struct wander_method_naive *method = &platform->methods.naive;
-            void **current_frame = __builtin_frame_address(0);
-            while (current_frame) {
-                current_frame = *current_frame;
-                if (current_frame == method->root_frame) break;
-                counter.depth++;
-                if (counter.max_depth != 0 && counter.depth >= counter.max_depth) {
-                    break;
-                }
-            }
+            counter.depth = naive_walk(platform, NULL, counter.max_depth != 0 ? counter.max_depth : SIZE_MAX);
+        }
+#endif
+        break;
+    case WANDER_UNWIND_METHOD_DWELLER:
+#if WANDER_DWELLER_UNWIND
+        {
+            counter.depth = dweller_walk(NULL, counter.max_depth != 0 ? counter.max_depth : SIZE_MAX);
         }
 #endif
         break;
@@ -344,20 +905,20 @@ WANDER_FUN(wander_backtrace_t) wander_platform_backtrace(wander_platform_t *plat
     case WANDER_UNWIND_METHOD_NAIVE:
 #if WANDER_CONFIG_UNWIND_METHOD_NAIVE
         {
-            struct wander_method_naive *method = &platform->methods.naive;
             void *rip = naive_getrip();
             if (backtrace.depth >= backtrace.max_depth)
                 break;
             backtrace.frames[backtrace.depth++] = rip;
-            void **current_frame = __builtin_frame_address(0);
-            while (current_frame) {
-                if (backtrace.depth >= backtrace.max_depth)
-                    break;
-                void *return_address = *(current_frame + 1);
-                backtrace.frames[backtrace.depth++] = __builtin_extract_return_addr(return_address);
-                current_frame = *current_frame;
-                if (current_frame == method->root_frame) break;
-            }
+            backtrace.depth += naive_walk(platform, &backtrace.frames[backtrace.depth], backtrace.max_depth - backtrace.depth);
+        }
+#endif
+        break;
+    case WANDER_UNWIND_METHOD_DWELLER:
+#if WANDER_DWELLER_UNWIND
+        {
+            if (backtrace.depth >= backtrace.max_depth)
+                break;
+            backtrace.depth += dweller_walk(&backtrace.frames[backtrace.depth], backtrace.max_depth - backtrace.depth);
         }
 #endif
         break;
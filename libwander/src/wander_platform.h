@@ -4,6 +4,8 @@
 #include <libwander/wander.h>
 #include <libwander/wander_printer.h>
 
+#include <stdbool.h>
+
 /****************************************************************************/
 /* #includes for wander_platform_thread_id() */
 #if WANDER_CONFIG_HAVE_PTHREAD_GETTHREADID_NP
@@ -91,7 +93,8 @@ typedef enum wander_method {
     WANDER_UNWIND_METHOD_LIBUNWIND,
     WANDER_UNWIND_METHOD_LIBBACKTRACE,
     WANDER_UNWIND_METHOD_GNULIBC,
-    WANDER_UNWIND_METHOD_NAIVE
+    WANDER_UNWIND_METHOD_NAIVE,
+    WANDER_UNWIND_METHOD_DWELLER
 } wander_method_t;
 
 typedef struct wander_platform wander_platform_t;
@@ -150,4 +153,21 @@ WANDER_INTERNAL(wander_thread_id_t) wander_platform_thread_id(wander_platform_t
 WANDER_INTERNAL(size_t) wander_platform_stackdepth(wander_platform_t *platform, size_t max_depth); /* AS-safe */
 WANDER_INTERNAL(wander_backtrace_t) wander_platform_backtrace(wander_platform_t *platform, wander_backtrace_t backtrace); /* AS-safe */
 
+#if defined(__linux__)
+/* A line of /proc/self/maps, the strings point into it and are not NUL-terminated */
+struct wander_mapping {
+    uintptr_t     begin;
+    uintptr_t     end;
+    const char   *perms;
+    uintptr_t     offset;
+    unsigned long dev_major;
+    unsigned long dev_minor;
+    unsigned long inode;
+    const char   *path; /* Empty for anonymous mappings */
+    size_t        path_size;
+};
+WANDER_INTERNAL(bool) wander_platform_maps(bool (*fn)(void *ud, const struct wander_mapping *mapping), void *ud); /* AS-safe */
+WANDER_INTERNAL(bool) wander_platform_maps_file(const char *path, bool (*fn)(void *ud, const struct wander_mapping *mapping), void *ud); /* AS-safe */
+#endif
+
 #endif /* !defined(WANDER_PLATFORM_H) */
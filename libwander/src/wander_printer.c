@@ -2,7 +2,23 @@
 
 #include "wander_internal.h"
 
+#if defined(__unix__)
+# include <fcntl.h> /* open */
+# include <pthread.h> /* pthread_key_create */
+# include <sys/mman.h> /* mmap */
+# include <sys/stat.h> /* fstat */
+# include <sys/uio.h> /* writev */
+#endif
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h> /* offsetof */
 #include <stdint.h>
+#include <stdlib.h> /* malloc, free */
 #include <string.h> /* strlen, memset */
 #include <unistd.h> /* write */
 
@@ -146,8 +162,198 @@ WANDER_FUN(wander_printer_t) wander_safe_printer(wander_writer_t writer, int ist
     if (istty) printer.details |= WANDER_DETAIL_TTY;
     return printer;
 }
+/* `wander_print` collects its output here, instead of writing every token on its own.
+ * The size is PIPE_BUF on Linux: a write of at most that many bytes to a pipe is not interleaved with those of other threads.
+ */
+#define PRINT_BUFFER_SIZE 4096
+/* The pool of the query `wander_print` resolves frames with, which is its own so other threads can print at the same time.
+ * It only has to hold the inlined calls of one frame, they are printed before the next frame is resolved.
+ */
+#define PRINT_MAX_INLINES 32
+struct print_buffer {
+    wander_printer_t  printer;     /* A copy of `target` that writes into `data` */
+    wander_printer_t *target;
+    size_t            used;
+    size_t            frame_start; /* Where the frame that is being printed starts, everything before is complete */
+    char              data[PRINT_BUFFER_SIZE];
+};
+struct print_segment {
+    const void *data;
+    size_t      size;
+};
+/* This function is AS-safe if `printer->writer` is safe. */
+static int print_segments(wander_printer_t *printer, struct print_segment *segments, size_t num_segments)
+{
+#if defined(__unix__)
+    if (printer->writer == wander_safe_stderr_writer) {
+        /* Our own writer, so everything can go out with a single system call */
+        struct iovec iov[2];
+        for (size_t i=0; i < num_segments; i++) {
+            iov[i].iov_base = (void *)segments[i].data;
+            iov[i].iov_len = segments[i].size;
+        }
+        struct iovec *next = iov;
+        int saved_errno = errno;
+        while (num_segments != 0) {
+            ssize_t res = writev(STDERR_FILENO, next, num_segments);
+            if (res == -1 && errno == EINTR) continue;
+            if (res <= 0) {
+                errno = saved_errno;
+                return -1;
+            }
+            /* Partial write, continue where it stopped */
+            for (; num_segments != 0 && (size_t)res >= next->iov_len; next++, num_segments--) res -= next->iov_len;
+            if (num_segments != 0) {
+                next->iov_base = (char *)next->iov_base + res;
+                next->iov_len -= res;
+            }
+        }
+        errno = saved_errno;
+        return 0;
+    }
+#endif
+    for (size_t i=0; i < num_segments; i++) {
+        if (segments[i].size != 0 && wander_printer_write(printer, segments[i].data, segments[i].size) < 0) return -1;
+    }
+    return 0;
+}
+/* This function is AS-safe. */
+static int print_buffer_writer(WANDER_SELF *self, const void *data, size_t size)
+{
+    struct print_buffer *buffer = (struct print_buffer *)((char *)self - offsetof(struct print_buffer, printer.writer));
+    if (buffer->used + size > sizeof(buffer->data) && buffer->frame_start != 0) {
+        /* Send the complete frames, and keep the rest of this one together */
+        struct print_segment complete = { buffer->data, buffer->frame_start };
+        if (print_segments(buffer->target, &complete, 1) < 0) return -1;
+        buffer->used -= buffer->frame_start;
+        memmove(buffer->data, buffer->data + buffer->frame_start, buffer->used);
+        buffer->frame_start = 0;
+    }
+    if (buffer->used + size > sizeof(buffer->data)) {
+        /* A single frame does not fit, this is as close as it gets */
+        struct print_segment segments[2] = { { buffer->data, buffer->used }, { data, size } };
+        buffer->used = 0;
+        return print_segments(buffer->target, segments, 2) < 0 ? -1 : (int)size;
+    }
+    memcpy(buffer->data + buffer->used, data, size);
+    buffer->used += size;
+    return size;
+}
+#if defined(__unix__)
+/* A source file, mapped into memory, and where its lines start.
+ * The index is only built once a snippet of the file is wanted, in anonymous memory so that no malloc is needed.
+ */
+struct snippet_file {
+    uint64_t    hash;      /* Of `path`, 0 if the entry is unused */
+    unsigned    last_used;
+    bool        exists;    /* Files that could not be read are remembered too, so they are only tried once */
+    const char *data;
+    size_t      size;
+    uint32_t   *lines;     /* Offset of the start of every line, followed by `size` */
+    size_t      num_lines;
+    size_t      lines_size;
+    char        path[WANDER_CONFIG_MAX_SHARED_STRING_SIZE];
+};
+#endif
+/* The buffers of `wander_print` and `wander_print_snippet`, which are too large for the small stack a signal handler
+ * may run on. Every thread maps its own on first use, as static TLS is too scarce for them.
+ * A part that is busy, because a signal handler interrupted the thread using it, is done without.
+ */
+struct print_scratch {
+    atomic_bool         buffer_busy;
+    struct print_buffer buffer;
+#if defined(__unix__)
+    atomic_bool         snippet_busy;
+    struct snippet_file snippet;
+    char                output[1024]; /* The lines of a snippet */
+#endif
+};
+#if defined(__unix__)
+static __thread _Atomic(struct print_scratch *) print_scratch __attribute__((tls_model("initial-exec")));
+static pthread_key_t print_scratch_key;
+static pthread_once_t print_scratch_once = PTHREAD_ONCE_INIT;
+static bool print_scratch_have_key;
+
+static void print_scratch_free(void *scratch)
+{
+    munmap(scratch, sizeof(struct print_scratch));
+}
+static void print_scratch_create_key(void)
+{
+    print_scratch_have_key = pthread_key_create(&print_scratch_key, print_scratch_free) == 0;
+}
+#else
+static struct print_scratch print_scratch_shared; /* Shared by all threads, the others print without */
+#endif
+/**
+ * Prepare for unmapping the buffers of `wander_print` when a thread exits.
+ */
+WANDER_FUN(void) wander_printer_init(void)
+{
+#if defined(__unix__)
+    pthread_once(&print_scratch_once, print_scratch_create_key);
+#endif
+}
+/* The scratch space of this thread, or NULL if it can not be mapped. This function is AS-safe. */
+static struct print_scratch *print_scratch_get(void)
+{
+#if defined(__unix__)
+    struct print_scratch *scratch = atomic_load(&print_scratch);
+    if (scratch != NULL) return scratch;
+    void *mapped = mmap(NULL, sizeof(struct print_scratch), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED) return NULL;
+    /* A signal handler may have mapped one meanwhile */
+    if (!atomic_compare_exchange_strong(&print_scratch, &scratch, mapped)) {
+        munmap(mapped, sizeof(struct print_scratch));
+        return scratch;
+    }
+    if (print_scratch_have_key) pthread_setspecific(print_scratch_key, mapped);
+    return mapped;
+#else
+    return &print_scratch_shared;
+#endif
+}
+/* Take the part of the scratch space that `busy` belongs to, returns false if it is in use. This function is AS-safe. */
+static bool print_scratch_claim(atomic_bool *busy)
+{
+    return !atomic_exchange(busy, true);
+}
+/* This function is AS-safe. */
+static void print_buffer_init(struct print_buffer *buffer, wander_printer_t *target)
+{
+    buffer->printer = *target;
+    buffer->printer.writer = print_buffer_writer;
+    buffer->target = target;
+    buffer->used = 0;
+    buffer->frame_start = 0;
+}
+/* This function is AS-safe if `buffer->target` is safe. */
+static int print_buffer_flush(struct print_buffer *buffer)
+{
+    struct print_segment segment = { buffer->data, buffer->used };
+    buffer->used = 0;
+    buffer->frame_start = 0;
+    return print_segments(buffer->target, &segment, 1);
+}
+/* This function is AS-safe if `printer->writer` is safe. */
+static void print_location(wander_printer_t *printer, wander_source_t source)
+{
+    wander_printer_writestr(printer, " at ");
+    if (source.directory) {
+        wander_printer_writestr(printer, source.directory);
+        wander_printer_writestr(printer, "/");
+    }
+    wander_printer_writestr(printer, source.filename);
+    wander_printer_writestr(printer, ":");
+    wander_printer_writedec(printer, source.lineno);
+    if (source.column) {
+        wander_printer_writestr(printer, ":");
+        wander_printer_writedec(printer, source.column);
+    }
+}
 /**
  * Print a stacktrace using the given printer.
+ * The output is collected in a buffer of this thread, and handed to the writer a few frames at a time.
  */
 WANDER_FUN(int) wander_print(wander_printer_t *printer, wander_backtrace_t *backtrace)
 {
@@ -155,14 +361,23 @@ WANDER_FUN(int) wander_print(wander_printer_t *printer, wander_backtrace_t *back
         wander_printer_writestr(printer, "Failed to obtain a stack trace!\n");
         return -1;
     }
-    wander_resolver_load(wander_global.resolver, backtrace);
+    wander_source_t locations[PRINT_MAX_INLINES];
+    wander_query_t query = wander_query_safe(wander_global.resolver, locations, PRINT_MAX_INLINES);
+    wander_query_load(&query, backtrace);
+    struct print_scratch *scratch = print_scratch_get();
+    struct print_buffer *buffer = scratch != NULL && print_scratch_claim(&scratch->buffer_busy) ? &scratch->buffer : NULL;
+    if (buffer != NULL) {
+        print_buffer_init(buffer, printer);
+        printer = &buffer->printer;
+    }
     wander_printer_writestr(printer, "Stack trace (most recent call last):\n");
     size_t max_len = wander_log10(backtrace->depth);
     for (size_t i=backtrace->offset; i < backtrace->depth; i++) {
+        if (buffer != NULL) buffer->frame_start = buffer->used;
         size_t idx = backtrace->depth - (i - backtrace->offset) - 1;
         wander_frame_t frame = wander_backtrace_frame(backtrace, idx);
         wander_resolution_t resolution_buffer;
-        wander_resolution_t *resolution = wander_resolve_frame_safe(wander_global.resolver, frame, &resolution_buffer);
+        wander_resolution_t *resolution = wander_query_resolve_frame_safe(&query, frame, &resolution_buffer);
         wander_printer_writestr(printer, "#");
         wander_printer_writedec(printer, idx);
         size_t len = wander_log10(idx);
@@ -197,30 +412,36 @@ WANDER_FUN(int) wander_print(wander_printer_t *printer, wander_backtrace_t *back
             wander_printer_writestr(printer, "???");
         }
         if (source.filename && source.lineno) {
-            wander_printer_writestr(printer, " at ");
-            if (source.directory) {
-                wander_printer_writestr(printer, source.directory);
-                wander_printer_writestr(printer, "/");
-            }
-            wander_printer_writestr(printer, source.filename);
-            wander_printer_writestr(printer, ":");
-            wander_printer_writedec(printer, source.lineno);
-            if (source.column) {
-                wander_printer_writestr(printer, ":");
-                wander_printer_writedec(printer, source.column);
-            }
+            print_location(printer, source);
         } else if ((source.function || symbol.name) && resolution->object) {
             wander_printer_writestr(printer, " from ");
             wander_printer_writestr(printer, resolution->object);
         }
         wander_printer_writestr(printer, "\n");
-        if (source.directory && source.filename && source.lineno && printer->snippet_context != 0) {
+        if ((printer->details & WANDER_DETAIL_SNIPPET) && source.directory && source.filename && source.lineno && printer->snippet_context != 0) {
             wander_print_snippet(printer, source.directory, source.filename, source.lineno - printer->snippet_context / 2, source.lineno + printer->snippet_context / 2);
         }
+        /* The functions `source.function` was inlined into share the frame, innermost first */
+        for (size_t j=0; j < resolution->num_inlines; j++) {
+            wander_source_t inlined = resolution->inlines[j];
+            len = 0;
+            do {
+                wander_printer_writestr(printer, " ");
+            } while (len++ < max_len + 1);
+            wander_printer_writestr(printer, "inlined into ");
+            wander_printer_writestr(printer, inlined.function ? inlined.function : "???");
+            wander_printer_writestr(printer, "()");
+            if (inlined.filename && inlined.lineno) {
+                print_location(printer, inlined);
+            }
+            wander_printer_writestr(printer, "\n");
+        }
         wander_destroy_resolution(&resolution);
     }
-
-    return 0;
+    if (buffer == NULL) return 0;
+    int res = print_buffer_flush(buffer);
+    atomic_store(&scratch->buffer_busy, false);
+    return res;
 }
 /**
  * Print a stacktrace using the given printer.
@@ -233,20 +454,292 @@ WANDER_FUN(int) wander_print_safe(wander_printer_t *printer, wander_backtrace_t
     return wander_print(printer, backtrace); /* `wander_print` is AS-safe if `printer->writer` is safe */
 }
 
+#if defined(__unix__)
+#if WANDER_CONFIG_SNIPPET_CACHE_SIZE > 0
+/* The files of the last snippets, most backtraces only touch a few.
+ * A thread that finds the cache busy (maybe because it interrupted the thread using it) maps the file just for itself.
+ */
+static struct {
+    atomic_flag         lock;
+    unsigned            clock;
+    struct snippet_file files[WANDER_CONFIG_SNIPPET_CACHE_SIZE];
+} snippet_cache = { .lock = ATOMIC_FLAG_INIT, .clock = 0 };
+#endif
+
+static uint64_t snippet_hash(const char *path)
+{
+    uint64_t hash = 0xcbf29ce484222325ull; /* FNV-1a */
+    for (; *path; path++) hash = (hash ^ (unsigned char)*path) * 0x100000001b3ull;
+    return hash | 1;
+}
+/* Find the start of every line after the first. Only counts them if `lines` is NULL. */
+static size_t snippet_scan(const char *data, size_t size, uint32_t *lines)
+{
+    size_t count = 0, i = 0;
+#if defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; i + 16 <= size; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(data + i));
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+        if (lines == NULL) {
+            count += __builtin_popcount(mask);
+            continue;
+        }
+        for (; mask != 0; mask &= mask - 1) lines[count++] = i + __builtin_ctz(mask) + 1;
+    }
+#endif
+    const char *eol;
+    while (i < size && (eol = memchr(data + i, '\n', size - i)) != NULL) {
+        i = eol - data + 1;
+        if (lines != NULL) lines[count] = i;
+        count++;
+    }
+    return count;
+}
+/* This function is AS-safe. */
+static bool snippet_index(struct snippet_file *file)
+{
+    if (file->lines != NULL) return true;
+    if (file->size >= UINT32_MAX) return false;
+    size_t num_lines = snippet_scan(file->data, file->size, NULL) + 1;
+    size_t lines_size = (num_lines + 1) * sizeof(uint32_t);
+    void *lines = mmap(NULL, lines_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (lines == MAP_FAILED) return false;
+    file->lines = lines;
+    file->lines[0] = 0;
+    snippet_scan(file->data, file->size, &file->lines[1]);
+    /* A last line that ends with a newline is not followed by another one */
+    if (file->lines[num_lines - 1] == file->size && num_lines > 1) num_lines--;
+    file->lines[num_lines] = file->size;
+    file->num_lines = num_lines;
+    file->lines_size = lines_size;
+    return true;
+}
+/* This function is AS-safe. */
+static void snippet_open(struct snippet_file *file)
+{
+    file->exists = false;
+    file->data = NULL;
+    file->size = 0;
+    file->lines = NULL;
+    file->num_lines = 0;
+    int fd = open(file->path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return;
+    struct stat sb;
+    if (fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode)) {
+        file->exists = true;
+        file->size = sb.st_size;
+        if (file->size != 0) {
+            void *data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) file->data = data;
+            else file->exists = false;
+        }
+    }
+    close(fd);
+}
+/* This function is AS-safe. */
+static void snippet_close(struct snippet_file *file)
+{
+    if (file->data != NULL) munmap((void *)file->data, file->size);
+    if (file->lines != NULL) munmap(file->lines, file->lines_size);
+    file->hash = 0;
+    file->data = NULL;
+    file->lines = NULL;
+}
+/* Get the file at `directory`/`filename`, from the cache if possible, or in `buffer` if not.
+ * If the result is in the cache, the cache stays locked until `snippet_release`.
+ * This function is AS-safe.
+ */
+static struct snippet_file *snippet_acquire(const char *directory, const char *filename, struct snippet_file *buffer)
+{
+    size_t directory_len = filename[0] == '/' ? 0 : strlen(directory);
+    size_t filename_len = strlen(filename);
+    if (directory_len + 1 + filename_len >= sizeof(buffer->path)) return NULL;
+    if (directory_len != 0) {
+        memcpy(buffer->path, directory, directory_len);
+        buffer->path[directory_len++] = '/';
+    }
+    memcpy(buffer->path + directory_len, filename, filename_len + 1);
+    uint64_t hash = snippet_hash(buffer->path);
+
+#if WANDER_CONFIG_SNIPPET_CACHE_SIZE > 0
+    if (!atomic_flag_test_and_set_explicit(&snippet_cache.lock, memory_order_acquire)) {
+        struct snippet_file *victim = &snippet_cache.files[0];
+        unsigned now = ++snippet_cache.clock;
+        for (size_t i=0; i < WANDER_CONFIG_SNIPPET_CACHE_SIZE; i++) {
+            struct snippet_file *file = &snippet_cache.files[i];
+            if (file->hash == hash && strcmp(file->path, buffer->path) == 0) {
+                file->last_used = now;
+                return file;
+            }
+            if (file->hash == 0 || (victim->hash != 0 && now - file->last_used > now - victim->last_used)) victim = file;
+        }
+        snippet_close(victim);
+        memcpy(victim->path, buffer->path, directory_len + filename_len + 1);
+        victim->hash = hash;
+        victim->last_used = now;
+        snippet_open(victim);
+        return victim;
+    }
+#endif
+    buffer->hash = hash;
+    snippet_open(buffer);
+    return buffer;
+}
+/* This function is AS-safe. */
+static void snippet_release(struct snippet_file *file, struct snippet_file *buffer)
+{
+    if (file == buffer) snippet_close(buffer);
+#if WANDER_CONFIG_SNIPPET_CACHE_SIZE > 0
+    else atomic_flag_clear_explicit(&snippet_cache.lock, memory_order_release);
+#endif
+}
+/* Find the lines `from` to `to` (inclusive, starting at 1), returns false if there are none.
+ * Without an index, the file is searched from the start.
+ * This function is AS-safe.
+ */
+static bool snippet_lines(struct snippet_file *file, size_t from, size_t to, size_t *begin, size_t *end)
+{
+    if (file->data == NULL || from > to) return false;
+    if (snippet_index(file)) {
+        if (from > file->num_lines) return false;
+        if (to > file->num_lines) to = file->num_lines;
+        *begin = file->lines[from - 1];
+        *end = file->lines[to];
+        return true;
+    }
+    size_t lineno = 1, offset = 0;
+    const char *eol;
+    while (lineno < from && (eol = memchr(file->data + offset, '\n', file->size - offset)) != NULL) {
+        offset = eol - file->data + 1;
+        lineno++;
+    }
+    if (lineno < from || offset == file->size) return false;
+    *begin = offset;
+    while (lineno <= to && (eol = memchr(file->data + offset, '\n', file->size - offset)) != NULL) {
+        offset = eol - file->data + 1;
+        lineno++;
+    }
+    *end = lineno <= to ? file->size : offset;
+    return true;
+}
+#endif
+/* Lines `from` to `to` (starting at 1) are wanted, `from` may have wrapped around below the first line */
+static size_t snippet_first_line(size_t from, size_t to)
+{
+    return from == 0 || from > to ? 1 : from;
+}
+
 /**
+ * Print lines `from` to `to` of a source file, and mark the one in the middle.
+ * The file stays mapped for the next snippets, up to `WANDER_CONFIG_SNIPPET_CACHE_SIZE` files are kept.
+ * The lines are collected and written at once, as long as they fit into a small buffer.
  * This function is AS-safe.
  */
 WANDER_FUN(int) wander_print_snippet(wander_printer_t *printer, const char *directory, const char *filename, size_t from, size_t to)
 {
-    return 0; /* TODO */
+#if defined(__unix__)
+    struct print_scratch *scratch = print_scratch_get();
+    if (scratch == NULL || !print_scratch_claim(&scratch->snippet_busy)) return -1;
+    struct snippet_file *buffer = &scratch->snippet;
+    char *output = scratch->output;
+    size_t marked = from + (to - from) / 2;
+    from = snippet_first_line(from, to);
+    struct snippet_file *file = snippet_acquire(directory, filename, buffer);
+    size_t begin, end;
+    if (file == NULL || !snippet_lines(file, from, to, &begin, &end)) {
+        if (file != NULL) snippet_release(file, buffer);
+        atomic_store(&scratch->snippet_busy, false);
+        return -1;
+    }
+    size_t used = 0, width = wander_log10(to);
+    int res = 0;
+    for (size_t lineno = from; begin < end; lineno++) {
+        const char *line = file->data + begin;
+        const char *eol = memchr(line, '\n', end - begin);
+        size_t len = eol != NULL ? (size_t)(eol - line) : end - begin;
+        begin += len + 1;
+        /* "  >  15 | code" */
+        char prefix[8 + 20 + 3];
+        size_t prefix_len = 0, digits = wander_log10(lineno);
+        memcpy(prefix, lineno == marked ? "  >  " : "     ", 5);
+        prefix_len = 5;
+        for (size_t i = digits; i < width; i++) prefix[prefix_len++] = ' ';
+        for (size_t i = 0, value = lineno; i < digits; i++, value /= 10) prefix[prefix_len + digits - i - 1] = '0' + value % 10;
+        prefix_len += digits;
+        memcpy(prefix + prefix_len, " | ", 3);
+        prefix_len += 3;
+        if (used + prefix_len + len + 1 > sizeof(scratch->output) && used != 0) {
+            if (wander_printer_write(printer, output, used) < 0) res = -1;
+            used = 0;
+        }
+        if (prefix_len + len + 1 > sizeof(scratch->output)) {
+            /* A very long line is written as it is */
+            if (wander_printer_write(printer, prefix, prefix_len) < 0 || wander_printer_write(printer, line, len) < 0 || wander_printer_write(printer, "\n", 1) < 0) res = -1;
+            continue;
+        }
+        memcpy(output + used, prefix, prefix_len);
+        memcpy(output + used + prefix_len, line, len);
+        used += prefix_len + len;
+        output[used++] = '\n';
+    }
+    if (used != 0 && wander_printer_write(printer, output, used) < 0) res = -1;
+    snippet_release(file, buffer);
+    atomic_store(&scratch->snippet_busy, false);
+    return res;
+#else
+    return -1;
+#endif
+}
+static void wander_free_snippet_lines(const char **lines)
+{
+    free((void *)lines);
 }
+/**
+ * Get lines `from` to `to` of a source file, each without its newline.
+ * `line_base` is the number of the first line, which may be after `from` if that is before the start of the file.
+ * The lines are copied, they must be released with `wander_free_snippet`.
+ */
 WANDER_FUN(wander_snippet_t) wander_get_snippet(wander_printer_t *printer, const char *directory, const char *filename, size_t from, size_t to)
 {
     wander_snippet_t snippet;
-    snippet.line_base = from - printer->snippet_context / 2;
+    snippet.line_base = snippet_first_line(from, to);
     snippet.num_lines = 0;
-    snippet.lines = NULL; /* TODO */
+    snippet.lines = NULL;
     snippet.free_fn = NULL;
+#if defined(__unix__)
+    struct snippet_file *buffer = malloc(sizeof(struct snippet_file));
+    struct snippet_file *file = buffer != NULL ? snippet_acquire(directory, filename, buffer) : NULL;
+    if (file == NULL) {
+        free(buffer);
+        return snippet;
+    }
+    size_t begin, end;
+    if (snippet_lines(file, snippet.line_base, to, &begin, &end)) {
+        /* The pointers, followed by the text, with every newline turned into a '\0' */
+        size_t num_lines = 0;
+        for (size_t i = begin; i < end; i++) num_lines += file->data[i] == '\n';
+        if (end == begin || file->data[end - 1] != '\n') num_lines++;
+        const char **lines = malloc(num_lines * sizeof(char *) + (end - begin) + 1);
+        if (lines != NULL) {
+            char *text = (char *)&lines[num_lines];
+            memcpy(text, file->data + begin, end - begin);
+            text[end - begin] = '\0';
+            for (size_t i = 0; i < num_lines; i++) {
+                lines[i] = text;
+                char *eol = strchr(text, '\n');
+                if (eol == NULL) break;
+                *eol = '\0';
+                text = eol + 1;
+            }
+            snippet.num_lines = num_lines;
+            snippet.lines = lines;
+            snippet.free_fn = wander_free_snippet_lines;
+        }
+    }
+    snippet_release(file, buffer);
+    free(buffer);
+#endif
     return snippet;
 }
 WANDER_FUN(void) wander_free_snippet(wander_snippet_t *snippet)
@@ -0,0 +1,456 @@
+#include <libwander/wander.h>
+#include <libwander/wander_profiler.h>
+
+#include "wander_internal.h"
+
+#if defined(__linux__)
+# include <errno.h>
+# include <pthread.h>
+# include <sched.h> /* sched_yield */
+# include <sys/syscall.h> /* SYS_gettid */
+# include <time.h> /* timer_create */
+# include <unistd.h>
+# ifndef sigev_notify_thread_id
+#  define sigev_notify_thread_id _sigev_un._tid
+# endif
+#endif
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h> /* malloc, free */
+#include <string.h> /* memset, memcmp */
+
+#define PROFILER_MAX_DEPTH   128  /* Frames kept of every sample */
+#define PROFILER_RING_SIZE   64   /* Samples a thread can take between two drains, must be a power of 2 */
+#define PROFILER_MAX_THREADS 1024 /* Threads that can be profiled at once, must be a power of 2 */
+#define PROFILER_DRAIN_MS    50   /* How often the drainer thread empties the rings */
+
+#if defined(__linux__)
+struct profiler_sample {
+    size_t offset;
+    size_t depth;
+    void  *frames[PROFILER_MAX_DEPTH];
+};
+/* Filled by the signal handler of one thread and emptied by the drainer thread */
+struct profiler_ring {
+    atomic_size_t          head; /* Written by the handler */
+    atomic_size_t          tail; /* Written by the drainer */
+    atomic_size_t          dropped;
+    timer_t                timer;
+    bool                   have_timer;
+    struct profiler_sample samples[PROFILER_RING_SIZE];
+};
+/* Threads are found by the handler in an open-addressing table, `tid` is 0 for a free entry and -1 for a removed one */
+struct profiler_thread {
+    atomic_int                     tid;
+    _Atomic(struct profiler_ring *) ring;
+};
+/* A distinct stack and how often it was sampled */
+struct profiler_stack {
+    uint64_t hash;
+    size_t   count;
+    size_t   depth;
+    void   **frames;
+};
+#endif
+
+struct wander_profiler {
+#if defined(__linux__)
+    long                    period; /* Nanoseconds of CPU time between samples */
+    pthread_mutex_t         lock; /* Protects everything except what the handler touches */
+    pthread_cond_t          wakeup;
+    pthread_t               drainer;
+    bool                    stopped;
+    struct profiler_thread *threads;
+    size_t                  num_stacks;
+    size_t                  max_stacks;
+    struct profiler_stack  *stacks;
+    size_t                  dropped;
+#endif
+};
+
+#if defined(__linux__)
+/* Only one profiler runs at a time.
+ * The handler stays installed after the profiler is stopped, so a late SIGPROF does not terminate the process.
+ * It counts itself in `active`, so the profiler is not freed while a handler might still look at it.
+ */
+static struct {
+    pthread_mutex_t              lock;
+    bool                         installed;
+    _Atomic(wander_profiler_t *) profiler;
+    atomic_size_t                active;
+} profiler_global = { PTHREAD_MUTEX_INITIALIZER, false, NULL, 0 };
+
+static struct profiler_thread *profiler_find(wander_profiler_t *profiler, int tid)
+{
+    for (size_t i=0; i < PROFILER_MAX_THREADS; i++) {
+        struct profiler_thread *thread = &profiler->threads[((size_t)tid + i) & (PROFILER_MAX_THREADS - 1)];
+        int entry = atomic_load(&thread->tid);
+        if (entry == tid) return thread;
+        if (entry == 0) break;
+    }
+    return NULL;
+}
+static void profiler_handler(int signo, siginfo_t *info, void *ucontext)
+{
+    (void)signo;
+    (void)info;
+    int saved_errno = errno;
+    atomic_fetch_add(&profiler_global.active, 1);
+    wander_profiler_t *profiler = atomic_load(&profiler_global.profiler);
+    struct profiler_thread *thread = profiler != NULL ? profiler_find(profiler, syscall(SYS_gettid)) : NULL;
+    struct profiler_ring *ring = thread != NULL ? atomic_load(&thread->ring) : NULL;
+    if (ring != NULL) {
+        size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head - tail < PROFILER_RING_SIZE) {
+            struct profiler_sample *sample = &ring->samples[head & (PROFILER_RING_SIZE - 1)];
+            wander_backtrace_t backtrace = wander_backtrace_safe(sample->frames, PROFILER_MAX_DEPTH);
+            wander_skip_signal_frames(&backtrace, wander_ucontext_pc(ucontext));
+            sample->offset = backtrace.offset;
+            sample->depth = backtrace.depth;
+            atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+        } else {
+            atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        }
+    }
+    atomic_fetch_sub(&profiler_global.active, 1);
+    errno = saved_errno;
+}
+
+static uint64_t profiler_hash(void **frames, size_t depth)
+{
+    uint64_t hash = 0xcbf29ce484222325ull; /* FNV-1a */
+    for (size_t i=0; i < depth; i++) {
+        hash ^= (uintptr_t)frames[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+static bool profiler_grow(wander_profiler_t *profiler)
+{
+    size_t max_stacks = profiler->max_stacks == 0 ? 1024 : profiler->max_stacks * 2;
+    struct profiler_stack *stacks = calloc(max_stacks, sizeof(struct profiler_stack));
+    if (stacks == NULL) return false;
+    for (size_t i=0; i < profiler->max_stacks; i++) {
+        struct profiler_stack *stack = &profiler->stacks[i];
+        if (stack->count == 0) continue;
+        size_t k = stack->hash & (max_stacks - 1);
+        while (stacks[k].count != 0) k = (k + 1) & (max_stacks - 1);
+        stacks[k] = *stack;
+    }
+    free(profiler->stacks);
+    profiler->stacks = stacks;
+    profiler->max_stacks = max_stacks;
+    return true;
+}
+static void profiler_count(wander_profiler_t *profiler, void **frames, size_t depth)
+{
+    if (depth == 0) return;
+    if (2 * (profiler->num_stacks + 1) > profiler->max_stacks && !profiler_grow(profiler)) return;
+    uint64_t hash = profiler_hash(frames, depth);
+    size_t k = hash & (profiler->max_stacks - 1);
+    for (;; k = (k + 1) & (profiler->max_stacks - 1)) {
+        struct profiler_stack *stack = &profiler->stacks[k];
+        if (stack->count == 0) break;
+        if (stack->hash == hash && stack->depth == depth && memcmp(stack->frames, frames, depth * sizeof(void *)) == 0) {
+            stack->count++;
+            return;
+        }
+    }
+    struct profiler_stack *stack = &profiler->stacks[k];
+    stack->frames = malloc(depth * sizeof(void *));
+    if (stack->frames == NULL) return;
+    memcpy(stack->frames, frames, depth * sizeof(void *));
+    stack->hash = hash;
+    stack->depth = depth;
+    stack->count = 1;
+    profiler->num_stacks++;
+}
+/* Move the samples of a thread into the table of stacks, with `profiler->lock` held */
+static void profiler_drain_ring(wander_profiler_t *profiler, struct profiler_ring *ring)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    for (; tail != head; tail++) {
+        struct profiler_sample *sample = &ring->samples[tail & (PROFILER_RING_SIZE - 1)];
+        if (sample->offset < sample->depth) profiler_count(profiler, &sample->frames[sample->offset], sample->depth - sample->offset);
+    }
+    atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    profiler->dropped += atomic_exchange_explicit(&ring->dropped, 0, memory_order_relaxed);
+}
+static void profiler_drain(wander_profiler_t *profiler)
+{
+    for (size_t i=0; i < PROFILER_MAX_THREADS; i++) {
+        struct profiler_ring *ring = atomic_load(&profiler->threads[i].ring);
+        if (ring != NULL) profiler_drain_ring(profiler, ring);
+    }
+}
+static void *profiler_drainer(void *ud)
+{
+    wander_profiler_t *profiler = ud;
+    pthread_mutex_lock(&profiler->lock);
+    while (!profiler->stopped) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += PROFILER_DRAIN_MS * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&profiler->wakeup, &profiler->lock, &deadline);
+        profiler_drain(profiler);
+    }
+    pthread_mutex_unlock(&profiler->lock);
+    return NULL;
+}
+static bool profiler_install(void)
+{
+    if (profiler_global.installed) return true;
+    struct sigaction action;
+    memset(&action, 0x00, sizeof(action));
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigfillset(&action.sa_mask);
+    action.sa_sigaction = &profiler_handler;
+    if (sigaction(SIGPROF, &action, NULL) != 0) return false;
+    profiler_global.installed = true;
+    return true;
+}
+#endif
+
+/**
+ * Start a sampling profiler that takes a backtrace of the calling thread `frequency` times per second of CPU time it uses.
+ * Other threads are profiled once they call `wander_profiler_add_thread`.
+ * The samples are taken in a SIGPROF handler with `wander_backtrace_safe`, and collected by a background thread.
+ * The application must not use SIGPROF itself, only one profiler can run at a time, and `wander_init` must have been called.
+ * Returns NULL on failure.
+ */
+WANDER_FUN(wander_profiler_t*) wander_profiler_start(unsigned frequency)
+{
+#if defined(__linux__)
+    if (frequency == 0 || frequency > 1000000000u) return NULL;
+    wander_profiler_t *profiler = calloc(1, sizeof(wander_profiler_t));
+    if (profiler == NULL) return NULL;
+    profiler->period = 1000000000L / frequency;
+    profiler->threads = calloc(PROFILER_MAX_THREADS, sizeof(struct profiler_thread));
+    if (profiler->threads == NULL) {
+        free(profiler);
+        return NULL;
+    }
+    pthread_mutex_init(&profiler->lock, NULL);
+    pthread_cond_init(&profiler->wakeup, NULL);
+
+    pthread_mutex_lock(&profiler_global.lock);
+    wander_profiler_t *expected = NULL;
+    bool ok = profiler_install() && atomic_compare_exchange_strong(&profiler_global.profiler, &expected, profiler);
+    pthread_mutex_unlock(&profiler_global.lock);
+    if (!ok || pthread_create(&profiler->drainer, NULL, profiler_drainer, profiler) != 0) {
+        if (ok) atomic_store(&profiler_global.profiler, NULL);
+        pthread_cond_destroy(&profiler->wakeup);
+        pthread_mutex_destroy(&profiler->lock);
+        free(profiler->threads);
+        free(profiler);
+        return NULL;
+    }
+    wander_profiler_add_thread(profiler);
+    return profiler;
+#else
+    return NULL;
+#endif
+}
+/**
+ * Start profiling the calling thread.
+ * Returns 0 on success, and -1 if the thread can not be profiled.
+ */
+WANDER_FUN(int) wander_profiler_add_thread(wander_profiler_t *profiler)
+{
+#if defined(__linux__)
+    int tid = syscall(SYS_gettid);
+    struct profiler_ring *ring = calloc(1, sizeof(struct profiler_ring));
+    if (ring == NULL) return -1;
+
+    /* A timer on the CPU time of this thread, that signals this thread */
+    struct sigevent event;
+    memset(&event, 0x00, sizeof(event));
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGPROF;
+    event.sigev_notify_thread_id = tid;
+    if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &ring->timer) != 0) {
+        free(ring);
+        return -1;
+    }
+    ring->have_timer = true;
+
+    pthread_mutex_lock(&profiler->lock);
+    struct profiler_thread *free_thread = NULL;
+    for (size_t i=0; !profiler->stopped && profiler_find(profiler, tid) == NULL && i < PROFILER_MAX_THREADS; i++) {
+        struct profiler_thread *thread = &profiler->threads[((size_t)tid + i) & (PROFILER_MAX_THREADS - 1)];
+        int entry = atomic_load(&thread->tid);
+        if (entry == 0 || entry == -1) {
+            free_thread = thread;
+            break;
+        }
+    }
+    if (free_thread != NULL) {
+        atomic_store(&free_thread->ring, ring);
+        atomic_store(&free_thread->tid, tid);
+    }
+    pthread_mutex_unlock(&profiler->lock);
+    if (free_thread == NULL) {
+        timer_delete(ring->timer);
+        free(ring);
+        return -1;
+    }
+
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = profiler->period / 1000000000L;
+    spec.it_interval.tv_nsec = profiler->period % 1000000000L;
+    spec.it_value = spec.it_interval;
+    timer_settime(ring->timer, 0, &spec, NULL);
+    return 0;
+#else
+    return -1;
+#endif
+}
+/**
+ * Stop profiling the calling thread, its samples so far are kept.
+ * Threads should do this before they exit.
+ */
+WANDER_FUN(void) wander_profiler_remove_thread(wander_profiler_t *profiler)
+{
+#if defined(__linux__)
+    int tid = syscall(SYS_gettid);
+    pthread_mutex_lock(&profiler->lock);
+    struct profiler_thread *thread = profiler_find(profiler, tid);
+    struct profiler_ring *ring = thread != NULL ? atomic_load(&thread->ring) : NULL;
+    if (ring != NULL) {
+        if (ring->have_timer) timer_delete(ring->timer);
+        ring->have_timer = false;
+        profiler_drain_ring(profiler, ring);
+        /* A tick that was already pending finds nothing from here on */
+        atomic_store(&thread->ring, NULL);
+        atomic_store(&thread->tid, -1);
+    }
+    pthread_mutex_unlock(&profiler->lock);
+    free(ring);
+#endif
+}
+/**
+ * Stop taking samples in every thread, the profile can be written out after this.
+ */
+WANDER_FUN(void) wander_profiler_stop(wander_profiler_t *profiler)
+{
+#if defined(__linux__)
+    pthread_mutex_lock(&profiler->lock);
+    if (profiler->stopped) {
+        pthread_mutex_unlock(&profiler->lock);
+        return;
+    }
+    for (size_t i=0; i < PROFILER_MAX_THREADS; i++) {
+        struct profiler_ring *ring = atomic_load(&profiler->threads[i].ring);
+        if (ring == NULL || !ring->have_timer) continue;
+        timer_delete(ring->timer);
+        ring->have_timer = false;
+    }
+    profiler->stopped = true;
+    pthread_cond_signal(&profiler->wakeup);
+    pthread_mutex_unlock(&profiler->lock);
+    pthread_join(profiler->drainer, NULL); /* It drains once more before it exits */
+
+    atomic_store(&profiler_global.profiler, NULL);
+    while (atomic_load(&profiler_global.active) != 0) sched_yield();
+    pthread_mutex_lock(&profiler->lock);
+    profiler_drain(profiler); /* Samples of handlers that were still running */
+    pthread_mutex_unlock(&profiler->lock);
+#endif
+}
+#if defined(__linux__)
+static void profiler_write_frame(wander_writer_t *writer, wander_batch_t *batch, wander_location_t *location)
+{
+    if (location->function != 0) {
+        wander_writestr(writer, batch->strings[location->function]);
+    } else if (location->symbol != 0) {
+        wander_writestr(writer, batch->strings[location->symbol]);
+    } else if (location->object != 0) {
+        const char *object = batch->strings[location->object];
+        const char *slash = strrchr(object, '/');
+        wander_writestr(writer, slash != NULL ? slash + 1 : object);
+        wander_writestr(writer, "+");
+        wander_writehex(writer, location->address - location->object_base);
+    } else {
+        wander_writehex(writer, location->address);
+    }
+}
+#endif
+/**
+ * Write the profile in the folded format of flamegraph.pl: one line per distinct stack,
+ * with the functions from the outermost to the innermost separated by ';', followed by a space and the number of samples.
+ * The stacks are resolved with one call to `wander_resolve_batch`, with the return addresses moved back into their calls.
+ * A stack can be on more than one line when it was interrupted at different instructions of the same function, flamegraph.pl adds those up.
+ * Returns 0 on success, and -1 on failure.
+ */
+WANDER_FUN(int) wander_profiler_write_folded(wander_profiler_t *profiler, wander_resolver_t *resolver, wander_writer_t *writer)
+{
+#if defined(__linux__)
+    pthread_mutex_lock(&profiler->lock);
+    profiler_drain(profiler);
+    size_t num_addrs = 0;
+    for (size_t i=0; i < profiler->max_stacks; i++) num_addrs += profiler->stacks[i].depth;
+    uintptr_t *addrs = malloc((num_addrs + 1) * sizeof(uintptr_t));
+    if (addrs == NULL) {
+        pthread_mutex_unlock(&profiler->lock);
+        return -1;
+    }
+    size_t k = 0;
+    for (size_t i=0; i < profiler->max_stacks; i++) {
+        struct profiler_stack *stack = &profiler->stacks[i];
+        /* Only the innermost frame is the interrupted instruction, the others are return addresses,
+         * which point past the call and might already belong to the next line or function
+         */
+        for (size_t j=0; j < stack->depth; j++) addrs[k++] = (uintptr_t)stack->frames[j] - (j > 0 ? 1 : 0);
+    }
+    wander_batch_t batch;
+    if (wander_resolve_batch(resolver, addrs, num_addrs, &batch) != 0) {
+        free(addrs);
+        pthread_mutex_unlock(&profiler->lock);
+        return -1;
+    }
+    k = 0;
+    for (size_t i=0; i < profiler->max_stacks; i++) {
+        struct profiler_stack *stack = &profiler->stacks[i];
+        if (stack->count == 0) continue;
+        for (size_t j=stack->depth; j-- > 0;) {
+            profiler_write_frame(writer, &batch, &batch.locations[batch.ids[k + j]]);
+            wander_writestr(writer, j > 0 ? ";" : " ");
+        }
+        wander_writedec(writer, stack->count);
+        wander_writestr(writer, "\n");
+        k += stack->depth;
+    }
+    wander_batch_free(&batch);
+    free(addrs);
+    pthread_mutex_unlock(&profiler->lock);
+    return 0;
+#else
+    return -1;
+#endif
+}
+/**
+ * Stop the profiler and release everything it uses.
+ */
+WANDER_FUN(void) wander_profiler_free(wander_profiler_t **profiler)
+{
+#if defined(__linux__)
+    wander_profiler_stop(*profiler);
+    for (size_t i=0; i < PROFILER_MAX_THREADS; i++) {
+        free(atomic_load(&(*profiler)->threads[i].ring));
+    }
+    for (size_t i=0; i < (*profiler)->max_stacks; i++) {
+        free((*profiler)->stacks[i].frames);
+    }
+    free((*profiler)->stacks);
+    free((*profiler)->threads);
+    pthread_cond_destroy(&(*profiler)->wakeup);
+    pthread_mutex_destroy(&(*profiler)->lock);
+#endif
+    free(*profiler);
+    *profiler = NULL;
+}
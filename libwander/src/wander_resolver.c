@@ -1,6 +1,8 @@
 #include <libwander/wander.h>
 
 #include "wander_internal.h"
+#include "wander_debugfile.h"
+#include "wander_symbolized.h"
 
 #include <assert.h>
 
@@ -12,16 +14,30 @@
 # include <sys/stat.h> /* struct stat */
 # include <fcntl.h> /* O_* */
 # include <unistd.h>
+# include <pthread.h> /* pthread_create */
+# include <sched.h> /* SCHED_IDLE */
+# include <time.h> /* clock_gettime */
 #elif defined(_WIN32)
 # include <windows.h>
 #endif
 
+#include <stdatomic.h>
 #include <stdlib.h> /* malloc, free */
 #include <string.h> /* memset */
 
 #include <dweller/dwarf.h>
 #include <dweller/stream.h>
 #include <dweller/libc.h>
+#include <dweller/arena.h>
+
+/* A lazy resolver only maps an object file once an address in it is resolved, see `map_lazily` */
+#if WANDER_CONFIG_RESOLVER_INDEX && WANDER_CONFIG_RESOLVER_LAZY && defined(__unix__)
+# define LAZY_MAPPING 1
+#else
+# define LAZY_MAPPING 0
+#endif
+
+#define RESOLVER_REFRESH_MS 100 /* `wander_resolve_addr` looks for loaded and unloaded objects at most this often, see `refresh_lazily` */
 
 /* NOTE: A lot of code in this file is non-portable.
  * This file is supposed to be a proof-of-concept more-so than production-ready code.
@@ -39,6 +55,12 @@ struct die_data {
     uint64_t    line_offset;
     bool        have_line_offset;
     bool        external;
+    dwarf_attr_t ranges;
+    bool        have_ranges;
+    uint64_t    origin; /* `.debug_info` offset of the `DW_AT_abstract_origin` or `DW_AT_specification`, or 0 */
+    uint64_t    call_file;
+    uint64_t    call_line;
+    uint64_t    call_column;
 };
 
 struct function {
@@ -64,6 +86,146 @@ struct function {
     struct die_data     die_data;
 };
 
+#if WANDER_CONFIG_RESOLVER_INDEX
+/* Flat lookup tables, built once by `wander_resolver_create`.
+ * Every table is sorted, so resolving an address is a handful of binary searches
+ * that neither allocate nor perform system calls. Strings point into the mapped object file.
+ */
+struct index_symbol {
+    uint64_t    addr;
+    uint64_t    size;
+    uint64_t    max_end; /* Highest `addr + size` of this and all preceding symbols */
+    const char *name;
+};
+struct index_function {
+    uint64_t    low_pc;
+    uint64_t    high_pc;
+    uint64_t    max_high_pc; /* Highest `high_pc` of this and all preceding functions */
+    const char *name;
+};
+struct index_range {
+    uint64_t    low_pc;
+    uint64_t    high_pc;
+    size_t      unit; /* Index into `units` (the `.debug_info` offset while building) */
+};
+struct index_unit {
+    dw_off_t    info_offset;
+    dw_off_t    line_offset; /* -1 if the unit has no line table */
+    size_t      program; /* Index into `programs`, or SIZE_MAX */
+};
+struct index_program {
+    dw_off_t    line_offset;
+    size_t      first_row;
+    size_t      num_rows;
+    size_t      first_file;
+    size_t      num_files;
+    size_t      file_base; /* Index of the first file entry (0 since DWARF 5, 1 before) */
+};
+struct index_row {
+    uint64_t    address;
+    uint32_t    order; /* Position in the line program, keeps sorting stable */
+    uint32_t    file;
+    uint32_t    line;
+    uint16_t    column;
+    bool        end_sequence;
+};
+struct index_file {
+    const char *name;
+    const char *directory;
+};
+/* A `DW_TAG_inlined_subroutine`, the location it was called from is in its caller */
+struct index_inline {
+    const char                *name;
+    const char                *call_filename;
+    const char                *call_directory;
+    uint32_t                   call_line;
+    uint32_t                   call_column;
+    const struct index_inline *caller; /* NULL if it was inlined into the function itself */
+    /* Only used while building */
+    size_t                     parent;
+    uint64_t                   origin;
+    dw_off_t                   unit;
+    uint64_t                   call_file;
+};
+/* Inlined code is properly nested, so the innermost inlined call containing an address is found by
+ * walking up the enclosing ranges of the last range that starts before it.
+ */
+struct index_inline_range {
+    uint64_t    low_pc;
+    uint64_t    high_pc;
+    size_t      parent; /* The enclosing range, or SIZE_MAX */
+    size_t      call; /* Index into `inlines` */
+};
+struct object_index {
+    size_t                  num_symbols;
+    struct index_symbol    *symbols;
+    size_t                  num_functions;
+    struct index_function  *functions;
+    size_t                  num_ranges;
+    struct index_range     *ranges;
+    size_t                  num_units;
+    struct index_unit      *units;
+    size_t                  num_programs;
+    struct index_program   *programs;
+    size_t                  num_rows;
+    struct index_row       *rows;
+    size_t                  num_files;
+    struct index_file      *files;
+    size_t                  num_inlines;
+    struct index_inline    *inlines;
+    size_t                  num_inline_ranges;
+    struct index_inline_range *inline_ranges;
+};
+/* An entry in the address -> object file map */
+struct index_object {
+    uint64_t            start;
+    uint64_t            end;
+    struct object_file *object_file;
+};
+/* An immutable snapshot of the loaded object files, replaced whenever objects are loaded or unloaded */
+struct object_map {
+    uint64_t            version; /* Cached resolutions are only valid for the map they were made with */
+    size_t              num_objects;
+    struct index_object objects[];
+};
+# if WANDER_CONFIG_RESOLVER_CACHE_SIZE > 0
+/* A resolution that was looked up before.
+ * Entries are protected by a sequence lock: `seq` is odd while the entry is being written,
+ * readers retry (or rather, treat it as a miss) if it changed while they were copying.
+ */
+struct cache_entry {
+    atomic_uint         seq;
+    atomic_uint         last_used;
+    uint64_t            version;
+    uintptr_t           address;
+    const char         *object;
+    size_t              object_base;
+    wander_source_t     source;
+    wander_symbol_t     symbol;
+    const struct index_inline *call; /* Expanded again on every hit, the pool entries do not outlive a backtrace */
+};
+#  define CACHE_WAYS 4
+# endif
+#endif
+
+#if defined(__unix__)
+/* The interface that JIT compilers use to tell debuggers about the code they generate,
+ * see "JIT Compilation Interface" in the GDB manual. Each entry is an ELF object file in memory.
+ */
+struct jit_code_entry {
+    struct jit_code_entry *next_entry;
+    struct jit_code_entry *prev_entry;
+    const char            *symfile_addr;
+    uint64_t               symfile_size;
+};
+struct jit_descriptor {
+    uint32_t               version;
+    uint32_t               action_flag;
+    struct jit_code_entry *relevant_entry;
+    struct jit_code_entry *first_entry;
+};
+#endif
+
 struct object_file {
     const char             *name;
     uint64_t                base;
@@ -75,6 +237,9 @@ struct object_file {
 #if defined(__unix__)
     int                     fd;
     const ElfW(Phdr)       *phdr;
+    char                    build_id[WANDER_BUILD_ID_SIZE]; /* Empty if unknown */
+    bool                    in_memory;  /* `data` is an image in memory instead of a mapped file, see `map_vdso` and `add_jit_object` */
+    void                   *copy;       /* Freed with the object file */
 #else
     HMODULE                 hModule;
     HANDLE                  hFile;
@@ -82,6 +247,16 @@ struct object_file {
 #endif
     struct dwarf           *dwarf;
     struct dwarf_errinfo    errinfo;
+    uint64_t                generation; /* The last scan that found this object loaded */
+    uint64_t                hash;       /* See `object_file_hash` */
+#if WANDER_CONFIG_RESOLVER_INDEX
+    struct object_index     index;
+    atomic_bool             indexed;    /* Readers may use `index`, it is cleared before the object file is unmapped */
+#endif
+#if LAZY_MAPPING
+    bool                    unreadable; /* Mapping it failed, so it is not tried again */
+    atomic_size_t           last_used;  /* When an address in it was last resolved, see `touch_object_file` */
+#endif
 };
 
 struct symbol {
@@ -89,32 +264,105 @@ struct symbol {
     struct object_file *object_file;
     struct function     fun;
 };
+/* The frames of the backtrace a query loaded without an index, filled in by `parse_object_files` */
+struct wander_query_frames {
+    wander_backtrace_t *backtrace;
+    size_t              num_frames;
+    size_t              max_frames;
+    char                buffer[WANDER_CONFIG_MAX_SHARED_STRING_SIZE]; /* The strings of the last frame resolved */
+    struct symbol       symbols[];
+};
+/* The query that the functions which take the resolver itself (`wander_resolver_load`, `wander_resolve_addr_safe`, ...)
+ * use on this thread, followed by the symbols of `frames` and the pool of `query`. It is mapped on first use, as these
+ * are AS-safe, and a thread that goes on to another resolver starts over with an empty pool.
+ * While `busy`, because a signal handler interrupted the thread using it, a handler does without.
+ */
+struct resolver_thread {
+    atomic_bool                 busy;
+    uint64_t                    resolver_id;
+    size_t                      size;      /* Of the mapping */
+    size_t                      max_depth; /* The room in `frames` and `locations`, those of `query` are the resolver's */
+    size_t                      max_locations;
+    wander_query_t              query;
+    struct wander_query_frames *frames;
+    wander_source_t            *locations;
+};
 
 struct wander_resolver {
-    wander_backtrace_t *backtrace;
+    uint64_t            id; /* Unique, so the state of a thread is never mistaken for that of a freed resolver */
     size_t              max_depth;
-
-    size_t              num_stack_frames;
-    struct symbol      *symbols;
-
     size_t              max_locations;
-    size_t              num_locations;
-    wander_source_t    *source_locations;
+
+    /* Without an index, the debug information is parsed into `arena` for one query at a time */
+    atomic_bool         parsing;
+    struct wander_query_frames *loading; /* The frames `parse_object_files` fills in */
+#if !defined(__unix__)
+    struct resolver_thread *thread; /* Shared by every thread */
+#endif
 
     size_t              max_object_files;
     size_t              num_object_files;
-    struct object_file *object_files;
+    struct object_file **object_files;        /* In the order they were found */
+    struct object_file **sorted_object_files; /* By address, see `find_object_file` */
+    size_t              num_object_slots;     /* A power of two, at least twice `num_object_files` */
+    struct object_file **object_slots;        /* An open addressing table by `hash`, see `next_object_file` */
 
     struct object_file *current_object_file;
 
-    int                 debug_dir;
+    /* The DWARF state of every object file comes from here, so parsing in a signal handler does not call malloc */
+    struct dweller_arena arena;
+    void               *arena_memory;
+    size_t              arena_mark; /* Blocks after the mark are only used while a section is parsed */
+
+#if WANDER_CONFIG_RESOLVER_INDEX
+    /* Readers register themselves in `map_readers[map_epoch & 1]` while they use `object_map`,
+     * an old map is freed once every reader that might have seen it is gone.
+     */
+    _Atomic(struct object_map *) object_map; /* NULL until the index may be used */
+    atomic_uint         map_epoch;
+    atomic_size_t       map_readers[2];
+    uint64_t            map_version;
+# if WANDER_CONFIG_RESOLVER_CACHE_SIZE > 0
+    struct cache_entry *cache; /* `WANDER_CONFIG_RESOLVER_CACHE_SIZE` entries in sets of `CACHE_WAYS` */
+    atomic_uint         cache_clock;
+# endif
+# if defined(__unix__)
+    pthread_mutex_t     update_lock;
+# endif
+# if LAZY_MAPPING
+    atomic_size_t       lru_clock; /* See `touch_object_file` */
+# endif
+
+    bool                detached; /* Only has the files added by `wander_resolver_add_file` */
+    uintptr_t           next_base; /* Where `wander_resolver_add_file` puts the next file */
+    atomic_bool         lazy_index; /* Objects are not loaded until an address has to be resolved in this process */
+# if defined(__unix__)
+    int                 symbolized_fd; /* Connection to `dweller-symbolized`, or -1 */
+    pthread_mutex_t     symbolized_lock;
+# endif
+
+    bool                warming_up; /* The index is being built by `warmup_thread` */
+    atomic_bool         cancel_warmup;
+# if defined(__unix__)
+    pthread_t           warmup_thread;
+# elif defined(_WIN32)
+    HANDLE              warmup_thread;
+# endif
+#endif
+
+    uint64_t            generation; /* Incremented on every scan of the loaded objects */
+    atomic_ullong       dl_adds; /* `dlpi_adds` and `dlpi_subs` as of the last scan, compared without the lock */
+    atomic_ullong       dl_subs;
+    atomic_llong        refreshed; /* When `refresh_lazily` last refreshed, in ms of CLOCK_MONOTONIC_COARSE */
+#if defined(__unix__)
+    struct jit_descriptor *_Atomic jit_descriptor; /* `__jit_debug_descriptor`, if some object defines it */
+    struct jit_descriptor  jit_seen;       /* Its contents as of the last scan */
+#endif
 
     uintptr_t           start_addr; // the address of _start
     uintptr_t           init_addr;  // the address of _init
     uintptr_t           fini_addr;  // the address of _fini
 
-    char                buffer[WANDER_CONFIG_MAX_SHARED_STRING_SIZE];
-
     void              (*free_fn)(void *ptr);
 };
 
@@ -218,8 +466,8 @@ static enum dw_cb_status my_die_attr_cb(struct dwarf *dwarf, dwarf_unit_t *unit,
     case DW_TAG_compile_unit:
     case DW_TAG_partial_unit:
         /* We are just here to search for the offset in `.debug_line` */
-        for (size_t i=0; i < resolver->num_stack_frames; i++) {
-            struct symbol *sym = &resolver->symbols[i];
+        for (size_t i=0; i < resolver->loading->num_frames; i++) {
+            struct symbol *sym = &resolver->loading->symbols[i];
             struct function *fun = &sym->fun;
             if (fun->have_info_offset) {
                 if (attr->name == DW_AT_stmt_list && unit->die.section_offset == fun->info_offset) {
@@ -238,8 +486,8 @@ static enum dw_cb_status my_die_attr_cb(struct dwarf *dwarf, dwarf_unit_t *unit,
     switch (attr->name) {
     case 0:
         /* End of DIE */
-        for (size_t i=0; i < resolver->num_stack_frames; i++) {
-            struct symbol *sym = &resolver->symbols[i];
+        for (size_t i=0; i < resolver->loading->num_frames; i++) {
+            struct symbol *sym = &resolver->loading->symbols[i];
             struct function *fun = &sym->fun;
             /* Check if our PC is within this function */
             if (data->have_low_pc && data->have_high_pc && sym->object_file) {
@@ -269,13 +517,21 @@ static enum dw_cb_status my_die_attr_cb(struct dwarf *dwarf, dwarf_unit_t *unit,
         }
         break;
     case DW_AT_name:
-        if (attr->form == DW_FORM_strp) {
+        switch (attr->form) {
+        case DW_FORM_strp:
+        case DW_FORM_strx:
+        case DW_FORM_strx1:
+        case DW_FORM_strx2:
+        case DW_FORM_strx3:
+        case DW_FORM_strx4:
             data->name.section = DWARF_SECTION_STR;
             data->name.off = attr->value.stroff;
             data->name.len = -1;
-        } else if (attr->form == DW_FORM_string) {
+            break;
+        case DW_FORM_string:
             data->name = attr->value.str;
             assert(data->name.section != DWARF_SECTION_UNKNOWN);
+            break;
         }
         break;
     case DW_AT_external:
@@ -287,16 +543,15 @@ static enum dw_cb_status my_die_attr_cb(struct dwarf *dwarf, dwarf_unit_t *unit,
         data->decl_line = attr->value.val;
         break;
     case DW_AT_low_pc:
-        assert(attr->form == DW_FORM_addr);
+        /* Indexed `DW_FORM_addrx*` are already resolved to an address */
         data->low_pc = attr->value.val;
         data->have_low_pc = true;
         break;
     case DW_AT_high_pc:
-        if (attr->form == DW_FORM_data1 || attr->form == DW_FORM_data2 || attr->form == DW_FORM_data4 || attr->form == DW_FORM_data8) {
+        if (attr->form == DW_FORM_data1 || attr->form == DW_FORM_data2 || attr->form == DW_FORM_data4 || attr->form == DW_FORM_data8 || attr->form == DW_FORM_udata) {
             assert(data->have_low_pc);
             data->high_pc = data->low_pc + attr->value.val;
         } else {
-            assert(attr->form == DW_FORM_addr);
             data->high_pc = attr->value.val;
         }
         data->have_high_pc = true;
@@ -309,8 +564,8 @@ static enum dw_cb_status my_die_cb(struct dwarf *dwarf, dwarf_unit_t *unit, dwar
 {
     wander_resolver_t *resolver = dwarf->data;
 
-    for (size_t i=0; i < resolver->num_stack_frames; i++) {
-        struct symbol *sym = &resolver->symbols[i];
+    for (size_t i=0; i < resolver->loading->num_frames; i++) {
+        struct symbol *sym = &resolver->loading->symbols[i];
         struct function *fun = &sym->fun;
         if (fun->found) continue;
         if (sym->object_file != resolver->current_object_file) continue;
@@ -320,7 +575,7 @@ static enum dw_cb_status my_die_cb(struct dwarf *dwarf, dwarf_unit_t *unit, dwar
         case DW_TAG_subprogram:
         case DW_TAG_inlined_subroutine:
         case DW_TAG_partial_unit:;
-            struct die_data *die_data = &resolver->symbols[i].fun.die_data; // TODO: Do we even need to allocate multiple die_data?
+            struct die_data *die_data = &resolver->loading->symbols[i].fun.die_data; // TODO: Do we even need to allocate multiple die_data?
             memset(die_data, 0x00, sizeof(struct die_data));
             die_data->decl_file = -1;
             die_data->decl_line = -1;
@@ -337,8 +592,8 @@ static enum dw_cb_status my_cu_cb(struct dwarf *dwarf, dwarf_cu_t *cu)
 {
     wander_resolver_t *resolver = dwarf->data;
 
-    for (size_t i=0; i < resolver->num_stack_frames; i++) {
-        struct symbol *sym = &resolver->symbols[i];
+    for (size_t i=0; i < resolver->loading->num_frames; i++) {
+        struct symbol *sym = &resolver->loading->symbols[i];
         struct function *fun = &sym->fun;
         if (fun->found) continue;
         if (sym->object_file != resolver->current_object_file) continue;
@@ -351,8 +606,8 @@ static enum dw_cb_status my_line_row_cb(struct dwarf *dwarf, struct dwarf_line_p
 {
     wander_resolver_t *resolver = dwarf->data;
 
-    for (size_t i=0; i < resolver->num_stack_frames; i++) {
-        struct symbol *sym = &resolver->symbols[i];
+    for (size_t i=0; i < resolver->loading->num_frames; i++) {
+        struct symbol *sym = &resolver->loading->symbols[i];
         struct function *fun = &sym->fun;
         if (fun->found_location) continue;
         if (sym->object_file != resolver->current_object_file) continue;
@@ -364,24 +619,28 @@ static enum dw_cb_status my_line_row_cb(struct dwarf *dwarf, struct dwarf_line_p
 #endif
         if (addr >= last_state->address && addr <= state->address) {
             /* Since a `call` instruction pushes the address AFTER the call, we must check last_state to get the correct line-number */
-            if (last_state->file == 0) continue;
-            assert(last_state->file > 0 && last_state->file <= program->num_files);
-            struct dwarf_fileinfo *file = &program->files[last_state->file - 1];
+            struct dwarf_fileinfo *file = dwarf_line_program_file(program, last_state->file);
+            if (!file) continue;
             fun->found_location = true;
             fun->decl_file = last_state->file;
             fun->decl_line = last_state->line;
             fun->filename = file->name;
-            if (file->include_directory_idx != 0) {
-                struct dwarf_pathinfo info = program->include_directories[file->include_directory_idx - 1];
-                switch (info.form) {
+            struct dwarf_pathinfo *info = dwarf_line_program_include_directory(program, file->include_directory_idx);
+            if (info) {
+                switch (info->form) {
                 case DW_FORM_string:
                     fun->include_dir.section = DWARF_SECTION_LINE;
-                    fun->include_dir.off = info.value.str.off;
-                    fun->include_dir.len = info.value.str.len;
+                    fun->include_dir.off = info->value.str.off;
+                    fun->include_dir.len = info->value.str.len;
                     break;
                 case DW_FORM_strp:
                     fun->include_dir.section = DWARF_SECTION_STR;
-                    fun->include_dir.off = info.value.stroff;
+                    fun->include_dir.off = info->value.stroff;
+                    fun->include_dir.len = -1;
+                    break;
+                case DW_FORM_line_strp:
+                    fun->include_dir.section = DWARF_SECTION_LINESTR;
+                    fun->include_dir.off = info->value.stroff;
                     fun->include_dir.len = -1;
                     break;
                 }
@@ -394,19 +653,31 @@ static enum dw_cb_status my_line_cb(struct dwarf *dwarf, struct dwarf_line_progr
 {
     wander_resolver_t *resolver = dwarf->data;
 
-    for (size_t i=0; i < resolver->num_stack_frames; i++) {
-        struct symbol *sym = &resolver->symbols[i];
+    for (size_t i=0; i < resolver->loading->num_frames; i++) {
+        struct symbol *sym = &resolver->loading->symbols[i];
         struct function *fun = &sym->fun;
         if (sym->object_file != resolver->current_object_file) continue;
         if (!fun->have_line_offset || program->section_offset != fun->line_offset) continue;
-        if (fun->decl_file != -1) {
-            assert(fun->decl_file > 0 && fun->decl_file <= program->num_files);
-            struct dwarf_fileinfo *file = &program->files[fun->decl_file - 1];
-            if (file->include_directory_idx != 0) {
-                struct dwarf_pathinfo info = program->include_directories[file->include_directory_idx - 1];
-                assert(info.form == DW_FORM_string);
-                fun->include_dir = info.value.str;
-                fun->include_dir.section = DWARF_SECTION_LINE;
+        struct dwarf_fileinfo *file = fun->decl_file != -1 ? dwarf_line_program_file(program, fun->decl_file) : NULL;
+        if (file) {
+            struct dwarf_pathinfo *info = dwarf_line_program_include_directory(program, file->include_directory_idx);
+            if (info) {
+                switch (info->form) {
+                case DW_FORM_string:
+                    fun->include_dir = info->value.str;
+                    fun->include_dir.section = DWARF_SECTION_LINE;
+                    break;
+                case DW_FORM_strp:
+                    fun->include_dir.section = DWARF_SECTION_STR;
+                    fun->include_dir.off = info->value.stroff;
+                    fun->include_dir.len = -1;
+                    break;
+                case DW_FORM_line_strp:
+                    fun->include_dir.section = DWARF_SECTION_LINESTR;
+                    fun->include_dir.off = info->value.stroff;
+                    fun->include_dir.len = -1;
+                    break;
+                }
             }
             fun->filename = file->name;
         }
@@ -418,9 +689,9 @@ static enum dw_cb_status my_arange_cb(struct dwarf *dwarf, dwarf_aranges_t *aran
 {
     wander_resolver_t *resolver = dwarf->data;
 
-    for (size_t i=0; i < resolver->num_stack_frames; i++) {
-        uintptr_t retaddr = (uintptr_t)resolver->symbols[i].address;
-        struct function *fun = &resolver->symbols[i].fun;
+    for (size_t i=0; i < resolver->loading->num_frames; i++) {
+        uintptr_t retaddr = (uintptr_t)resolver->loading->symbols[i].address;
+        struct function *fun = &resolver->loading->symbols[i].fun;
         // FIXME: It seems we don't need resolver->current_object_file->base on Win32? Perhaps we should detect if executable is relocatable?
         // Or do some tests on non-relocatable executables on unix
 #if _WIN32
@@ -440,9 +711,92 @@ static struct object_file *alloc_object_file(wander_resolver_t *resolver)
     if (resolver->num_object_files + 1 > resolver->max_object_files) {
         if (resolver->max_object_files == 0) resolver->max_object_files = 1;
         resolver->max_object_files *= 2;
-        resolver->object_files = realloc(resolver->object_files, resolver->max_object_files * sizeof(struct object_file));
+        resolver->object_files = realloc(resolver->object_files, resolver->max_object_files * sizeof(struct object_file *));
+        resolver->sorted_object_files = realloc(resolver->sorted_object_files, resolver->max_object_files * sizeof(struct object_file *));
+    }
+    /* Object files are allocated individually, so pointers to them stay valid when others are added or removed */
+    struct object_file *object_file = calloc(1, sizeof(struct object_file));
+    resolver->object_files[resolver->num_object_files++] = object_file;
+    return object_file;
+}
+/* Object files are looked up by their name and base address while the loaded objects are scanned,
+ * and by their build-id (or path, if there is none) in a detached resolver.
+ */
+static uint64_t object_file_hash(const char *key, uint64_t base)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (; *key != '\0'; key++) hash = (hash ^ (unsigned char)*key) * 0x100000001b3ull;
+    return (hash ^ base) * 0x9e3779b97f4a7c15ull;
+}
+static void place_object_file(wander_resolver_t *resolver, struct object_file *object_file)
+{
+    size_t mask = resolver->num_object_slots - 1, slot = object_file->hash & mask;
+    while (resolver->object_slots[slot] != NULL) slot = (slot + 1) & mask;
+    resolver->object_slots[slot] = object_file;
+}
+/* Rebuild the table of object files by hash, after objects were removed or it got too full. */
+static void rehash_object_files(wander_resolver_t *resolver)
+{
+    size_t num_slots = 16;
+    while (num_slots < 2 * resolver->num_object_files) num_slots *= 2;
+    free(resolver->object_slots);
+    resolver->object_slots = calloc(num_slots, sizeof(struct object_file *));
+    resolver->num_object_slots = resolver->object_slots != NULL ? num_slots : 0;
+    if (resolver->object_slots == NULL) return;
+    for (size_t i=0; i < resolver->num_object_files; i++) place_object_file(resolver, resolver->object_files[i]);
+}
+/* Add an object file from `alloc_object_file` to the table, once its hash is set. */
+static void insert_object_file(wander_resolver_t *resolver, struct object_file *object_file)
+{
+    if (2 * resolver->num_object_files > resolver->num_object_slots) rehash_object_files(resolver);
+    else place_object_file(resolver, object_file);
+}
+/* Returns the next object file with the given hash, starting the search at `*slot` (which should be `hash` initially), or NULL.
+ * Different keys can have the same hash, so the caller still has to compare them.
+ */
+static struct object_file *next_object_file(wander_resolver_t *resolver, uint64_t hash, size_t *slot)
+{
+    if (resolver->num_object_slots == 0) return NULL;
+    size_t mask = resolver->num_object_slots - 1;
+    for (; resolver->object_slots[*slot & mask] != NULL; (*slot)++) {
+        struct object_file *object_file = resolver->object_slots[*slot & mask];
+        if (object_file->hash != hash) continue;
+        (*slot)++;
+        return object_file;
+    }
+    return NULL;
+}
+static int object_file_compare(const void *a, const void *b)
+{
+    const struct object_file *lhs = *(struct object_file * const *)a, *rhs = *(struct object_file * const *)b;
+    uint64_t lhs_start = lhs->base + lhs->vaddr, rhs_start = rhs->base + rhs->vaddr;
+    if (lhs_start != rhs_start) return lhs_start < rhs_start ? -1 : 1;
+    return 0;
+}
+/* Sort the object files by address and rebuild the table by hash, whenever the set of object files changed. */
+static void sort_object_files(wander_resolver_t *resolver)
+{
+    if (resolver->num_object_files > 0) {
+        memcpy(resolver->sorted_object_files, resolver->object_files, resolver->num_object_files * sizeof(struct object_file *));
+        qsort(resolver->sorted_object_files, resolver->num_object_files, sizeof(struct object_file *), object_file_compare);
+    }
+    rehash_object_files(resolver);
+}
+/* Returns the object file whose executable segment contains `addr`, or NULL.
+ * This function is AS-safe.
+ */
+static struct object_file *find_object_file(wander_resolver_t *resolver, uintptr_t addr)
+{
+    size_t lo = 0, hi = resolver->num_object_files;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        struct object_file *object_file = resolver->sorted_object_files[mid];
+        if (object_file->base + object_file->vaddr <= addr) lo = mid + 1;
+        else hi = mid;
     }
-    return &resolver->object_files[resolver->num_object_files++];
+    if (lo == 0) return NULL;
+    struct object_file *object_file = resolver->sorted_object_files[lo - 1];
+    return addr < object_file->base + object_file->vaddr + object_file->memsz ? object_file : NULL;
 }
 
 static void load_section(struct object_file *object_file, const char *name, struct dwarf_section section)
@@ -452,9 +806,72 @@ static void load_section(struct object_file *object_file, const char *name, stru
     else if (strcmp(name, ".debug_info") == 0) dwarf_load_section(object_file->dwarf, DWARF_SECTION_INFO, section, &object_file->errinfo);
     else if (strcmp(name, ".debug_line") == 0) dwarf_load_section(object_file->dwarf, DWARF_SECTION_LINE, section, &object_file->errinfo);
     else if (strcmp(name, ".debug_str") == 0) dwarf_load_section(object_file->dwarf, DWARF_SECTION_STR, section, &object_file->errinfo);
+    else if (strcmp(name, ".debug_line_str") == 0) dwarf_load_section(object_file->dwarf, DWARF_SECTION_LINESTR, section, &object_file->errinfo);
+    else if (strcmp(name, ".debug_str_offsets") == 0) dwarf_load_section(object_file->dwarf, DWARF_SECTION_STROFFSETS, section, &object_file->errinfo);
+    else if (strcmp(name, ".debug_addr") == 0) dwarf_load_section(object_file->dwarf, DWARF_SECTION_ADDR, section, &object_file->errinfo);
+    else if (strcmp(name, ".debug_ranges") == 0) dwarf_load_section(object_file->dwarf, DWARF_SECTION_RANGES, section, &object_file->errinfo);
+    else if (strcmp(name, ".debug_rnglists") == 0) dwarf_load_section(object_file->dwarf, DWARF_SECTION_RANGELISTS, section, &object_file->errinfo);
+    else if (strcmp(name, ".debug_loclists") == 0) dwarf_load_section(object_file->dwarf, DWARF_SECTION_LOCATIONLISTS, section, &object_file->errinfo);
 }
 
 #if defined(__unix__)
+/* Map the debug information of an object file, from a separate debug file if there is one. */
+static bool map_object_file(struct object_file *object_file, const char *path)
+{
+    struct stat sb;
+    object_file->fd = wander_debugfile_open(object_file->build_id, path);
+    if (object_file->fd == -1) return false;
+    if (fstat(object_file->fd, &sb) == -1) {
+        close(object_file->fd);
+        object_file->fd = -1;
+        return false;
+    }
+    object_file->size = sb.st_size;
+    object_file->data = mmap(NULL, object_file->size, PROT_READ, MAP_SHARED, object_file->fd, 0);
+    if (object_file->data == MAP_FAILED) {
+        object_file->data = NULL;
+        close(object_file->fd);
+        object_file->fd = -1;
+        return false;
+    }
+    return true;
+}
+/* Symbols of relocatable object files (like JIT code) are relative to their section, which was placed at `sh_addr`. */
+static uint64_t symbol_address(const Elf64_Ehdr *ehdr, const Elf64_Shdr *shdrs, const Elf64_Sym *sym)
+{
+    if (ehdr->e_type == ET_REL && sym->st_shndx < ehdr->e_shnum) return shdrs[sym->st_shndx].sh_addr + sym->st_value;
+    return sym->st_value;
+}
+/* Returns true if the ELF image of `size` bytes at `data` has its section headers, so it can be read like a file. */
+static bool elf_image_complete(const uint8_t *data, size_t size)
+{
+    const Elf64_Ehdr *ehdr = (const Elf64_Ehdr *)data;
+    if (size < sizeof(Elf64_Ehdr) || memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 || ehdr->e_ident[EI_CLASS] != ELFCLASS64) return false;
+    if (ehdr->e_shentsize != sizeof(Elf64_Shdr) || ehdr->e_shoff > size || (size - ehdr->e_shoff) / sizeof(Elf64_Shdr) < ehdr->e_shnum) return false;
+    return ehdr->e_shnum > 0 && ehdr->e_shstrndx < ehdr->e_shnum;
+}
+/* The vDSO has no file, but the kernel maps all of its image, so it is read in place.
+ * The section headers come last in the image, past the loadable segment.
+ */
+static bool map_vdso(struct object_file *object_file, const struct dl_phdr_info *info)
+{
+    uintptr_t vdso = getauxval(AT_SYSINFO_EHDR);
+    if (vdso == 0) return false;
+    for (size_t k = 0; k < info->dlpi_phnum; k++) {
+        const ElfW(Phdr) *phdr = &info->dlpi_phdr[k];
+        if (phdr->p_type != PT_LOAD || phdr->p_offset != 0) continue;
+        if (info->dlpi_addr + phdr->p_vaddr != vdso) return false;
+        const Elf64_Ehdr *ehdr = (const Elf64_Ehdr *)vdso;
+        size_t size = ehdr->e_shoff + (size_t)ehdr->e_shnum * ehdr->e_shentsize;
+        if (!elf_image_complete((const uint8_t *)vdso, size)) return false;
+        object_file->data = (uint8_t *)vdso;
+        object_file->size = size;
+        object_file->in_memory = true;
+        object_file->fd = -1;
+        return true;
+    }
+    return false;
+}
 static int phdr_iterate_callback(struct dl_phdr_info *info, size_t size, void *ud)
 {
     wander_resolver_t *resolver = (wander_resolver_t*)ud;
@@ -463,6 +880,11 @@ static int phdr_iterate_callback(struct dl_phdr_info *info, size_t size, void *u
     // However, this will stop the phdr iteration.
     // Find some other way to signal errors
 
+    if (size >= offsetof(struct dl_phdr_info, dlpi_subs) + sizeof(info->dlpi_subs)) {
+        resolver->dl_adds = info->dlpi_adds;
+        resolver->dl_subs = info->dlpi_subs;
+    }
+
     const char *soname = info->dlpi_name;
     if (!soname || soname[0] == '\0') soname = (const char *)getauxval(AT_EXECFN);
     if (!soname || soname[0] == '\0') soname = "/proc/self/exe";
@@ -487,71 +909,123 @@ static int phdr_iterate_callback(struct dl_phdr_info *info, size_t size, void *u
         if (phdr->p_type != PT_LOAD) continue;
         if ((phdr->p_flags & PF_X) == 0) continue;
 
+        uint64_t hash = object_file_hash(soname, info->dlpi_addr);
         struct object_file *object_file = NULL;
-        for (size_t i=0; i < resolver->num_object_files; i++) {
-            struct object_file *obj_file = &resolver->object_files[i];
-            if (strcmp(soname, obj_file->name) == 0) {
-                object_file = obj_file;
-            }
+        for (size_t slot=hash; (object_file = next_object_file(resolver, hash, &slot)) != NULL;) {
+            if (object_file->base == info->dlpi_addr && strcmp(soname, object_file->name) == 0) break;
         }
-        if (object_file == NULL) {
-            static struct stat sb;
+        if (object_file != NULL) {
+            object_file->generation = resolver->generation;
+        } else {
             object_file = alloc_object_file(resolver);
             memset(object_file, 0x00, sizeof(struct object_file));
             object_file->phdr = phdr;
             object_file->base = info->dlpi_addr;
             object_file->vaddr = phdr->p_vaddr;
             object_file->memsz = phdr->p_memsz;
-            object_file->name = soname;
+            object_file->generation = resolver->generation;
+            object_file->hash = hash;
+            insert_object_file(resolver, object_file);
+            /* `dlpi_name` goes away with the object, which might outlive it in our object map */
+            object_file->name = strdup(soname);
             object_file->is_exe = (k == 0);
-            object_file->fd = -1;
-            if (resolver->debug_dir != -1) {
-                /* Some libraries are symlinked for backwards
-                 * compatability (notably libc)
-                 * Try to find the real location
-                 */
-                char *sopath = realpath(soname, NULL);
-                if (sopath != NULL) {
-                    size_t sopath_sz = strlen(sopath);
-                    /* Create a relative path to search for in debug_dir
-                     */
-                    sopath = realloc(sopath, sopath_sz + 3);
-                    if (!sopath) return 0; // TODO: Signal error
-                    memmove(sopath + 2, sopath, sopath_sz + 1);
-                    sopath[0] = '.';
-                    sopath[1] = '/';
-                    /* Find it in the debug directory */
-                    object_file->fd = openat(resolver->debug_dir, sopath, O_RDONLY);
-                    free(sopath);
-                }
-            }
-            if (object_file->fd == -1) {
-                /* Let's hope the library itself has debug symbols
-                 */
-                object_file->fd = open(soname, O_RDONLY);
-            }
-            if (object_file->fd == -1) return 0; // TODO: Signal error
-            if (fstat(object_file->fd, &sb) == -1) {
-                close(object_file->fd);
-                return 0; // TODO: Signal error
-            }
-            object_file->size = sb.st_size;
-            object_file->data = mmap(NULL, object_file->size, PROT_READ, MAP_SHARED, object_file->fd, 0);
-            if (object_file->data == MAP_FAILED) {
-                close(object_file->fd);
-                return 0; // TODO: Signal error
+            wander_debugfile_build_id(info, object_file->build_id, sizeof(object_file->build_id));
+#if LAZY_MAPPING
+            /* Only libc is mapped right away, `load_object_files` looks for the signal trampolines in it */
+            bool need_now = strstr(soname, "/libc.so") && wander_global.platform.sym_restore == NULL && wander_global.platform.sym_restore_rt == NULL;
+            if (!need_now) {
+                object_file->fd = -1;
+                map_vdso(object_file, info); /* Nothing to map, it is in memory already */
+                continue;
             }
+#endif
+            if (!map_object_file(object_file, soname) && !map_vdso(object_file, info)) return 0; // TODO: Signal error
         }
     }
 
     return 0;
 }
+/* Add the object file of a JIT code entry, or mark it as still registered.
+ * The JIT may free the entry as soon as it unregisters it, so the object file is copied.
+ */
+static void add_jit_object(wander_resolver_t *resolver, const struct jit_code_entry *entry)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "<in-memory@%p>", (const void *)entry->symfile_addr); /* Like GDB calls them */
+    uint64_t hash = object_file_hash(name, 0);
+    struct object_file *object_file;
+    for (size_t slot=hash; (object_file = next_object_file(resolver, hash, &slot)) != NULL;) {
+        if (object_file->in_memory && object_file->size == entry->symfile_size && strcmp(object_file->name, name) == 0) {
+            object_file->generation = resolver->generation;
+            return;
+        }
+    }
+    const uint8_t *image = (const uint8_t *)entry->symfile_addr;
+    if (image == NULL || !elf_image_complete(image, entry->symfile_size)) return;
+    /* The JIT placed the sections at `sh_addr`, the object is the range of its code */
+    const Elf64_Ehdr *ehdr = (const Elf64_Ehdr *)image;
+    const Elf64_Shdr *shdrs = (const Elf64_Shdr *)(image + ehdr->e_shoff);
+    uint64_t begin = UINT64_MAX, end = 0;
+    for (size_t i=0; i < ehdr->e_shnum; i++) {
+        if ((shdrs[i].sh_flags & SHF_EXECINSTR) == 0 || shdrs[i].sh_addr == 0 || shdrs[i].sh_size == 0) continue;
+        if (shdrs[i].sh_addr < begin) begin = shdrs[i].sh_addr;
+        if (shdrs[i].sh_addr + shdrs[i].sh_size > end) end = shdrs[i].sh_addr + shdrs[i].sh_size;
+    }
+    if (begin >= end) return;
+    void *copy = malloc(entry->symfile_size);
+    char *copy_name = strdup(name);
+    if (copy == NULL || copy_name == NULL) {
+        free(copy);
+        free(copy_name);
+        return;
+    }
+    memcpy(copy, image, entry->symfile_size);
+    object_file = alloc_object_file(resolver);
+    object_file->name = copy_name;
+    object_file->fd = -1;
+    object_file->vaddr = begin;
+    object_file->memsz = end - begin;
+    object_file->data = copy;
+    object_file->size = entry->symfile_size;
+    object_file->in_memory = true;
+    object_file->copy = copy;
+    object_file->generation = resolver->generation;
+    object_file->hash = hash;
+    insert_object_file(resolver, object_file);
+}
+#if WANDER_CONFIG_RESOLVER_INDEX
+/* Returns true if code was registered or unregistered through the JIT interface since the last scan.
+ * Every registration points `relevant_entry` at the entry and sets `action_flag` before it tells the debugger.
+ */
+static bool jit_changed(wander_resolver_t *resolver)
+{
+    struct jit_descriptor *descriptor = resolver->jit_descriptor;
+    if (descriptor == NULL) return false;
+    return descriptor->first_entry != resolver->jit_seen.first_entry || descriptor->relevant_entry != resolver->jit_seen.relevant_entry
+        || descriptor->action_flag != resolver->jit_seen.action_flag;
+}
+#endif
+/* Add the code registered through the JIT interface since the last scan, and mark what is still registered.
+ * The list is read while the JIT might change it, like a debugger would if it did not stop the process.
+ */
+static void load_jit_objects(wander_resolver_t *resolver)
+{
+    struct jit_descriptor *descriptor = resolver->jit_descriptor;
+    if (descriptor == NULL) return;
+    resolver->jit_seen = *descriptor;
+    for (const struct jit_code_entry *entry = resolver->jit_seen.first_entry; entry != NULL; entry = entry->next_entry) {
+        add_jit_object(resolver, entry);
+    }
+}
 static void load_object_files(wander_resolver_t *resolver)
 {
     dl_iterate_phdr(phdr_iterate_callback, resolver);
+    resolver->jit_descriptor = dlsym(RTLD_DEFAULT, "__jit_debug_descriptor");
+    load_jit_objects(resolver);
+    sort_object_files(resolver);
     if (wander_global.platform.sym_restore == NULL && wander_global.platform.sym_restore_rt == NULL) {
         for (size_t i=0; i < resolver->num_object_files; i++) {
-            struct object_file *object_file = &resolver->object_files[i];
+            struct object_file *object_file = resolver->object_files[i];
             Elf64_Ehdr *ehdr = (Elf64_Ehdr *)object_file->data;
             if (ehdr == NULL) continue; /* object file is not mapped */
             if (i == 0) {
@@ -589,11 +1063,9 @@ static void load_object_files(wander_resolver_t *resolver)
         }
     }
 }
-static void load_debug_sections(wander_resolver_t *resolver, struct object_file *object_file)
+static void load_symbols(wander_resolver_t *resolver, struct object_file *object_file)
 {
     Elf64_Ehdr *ehdr = (Elf64_Ehdr *)object_file->data;
-    Elf64_Shdr *shstrh = (Elf64_Shdr *)(object_file->data + ehdr->e_shoff + (ehdr->e_shstrndx * ehdr->e_shentsize));
-    char *shstrs = (char *)(object_file->data + shstrh->sh_offset);
     Elf64_Shdr *shdrs = (Elf64_Shdr *)(object_file->data + ehdr->e_shoff);
     for (size_t j=0; j < ehdr->e_shnum; j++) {
         assert(sizeof(Elf64_Shdr) == ehdr->e_shentsize);
@@ -607,16 +1079,17 @@ static void load_debug_sections(wander_resolver_t *resolver, struct object_file
                 Elf64_Sym *sym = (Elf64_Sym *)(object_file->data + symtab->sh_offset);
                 size_t size = symtab->sh_size;
                 while (size > sizeof(Elf64_Sym)) {
-                    for (size_t k=0; k < resolver->num_stack_frames; k++) {
-                        struct symbol *funsym = &resolver->symbols[k];
+                    uint64_t value = symbol_address(ehdr, shdrs, sym);
+                    for (size_t k=0; k < resolver->loading->num_frames; k++) {
+                        struct symbol *funsym = &resolver->loading->symbols[k];
                         struct function *fun = &funsym->fun;
                         if (fun->found && fun->name.section != DWARF_SECTION_UNKNOWN) continue;
-                        bool is_same = funsym->address == (void *)(object_file->base + sym->st_value);
-                        bool in_range = funsym->address >= (void *)(object_file->base + sym->st_value)
-                                     && funsym->address < (void *)(object_file->base + sym->st_value + sym->st_size);
+                        bool is_same = funsym->address == (void *)(object_file->base + value);
+                        bool in_range = funsym->address >= (void *)(object_file->base + value)
+                                     && funsym->address < (void *)(object_file->base + value + sym->st_size);
                         if (is_same || in_range) {
                             fun->symname = &strs[sym->st_name];
-                            fun->symaddr = (void *)(object_file->base + sym->st_value);
+                            fun->symaddr = (void *)(object_file->base + value);
                             fun->symsize = sym->st_size;
                         }
                     }
@@ -626,6 +1099,18 @@ static void load_debug_sections(wander_resolver_t *resolver, struct object_file
             }
             break;
         }
+    }
+}
+static void load_debug_sections(wander_resolver_t *resolver, struct object_file *object_file)
+{
+    (void)resolver;
+    Elf64_Ehdr *ehdr = (Elf64_Ehdr *)object_file->data;
+    Elf64_Shdr *shstrh = (Elf64_Shdr *)(object_file->data + ehdr->e_shoff + (ehdr->e_shstrndx * ehdr->e_shentsize));
+    char *shstrs = (char *)(object_file->data + shstrh->sh_offset);
+    Elf64_Shdr *shdrs = (Elf64_Shdr *)(object_file->data + ehdr->e_shoff);
+    for (size_t j=0; j < ehdr->e_shnum; j++) {
+        assert(sizeof(Elf64_Shdr) == ehdr->e_shentsize);
+        Elf64_Shdr *shdr = &shdrs[j];
         char *name = &shstrs[shdr->sh_name];
         struct dwarf_section section;
         section.base = object_file->data + shdr->sh_offset;
@@ -633,6 +1118,15 @@ static void load_debug_sections(wander_resolver_t *resolver, struct object_file
         load_section(object_file, name, section);
     }
 }
+static void unmap_object_file(struct object_file *object_file)
+{
+    if (object_file->data != NULL && !object_file->in_memory) munmap(object_file->data, object_file->size);
+    if (object_file->fd != -1) close(object_file->fd);
+    free(object_file->copy);
+    object_file->data = NULL;
+    object_file->copy = NULL;
+    object_file->fd = -1;
+}
 #elif defined(_WIN32)
 HMODULE GetCurrentModule() {
     HMODULE hModule = NULL;
@@ -703,8 +1197,13 @@ static void load_object_files(wander_resolver_t *resolver)
     object_file->base = hCurrentModule;
     object_file->vaddr = oh->BaseOfCode;
     object_file->memsz = oh->SizeOfCode;
-    object_file->name = currentModuleName; // FIXME: Memory leak
+    object_file->name = currentModuleName;
     object_file->is_exe = true;
+    sort_object_files(resolver);
+}
+static void load_symbols(wander_resolver_t *resolver, struct object_file *object_file)
+{
+    /* TODO: Read the COFF symbol table */
 }
 static void load_debug_sections(wander_resolver_t *resolver, struct object_file *object_file)
 {
@@ -734,23 +1233,86 @@ static void load_debug_sections(wander_resolver_t *resolver, struct object_file
         load_section(object_file, name, section);
     }
 }
+static void unmap_object_file(struct object_file *object_file)
+{
+    if (object_file->data != NULL) UnmapViewOfFile(object_file->data);
+    if (object_file->hFileMapping) CloseHandle(object_file->hFileMapping);
+    if (object_file->hFile != INVALID_HANDLE_VALUE) CloseHandle(object_file->hFile);
+    object_file->data = NULL;
+}
 #else
 # error "Platform not (yet) supported"
 #endif
 
+/* Initialize the DWARF context of an object file, this only has to be done once. */
+static bool open_object_file_dwarf(wander_resolver_t *resolver, struct object_file *object_file)
+{
+    if (object_file->dwarf != NULL) return true;
+    if (!dwarf_init(&object_file->dwarf, &resolver->arena.allocator, &object_file->errinfo)) return false;
+    load_debug_sections(resolver, object_file);
+    if (dwarf_has_section(object_file->dwarf, DWARF_SECTION_ABBREV, &object_file->errinfo)) dwarf_parse_section(object_file->dwarf, DWARF_SECTION_ABBREV, &object_file->errinfo);
+    /* The abbreviations are kept for as long as the object file */
+    resolver->arena_mark = dweller_arena_mark(&resolver->arena);
+    return true;
+}
+#if WANDER_CONFIG_RESOLVER_INDEX
+static void index_free(struct object_index *index)
+{
+    free(index->symbols);
+    free(index->functions);
+    free(index->ranges);
+    free(index->units);
+    free(index->programs);
+    free(index->rows);
+    free(index->files);
+    free(index->inlines);
+    free(index->inline_ranges);
+    memset(index, 0x00, sizeof(struct object_index));
+}
+#endif
+static void release_object_file(struct object_file *object_file)
+{
+#if WANDER_CONFIG_RESOLVER_INDEX
+    index_free(&object_file->index);
+#endif
+    if (object_file->dwarf != NULL) dwarf_fini(&object_file->dwarf, NULL);
+    unmap_object_file(object_file);
+    free((char *)object_file->name);
+    free(object_file);
+}
+/* Forget the tables that parsing the sections built, before the part of the arena they are in is released */
+static void forget_parsed_sections(struct dwarf *dwarf)
+{
+    dwarf->aranges.aranges = NULL;
+    dwarf->aranges.num_aranges = 0;
+}
 static void parse_object_files(wander_resolver_t *resolver)
 {
+    /* This runs in signal handlers, so the arena must not fall back to malloc.
+     * What the previous call parsed is dropped, and every object file is opened before anything is parsed,
+     * so that the arena only keeps the abbreviations.
+     */
+    dw_alloc_t *fallback = resolver->arena.fallback;
+    resolver->arena.fallback = NULL;
+    for (size_t i=0; i < resolver->num_object_files; i++) {
+        struct object_file *object_file = resolver->object_files[i];
+        if (object_file->dwarf != NULL) forget_parsed_sections(object_file->dwarf);
+    }
+    dweller_arena_release(&resolver->arena, resolver->arena_mark);
     for (size_t i=0; i < resolver->num_object_files; i++) {
-        struct object_file *object_file = &resolver->object_files[i];
+        struct object_file *object_file = resolver->object_files[i];
         if (object_file->data == NULL) continue; /* object file is not mapped */
+        open_object_file_dwarf(resolver, object_file);
+    }
+    for (size_t i=0; i < resolver->num_object_files; i++) {
+        struct object_file *object_file = resolver->object_files[i];
+        if (object_file->data == NULL || object_file->dwarf == NULL) continue; /* object file is not mapped */
         resolver->current_object_file = object_file;
-        dwarf_init(&object_file->dwarf, &dweller_libc_allocator, &object_file->errinfo); // TODO: No allocation after initialization
+        load_symbols(resolver, object_file);
         object_file->dwarf->data = resolver;
-        load_debug_sections(resolver, object_file);
         object_file->dwarf->arange_cb = my_arange_cb;
         object_file->dwarf->line_cb = my_line_cb;
         object_file->dwarf->cu_cb = my_cu_cb;
-        if (dwarf_has_section(object_file->dwarf, DWARF_SECTION_ABBREV, &object_file->errinfo)) dwarf_parse_section(object_file->dwarf, DWARF_SECTION_ABBREV, &object_file->errinfo);
         if (dwarf_has_section(object_file->dwarf, DWARF_SECTION_ARANGES, &object_file->errinfo)) dwarf_parse_section(object_file->dwarf, DWARF_SECTION_ARANGES, &object_file->errinfo);
         if (dwarf_has_section(object_file->dwarf, DWARF_SECTION_INFO, &object_file->errinfo)) dwarf_parse_section(object_file->dwarf, DWARF_SECTION_INFO, &object_file->errinfo);
         if (dwarf_has_section(object_file->dwarf, DWARF_SECTION_LINE, &object_file->errinfo)) dwarf_parse_section(object_file->dwarf, DWARF_SECTION_LINE, &object_file->errinfo);
@@ -758,15 +1320,16 @@ static void parse_object_files(wander_resolver_t *resolver)
             dwarf_write_error(&object_file->errinfo, &dweller_libc_stderr_writer);
         }
     }
+    resolver->arena.fallback = fallback;
 #if 0
     printf("\n-----------------------------------------------------------\n");
-    for (size_t i=0; i < resolver->num_stack_frames; i++) {
-        struct symbol *sym = &resolver->symbols[i];
+    for (size_t i=0; i < resolver->loading->num_frames; i++) {
+        struct symbol *sym = &resolver->loading->symbols[i];
         struct function fun = sym->fun;
         struct object_file *object_file = sym->object_file;
         struct dwarf *dwarf = NULL;
         if (object_file != NULL) dwarf = object_file->dwarf;
-        printf("#%-3zu 0x%016lx in ", i, resolver->backtrace->frames[i]);
+        printf("#%-3zu 0x%016lx in ", i, resolver->loading->backtrace->frames[i]);
         if (fun.name.section != DWARF_SECTION_UNKNOWN) {
             printstr(dwarf, fun.name);
             printf("()");
@@ -793,142 +1356,2169 @@ static void parse_object_files(wander_resolver_t *resolver)
 #endif
 }
 
-/**
- * Create a new symbol resolver capable of resolving symbols for at least `max_depth` frames and `max_locations` locations.
- */
-WANDER_FUN(wander_resolver_t*) wander_resolver_create(size_t max_depth, size_t max_locations)
+#if WANDER_CONFIG_RESOLVER_INDEX
+struct index_builder {
+    struct object_index *index;
+    size_t               max_symbols;
+    size_t               max_functions;
+    size_t               max_ranges;
+    size_t               max_units;
+    size_t               max_programs;
+    size_t               max_rows;
+    size_t               max_files;
+    size_t               max_inlines;
+    size_t               max_inline_ranges;
+    bool                 have_aranges;
+    bool                 failed;
+    struct die_data      die_data;
+    uint64_t             unit_base; /* The base address of the current unit's range lists */
+    /* The innermost inlined call around each depth of the current unit, or SIZE_MAX */
+    size_t              *scopes;
+    size_t               max_scopes;
+    /* The address ranges of the current DIE */
+    struct index_pc_range {
+        uint64_t low_pc;
+        uint64_t high_pc;
+    }                   *pcs;
+    size_t               num_pcs;
+    size_t               max_pcs;
+    /* Names of functions, to resolve `DW_AT_abstract_origin` and `DW_AT_specification` */
+    struct index_name {
+        uint64_t    offset;
+        uint64_t    origin;
+        const char *name;
+    }                   *names;
+    size_t               num_names;
+    size_t               max_names;
+    /* Functions without a name of their own */
+    struct index_unnamed {
+        size_t      function;
+        uint64_t    origin;
+    }                   *unnamed;
+    size_t               num_unnamed;
+    size_t               max_unnamed;
+};
+
+static void *index_push(struct index_builder *builder, void **array, size_t *num, size_t *max, size_t size)
 {
-    wander_resolver_t *resolver = malloc(sizeof(wander_resolver_t));
-    memset(resolver, 0x00, sizeof(wander_resolver_t));
-    resolver->max_depth = max_depth;
-    resolver->max_locations = max_locations;
-    resolver->free_fn = free;
-    resolver->backtrace = NULL;
-    resolver->symbols = malloc(max_depth * sizeof(struct symbol));
-#if defined(__unix__)
-    resolver->debug_dir = open("/usr/lib/debug/", O_RDONLY);
-#else
-    resolver->debug_dir = -1;
-#endif
-    load_object_files(resolver);
-    return resolver;
+    if (builder->failed) return NULL;
+    if (*num + 1 > *max) {
+        size_t new_max = *max == 0 ? 64 : *max * 2;
+        void *new_array = realloc(*array, new_max * size);
+        if (new_array == NULL) {
+            builder->failed = true;
+            return NULL;
+        }
+        *array = new_array;
+        *max = new_max;
+    }
+    return (char *)*array + (*num)++ * size;
 }
-WANDER_FUN(int) wander_resolver_load(wander_resolver_t *resolver, wander_backtrace_t *backtrace)
+/* Strings are NUL-terminated in their section, so we can hand out pointers into the mapping */
+static const char *index_str(struct dwarf *dwarf, dw_str_t str)
 {
-    resolver->backtrace = backtrace;
-    resolver->num_stack_frames = backtrace->depth;
-    for (size_t i=0; i < resolver->num_stack_frames; i++) {
-        struct symbol *sym = &resolver->symbols[i];
-        memset(sym, 0x00, sizeof(struct symbol));
-        sym->address = backtrace->frames[i];
-        struct function *fun = &resolver->symbols[i].fun;
-        clear_function(fun);
-        for (size_t k = 0; k < resolver->num_object_files; k++) {
-            struct object_file *object_file = &resolver->object_files[k];
-            void *retaddr = sym->address;
-            if (retaddr >= (void *)object_file->base + object_file->vaddr && retaddr < (void *)object_file->base + object_file->vaddr + object_file->memsz) {
-                sym->object_file = object_file;
-                break;
-            }
-        }
-        if (sym->address == resolver->init_addr) {
-            fun->symname = "_init";
-            fun->symaddr = sym->address;
-            fun->symsize = 0;
-        }
-        if (sym->address == resolver->fini_addr) {
-            fun->symname = "_fini";
-            fun->symaddr = sym->address;
-            fun->symsize = 0;
-        }
-        if (sym->address == resolver->start_addr) {
-            fun->symname = "_start";
-            fun->symaddr = sym->address;
-            fun->symsize = 0;
-        }
+    const struct dwarf_section *section;
+    switch (str.section) {
+    case DWARF_SECTION_LINE:    section = &dwarf->line.section; break;
+    case DWARF_SECTION_STR:     section = &dwarf->str.section; break;
+    case DWARF_SECTION_LINESTR: section = &dwarf->line_str.section; break;
+    case DWARF_SECTION_INFO:    section = &dwarf->info.section; break;
+    default:
+        return NULL;
     }
-    parse_object_files(resolver);
-    return 0;
+    if (section->base == NULL || str.off >= section->size) return NULL;
+    return (const char *)section->base + str.off;
 }
-WANDER_FUN(void) wander_resolver_free(wander_resolver_t **resolver)
+static const char *index_path(struct dwarf *dwarf, struct dwarf_pathinfo *info)
 {
-    if ((*resolver)->free_fn != NULL) {
-        (*resolver)->free_fn(*resolver);
+    dw_str_t str;
+    switch (info->form) {
+    case DW_FORM_string:
+        str = info->value.str;
+        str.section = DWARF_SECTION_LINE;
+        break;
+    case DW_FORM_strp:
+        str.section = DWARF_SECTION_STR;
+        str.off = info->value.stroff;
+        break;
+    case DW_FORM_line_strp:
+        str.section = DWARF_SECTION_LINESTR;
+        str.off = info->value.stroff;
+        break;
+    default:
+        return NULL;
     }
-    *resolver = NULL;
+    return index_str(dwarf, str);
 }
 
-/**
- * Resolve an arbitrary address.
- * Note that this function does not cache any debug information.
- * If you want to resolve multiple addresses from a backtrace, prefer loading the entire backtrace
- * into the resolver with `wander_resolver_load`, and then query individual frames with `wander_resolve_frame_safe`.
- *
- * This function is AS-safe.
- */
-WANDER_FUN(wander_resolution_t*) wander_resolve_addr_safe(wander_resolver_t *resolver, uintptr_t addr, wander_resolution_t *resolution)
+/* Returns the `.debug_info` offset a reference attribute points to, or 0 */
+static uint64_t index_ref(dwarf_unit_t *unit, dwarf_attr_t *attr)
 {
-    /* TODO */
-    return resolution;
+    switch (attr->form) {
+    case DW_FORM_ref1:
+    case DW_FORM_ref2:
+    case DW_FORM_ref4:
+    case DW_FORM_ref8:
+    case DW_FORM_ref_udata:
+        return unit->die.section_offset + attr->value.val;
+    case DW_FORM_ref_addr:
+        return attr->value.off;
+    default:
+        return 0; /* References into type units or supplementary files */
+    }
 }
-/**
- * This function returns a newly allocated resolution that should be destroyed with `wander_destroy_resolution`.
- * For more information, see `wander_resolve_addr_safe`.
- */
-WANDER_FUN(wander_resolution_t*) wander_resolve_addr(wander_resolver_t *resolver, uintptr_t addr)
+static enum dw_cb_status index_pc_range_cb(struct dwarf *dwarf, const dwarf_unit_t *unit, dw_u64_t low_pc, dw_u64_t high_pc, void *ud)
 {
-    wander_resolution_t *resolution = malloc(sizeof(wander_resolution_t));
-    resolution = wander_resolve_addr_safe(resolver, addr, resolution);
-    if (resolution != NULL) {
-        resolution->free_fn = free;
+    (void)dwarf;
+    (void)unit;
+    struct index_builder *builder = ud;
+    struct index_pc_range *pcs = index_push(builder, (void **)&builder->pcs, &builder->num_pcs, &builder->max_pcs, sizeof(struct index_pc_range));
+    if (pcs == NULL) return DW_CB_DONE;
+    pcs->low_pc = low_pc;
+    pcs->high_pc = high_pc;
+    return DW_CB_OK;
+}
+/* Collect the address ranges of a DIE in `builder->pcs`, from either `DW_AT_low_pc`/`DW_AT_high_pc` or `DW_AT_ranges` */
+static void index_die_pcs(struct index_builder *builder, struct dwarf *dwarf, dwarf_unit_t *unit, struct die_data *data)
+{
+    builder->num_pcs = 0;
+    if (data->have_low_pc && data->have_high_pc) {
+        if (data->high_pc > data->low_pc) index_pc_range_cb(dwarf, unit, data->low_pc, data->high_pc, builder);
+    } else if (data->have_ranges) {
+        /* A broken range list only costs us this DIE */
+        struct dwarf_errinfo errinfo;
+        memset(&errinfo, 0x00, sizeof(struct dwarf_errinfo));
+        dwarf_read_ranges(dwarf, unit, &data->ranges, builder->unit_base, index_pc_range_cb, builder, &errinfo);
     }
-    return resolution;
 }
-
-/**
- * Resolve a address from a stack frame in a backtrace.
- * For increased performance, load the entire backtrace into the resolver with `wander_resolver_load`.
- * If the backtrace is not loaded, this function will fall back to using `wander_resolve_addr_safe`, which is slower.
- *
- * This function is AS-safe.
- */
-WANDER_FUN(wander_resolution_t*) wander_resolve_frame_safe(wander_resolver_t *resolver, wander_frame_t frame, wander_resolution_t *resolution)
+static enum dw_cb_status index_die_attr_cb(struct dwarf *dwarf, dwarf_unit_t *unit, dwarf_die_t *die, dwarf_attr_t *attr)
 {
-    memset(resolution, 0x00, sizeof(wander_resolution_t));
-    resolution->frame = frame;
-    if (frame.backtrace != NULL && frame.backtrace == resolver->backtrace) {
-        size_t idx = frame.frame_index;
-        struct symbol *sym = &resolver->symbols[idx];
-        struct function fun = sym->fun;
-        struct object_file *object_file = sym->object_file;
-        struct dwarf *dwarf = NULL;
-        if (object_file != NULL) {
-            dwarf = object_file->dwarf;
-            resolution->object = object_file->name;
-            resolution->object_base = object_file->base;
-        }
-        char *ptr = resolver->buffer;
-        size_t max_n = sizeof(resolver->buffer);
-        if (fun.decl_line != -1) {
-            resolution->source.lineno = fun.decl_line;
-        }
-        if (fun.symname) {
-            resolution->symbol.name = fun.symname;
-            resolution->symbol.addr = fun.symaddr;
-            resolution->symbol.size = fun.symsize;
-        }
-        if (fun.name.section != DWARF_SECTION_UNKNOWN) {
-            resolution->source.function = copy_dwarf_str(dwarf, fun.name, &ptr, &max_n);
+    struct index_builder *builder = dwarf->data;
+    struct object_index *index = builder->index;
+    struct die_data *data = die->data;
+
+    switch (attr->name) {
+    case 0:
+        /* End of DIE */
+        if (builder->failed) break;
+        switch (die->tag) {
+        case DW_TAG_compile_unit:
+        case DW_TAG_partial_unit:;
+            struct index_unit *iunit = &index->units[index->num_units - 1];
+            if (data->have_line_offset) iunit->line_offset = data->line_offset;
+            builder->unit_base = data->have_low_pc ? data->low_pc : 0;
+            /* Without `.debug_aranges` we rely on the unit's own bounds */
+            if (builder->have_aranges) break;
+            index_die_pcs(builder, dwarf, unit, data);
+            for (size_t i=0; i < builder->num_pcs; i++) {
+                struct index_range *range = index_push(builder, (void **)&index->ranges, &index->num_ranges, &builder->max_ranges, sizeof(struct index_range));
+                if (range == NULL) break;
+                range->low_pc = builder->pcs[i].low_pc;
+                range->high_pc = builder->pcs[i].high_pc;
+                range->unit = iunit->info_offset;
+            }
+            break;
+        case DW_TAG_subprogram:;
+            const char *name = index_str(dwarf, data->name);
+            if (name != NULL || data->origin != 0) {
+                struct index_name *iname = index_push(builder, (void **)&builder->names, &builder->num_names, &builder->max_names, sizeof(struct index_name));
+                if (iname == NULL) break;
+                iname->offset = die->section_offset;
+                iname->origin = data->origin;
+                iname->name = name;
+            }
+            index_die_pcs(builder, dwarf, unit, data);
+            for (size_t i=0; i < builder->num_pcs; i++) {
+                struct index_function *function = index_push(builder, (void **)&index->functions, &index->num_functions, &builder->max_functions, sizeof(struct index_function));
+                if (function == NULL) break;
+                function->low_pc = builder->pcs[i].low_pc;
+                function->high_pc = builder->pcs[i].high_pc;
+                function->name = name;
+                if (name != NULL || data->origin == 0) continue;
+                /* Out-of-line instances of inline functions only refer to their name */
+                struct index_unnamed *unnamed = index_push(builder, (void **)&builder->unnamed, &builder->num_unnamed, &builder->max_unnamed, sizeof(struct index_unnamed));
+                if (unnamed == NULL) break;
+                unnamed->function = index->num_functions - 1;
+                unnamed->origin = data->origin;
+            }
+            break;
+        case DW_TAG_inlined_subroutine:;
+            size_t call_idx = builder->scopes[die->depth];
+            struct index_inline *call = &index->inlines[call_idx];
+            call->name = index_str(dwarf, data->name);
+            call->origin = data->origin;
+            call->call_file = data->call_file;
+            call->call_line = data->call_line;
+            call->call_column = data->call_column;
+            index_die_pcs(builder, dwarf, unit, data);
+            for (size_t i=0; i < builder->num_pcs; i++) {
+                struct index_inline_range *range = index_push(builder, (void **)&index->inline_ranges, &index->num_inline_ranges, &builder->max_inline_ranges, sizeof(struct index_inline_range));
+                if (range == NULL) break;
+                range->low_pc = builder->pcs[i].low_pc;
+                range->high_pc = builder->pcs[i].high_pc;
+                range->call = call_idx;
+            }
+            break;
+        }
+        break;
+    case DW_AT_name:
+        switch (attr->form) {
+        case DW_FORM_strp:
+        case DW_FORM_strx:
+        case DW_FORM_strx1:
+        case DW_FORM_strx2:
+        case DW_FORM_strx3:
+        case DW_FORM_strx4:
+            data->name.section = DWARF_SECTION_STR;
+            data->name.off = attr->value.stroff;
+            data->name.len = -1;
+            break;
+        case DW_FORM_string:
+            data->name = attr->value.str;
+            break;
+        }
+        break;
+    case DW_AT_stmt_list:
+        data->line_offset = attr->value.off;
+        data->have_line_offset = true;
+        break;
+    case DW_AT_low_pc:
+        data->low_pc = attr->value.val;
+        data->have_low_pc = true;
+        break;
+    case DW_AT_high_pc:
+        if (attr->form == DW_FORM_data1 || attr->form == DW_FORM_data2 || attr->form == DW_FORM_data4 || attr->form == DW_FORM_data8 || attr->form == DW_FORM_udata) {
+            if (!data->have_low_pc) break;
+            data->high_pc = data->low_pc + attr->value.val;
+        } else {
+            data->high_pc = attr->value.val;
+        }
+        data->have_high_pc = true;
+        break;
+    case DW_AT_ranges:
+        data->ranges = *attr;
+        data->have_ranges = true;
+        break;
+    case DW_AT_abstract_origin:
+    case DW_AT_specification:
+        data->origin = index_ref(unit, attr);
+        break;
+    case DW_AT_call_file:
+        data->call_file = attr->value.val;
+        break;
+    case DW_AT_call_line:
+        data->call_line = attr->value.val;
+        break;
+    case DW_AT_call_column:
+        data->call_column = attr->value.val;
+        break;
+    }
+
+    return DW_CB_OK;
+}
+static enum dw_cb_status index_die_cb(struct dwarf *dwarf, dwarf_unit_t *unit, dwarf_die_t *die)
+{
+    struct index_builder *builder = dwarf->data;
+    struct object_index *index = builder->index;
+
+    if (builder->failed || die->depth < 0) return DW_CB_OK;
+    size_t depth = die->depth;
+    if (depth >= builder->max_scopes) {
+        size_t max_scopes = builder->max_scopes == 0 ? 16 : builder->max_scopes;
+        while (max_scopes <= depth) max_scopes *= 2;
+        size_t *scopes = realloc(builder->scopes, max_scopes * sizeof(size_t));
+        if (scopes == NULL) {
+            builder->failed = true;
+            return DW_CB_OK;
+        }
+        builder->scopes = scopes;
+        builder->max_scopes = max_scopes;
+    }
+    /* Everything nested in an inlined call belongs to it, until the next function */
+    builder->scopes[depth] = depth > 0 ? builder->scopes[depth - 1] : SIZE_MAX;
+
+    switch (die->tag) {
+    case DW_TAG_inlined_subroutine:;
+        struct index_inline *call = index_push(builder, (void **)&index->inlines, &index->num_inlines, &builder->max_inlines, sizeof(struct index_inline));
+        if (call == NULL) break;
+        memset(call, 0x00, sizeof(struct index_inline));
+        call->parent = builder->scopes[depth];
+        call->unit = unit->die.section_offset;
+        builder->scopes[depth] = index->num_inlines - 1;
+        /* fallthrough */
+    case DW_TAG_compile_unit:
+    case DW_TAG_partial_unit:
+    case DW_TAG_subprogram:
+        if (die->tag == DW_TAG_subprogram) builder->scopes[depth] = SIZE_MAX;
+        memset(&builder->die_data, 0x00, sizeof(struct die_data));
+        die->attr_cb = index_die_attr_cb;
+        die->data = &builder->die_data;
+        break;
+    }
+    return DW_CB_OK;
+}
+static enum dw_cb_status index_cu_cb(struct dwarf *dwarf, dwarf_cu_t *cu)
+{
+    struct index_builder *builder = dwarf->data;
+    struct object_index *index = builder->index;
+
+    struct index_unit *iunit = index_push(builder, (void **)&index->units, &index->num_units, &builder->max_units, sizeof(struct index_unit));
+    if (iunit == NULL) return DW_CB_NEXT;
+    iunit->info_offset = cu->unit.die.section_offset;
+    iunit->line_offset = -1;
+    iunit->program = SIZE_MAX;
+    cu->unit.die_cb = index_die_cb;
+    return DW_CB_OK;
+}
+static enum dw_cb_status index_arange_cb(struct dwarf *dwarf, dwarf_aranges_t *aranges, dwarf_arange_t *arange)
+{
+    struct index_builder *builder = dwarf->data;
+    struct object_index *index = builder->index;
+
+    if (arange->size == 0) return DW_CB_OK;
+    struct index_range *range = index_push(builder, (void **)&index->ranges, &index->num_ranges, &builder->max_ranges, sizeof(struct index_range));
+    if (range == NULL) return DW_CB_OK;
+    range->low_pc = arange->base;
+    range->high_pc = arange->base + arange->size;
+    range->unit = aranges->debug_info_offset;
+    return DW_CB_OK;
+}
+static enum dw_cb_status index_line_row_cb(struct dwarf *dwarf, struct dwarf_line_program *program, struct dwarf_line_program_state *state, struct dwarf_line_program_state *last_state)
+{
+    (void)program;
+    (void)last_state;
+    struct index_builder *builder = dwarf->data;
+    struct object_index *index = builder->index;
+
+    struct index_row *row = index_push(builder, (void **)&index->rows, &index->num_rows, &builder->max_rows, sizeof(struct index_row));
+    if (row == NULL) return DW_CB_OK;
+    struct index_program *iprogram = &index->programs[index->num_programs - 1];
+    row->address = state->address;
+    row->order = iprogram->num_rows++;
+    row->file = state->file;
+    row->line = state->line;
+    row->column = state->column;
+    row->end_sequence = state->end_sequence;
+    return DW_CB_OK;
+}
+static enum dw_cb_status index_line_cb(struct dwarf *dwarf, struct dwarf_line_program *program)
+{
+    struct index_builder *builder = dwarf->data;
+    struct object_index *index = builder->index;
+
+    struct index_program *iprogram = index_push(builder, (void **)&index->programs, &index->num_programs, &builder->max_programs, sizeof(struct index_program));
+    if (iprogram == NULL) return DW_CB_OK;
+    iprogram->line_offset = program->section_offset;
+    iprogram->first_row = index->num_rows;
+    iprogram->num_rows = 0;
+    iprogram->first_file = index->num_files;
+    iprogram->num_files = 0;
+    iprogram->file_base = program->version >= 5 ? 0 : 1;
+    for (size_t i=0; i < program->num_files; i++) {
+        struct dwarf_fileinfo *file = dwarf_line_program_file(program, iprogram->file_base + i);
+        struct index_file *ifile = index_push(builder, (void **)&index->files, &index->num_files, &builder->max_files, sizeof(struct index_file));
+        if (ifile == NULL) return DW_CB_OK;
+        ifile->name = file ? index_str(dwarf, file->name) : NULL;
+        ifile->directory = NULL;
+        struct dwarf_pathinfo *info = file ? dwarf_line_program_include_directory(program, file->include_directory_idx) : NULL;
+        if (info) {
+            ifile->directory = index_path(dwarf, info);
+        }
+        iprogram->num_files++;
+    }
+    program->line_row_cb = index_line_row_cb;
+    return DW_CB_OK;
+}
+
+static int index_symbol_compare(const void *a, const void *b)
+{
+    const struct index_symbol *lhs = a, *rhs = b;
+    if (lhs->addr != rhs->addr) return lhs->addr < rhs->addr ? -1 : 1;
+    return 0;
+}
+static int index_function_compare(const void *a, const void *b)
+{
+    const struct index_function *lhs = a, *rhs = b;
+    if (lhs->low_pc != rhs->low_pc) return lhs->low_pc < rhs->low_pc ? -1 : 1;
+    /* Enclosing functions first, so nested functions are found first when searching backwards */
+    if (lhs->high_pc != rhs->high_pc) return lhs->high_pc > rhs->high_pc ? -1 : 1;
+    return 0;
+}
+static int index_range_compare(const void *a, const void *b)
+{
+    const struct index_range *lhs = a, *rhs = b;
+    if (lhs->low_pc != rhs->low_pc) return lhs->low_pc < rhs->low_pc ? -1 : 1;
+    return 0;
+}
+static int index_unit_compare(const void *a, const void *b)
+{
+    const struct index_unit *lhs = a, *rhs = b;
+    if (lhs->info_offset != rhs->info_offset) return lhs->info_offset < rhs->info_offset ? -1 : 1;
+    return 0;
+}
+static int index_program_compare(const void *a, const void *b)
+{
+    const struct index_program *lhs = a, *rhs = b;
+    if (lhs->line_offset != rhs->line_offset) return lhs->line_offset < rhs->line_offset ? -1 : 1;
+    return 0;
+}
+static int index_row_compare(const void *a, const void *b)
+{
+    const struct index_row *lhs = a, *rhs = b;
+    if (lhs->address != rhs->address) return lhs->address < rhs->address ? -1 : 1;
+    /* The end of one sequence may coincide with the start of the next one */
+    if (lhs->end_sequence != rhs->end_sequence) return lhs->end_sequence ? -1 : 1;
+    if (lhs->order != rhs->order) return lhs->order < rhs->order ? -1 : 1;
+    return 0;
+}
+static int index_name_compare(const void *a, const void *b)
+{
+    const struct index_name *lhs = a, *rhs = b;
+    if (lhs->offset != rhs->offset) return lhs->offset < rhs->offset ? -1 : 1;
+    return 0;
+}
+static int index_inline_range_compare(const void *a, const void *b)
+{
+    const struct index_inline_range *lhs = a, *rhs = b;
+    if (lhs->low_pc != rhs->low_pc) return lhs->low_pc < rhs->low_pc ? -1 : 1;
+    /* Enclosing calls first, like functions */
+    if (lhs->high_pc != rhs->high_pc) return lhs->high_pc > rhs->high_pc ? -1 : 1;
+    return 0;
+}
+static int index_object_compare(const void *a, const void *b)
+{
+    const struct index_object *lhs = a, *rhs = b;
+    if (lhs->start != rhs->start) return lhs->start < rhs->start ? -1 : 1;
+    return 0;
+}
+
+static struct index_unit *index_find_unit(struct object_index *index, dw_off_t info_offset)
+{
+    size_t lo = 0, hi = index->num_units;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index->units[mid].info_offset < info_offset) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < index->num_units && index->units[lo].info_offset == info_offset) return &index->units[lo];
+    return NULL;
+}
+static size_t index_find_program(struct object_index *index, dw_off_t line_offset)
+{
+    size_t lo = 0, hi = index->num_programs;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index->programs[mid].line_offset < line_offset) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < index->num_programs && index->programs[lo].line_offset == line_offset) return lo;
+    return SIZE_MAX;
+}
+
+/* Follow `DW_AT_abstract_origin`/`DW_AT_specification` until a name turns up. The names must be sorted. */
+static const char *index_origin_name(struct index_builder *builder, uint64_t origin)
+{
+    for (int hops=0; origin != 0 && hops < 8; hops++) {
+        struct index_name key = { .offset = origin };
+        struct index_name *iname = bsearch(&key, builder->names, builder->num_names, sizeof(struct index_name), index_name_compare);
+        if (iname == NULL) return NULL;
+        if (iname->name != NULL) return iname->name;
+        origin = iname->origin;
+    }
+    return NULL;
+}
+/* Name the functions and inlined calls that only refer to their abstract instance. */
+static void index_resolve_names(struct index_builder *builder)
+{
+    struct object_index *index = builder->index;
+    qsort(builder->names, builder->num_names, sizeof(struct index_name), index_name_compare);
+    for (size_t i=0; i < builder->num_unnamed; i++) {
+        struct index_unnamed *unnamed = &builder->unnamed[i];
+        index->functions[unnamed->function].name = index_origin_name(builder, unnamed->origin);
+    }
+    for (size_t i=0; i < index->num_inlines; i++) {
+        struct index_inline *call = &index->inlines[i];
+        if (call->name == NULL) call->name = index_origin_name(builder, call->origin);
+    }
+}
+/* Link the inlined calls to their callers and files, and nest their ranges. Needs the units and programs to be linked. */
+static void index_link_inlines(struct object_index *index)
+{
+    for (size_t i=0; i < index->num_inlines; i++) {
+        struct index_inline *call = &index->inlines[i];
+        call->caller = call->parent != SIZE_MAX ? &index->inlines[call->parent] : NULL;
+        struct index_unit *unit = index_find_unit(index, call->unit);
+        if (unit == NULL || unit->program == SIZE_MAX) continue;
+        struct index_program *program = &index->programs[unit->program];
+        if (call->call_file >= program->file_base && call->call_file - program->file_base < program->num_files) {
+            struct index_file *file = &index->files[program->first_file + call->call_file - program->file_base];
+            call->call_filename = file->name;
+            call->call_directory = file->directory;
+        }
+    }
+    qsort(index->inline_ranges, index->num_inline_ranges, sizeof(struct index_inline_range), index_inline_range_compare);
+    /* The parent of a range is the innermost preceding range that still covers it */
+    size_t top = SIZE_MAX;
+    for (size_t i=0; i < index->num_inline_ranges; i++) {
+        struct index_inline_range *range = &index->inline_ranges[i];
+        while (top != SIZE_MAX && (index->inline_ranges[top].high_pc <= range->low_pc || index->inline_ranges[top].high_pc < range->high_pc)) {
+            top = index->inline_ranges[top].parent;
+        }
+        range->parent = top;
+        top = i;
+    }
+}
+static void index_builder_free(struct index_builder *builder)
+{
+    free(builder->scopes);
+    free(builder->pcs);
+    free(builder->names);
+    free(builder->unnamed);
+}
+
+#if defined(__unix__)
+static void index_symbols(struct index_builder *builder, struct object_file *object_file)
+{
+    struct object_index *index = builder->index;
+    Elf64_Ehdr *ehdr = (Elf64_Ehdr *)object_file->data;
+    Elf64_Shdr *shdrs = (Elf64_Shdr *)(object_file->data + ehdr->e_shoff);
+    for (size_t j=0; j < ehdr->e_shnum; j++) {
+        Elf64_Shdr *shdr = &shdrs[j];
+        if (shdr->sh_type != SHT_SYMTAB && shdr->sh_type != SHT_DYNSYM) continue;
+        Elf64_Shdr *strh = &shdrs[shdr->sh_link];
+        char *strs = (char *)(object_file->data + strh->sh_offset);
+        Elf64_Sym *syms = (Elf64_Sym *)(object_file->data + shdr->sh_offset);
+        size_t num_syms = shdr->sh_size / sizeof(Elf64_Sym);
+        for (size_t k=0; k < num_syms; k++) {
+            Elf64_Sym *sym = &syms[k];
+            if (ELF64_ST_TYPE(sym->st_info) != STT_FUNC) continue;
+            uint64_t addr = symbol_address(ehdr, shdrs, sym);
+            if (sym->st_shndx == SHN_UNDEF || addr == 0) continue;
+            struct index_symbol *isym = index_push(builder, (void **)&index->symbols, &index->num_symbols, &builder->max_symbols, sizeof(struct index_symbol));
+            if (isym == NULL) return;
+            isym->addr = addr;
+            isym->size = sym->st_size;
+            isym->name = &strs[sym->st_name];
+        }
+    }
+}
+#else
+static void index_symbols(struct index_builder *builder, struct object_file *object_file)
+{
+    /* TODO: Read the COFF symbol table */
+}
+#endif
+
+static void index_object_file(wander_resolver_t *resolver, struct object_file *object_file)
+{
+    struct object_index *index = &object_file->index;
+    struct index_builder builder;
+    memset(&builder, 0x00, sizeof(builder));
+    builder.index = index;
+
+    index_symbols(&builder, object_file);
+
+    if (!open_object_file_dwarf(resolver, object_file)) goto done;
+    struct dwarf *dwarf = object_file->dwarf;
+    struct dwarf_errinfo *errinfo = &object_file->errinfo;
+    dwarf->data = &builder;
+    dwarf->arange_cb = index_arange_cb;
+    dwarf->cu_cb = index_cu_cb;
+    dwarf->line_cb = index_line_cb;
+    builder.have_aranges = dwarf_has_section(dwarf, DWARF_SECTION_ARANGES, errinfo);
+    if (builder.have_aranges) dwarf_parse_section(dwarf, DWARF_SECTION_ARANGES, errinfo);
+    if (dwarf_has_section(dwarf, DWARF_SECTION_INFO, errinfo)) dwarf_parse_section(dwarf, DWARF_SECTION_INFO, errinfo);
+    if (dwarf_has_section(dwarf, DWARF_SECTION_LINE, errinfo)) dwarf_parse_section(dwarf, DWARF_SECTION_LINE, errinfo);
+    if (dwarf_has_error(errinfo)) {
+        dwarf_write_error(errinfo, &dweller_libc_stderr_writer);
+    }
+    dwarf->arange_cb = NULL;
+    dwarf->cu_cb = NULL;
+    dwarf->line_cb = NULL;
+    dwarf->data = resolver;
+    /* Everything we need was copied into the index */
+    forget_parsed_sections(dwarf);
+    dweller_arena_release(&resolver->arena, resolver->arena_mark);
+
+done:
+    if (builder.failed) {
+        index_builder_free(&builder);
+        index_free(index);
+        atomic_store_explicit(&object_file->indexed, true, memory_order_release); /* Still safe to look at, it is empty */
+        return;
+    }
+    index_resolve_names(&builder);
+    index_builder_free(&builder);
+
+    qsort(index->symbols, index->num_symbols, sizeof(struct index_symbol), index_symbol_compare);
+    qsort(index->functions, index->num_functions, sizeof(struct index_function), index_function_compare);
+    qsort(index->ranges, index->num_ranges, sizeof(struct index_range), index_range_compare);
+    qsort(index->units, index->num_units, sizeof(struct index_unit), index_unit_compare);
+    qsort(index->programs, index->num_programs, sizeof(struct index_program), index_program_compare);
+    for (size_t i=0; i < index->num_programs; i++) {
+        struct index_program *program = &index->programs[i];
+        qsort(&index->rows[program->first_row], program->num_rows, sizeof(struct index_row), index_row_compare);
+    }
+
+    uint64_t max_end = 0;
+    for (size_t i=0; i < index->num_symbols; i++) {
+        struct index_symbol *sym = &index->symbols[i];
+        if (sym->addr + sym->size > max_end) max_end = sym->addr + sym->size;
+        sym->max_end = max_end;
+    }
+    uint64_t max_high_pc = 0;
+    for (size_t i=0; i < index->num_functions; i++) {
+        struct index_function *function = &index->functions[i];
+        if (function->high_pc > max_high_pc) max_high_pc = function->high_pc;
+        function->max_high_pc = max_high_pc;
+    }
+    for (size_t i=0; i < index->num_units; i++) {
+        struct index_unit *unit = &index->units[i];
+        if (unit->line_offset != (dw_off_t)-1) unit->program = index_find_program(index, unit->line_offset);
+    }
+    index_link_inlines(index);
+    /* Replace `.debug_info` offsets with unit indices, dropping ranges of unknown units */
+    size_t num_ranges = 0;
+    for (size_t i=0; i < index->num_ranges; i++) {
+        struct index_range range = index->ranges[i];
+        struct index_unit *unit = index_find_unit(index, range.unit);
+        if (unit == NULL) continue;
+        range.unit = unit - index->units;
+        index->ranges[num_ranges++] = range;
+    }
+    index->num_ranges = num_ranges;
+    atomic_store_explicit(&object_file->indexed, true, memory_order_release);
+}
+/* Create a snapshot of the address ranges of the current object files. */
+static struct object_map *create_object_map(wander_resolver_t *resolver)
+{
+    struct object_map *map = malloc(sizeof(struct object_map) + resolver->num_object_files * sizeof(struct index_object));
+    if (map == NULL) return NULL;
+    map->version = ++resolver->map_version;
+    map->num_objects = resolver->num_object_files;
+    for (size_t i=0; i < resolver->num_object_files; i++) {
+        struct object_file *object_file = resolver->object_files[i];
+        struct index_object *object = &map->objects[i];
+        object->start = object_file->base + object_file->vaddr;
+        object->end = object_file->base + object_file->vaddr + object_file->memsz;
+        object->object_file = object_file;
+    }
+    qsort(map->objects, map->num_objects, sizeof(struct index_object), index_object_compare);
+    return map;
+}
+/* Wait until no reader can still be using a map that has been replaced. */
+static void synchronize_readers(wander_resolver_t *resolver)
+{
+    unsigned epoch = atomic_fetch_add(&resolver->map_epoch, 1);
+    while (atomic_load(&resolver->map_readers[epoch & 1]) != 0) {
+#if defined(__unix__)
+        sched_yield();
+#elif defined(_WIN32)
+        SwitchToThread();
+#endif
+    }
+}
+/* Returns the map that was replaced, it may only be freed after `synchronize_readers` */
+static struct object_map *publish_object_map(wander_resolver_t *resolver, struct object_map *map)
+{
+    return atomic_exchange(&resolver->object_map, map);
+}
+/* This function is AS-safe. */
+static struct object_map *enter_object_map(wander_resolver_t *resolver, unsigned *pepoch)
+{
+    unsigned epoch;
+    for (;;) {
+        epoch = atomic_load(&resolver->map_epoch);
+        atomic_fetch_add(&resolver->map_readers[epoch & 1], 1);
+        /* If a writer flipped the epoch in the meantime, it may not wait for us */
+        if (atomic_load(&resolver->map_epoch) == epoch) break;
+        atomic_fetch_sub(&resolver->map_readers[epoch & 1], 1);
+    }
+    *pepoch = epoch;
+    return atomic_load(&resolver->object_map);
+}
+/* This function is AS-safe. */
+static void leave_object_map(wander_resolver_t *resolver, unsigned epoch)
+{
+    atomic_fetch_sub(&resolver->map_readers[epoch & 1], 1);
+}
+/* Build the lookup tables of all object files and the address -> object file map. */
+static void build_index(wander_resolver_t *resolver)
+{
+    for (size_t i=0; i < resolver->num_object_files; i++) {
+        if (atomic_load_explicit(&resolver->cancel_warmup, memory_order_relaxed)) return;
+        struct object_file *object_file = resolver->object_files[i];
+        if (object_file->data == NULL) continue; /* object file is not mapped */
+        index_object_file(resolver, object_file);
+    }
+    struct object_map *map = create_object_map(resolver);
+    if (map != NULL) publish_object_map(resolver, map);
+}
+#if defined(__unix__)
+static int phdr_counter_callback(struct dl_phdr_info *info, size_t size, void *ud)
+{
+    unsigned long long *counters = ud;
+    if (size < offsetof(struct dl_phdr_info, dlpi_subs) + sizeof(info->dlpi_subs)) return -1;
+    counters[0] = info->dlpi_adds;
+    counters[1] = info->dlpi_subs;
+    return 1; /* One object is enough, the counters are global */
+}
+/* Compare the loader's counters to the last scan. This takes the loader's lock only briefly, and not `update_lock`. */
+static bool dl_objects_changed(wander_resolver_t *resolver)
+{
+    unsigned long long counters[2];
+    if (dl_iterate_phdr(phdr_counter_callback, counters) != 1) return true;
+    return counters[0] != resolver->dl_adds || counters[1] != resolver->dl_subs;
+}
+/* Index objects that were loaded since the last scan and retire the ones that were unloaded. */
+static int update_index(wander_resolver_t *resolver)
+{
+    bool dl_changed = dl_objects_changed(resolver);
+    /* The JIT might have been loaded just now */
+    if (dl_changed) resolver->jit_descriptor = dlsym(RTLD_DEFAULT, "__jit_debug_descriptor");
+    if (!dl_changed && !jit_changed(resolver)) {
+        return 0; /* Nothing was loaded or unloaded */
+    }
+
+    size_t num_old = resolver->num_object_files;
+    resolver->generation++;
+    dl_iterate_phdr(phdr_iterate_callback, resolver);
+    load_jit_objects(resolver);
+
+    size_t num_retired = 0;
+    struct object_file **retired = malloc((num_old + 1) * sizeof(struct object_file *));
+    if (retired == NULL) return -1;
+    size_t num_live = 0;
+    for (size_t i=0; i < resolver->num_object_files; i++) {
+        struct object_file *object_file = resolver->object_files[i];
+        if (object_file->generation != resolver->generation) {
+            retired[num_retired++] = object_file;
+            continue;
+        }
+        if (i >= num_old && object_file->data != NULL) index_object_file(resolver, object_file);
+        resolver->object_files[num_live++] = object_file;
+    }
+    resolver->num_object_files = num_live;
+    sort_object_files(resolver);
+
+    struct object_map *map = create_object_map(resolver);
+    if (map == NULL) {
+        /* Keep the old map and the objects it refers to */
+        for (size_t i=0; i < num_retired; i++) resolver->object_files[resolver->num_object_files++] = retired[i];
+        sort_object_files(resolver);
+        free(retired);
+        return -1;
+    }
+    struct object_map *old_map = publish_object_map(resolver, map);
+    synchronize_readers(resolver);
+    free(old_map);
+    for (size_t i=0; i < num_retired; i++) release_object_file(retired[i]);
+    free(retired);
+    return 1;
+}
+#endif
+static void free_index(wander_resolver_t *resolver)
+{
+    free(publish_object_map(resolver, NULL));
+}
+/* This function is AS-safe. */
+static bool index_ready(wander_resolver_t *resolver)
+{
+    return atomic_load_explicit(&resolver->object_map, memory_order_acquire) != NULL;
+}
+#if LAZY_MAPPING
+/* Remember that an address in the object file was resolved, for `unmap_least_recently_used`. */
+static void touch_object_file(wander_resolver_t *resolver, struct object_file *object_file)
+{
+    size_t now = atomic_fetch_add_explicit(&resolver->lru_clock, 1, memory_order_relaxed);
+    atomic_store_explicit(&object_file->last_used, now, memory_order_relaxed);
+}
+static bool over_mapping_limits(size_t num_mapped, size_t mapped_size)
+{
+    return (WANDER_CONFIG_RESOLVER_MAX_MAPPED > 0 && num_mapped > WANDER_CONFIG_RESOLVER_MAX_MAPPED)
+        || (WANDER_CONFIG_RESOLVER_MAX_MAPPED_SIZE > 0 && mapped_size > WANDER_CONFIG_RESOLVER_MAX_MAPPED_SIZE);
+}
+/* Unmap the least recently used object files (but not `keep`) until the mapped ones fit
+ * `WANDER_CONFIG_RESOLVER_MAX_MAPPED` and `WANDER_CONFIG_RESOLVER_MAX_MAPPED_SIZE`.
+ * If any were, a new object map is published so resolutions cached with their strings are not used anymore,
+ * and this returns true. Mapping an object file needs no new map, as resolutions in it are only cached once it is indexed.
+ * The caller holds `update_lock`.
+ */
+static bool unmap_least_recently_used(wander_resolver_t *resolver, struct object_file *keep)
+{
+    size_t num_mapped = 0, mapped_size = 0;
+    for (size_t i=0; i < resolver->num_object_files; i++) {
+        struct object_file *object_file = resolver->object_files[i];
+        if (object_file->data == NULL || object_file->in_memory) continue; /* Nothing to unmap */
+        num_mapped++;
+        mapped_size += object_file->size;
+    }
+    if (!over_mapping_limits(num_mapped, mapped_size)) return false;
+    struct object_map *map = create_object_map(resolver);
+    if (map == NULL) return false; /* Keep everything mapped, the cache might still point into it */
+    bool unmapped = false;
+    while (over_mapping_limits(num_mapped, mapped_size)) {
+        struct object_file *victim = NULL;
+        size_t now = atomic_load_explicit(&resolver->lru_clock, memory_order_relaxed);
+        for (size_t i=0; i < resolver->num_object_files; i++) {
+            struct object_file *object_file = resolver->object_files[i];
+            if (object_file == keep || object_file->data == NULL || object_file->in_memory || !atomic_load(&object_file->indexed)) continue;
+            size_t age = now - atomic_load_explicit(&object_file->last_used, memory_order_relaxed);
+            if (victim == NULL || age > now - atomic_load_explicit(&victim->last_used, memory_order_relaxed)) victim = object_file;
+        }
+        if (victim == NULL) break;
+        /* Readers that enter the new map will not touch its index anymore */
+        atomic_store(&victim->indexed, false);
+        num_mapped--;
+        mapped_size -= victim->size;
+        unmapped = true;
+    }
+    if (!unmapped) {
+        free(map);
+        return false;
+    }
+    struct object_map *old_map = publish_object_map(resolver, map);
+    synchronize_readers(resolver);
+    free(old_map);
+    for (size_t i=0; i < resolver->num_object_files; i++) {
+        struct object_file *object_file = resolver->object_files[i];
+        if (object_file->data == NULL || atomic_load(&object_file->indexed)) continue;
+        index_free(&object_file->index);
+        /* It points into the mapping, `index_object_file` starts over if the object file is mapped again */
+        if (object_file->dwarf != NULL) dwarf_fini(&object_file->dwarf, NULL);
+        unmap_object_file(object_file);
+    }
+    return true;
+}
+/* Map and index the object file that contains `addr`, if that was not done yet.
+ * The DWARF state is only needed while the index is built, the arena goes back to where it was,
+ * so mapping and unmapping object files over and over does not use it up.
+ */
+static void map_lazily(wander_resolver_t *resolver, uintptr_t addr)
+{
+    if (!index_ready(resolver)) return;
+    pthread_mutex_lock(&resolver->update_lock);
+    struct object_file *object_file = find_object_file(resolver, addr);
+    if (object_file != NULL) {
+        touch_object_file(resolver, object_file);
+        if (object_file->data == NULL && !object_file->unreadable) {
+            if (map_object_file(object_file, object_file->name)) {
+                size_t mark = dweller_arena_mark(&resolver->arena);
+                index_object_file(resolver, object_file);
+                if (object_file->dwarf != NULL) dwarf_fini(&object_file->dwarf, NULL);
+                dweller_arena_release(&resolver->arena, mark);
+                resolver->arena_mark = mark;
+            } else {
+                object_file->unreadable = true;
+            }
+            unmap_least_recently_used(resolver, object_file);
+        }
+    }
+    pthread_mutex_unlock(&resolver->update_lock);
+}
+/* This function is AS-safe. */
+static bool needs_mapping(struct object_file *object_file)
+{
+    return !atomic_load_explicit(&object_file->indexed, memory_order_acquire);
+}
+#endif
+
+/* The lookups below only read the tables, so they are AS-safe.
+ * They remember their position in each table in a cursor. Looking up addresses in increasing order
+ * with the same cursor sweeps over the tables once, a fresh cursor makes a lookup a plain exponential search.
+ */
+struct index_cursor {
+    size_t object;
+    size_t symbol;
+    size_t function;
+    size_t range;
+    size_t inline_range;
+    size_t program; /* The line program `row` refers to, or SIZE_MAX */
+    size_t row;
+};
+static void index_cursor_init(struct index_cursor *cursor)
+{
+    memset(cursor, 0x00, sizeof(struct index_cursor));
+    cursor->program = SIZE_MAX;
+}
+/* Returns the number of leading elements of `array` with a 64-bit key (at `offset`) that is less than or equal to `key`.
+ * The keys must be sorted, and `cursor` must be a previous result for a key that was not larger.
+ */
+static size_t index_sweep(const void *array, size_t num, size_t size, size_t offset, size_t cursor, uint64_t key)
+{
+#define KEY(i) (*(const uint64_t *)((const char *)array + (i) * size + offset))
+    if (cursor >= num || KEY(cursor) > key) return cursor;
+    /* Gallop ahead, then binary search the last step */
+    size_t lo = cursor, step = 1;
+    while (lo + step < num && KEY(lo + step) <= key) {
+        lo += step;
+        step *= 2;
+    }
+    size_t hi = lo + step < num ? lo + step : num;
+    lo++;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (KEY(mid) <= key) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+#undef KEY
+}
+static struct index_object *index_lookup_object(struct object_map *map, struct index_cursor *cursor, uint64_t addr)
+{
+    size_t object = index_sweep(map->objects, map->num_objects, sizeof(struct index_object), offsetof(struct index_object, start), cursor->object, addr);
+    if (object != cursor->object) {
+        /* Positions in the previous object's tables are meaningless now */
+        index_cursor_init(cursor);
+        cursor->object = object;
+    }
+    if (object == 0) return NULL;
+    struct index_object *iobject = &map->objects[object - 1];
+    return addr < iobject->end ? iobject : NULL;
+}
+static struct index_symbol *index_lookup_symbol(struct object_index *index, struct index_cursor *cursor, uint64_t addr)
+{
+    cursor->symbol = index_sweep(index->symbols, index->num_symbols, sizeof(struct index_symbol), offsetof(struct index_symbol, addr), cursor->symbol, addr);
+    for (size_t i=cursor->symbol; i-- > 0;) {
+        struct index_symbol *sym = &index->symbols[i];
+        if (addr < sym->addr + sym->size || (sym->size == 0 && addr == sym->addr)) return sym;
+        if (sym->max_end <= addr) break;
+    }
+    return NULL;
+}
+static struct index_function *index_lookup_function(struct object_index *index, struct index_cursor *cursor, uint64_t addr)
+{
+    cursor->function = index_sweep(index->functions, index->num_functions, sizeof(struct index_function), offsetof(struct index_function, low_pc), cursor->function, addr);
+    for (size_t i=cursor->function; i-- > 0;) {
+        struct index_function *function = &index->functions[i];
+        if (addr < function->high_pc) return function;
+        if (function->max_high_pc <= addr) break;
+    }
+    return NULL;
+}
+static struct index_range *index_lookup_range(struct object_index *index, struct index_cursor *cursor, uint64_t addr)
+{
+    cursor->range = index_sweep(index->ranges, index->num_ranges, sizeof(struct index_range), offsetof(struct index_range, low_pc), cursor->range, addr);
+    if (cursor->range == 0) return NULL;
+    struct index_range *range = &index->ranges[cursor->range - 1];
+    return addr < range->high_pc ? range : NULL;
+}
+/* Returns the innermost inlined call containing `addr`, or NULL */
+static const struct index_inline *index_lookup_inline(struct object_index *index, struct index_cursor *cursor, uint64_t addr)
+{
+    cursor->inline_range = index_sweep(index->inline_ranges, index->num_inline_ranges, sizeof(struct index_inline_range), offsetof(struct index_inline_range, low_pc), cursor->inline_range, addr);
+    for (size_t i=cursor->inline_range - 1; cursor->inline_range != 0 && i != SIZE_MAX; i = index->inline_ranges[i].parent) {
+        struct index_inline_range *range = &index->inline_ranges[i];
+        if (addr < range->high_pc) return &index->inlines[range->call];
+    }
+    return NULL;
+}
+static struct index_row *index_lookup_row(struct object_index *index, struct index_cursor *cursor, size_t program_idx, uint64_t addr)
+{
+    struct index_program *program = &index->programs[program_idx];
+    struct index_row *rows = &index->rows[program->first_row];
+    if (cursor->program != program_idx) {
+        cursor->program = program_idx;
+        cursor->row = 0;
+    }
+    cursor->row = index_sweep(rows, program->num_rows, sizeof(struct index_row), offsetof(struct index_row, address), cursor->row, addr);
+    if (cursor->row == 0 || rows[cursor->row - 1].end_sequence) return NULL;
+    return &rows[cursor->row - 1];
+}
+/* Returns the innermost inlined call at `addr`, its callers are expanded by `resolve_inlines` */
+static const struct index_inline *resolve_object(struct object_file *object_file, struct index_cursor *cursor, uintptr_t addr, wander_resolution_t *resolution)
+{
+    struct object_index *index = &object_file->index;
+    resolution->object = object_file->name;
+    resolution->object_base = object_file->base;
+    /* Not mapped (yet), all we know is the object */
+    if (!atomic_load_explicit(&object_file->indexed, memory_order_acquire)) return NULL;
+#ifdef _WIN32 // FIXME: See `my_arange_cb`
+    uint64_t pc = addr;
+#else
+    uint64_t pc = addr - object_file->base;
+#endif
+
+    struct index_symbol *sym = index_lookup_symbol(index, cursor, pc);
+    if (sym) {
+        resolution->symbol.name = sym->name;
+        resolution->symbol.addr = (void *)(uintptr_t)(object_file->base + sym->addr);
+        resolution->symbol.size = sym->size != 0 ? sym->size : SIZE_MAX;
+    }
+    struct index_function *function = index_lookup_function(index, cursor, pc);
+    if (function) {
+        resolution->source.function = function->name;
+    }
+    const struct index_inline *call = index_lookup_inline(index, cursor, pc);
+    struct index_range *range = index_lookup_range(index, cursor, pc);
+    if (range == NULL) return call;
+    struct index_unit *unit = &index->units[range->unit];
+    if (unit->program == SIZE_MAX) return call;
+    struct index_program *program = &index->programs[unit->program];
+    struct index_row *row = index_lookup_row(index, cursor, unit->program, pc);
+    if (row == NULL) return call;
+    resolution->source.lineno = row->line;
+    resolution->source.column = row->column;
+    if (row->file >= program->file_base && row->file - program->file_base < program->num_files) {
+        struct index_file *file = &index->files[program->first_file + row->file - program->file_base];
+        resolution->source.filename = file->name;
+        resolution->source.directory = file->directory;
+    }
+    return call;
+}
+/* Take `num` entries from the source location pool of the query, the oldest ones are reused once it is exhausted.
+ * This function is AS-safe.
+ */
+static wander_source_t *reserve_locations(wander_query_t *query, size_t num)
+{
+    if (num == 0 || num > query->max_locations || query->locations == NULL) return NULL;
+    size_t first = query->num_locations + num > query->max_locations ? 0 : query->num_locations;
+    query->num_locations = first + num;
+    return &query->locations[first];
+}
+/* Turn the innermost inlined call into the function of the resolution, and the calls it is nested in into its inlines.
+ * This function is AS-safe.
+ */
+static void resolve_inlines(wander_query_t *query, const struct index_inline *call, wander_resolution_t *resolution)
+{
+    if (call == NULL) return;
+    const char *function = resolution->source.function;
+    size_t num_inlines = 0;
+    for (const struct index_inline *caller = call; caller != NULL; caller = caller->caller) num_inlines++;
+    if (num_inlines > query->max_locations) num_inlines = query->max_locations;
+    resolution->source.function = call->name;
+    resolution->inlines = reserve_locations(query, num_inlines);
+    if (resolution->inlines == NULL) return;
+    resolution->num_inlines = num_inlines;
+    for (size_t i=0; i < num_inlines; i++, call = call->caller) {
+        wander_source_t *source = &resolution->inlines[i];
+        source->function = call->caller != NULL ? call->caller->name : function;
+        source->filename = call->call_filename;
+        source->directory = call->call_directory;
+        source->lineno = call->call_line;
+        source->column = call->call_column;
+    }
+}
+#if WANDER_CONFIG_RESOLVER_CACHE_SIZE > 0
+# define CACHE_SETS ((WANDER_CONFIG_RESOLVER_CACHE_SIZE + CACHE_WAYS - 1) / CACHE_WAYS)
+/* The cache never blocks: a reader that races with a writer misses, and a writer that races with another writer gives up.
+ * This function is AS-safe.
+ */
+static struct cache_entry *cache_set(wander_resolver_t *resolver, uintptr_t addr)
+{
+    uint64_t hash = (uint64_t)addr * 0x9e3779b97f4a7c15ull;
+    return &resolver->cache[(hash >> 32) % CACHE_SETS * CACHE_WAYS];
+}
+/* This function is AS-safe. */
+static bool cache_lookup(wander_resolver_t *resolver, uint64_t version, uintptr_t addr, wander_resolution_t *resolution, const struct index_inline **pcall)
+{
+    struct cache_entry *set = cache_set(resolver, addr);
+    for (size_t i=0; i < CACHE_WAYS; i++) {
+        struct cache_entry *entry = &set[i];
+        unsigned seq = atomic_load_explicit(&entry->seq, memory_order_acquire);
+        if ((seq & 1) || entry->address != addr || entry->version != version) continue;
+        const char *object = entry->object;
+        size_t object_base = entry->object_base;
+        wander_source_t source = entry->source;
+        wander_symbol_t symbol = entry->symbol;
+        const struct index_inline *call = entry->call;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&entry->seq, memory_order_relaxed) != seq) continue;
+        resolution->object = object;
+        resolution->object_base = object_base;
+        resolution->source = source;
+        resolution->symbol = symbol;
+        *pcall = call;
+        atomic_store_explicit(&entry->last_used, atomic_fetch_add_explicit(&resolver->cache_clock, 1, memory_order_relaxed), memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+/* Replace the least recently used entry of the set. This function is AS-safe. */
+static void cache_insert(wander_resolver_t *resolver, uint64_t version, uintptr_t addr, const wander_resolution_t *resolution, const struct index_inline *call)
+{
+    struct cache_entry *set = cache_set(resolver, addr);
+    unsigned now = atomic_fetch_add_explicit(&resolver->cache_clock, 1, memory_order_relaxed);
+    struct cache_entry *victim = &set[0];
+    for (size_t i=1; i < CACHE_WAYS; i++) {
+        unsigned age = now - atomic_load_explicit(&set[i].last_used, memory_order_relaxed);
+        if (age > now - atomic_load_explicit(&victim->last_used, memory_order_relaxed)) victim = &set[i];
+    }
+    unsigned seq = atomic_load_explicit(&victim->seq, memory_order_relaxed);
+    if (seq & 1) return;
+    if (!atomic_compare_exchange_strong_explicit(&victim->seq, &seq, seq + 1, memory_order_acquire, memory_order_relaxed)) return;
+    atomic_thread_fence(memory_order_release);
+    victim->version = version;
+    victim->address = addr;
+    victim->object = resolution->object;
+    victim->object_base = resolution->object_base;
+    victim->source = resolution->source;
+    victim->symbol = resolution->symbol;
+    victim->call = call;
+    atomic_store_explicit(&victim->last_used, now, memory_order_relaxed);
+    atomic_store_explicit(&victim->seq, seq + 2, memory_order_release);
+}
+#endif
+/* Only reads the resolver, the inlined calls are taken from the pool of the query. This function is AS-safe. */
+static bool resolve_indexed(wander_query_t *query, uintptr_t addr, wander_resolution_t *resolution)
+{
+    wander_resolver_t *resolver = query->resolver;
+    unsigned epoch;
+    struct index_cursor cursor;
+    index_cursor_init(&cursor);
+    struct object_map *map = enter_object_map(resolver, &epoch);
+    if (map == NULL) {
+        leave_object_map(resolver, epoch);
+        return false;
+    }
+    const struct index_inline *call = NULL;
+#if WANDER_CONFIG_RESOLVER_CACHE_SIZE > 0
+    /* The strings of a cached resolution point into object files of the same map, which can not go away while we are in it */
+    if (resolver->cache != NULL && cache_lookup(resolver, map->version, addr, resolution, &call)) {
+        resolve_inlines(query, call, resolution);
+        leave_object_map(resolver, epoch);
+        return resolution->object != NULL;
+    }
+#endif
+    struct index_object *object = index_lookup_object(map, &cursor, addr);
+#if WANDER_CONFIG_RESOLVER_CACHE_SIZE > 0
+    /* An object file that is mapped later gets no new map, so only what it will still resolve to is cached */
+    bool indexed = object != NULL && atomic_load_explicit(&object->object_file->indexed, memory_order_acquire);
+#endif
+    if (object != NULL) call = resolve_object(object->object_file, &cursor, addr, resolution);
+#if WANDER_CONFIG_RESOLVER_CACHE_SIZE > 0
+    if (resolver->cache != NULL && (object == NULL || indexed)) cache_insert(resolver, map->version, addr, resolution, call);
+#endif
+    resolve_inlines(query, call, resolution);
+    leave_object_map(resolver, epoch);
+    return object != NULL;
+}
+#endif
+#if !LAZY_MAPPING
+static void map_lazily(wander_resolver_t *resolver, uintptr_t addr)
+{
+    (void)resolver;
+    (void)addr;
+}
+#endif
+
+#define RESOLVER_ALIGN(size) (((size) + 15) & ~(size_t)15)
+
+static atomic_uint_fast64_t resolver_ids;
+#if defined(__unix__)
+static __thread _Atomic(struct resolver_thread *) resolver_thread __attribute__((tls_model("initial-exec")));
+static pthread_key_t resolver_thread_key;
+static pthread_once_t resolver_thread_once = PTHREAD_ONCE_INIT;
+static bool resolver_thread_have_key;
+
+static void resolver_thread_free(void *thread)
+{
+    munmap(thread, ((struct resolver_thread *)thread)->size);
+}
+static void resolver_thread_create_key(void)
+{
+    resolver_thread_have_key = pthread_key_create(&resolver_thread_key, resolver_thread_free) == 0;
+}
+#endif
+/* This function is AS-safe. */
+static size_t frames_size(size_t max_depth)
+{
+    return RESOLVER_ALIGN(sizeof(struct wander_query_frames) + max_depth * sizeof(struct symbol));
+}
+/* This function is AS-safe. */
+static size_t resolver_thread_size(size_t max_depth, size_t max_locations)
+{
+    return RESOLVER_ALIGN(sizeof(struct resolver_thread)) + frames_size(max_depth) + max_locations * sizeof(wander_source_t);
+}
+/* Lay out the state of a thread in `memory`, which has room for `resolver_thread_size(max_depth, max_locations)` bytes.
+ * This function is AS-safe.
+ */
+static struct resolver_thread *init_resolver_thread(void *memory, size_t size, size_t max_depth, size_t max_locations)
+{
+    struct resolver_thread *thread = memory;
+    memset(thread, 0x00, sizeof(struct resolver_thread));
+    thread->size = size;
+    thread->max_depth = max_depth;
+    thread->max_locations = max_locations;
+    thread->frames = (struct wander_query_frames *)((char *)memory + RESOLVER_ALIGN(sizeof(struct resolver_thread)));
+    thread->locations = (wander_source_t *)((char *)thread->frames + frames_size(max_depth));
+    return thread;
+}
+/* Start over on `resolver` with an empty pool and no backtrace loaded. This function is AS-safe. */
+static void bind_resolver_thread(struct resolver_thread *thread, wander_resolver_t *resolver)
+{
+    thread->resolver_id = resolver->id;
+    thread->query = wander_query_safe(resolver, thread->locations, resolver->max_locations);
+    thread->query.frames = thread->frames;
+    thread->frames->backtrace = NULL;
+    thread->frames->num_frames = 0;
+    thread->frames->max_frames = resolver->max_depth;
+}
+/* Take the state of this thread for `resolver`, or NULL if it is in use or can not be mapped.
+ * Give it back with `release_resolver_thread`.
+ * This function is AS-safe.
+ */
+static struct resolver_thread *claim_resolver_thread(wander_resolver_t *resolver)
+{
+#if defined(__unix__)
+    struct resolver_thread *thread = atomic_load(&resolver_thread);
+    if (thread != NULL && atomic_exchange(&thread->busy, true)) return NULL;
+    if (thread == NULL || thread->max_depth < resolver->max_depth || thread->max_locations < resolver->max_locations) {
+        size_t size = resolver_thread_size(resolver->max_depth, resolver->max_locations);
+        void *mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapped == MAP_FAILED) {
+            if (thread != NULL) atomic_store(&thread->busy, false);
+            return NULL;
+        }
+        struct resolver_thread *grown = init_resolver_thread(mapped, size, resolver->max_depth, resolver->max_locations);
+        atomic_store(&grown->busy, true);
+        /* A signal handler may have mapped one meanwhile, which is then used instead */
+        if (!atomic_compare_exchange_strong(&resolver_thread, &thread, grown)) {
+            munmap(mapped, size);
+            return NULL;
+        }
+        if (resolver_thread_have_key) pthread_setspecific(resolver_thread_key, grown);
+        if (thread != NULL) munmap(thread, thread->size);
+        thread = grown;
+    }
+#else
+    struct resolver_thread *thread = resolver->thread;
+    if (thread == NULL || atomic_exchange(&thread->busy, true)) return NULL;
+#endif
+    if (thread->resolver_id != resolver->id) bind_resolver_thread(thread, resolver);
+    return thread;
+}
+/* This function is AS-safe. */
+static void release_resolver_thread(struct resolver_thread *thread)
+{
+    if (thread != NULL) atomic_store(&thread->busy, false);
+}
+
+static wander_resolver_t *alloc_resolver(size_t max_depth, size_t max_locations)
+{
+    wander_resolver_t *resolver = malloc(sizeof(wander_resolver_t));
+    memset(resolver, 0x00, sizeof(wander_resolver_t));
+    resolver->id = atomic_fetch_add(&resolver_ids, 1) + 1;
+    resolver->max_depth = max_depth;
+    resolver->max_locations = max_locations;
+    resolver->free_fn = free;
+#if defined(__unix__)
+    pthread_once(&resolver_thread_once, resolver_thread_create_key);
+#else
+    size_t size = resolver_thread_size(max_depth, max_locations);
+    void *memory = malloc(size);
+    if (memory != NULL) {
+        resolver->thread = init_resolver_thread(memory, size, max_depth, max_locations);
+        bind_resolver_thread(resolver->thread, resolver);
+    }
+#endif
+    /* Reserved up front, pages are only used once the arena gets to them. Without it, everything goes to malloc */
+#if defined(__unix__)
+    resolver->arena_memory = mmap(NULL, WANDER_CONFIG_RESOLVER_ARENA_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (resolver->arena_memory == MAP_FAILED) resolver->arena_memory = NULL;
+#elif defined(_WIN32)
+    resolver->arena_memory = VirtualAlloc(NULL, WANDER_CONFIG_RESOLVER_ARENA_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#endif
+    dweller_arena_init(&resolver->arena, resolver->arena_memory, WANDER_CONFIG_RESOLVER_ARENA_SIZE, &dweller_libc_allocator);
+#if WANDER_CONFIG_RESOLVER_INDEX && defined(__unix__)
+    pthread_mutex_init(&resolver->update_lock, NULL);
+    pthread_mutex_init(&resolver->symbolized_lock, NULL);
+    resolver->symbolized_fd = -1;
+#endif
+#if WANDER_CONFIG_RESOLVER_INDEX && WANDER_CONFIG_RESOLVER_CACHE_SIZE > 0
+    resolver->cache = calloc(CACHE_SETS * CACHE_WAYS, sizeof(struct cache_entry)); /* Without a cache, every lookup goes to the index */
+#endif
+    return resolver;
+}
+/**
+ * Create a new symbol resolver capable of resolving symbols for at least `max_depth` frames and `max_locations` locations.
+ */
+WANDER_FUN(wander_resolver_t*) wander_resolver_create(size_t max_depth, size_t max_locations)
+{
+    wander_resolver_t *resolver = alloc_resolver(max_depth, max_locations);
+    load_object_files(resolver);
+#if WANDER_CONFIG_RESOLVER_INDEX
+    build_index(resolver);
+#endif
+    return resolver;
+}
+#if WANDER_CONFIG_RESOLVER_INDEX
+static void warmup(wander_resolver_t *resolver)
+{
+    load_object_files(resolver);
+    build_index(resolver);
+}
+# if defined(__unix__)
+static void *warmup_thread(void *ud)
+{
+#  if defined(SCHED_IDLE)
+    struct sched_param param = { 0 };
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#  endif
+    warmup(ud);
+    return NULL;
+}
+static bool start_warmup(wander_resolver_t *resolver)
+{
+    /* Signals should be delivered to the application threads, not to us */
+    sigset_t set, old_set;
+    sigfillset(&set);
+    pthread_sigmask(SIG_SETMASK, &set, &old_set);
+    int res = pthread_create(&resolver->warmup_thread, NULL, warmup_thread, resolver);
+    pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+    return res == 0;
+}
+static void join_warmup(wander_resolver_t *resolver)
+{
+    pthread_join(resolver->warmup_thread, NULL);
+}
+# elif defined(_WIN32)
+static DWORD WINAPI warmup_thread(LPVOID ud)
+{
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_IDLE);
+    warmup(ud);
+    return 0;
+}
+static bool start_warmup(wander_resolver_t *resolver)
+{
+    resolver->warmup_thread = CreateThread(NULL, 0, warmup_thread, resolver, 0, NULL);
+    return resolver->warmup_thread != NULL;
+}
+static void join_warmup(wander_resolver_t *resolver)
+{
+    WaitForSingleObject(resolver->warmup_thread, INFINITE);
+    CloseHandle(resolver->warmup_thread);
+}
+# endif
+#endif
+/**
+ * Create a new symbol resolver like `wander_resolver_create`, but load the object files and build
+ * the index on a low-priority background thread.
+ * Until it is done, addresses resolve to nothing but themselves (see `wander_resolver_ready`).
+ */
+WANDER_FUN(wander_resolver_t*) wander_resolver_create_async(size_t max_depth, size_t max_locations)
+{
+#if WANDER_CONFIG_RESOLVER_INDEX
+    wander_resolver_t *resolver = alloc_resolver(max_depth, max_locations);
+    resolver->warming_up = true;
+    if (!start_warmup(resolver)) {
+        resolver->warming_up = false;
+        warmup(resolver);
+    }
+    return resolver;
+#else
+    return wander_resolver_create(max_depth, max_locations);
+#endif
+}
+/**
+ * Create a resolver that does not know about any object file of this process, files are added with `wander_resolver_add_file`.
+ * This is used to symbolize addresses on behalf of other processes.
+ */
+WANDER_FUN(wander_resolver_t*) wander_resolver_create_detached(size_t max_depth, size_t max_locations)
+{
+    wander_resolver_t *resolver = alloc_resolver(max_depth, max_locations);
+#if WANDER_CONFIG_RESOLVER_INDEX
+    resolver->detached = true;
+    resolver->next_base = (uintptr_t)1 << (sizeof(uintptr_t) > 4 ? 32 : 24);
+    build_index(resolver); /* An empty map, so lookups go to the index */
+#endif
+    return resolver;
+}
+/**
+ * Index the object file at `path` as if it were loaded at `*base`, which is chosen by the resolver.
+ * Files are remembered by `build_id` (a hexadecimal string, or NULL if unknown) or by path,
+ * adding the same file again just returns its base address.
+ * Returns 0 on success and -1 if the file can not be read or the resolver is not detached.
+ */
+WANDER_FUN(int) wander_resolver_add_file(wander_resolver_t *resolver, const char *path, const char *build_id, uintptr_t *base)
+{
+#if WANDER_CONFIG_RESOLVER_INDEX && defined(__unix__)
+    if (!resolver->detached) return -1;
+    if (build_id == NULL || strlen(build_id) >= WANDER_BUILD_ID_SIZE) build_id = "";
+    pthread_mutex_lock(&resolver->update_lock);
+    uint64_t hash = object_file_hash(build_id[0] != '\0' ? build_id : path, 0);
+    struct object_file *object_file;
+    for (size_t slot=hash; (object_file = next_object_file(resolver, hash, &slot)) != NULL;) {
+        bool same = build_id[0] != '\0' ? strcmp(object_file->build_id, build_id) == 0 : strcmp(object_file->name, path) == 0;
+        if (!same) continue;
+        *base = object_file->base;
+        pthread_mutex_unlock(&resolver->update_lock);
+# if LAZY_MAPPING
+        return !object_file->unreadable ? 0 : -1; /* It might have been unmapped since */
+# else
+        return object_file->data != NULL ? 0 : -1;
+# endif
+    }
+
+    object_file = alloc_object_file(resolver);
+    object_file->name = strdup(path);
+    object_file->fd = -1;
+    object_file->base = resolver->next_base;
+    object_file->hash = hash;
+    strcpy(object_file->build_id, build_id);
+    /* Files that can not be read are kept too, so they are not tried again */
+    if (object_file->name != NULL && map_object_file(object_file, path)) {
+        /* Like `phdr_iterate_callback`, the object is its executable segment, but every segment has to fit below `next_base` */
+        Elf64_Ehdr *ehdr = (Elf64_Ehdr *)object_file->data;
+        Elf64_Phdr *phdrs = (Elf64_Phdr *)(object_file->data + ehdr->e_phoff);
+        uint64_t end = 0;
+        for (size_t i=0; i < ehdr->e_phnum; i++) {
+            if (phdrs[i].p_type != PT_LOAD) continue;
+            if (phdrs[i].p_vaddr + phdrs[i].p_memsz > end) end = phdrs[i].p_vaddr + phdrs[i].p_memsz;
+            if ((phdrs[i].p_flags & PF_X) == 0 || object_file->memsz != 0) continue;
+            object_file->phdr = &phdrs[i];
+            object_file->vaddr = phdrs[i].p_vaddr;
+            object_file->memsz = phdrs[i].p_memsz;
+        }
+        resolver->next_base += (end + 2 * 0x100000 - 1) & ~(uintptr_t)(0x100000 - 1);
+        index_object_file(resolver, object_file);
+    }
+# if LAZY_MAPPING
+    object_file->unreadable = object_file->data == NULL;
+# endif
+    *base = object_file->base;
+    sort_object_files(resolver);
+
+    bool published = false;
+# if LAZY_MAPPING
+    /* Unmapped files are mapped again by `wander_resolve_batch` */
+    touch_object_file(resolver, object_file);
+    published = unmap_least_recently_used(resolver, object_file);
+# endif
+    if (!published) {
+        struct object_map *map = create_object_map(resolver);
+        if (map != NULL) {
+            struct object_map *old_map = publish_object_map(resolver, map);
+            synchronize_readers(resolver);
+            free(old_map);
+        }
+    }
+    pthread_mutex_unlock(&resolver->update_lock);
+    return object_file->data != NULL ? 0 : -1;
+#else
+    (void)resolver;
+    (void)path;
+    (void)build_id;
+    (void)base;
+    return -1;
+#endif
+}
+/**
+ * Create a resolver that sends batches (see `wander_resolve_batch`) to the `dweller-symbolized` daemon listening at `socket_path`
+ * (NULL for `wander_symbolized_socket_path`), so the object files of this process do not have to be indexed here.
+ * Everything else, and every batch after the daemon failed, is resolved in this process. The object files are loaded
+ * and indexed the first time that happens, until then the AS-safe functions only know the raw addresses.
+ * If the daemon can not be reached, this is the same as `wander_resolver_create`.
+ */
+WANDER_FUN(wander_resolver_t*) wander_resolver_create_client(size_t max_depth, size_t max_locations, const char *socket_path)
+{
+#if WANDER_CONFIG_RESOLVER_INDEX && defined(__unix__)
+    wander_resolver_t *resolver = alloc_resolver(max_depth, max_locations);
+    resolver->symbolized_fd = wander_symbolized_connect(socket_path);
+    if (resolver->symbolized_fd != -1) {
+        resolver->lazy_index = true;
+        return resolver;
+    }
+    load_object_files(resolver);
+    build_index(resolver);
+    return resolver;
+#else
+    (void)socket_path;
+    return wander_resolver_create(max_depth, max_locations);
+#endif
+}
+#if WANDER_CONFIG_RESOLVER_INDEX && defined(__unix__)
+/* Load and index the object files of a client resolver, once it has to resolve addresses by itself. */
+static void ensure_index(wander_resolver_t *resolver)
+{
+    if (!atomic_load(&resolver->lazy_index)) return;
+    pthread_mutex_lock(&resolver->update_lock);
+    if (atomic_load(&resolver->lazy_index)) {
+        load_object_files(resolver);
+        build_index(resolver);
+        atomic_store(&resolver->lazy_index, false);
+    }
+    pthread_mutex_unlock(&resolver->update_lock);
+}
+#else
+static void ensure_index(wander_resolver_t *resolver)
+{
+    (void)resolver;
+}
+#endif
+/**
+ * Pick up object files that were loaded or unloaded (e.g. with `dlopen` or `dlclose`) since the resolver was created
+ * or last refreshed. Only newly loaded objects are indexed, unloaded ones are released once no lookup is using them anymore.
+ * Returns 1 if the set of object files changed, 0 if it did not and -1 on error.
+ * This is done automatically by `wander_resolve_addr` and `wander_resolve_frame` when they are given an address outside
+ * of the known object files, and otherwise at most every 100 ms. Call this after `dlclose` to drop unloaded objects right away.
+ */
+WANDER_FUN(int) wander_resolver_refresh(wander_resolver_t *resolver)
+{
+#if WANDER_CONFIG_RESOLVER_INDEX && defined(__unix__)
+    if (!index_ready(resolver)) return 0; /* Still warming up, it will see the current objects */
+    if (resolver->detached) return 0;
+    /* `jit_seen` belongs to the lock, so only the loader's counters can be checked without it */
+    if (!dl_objects_changed(resolver) && resolver->jit_descriptor == NULL) return 0;
+    pthread_mutex_lock(&resolver->update_lock);
+    int res = update_index(resolver);
+    pthread_mutex_unlock(&resolver->update_lock);
+    return res;
+#else
+    (void)resolver;
+    return 0;
+#endif
+}
+#if WANDER_CONFIG_RESOLVER_INDEX && defined(__unix__)
+/* Returns true if `addr` is in one of the object files of the current map. */
+static bool known_address(wander_resolver_t *resolver, uintptr_t addr)
+{
+    unsigned epoch;
+    struct index_cursor cursor;
+    index_cursor_init(&cursor);
+    struct object_map *map = enter_object_map(resolver, &epoch);
+    bool known = map != NULL && index_lookup_object(map, &cursor, addr) != NULL;
+    leave_object_map(resolver, epoch);
+    return known;
+}
+/* Refresh before resolving `addr`, unless it is in a known object file and the last refresh was recent.
+ * A newly loaded object is picked up by the first address in it, an unloaded one within `RESOLVER_REFRESH_MS`.
+ */
+static void refresh_lazily(wander_resolver_t *resolver, uintptr_t addr)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    long long now_ms = (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+    if (now_ms - atomic_load(&resolver->refreshed) < RESOLVER_REFRESH_MS && known_address(resolver, addr)) return;
+    atomic_store(&resolver->refreshed, now_ms);
+    wander_resolver_refresh(resolver);
+}
+#else
+static void refresh_lazily(wander_resolver_t *resolver, uintptr_t addr)
+{
+    (void)addr;
+    wander_resolver_refresh(resolver);
+}
+#endif
+/**
+ * Returns non-zero if the resolver is done loading and lookups will produce symbols and source locations.
+ * This function is AS-safe.
+ */
+WANDER_FUN(int) wander_resolver_ready(wander_resolver_t *resolver)
+{
+#if WANDER_CONFIG_RESOLVER_INDEX
+    if (resolver->warming_up) return index_ready(resolver);
+#else
+    (void)resolver;
+#endif
+    return 1;
+}
+/* Look up the debug information of every frame of `backtrace` in the object files, into `frames`.
+ * The DWARF state of the object files is shared, so this fails while another thread is at it.
+ * This function is AS-safe.
+ */
+static int load_frames(wander_resolver_t *resolver, struct wander_query_frames *frames, wander_backtrace_t *backtrace)
+{
+    if (atomic_exchange(&resolver->parsing, true)) return -1;
+    frames->backtrace = backtrace;
+    frames->num_frames = backtrace->depth < frames->max_frames ? backtrace->depth : frames->max_frames;
+    for (size_t i=0; i < frames->num_frames; i++) {
+        struct symbol *sym = &frames->symbols[i];
+        memset(sym, 0x00, sizeof(struct symbol));
+        sym->address = backtrace->frames[i];
+        struct function *fun = &frames->symbols[i].fun;
+        clear_function(fun);
+        sym->object_file = find_object_file(resolver, (uintptr_t)sym->address);
+        if (sym->address == resolver->init_addr) {
+            fun->symname = "_init";
+            fun->symaddr = sym->address;
+            fun->symsize = 0;
+        }
+        if (sym->address == resolver->fini_addr) {
+            fun->symname = "_fini";
+            fun->symaddr = sym->address;
+            fun->symsize = 0;
+        }
+        if (sym->address == resolver->start_addr) {
+            fun->symname = "_start";
+            fun->symaddr = sym->address;
+            fun->symsize = 0;
+        }
+    }
+    resolver->loading = frames;
+    parse_object_files(resolver);
+    resolver->loading = NULL;
+    atomic_store(&resolver->parsing, false);
+    return 0;
+}
+/**
+ * Prepare the calling thread for the frames of `backtrace`, and hand out the locations of its pool from the start again.
+ * With an index this only resets the pool, and frames from any backtrace can be resolved.
+ * Without one, the debug information of every frame is looked up here, see `wander_query_load`.
+ * This function is AS-safe.
+ */
+WANDER_FUN(int) wander_resolver_load(wander_resolver_t *resolver, wander_backtrace_t *backtrace)
+{
+    struct resolver_thread *thread = claim_resolver_thread(resolver);
+    if (thread == NULL) return -1;
+    int res = wander_query_load(&thread->query, backtrace);
+    release_resolver_thread(thread);
+    return res;
+}
+WANDER_FUN(void) wander_resolver_free(wander_resolver_t **resolver)
+{
+#if WANDER_CONFIG_RESOLVER_INDEX
+    if ((*resolver)->warming_up) {
+        atomic_store_explicit(&(*resolver)->cancel_warmup, true, memory_order_relaxed);
+        join_warmup(*resolver);
+    }
+    free_index(*resolver);
+# if WANDER_CONFIG_RESOLVER_CACHE_SIZE > 0
+    free((*resolver)->cache);
+# endif
+# if defined(__unix__)
+    if ((*resolver)->symbolized_fd != -1) close((*resolver)->symbolized_fd);
+    pthread_mutex_destroy(&(*resolver)->symbolized_lock);
+    pthread_mutex_destroy(&(*resolver)->update_lock);
+# endif
+#endif
+    for (size_t i=0; i < (*resolver)->num_object_files; i++) {
+        release_object_file((*resolver)->object_files[i]);
+    }
+    free((*resolver)->object_files);
+    free((*resolver)->sorted_object_files);
+    free((*resolver)->object_slots);
+#if !defined(__unix__)
+    free((*resolver)->thread);
+#endif
+    /* Frees the DWARF state of every object file at once */
+    if ((*resolver)->arena_memory != NULL) {
+#if defined(__unix__)
+        munmap((*resolver)->arena_memory, WANDER_CONFIG_RESOLVER_ARENA_SIZE);
+#elif defined(_WIN32)
+        VirtualFree((*resolver)->arena_memory, 0, MEM_RELEASE);
+#endif
+    }
+    if ((*resolver)->free_fn != NULL) {
+        (*resolver)->free_fn(*resolver);
+    }
+    *resolver = NULL;
+}
+
+/**
+ * Create a query on `resolver`, with a pool of `max_locations` entries for the inlined calls of its resolutions,
+ * and room for the frames of a backtrace loaded without an index.
+ * The functions that take the resolver itself use a query of the calling thread, so a query of its own is only needed
+ * to keep resolutions apart, or to hand them to another thread. Release it with `wander_query_free`.
+ */
+WANDER_FUN(wander_query_t) wander_query(wander_resolver_t *resolver, size_t max_locations)
+{
+    wander_source_t *locations = max_locations > 0 ? malloc(max_locations * sizeof(wander_source_t)) : NULL;
+    wander_query_t query = wander_query_safe(resolver, locations, locations != NULL ? max_locations : 0);
+    query.frames = malloc(frames_size(resolver->max_depth));
+    if (query.frames != NULL) {
+        memset(query.frames, 0x00, sizeof(struct wander_query_frames));
+        query.frames->max_frames = resolver->max_depth;
+    }
+    query.free_fn = free;
+    return query;
+}
+/**
+ * Create a query on `resolver`, whose pool is the pre-allocated buffer `locations` of `max_locations` entries.
+ * A backtrace loaded without an index goes to the calling thread, as with `wander_resolver_load`.
+ * This function is AS-safe.
+ */
+WANDER_FUN(wander_query_t) wander_query_safe(wander_resolver_t *resolver, wander_source_t locations[], size_t max_locations)
+{
+    static wander_query_t null_query;
+    wander_query_t query = null_query;
+    query.resolver = resolver;
+    query.locations = locations;
+    query.max_locations = max_locations;
+    return query;
+}
+/**
+ * Hand out the locations of the pool from the start again, the inlined calls of earlier resolutions are overwritten.
+ * Without an index, the debug information of every frame of `backtrace` is looked up into the query.
+ * Only one thread at a time can do so, this returns -1 while another one is loading a backtrace.
+ * This function is AS-safe.
+ */
+WANDER_FUN(int) wander_query_load(wander_query_t *query, wander_backtrace_t *backtrace)
+{
+    wander_resolver_t *resolver = query->resolver;
+    query->num_locations = 0;
+#if WANDER_CONFIG_RESOLVER_INDEX
+    /* Frames are looked up in the index by `wander_query_resolve_frame_safe` */
+    if (index_ready(resolver)) return 0;
+    /* The background thread owns the object files until it is done */
+    if (resolver->warming_up) return -1;
+    if (atomic_load(&resolver->lazy_index)) return -1;
+#endif
+    if (query->frames != NULL) return load_frames(resolver, query->frames, backtrace);
+    struct resolver_thread *thread = claim_resolver_thread(resolver);
+    if (thread == NULL) return -1;
+    int res = load_frames(resolver, thread->frames, backtrace);
+    release_resolver_thread(thread);
+    return res;
+}
+/**
+ * Release the pool and the frames of a query.
+ * This function is AS-safe if `query->free_fn` is AS-safe.
+ */
+WANDER_FUN(void) wander_query_free(wander_query_t *query)
+{
+    static wander_query_t null_query;
+    if (query->free_fn != NULL) {
+        query->free_fn(query->locations);
+        query->free_fn(query->frames);
+    }
+    *query = null_query;
+}
+/**
+ * Resolve an arbitrary address with the location pool of the query, see `wander_resolve_addr_safe`.
+ * This function is AS-safe.
+ */
+WANDER_FUN(wander_resolution_t*) wander_query_resolve_addr_safe(wander_query_t *query, uintptr_t addr, wander_resolution_t *resolution)
+{
+    memset(resolution, 0x00, sizeof(wander_resolution_t));
+    resolution->frame.return_address = (void *)addr;
+#if WANDER_CONFIG_RESOLVER_INDEX
+    if (index_ready(query->resolver)) {
+        resolve_indexed(query, addr, resolution);
+    }
+#else
+    (void)query;
+#endif
+    return resolution;
+}
+/**
+ * Resolve an arbitrary address.
+ * The address is looked up in the index built by `wander_resolver_create`,
+ * the returned strings point into the mapped object files and stay valid until the object is unloaded
+ * and the resolver refreshed, or the resolver is freed.
+ * With `WANDER_CONFIG_RESOLVER_LAZY`, an object file is only mapped once `wander_resolve_addr`, `wander_resolve_frame`
+ * or `wander_resolve_batch` get an address in it (until then, only the object is filled in),
+ * and its strings also go away when it is unmapped again to make room for another one.
+ * Without an index, or while `wander_resolver_create_async` is still building it, only the address itself is filled in.
+ *
+ * This function is AS-safe.
+ */
+WANDER_FUN(wander_resolution_t*) wander_resolve_addr_safe(wander_resolver_t *resolver, uintptr_t addr, wander_resolution_t *resolution)
+{
+    struct resolver_thread *thread = claim_resolver_thread(resolver);
+    if (thread == NULL) {
+        /* Interrupted a resolution on this thread, only the inlined calls need the pool */
+        wander_query_t query = wander_query_safe(resolver, NULL, 0);
+        return wander_query_resolve_addr_safe(&query, addr, resolution);
+    }
+    wander_query_resolve_addr_safe(&thread->query, addr, resolution);
+    release_resolver_thread(thread);
+    return resolution;
+}
+/* Copy a resolution made with the pool of this thread into a newly allocated one, together with its inlined calls.
+ * The locations they took are handed out again.
+ */
+static wander_resolution_t *own_resolution(const wander_resolution_t *resolution, wander_query_t *query, size_t num_locations)
+{
+    wander_resolution_t *owned = malloc(sizeof(wander_resolution_t) + resolution->num_inlines * sizeof(wander_source_t));
+    if (owned != NULL) {
+        *owned = *resolution;
+        if (resolution->num_inlines != 0) {
+            owned->inlines = (wander_source_t *)(owned + 1);
+            memcpy(owned->inlines, resolution->inlines, resolution->num_inlines * sizeof(wander_source_t));
+        }
+        owned->free_fn = free;
+        owned->free_inlines_fn = NULL;
+    }
+    query->num_locations = num_locations;
+    return owned;
+}
+/**
+ * This function returns a newly allocated resolution that should be destroyed with `wander_destroy_resolution`.
+ * For more information, see `wander_resolve_addr_safe`.
+ */
+WANDER_FUN(wander_resolution_t*) wander_resolve_addr(wander_resolver_t *resolver, uintptr_t addr)
+{
+    ensure_index(resolver);
+    refresh_lazily(resolver, addr);
+    map_lazily(resolver, addr);
+    wander_resolution_t resolution;
+    struct resolver_thread *thread = claim_resolver_thread(resolver);
+    wander_query_t fallback = wander_query_safe(resolver, NULL, 0);
+    wander_query_t *query = thread != NULL ? &thread->query : &fallback;
+    size_t num_locations = query->num_locations;
+    wander_query_resolve_addr_safe(query, addr, &resolution);
+    wander_resolution_t *owned = own_resolution(&resolution, query, num_locations);
+    release_resolver_thread(thread);
+    return owned;
+}
+
+struct batch_entry {
+    uintptr_t address;
+    size_t    position; /* Index into the addresses passed to `wander_resolve_batch` */
+};
+/* Let `dweller-symbolized` resolve the sorted, distinct addresses of a batch, and remap `batch->ids` to its locations.
+ * Returns false if there is no daemon (anymore), the connection is dropped after the first failure.
+ */
+static bool remote_batch(wander_resolver_t *resolver, struct batch_entry *entries, size_t num_entries, uint32_t *slots, wander_batch_t *batch)
+{
+#if WANDER_CONFIG_RESOLVER_INDEX && defined(__unix__)
+    if (resolver->symbolized_fd == -1) return false;
+    uintptr_t *addrs = malloc((num_entries + 1) * sizeof(uintptr_t));
+    if (addrs == NULL) return false;
+    for (size_t i=0; i < num_entries; i++) addrs[i] = entries[i].address;
+    wander_batch_t remote;
+    pthread_mutex_lock(&resolver->symbolized_lock);
+    int res = resolver->symbolized_fd != -1 ? wander_symbolized_resolve(resolver->symbolized_fd, addrs, num_entries, &remote) : -1;
+    if (res != 0 && resolver->symbolized_fd != -1) {
+        close(resolver->symbolized_fd);
+        resolver->symbolized_fd = -1;
+    }
+    pthread_mutex_unlock(&resolver->symbolized_lock);
+    free(addrs);
+    if (res != 0) return false;
+
+    for (size_t i=0; i < num_entries; i++) slots[entries[i].position] = i;
+    for (size_t i=0; i < batch->num_addresses; i++) batch->ids[i] = slots[batch->ids[i]];
+    free(batch->locations);
+    free(remote.ids);
+    batch->num_locations = remote.num_locations;
+    batch->locations = remote.locations;
+    batch->num_strings = remote.num_strings;
+    batch->strings = remote.strings;
+    return true;
+#else
+    (void)resolver;
+    (void)entries;
+    (void)num_entries;
+    (void)slots;
+    (void)batch;
+    return false;
+#endif
+}
+static int batch_entry_compare(const void *a, const void *b)
+{
+    const struct batch_entry *lhs = a, *rhs = b;
+    if (lhs->address != rhs->address) return lhs->address < rhs->address ? -1 : 1;
+    return 0;
+}
+/* The strings of a batch are copied into one buffer, and the same string is stored only once */
+struct batch_strings {
+    char     *data;
+    size_t    size;
+    size_t    max_size;
+    struct batch_string {
+        size_t   offset;
+        uint32_t hash;
+    }        *entries; /* Entry 0 is unused, string id 0 is NULL */
+    size_t    num_strings;
+    size_t    max_strings;
+    uint32_t *slots;   /* Hash table of string ids, 0 means empty */
+    size_t    num_slots;
+    bool      failed;
+};
+static uint32_t batch_hash(const char *str, size_t len)
+{
+    uint32_t hash = 2166136261u; /* FNV-1a */
+    for (size_t i=0; i < len; i++) {
+        hash = (hash ^ (unsigned char)str[i]) * 16777619u;
+    }
+    return hash;
+}
+static bool batch_grow(void **array, size_t *max, size_t need, size_t size)
+{
+    if (need <= *max) return true;
+    size_t new_max = *max == 0 ? 64 : *max;
+    while (new_max < need) new_max *= 2;
+    void *new_array = realloc(*array, new_max * size);
+    if (new_array == NULL) return false;
+    *array = new_array;
+    *max = new_max;
+    return true;
+}
+static bool batch_rehash(struct batch_strings *strings, size_t num_slots)
+{
+    uint32_t *slots = calloc(num_slots, sizeof(uint32_t));
+    if (slots == NULL) return false;
+    for (size_t id=1; id < strings->num_strings; id++) {
+        size_t slot = strings->entries[id].hash & (num_slots - 1);
+        while (slots[slot] != 0) slot = (slot + 1) & (num_slots - 1);
+        slots[slot] = id;
+    }
+    free(strings->slots);
+    strings->slots = slots;
+    strings->num_slots = num_slots;
+    return true;
+}
+static uint32_t batch_intern(struct batch_strings *strings, const char *str)
+{
+    if (str == NULL || strings->failed) return 0;
+    size_t len = strlen(str);
+    uint32_t hash = batch_hash(str, len);
+    if (strings->num_strings * 2 >= strings->num_slots) {
+        if (!batch_rehash(strings, strings->num_slots == 0 ? 256 : strings->num_slots * 2)) goto fail;
+    }
+    size_t slot = hash & (strings->num_slots - 1);
+    for (; strings->slots[slot] != 0; slot = (slot + 1) & (strings->num_slots - 1)) {
+        uint32_t id = strings->slots[slot];
+        const char *other = &strings->data[strings->entries[id].offset];
+        if (strings->entries[id].hash == hash && strncmp(other, str, len + 1) == 0) return id;
+    }
+    if (strings->num_strings >= UINT32_MAX) goto fail;
+    if (!batch_grow((void **)&strings->data, &strings->max_size, strings->size + len + 1, sizeof(char))) goto fail;
+    if (!batch_grow((void **)&strings->entries, &strings->max_strings, strings->num_strings + 1, sizeof(struct batch_string))) goto fail;
+    uint32_t id = strings->num_strings++;
+    memcpy(&strings->data[strings->size], str, len + 1);
+    strings->entries[id].offset = strings->size;
+    strings->entries[id].hash = hash;
+    strings->size += len + 1;
+    strings->slots[slot] = id;
+    return id;
+fail:
+    strings->failed = true;
+    return 0;
+}
+static void batch_store(struct batch_strings *strings, wander_location_t *location, wander_resolution_t *resolution)
+{
+    location->object_base = resolution->object_base;
+    location->symbol_addr = (uintptr_t)resolution->symbol.addr;
+    location->lineno = resolution->source.lineno;
+    location->column = resolution->source.column;
+    location->object = batch_intern(strings, resolution->object);
+    location->symbol = batch_intern(strings, resolution->symbol.name);
+    location->function = batch_intern(strings, resolution->source.function);
+    location->filename = batch_intern(strings, resolution->source.filename);
+    location->directory = batch_intern(strings, resolution->source.directory);
+}
+/**
+ * Resolve many addresses at once, e.g. the samples of a profile or a set of recorded backtraces.
+ * Duplicate addresses are resolved only once, and the rest are resolved in order of address,
+ * so that each object's tables are swept once instead of searched for every address.
+ * Addresses are looked up as given, subtract 1 from return addresses to get the location of the call.
+ * A resolver created with `wander_resolver_create_client` hands the distinct addresses to `dweller-symbolized` instead.
+ *
+ * On success, `batch->ids[i]` is the index in `batch->locations` of the location of `addrs[i]`,
+ * and the strings of every location are ids into `batch->strings`, which are copied and stay valid until
+ * the batch is freed with `wander_batch_free`.
+ * Returns 0 on success and -1 if out of memory.
+ */
+WANDER_FUN(int) wander_resolve_batch(wander_resolver_t *resolver, const uintptr_t addrs[], size_t num_addrs, wander_batch_t *batch)
+{
+    memset(batch, 0x00, sizeof(wander_batch_t));
+    if (num_addrs >= UINT32_MAX) return -1;
+    wander_resolver_refresh(resolver);
+
+    struct batch_strings strings;
+    memset(&strings, 0x00, sizeof(struct batch_strings));
+    strings.num_strings = 1;
+    /* Deduplicate first, so only the distinct addresses need to be sorted */
+    size_t num_slots = 16;
+    while (num_slots < num_addrs * 2) num_slots *= 2;
+    uint32_t *slots = calloc(num_slots, sizeof(uint32_t));
+    struct batch_entry *entries = malloc((num_addrs + 1) * sizeof(struct batch_entry));
+    batch->ids = malloc((num_addrs + 1) * sizeof(uint32_t));
+    batch->locations = malloc((num_addrs + 1) * sizeof(wander_location_t));
+    if (slots == NULL || entries == NULL || batch->ids == NULL || batch->locations == NULL) goto fail;
+    size_t num_entries = 0;
+    for (size_t i=0; i < num_addrs; i++) {
+        size_t slot = (size_t)(((uint64_t)addrs[i] * 0x9e3779b97f4a7c15ull) >> 32) & (num_slots - 1);
+        while (slots[slot] != 0 && entries[slots[slot] - 1].address != addrs[i]) slot = (slot + 1) & (num_slots - 1);
+        if (slots[slot] == 0) {
+            entries[num_entries].address = addrs[i];
+            entries[num_entries].position = num_entries;
+            slots[slot] = ++num_entries;
         }
-        if (fun.include_dir.section != DWARF_SECTION_UNKNOWN) {
-            resolution->source.directory = copy_dwarf_str(dwarf, fun.include_dir, &ptr, &max_n);
+        batch->ids[i] = slots[slot] - 1;
+    }
+    qsort(entries, num_entries, sizeof(struct batch_entry), batch_entry_compare);
+    batch->num_addresses = num_addrs;
+    if (remote_batch(resolver, entries, num_entries, slots, batch)) {
+        free(entries);
+        free(slots);
+        return 0;
+    }
+    ensure_index(resolver);
+
+#if WANDER_CONFIG_RESOLVER_INDEX
+    unsigned epoch;
+    struct index_cursor cursor;
+    index_cursor_init(&cursor);
+    struct object_map *map = index_ready(resolver) ? enter_object_map(resolver, &epoch) : NULL;
+#endif
+#if LAZY_MAPPING
+    struct object_file *last_object_file = NULL;
+#endif
+    for (size_t i=0; i < num_entries; i++) {
+        wander_location_t *location = &batch->locations[i];
+        wander_resolution_t resolution;
+        memset(location, 0x00, sizeof(wander_location_t));
+        memset(&resolution, 0x00, sizeof(wander_resolution_t));
+        location->address = entries[i].address;
+#if WANDER_CONFIG_RESOLVER_INDEX
+        struct index_object *object = map ? index_lookup_object(map, &cursor, entries[i].address) : NULL;
+# if LAZY_MAPPING
+        /* The addresses are sorted, so each object file is mapped (and touched) at most once per batch */
+        if (object != NULL && object->object_file != last_object_file) {
+            last_object_file = object->object_file;
+            touch_object_file(resolver, last_object_file);
+            if (needs_mapping(last_object_file)) {
+                /* Mapping waits for readers to leave the map, so we can not be one of them */
+                leave_object_map(resolver, epoch);
+                map_lazily(resolver, entries[i].address);
+                map = enter_object_map(resolver, &epoch);
+                index_cursor_init(&cursor);
+                object = map ? index_lookup_object(map, &cursor, entries[i].address) : NULL;
+            }
         }
-        if (fun.filename.section != DWARF_SECTION_UNKNOWN) {
-            resolution->source.filename = copy_dwarf_str(dwarf, fun.filename, &ptr, &max_n);
+# endif
+        if (object != NULL) {
+            /* Only the innermost inlined function is kept, its callers would not fit a location */
+            const struct index_inline *call = resolve_object(object->object_file, &cursor, entries[i].address, &resolution);
+            if (call != NULL) resolution.source.function = call->name;
         }
+#endif
+        /* The strings are copied while the object map is entered, so the objects can not be unloaded meanwhile */
+        batch_store(&strings, location, &resolution);
+        /* Reuse the hash table to map the order of first appearance to the sorted order */
+        slots[entries[i].position] = i;
+    }
+#if WANDER_CONFIG_RESOLVER_INDEX
+    if (map != NULL) leave_object_map(resolver, epoch);
+#endif
+    for (size_t i=0; i < num_addrs; i++) {
+        batch->ids[i] = slots[batch->ids[i]];
+    }
+    batch->num_locations = num_entries;
+    batch->num_addresses = num_addrs;
+    if (strings.failed) goto fail;
+
+    /* Hand out the strings and their pointers as a single allocation */
+    char **pointers = malloc(strings.num_strings * sizeof(char *) + strings.size);
+    if (pointers == NULL) goto fail;
+    char *data = (char *)&pointers[strings.num_strings];
+    memcpy(data, strings.data, strings.size);
+    pointers[0] = NULL;
+    for (size_t id=1; id < strings.num_strings; id++) {
+        pointers[id] = &data[strings.entries[id].offset];
+    }
+    batch->strings = (const char **)pointers;
+    batch->num_strings = strings.num_strings;
+    free(strings.data);
+    free(strings.entries);
+    free(strings.slots);
+    free(entries);
+    free(slots);
+    return 0;
+fail:
+    free(strings.data);
+    free(strings.entries);
+    free(strings.slots);
+    free(entries);
+    free(slots);
+    wander_batch_free(batch);
+    return -1;
+}
+/**
+ * Free everything allocated by `wander_resolve_batch`.
+ */
+WANDER_FUN(void) wander_batch_free(wander_batch_t *batch)
+{
+    free(batch->ids);
+    free(batch->locations);
+    free((void *)batch->strings);
+    memset(batch, 0x00, sizeof(wander_batch_t));
+}
+
+/* Fill in a frame loaded by `load_frames`, the strings of its debug information are copied into the buffer of `frames`.
+ * Those are read from the object files, which is skipped while another thread is loading a backtrace.
+ * This function is AS-safe.
+ */
+static void resolve_loaded(wander_resolver_t *resolver, struct wander_query_frames *frames, size_t idx, wander_resolution_t *resolution)
+{
+    struct symbol *sym = &frames->symbols[idx];
+    struct function fun = sym->fun;
+    struct object_file *object_file = sym->object_file;
+    struct dwarf *dwarf = NULL;
+    if (object_file != NULL) {
+        dwarf = object_file->dwarf;
+        resolution->object = object_file->name;
+        resolution->object_base = object_file->base;
+    }
+    if (fun.decl_line != -1) {
+        resolution->source.lineno = fun.decl_line;
+    }
+    if (fun.symname) {
+        resolution->symbol.name = fun.symname;
+        resolution->symbol.addr = fun.symaddr;
+        resolution->symbol.size = fun.symsize;
+    }
+    if (atomic_exchange(&resolver->parsing, true)) return;
+    char *ptr = frames->buffer;
+    size_t max_n = sizeof(frames->buffer);
+    if (fun.name.section != DWARF_SECTION_UNKNOWN) {
+        resolution->source.function = copy_dwarf_str(dwarf, fun.name, &ptr, &max_n);
+    }
+    if (fun.include_dir.section != DWARF_SECTION_UNKNOWN) {
+        resolution->source.directory = copy_dwarf_str(dwarf, fun.include_dir, &ptr, &max_n);
+    }
+    if (fun.filename.section != DWARF_SECTION_UNKNOWN) {
+        resolution->source.filename = copy_dwarf_str(dwarf, fun.filename, &ptr, &max_n);
+    }
+    atomic_store(&resolver->parsing, false);
+}
+/**
+ * Resolve a address from a stack frame in a backtrace.
+ * If the resolver has an index, the frame is looked up in it directly.
+ * Otherwise, load the entire backtrace with `wander_resolver_load` on the same thread first.
+ * If the backtrace is not loaded, this function will fall back to using `wander_resolve_addr_safe`.
+ *
+ * This function is AS-safe.
+ */
+WANDER_FUN(wander_resolution_t*) wander_resolve_frame_safe(wander_resolver_t *resolver, wander_frame_t frame, wander_resolution_t *resolution)
+{
+    struct resolver_thread *thread = claim_resolver_thread(resolver);
+    if (thread == NULL) {
+        wander_query_t query = wander_query_safe(resolver, NULL, 0);
+        return wander_query_resolve_frame_safe(&query, frame, resolution);
+    }
+    wander_query_resolve_frame_safe(&thread->query, frame, resolution);
+    release_resolver_thread(thread);
+    return resolution;
+}
+/**
+ * Like `wander_resolve_frame_safe`, with the location pool of the query.
+ * Without an index, the frame must be from the backtrace loaded into the query (or into the calling thread, if the query
+ * has no frames of its own).
+ * This function is AS-safe.
+ */
+WANDER_FUN(wander_resolution_t*) wander_query_resolve_frame_safe(wander_query_t *query, wander_frame_t frame, wander_resolution_t *resolution)
+{
+    wander_resolver_t *resolver = query->resolver;
+    memset(resolution, 0x00, sizeof(wander_resolution_t));
+    resolution->frame = frame;
+#if WANDER_CONFIG_RESOLVER_INDEX
+    if (resolver->warming_up && !index_ready(resolver)) {
+        return resolution; /* Not done yet, all we have is the raw address */
+    }
+    if (index_ready(resolver)) {
+        /* A return address points past the call instruction, which might already belong to the next line or function */
+        uintptr_t addr = (uintptr_t)frame.return_address;
+        if (addr != 0) resolve_indexed(query, addr - 1, resolution);
+        return resolution;
+    }
+#endif
+    struct wander_query_frames *frames = query->frames;
+    struct resolver_thread *thread = NULL;
+    if (frames == NULL && (thread = claim_resolver_thread(resolver)) != NULL) frames = thread->frames;
+    if (frames != NULL && frame.backtrace != NULL && frame.backtrace == frames->backtrace && frame.frame_index < frames->num_frames) {
+        resolve_loaded(resolver, frames, frame.frame_index, resolution);
+        release_resolver_thread(thread);
         return resolution;
     }
-    return wander_resolve_addr_safe(resolver, (uintptr_t)frame.return_address, resolution);
+    release_resolver_thread(thread);
+    wander_query_resolve_addr_safe(query, (uintptr_t)frame.return_address, resolution);
+    resolution->frame = frame;
+    return resolution;
 }
 /**
  * This function returns a newly allocated resolution that should be destroyed with `wander_destroy_resolution`.
@@ -936,12 +3526,20 @@ WANDER_FUN(wander_resolution_t*) wander_resolve_frame_safe(wander_resolver_t *re
  */
 WANDER_FUN(wander_resolution_t*) wander_resolve_frame(wander_resolver_t *resolver, wander_frame_t frame)
 {
-    wander_resolution_t *resolution = malloc(sizeof(wander_resolution_t));
-    resolution = wander_resolve_frame_safe(resolver, frame, resolution);
-    if (resolution != NULL) {
-        resolution->free_fn = free;
+    ensure_index(resolver);
+    if (frame.return_address != NULL) {
+        refresh_lazily(resolver, (uintptr_t)frame.return_address - 1);
+        map_lazily(resolver, (uintptr_t)frame.return_address - 1);
     }
-    return resolution;
+    wander_resolution_t resolution;
+    struct resolver_thread *thread = claim_resolver_thread(resolver);
+    wander_query_t fallback = wander_query_safe(resolver, NULL, 0);
+    wander_query_t *query = thread != NULL ? &thread->query : &fallback;
+    size_t num_locations = query->num_locations;
+    wander_query_resolve_frame_safe(query, frame, &resolution);
+    wander_resolution_t *owned = own_resolution(&resolution, query, num_locations);
+    release_resolver_thread(thread);
+    return owned;
 }
 /**
  * Invalidate the resolution and deallocate used memory.
@@ -949,6 +3547,9 @@ WANDER_FUN(wander_resolution_t*) wander_resolve_frame(wander_resolver_t *resolve
  */
 WANDER_FUN(void) wander_destroy_resolution(wander_resolution_t **resolution)
 {
+    if ((*resolution)->free_inlines_fn != NULL) {
+        (*resolution)->free_inlines_fn((*resolution)->inlines);
+    }
     if ((*resolution)->free_fn != NULL) {
         (*resolution)->free_fn(*resolution);
     }
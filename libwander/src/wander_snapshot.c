@@ -0,0 +1,259 @@
+#include <libwander/wander.h>
+
+#include "wander_internal.h"
+
+#if defined(__linux__)
+# include <dirent.h> /* opendir */
+# include <errno.h>
+# include <pthread.h>
+# include <sched.h> /* sched_yield */
+# include <sys/syscall.h> /* SYS_gettid, SYS_tgkill */
+# include <time.h> /* clock_gettime, nanosleep */
+# include <unistd.h>
+#endif
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h> /* malloc, free */
+#include <string.h> /* memset */
+
+#if defined(__linux__)
+enum {
+    SLOT_PENDING,   /* The thread was signalled */
+    SLOT_WRITING,   /* The thread is writing its backtrace */
+    SLOT_DONE,      /* The backtrace is complete */
+    SLOT_ABANDONED, /* The thread did not respond in time, it must not touch the slot anymore */
+};
+/* The slots and the frames are one allocation, which is leaked when a thread might still write to it */
+struct snapshot_slot {
+    atomic_int         state;
+    pid_t              tid;
+    wander_backtrace_t backtrace;
+};
+struct snapshot_request {
+    size_t                num_slots;
+    struct snapshot_slot *slots;
+    void                **frames;
+};
+
+/* Only one snapshot is taken at a time.
+ * The handler stays installed after the first snapshot, a signal that arrives late would kill the process otherwise.
+ * It counts itself in `active`, so a request is not freed while a handler might still look at it.
+ */
+static struct {
+    pthread_mutex_t                   lock;
+    bool                              installed;
+    _Atomic(struct snapshot_request *) request;
+    atomic_size_t                     active;
+} snapshot_global = { PTHREAD_MUTEX_INITIALIZER, false, NULL, 0 };
+
+static void snapshot_handler(int signo, siginfo_t *info, void *ucontext)
+{
+    (void)signo;
+    if (info->si_code != SI_TKILL || info->si_pid != getpid()) return; /* Not ours */
+    int saved_errno = errno;
+    atomic_fetch_add(&snapshot_global.active, 1);
+    struct snapshot_request *request = atomic_load(&snapshot_global.request);
+    pid_t tid = syscall(SYS_gettid);
+    for (size_t i=0; request != NULL && i < request->num_slots; i++) {
+        struct snapshot_slot *slot = &request->slots[i];
+        if (slot->tid != tid) continue;
+        int expected = SLOT_PENDING;
+        if (!atomic_compare_exchange_strong(&slot->state, &expected, SLOT_WRITING)) break;
+        slot->backtrace = wander_backtrace_safe(slot->backtrace.frames, slot->backtrace.max_depth);
+        wander_skip_signal_frames(&slot->backtrace, wander_ucontext_pc(ucontext));
+        /* Too late if the slot was abandoned meanwhile */
+        expected = SLOT_WRITING;
+        atomic_compare_exchange_strong(&slot->state, &expected, SLOT_DONE);
+        break;
+    }
+    atomic_fetch_sub(&snapshot_global.active, 1);
+    errno = saved_errno;
+}
+static bool snapshot_install(void)
+{
+    if (snapshot_global.installed) return true;
+    struct sigaction action;
+    memset(&action, 0x00, sizeof(action));
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigfillset(&action.sa_mask);
+    action.sa_sigaction = &snapshot_handler;
+    if (sigaction(SIGRTMIN + WANDER_CONFIG_SNAPSHOT_SIGNAL, &action, NULL) != 0) return false;
+    snapshot_global.installed = true;
+    return true;
+}
+static uint64_t snapshot_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+/* Lists the threads of this process, except the calling one */
+static size_t snapshot_threads(struct snapshot_slot *slots, size_t max_slots, pid_t self)
+{
+    DIR *dir = opendir("/proc/self/task");
+    if (dir == NULL) return 0;
+    size_t num_slots = 0;
+    struct dirent *entry;
+    while (num_slots < max_slots && (entry = readdir(dir)) != NULL) {
+        char *end;
+        long tid = strtol(entry->d_name, &end, 10);
+        if (end == entry->d_name || *end != '\0' || tid == self) continue;
+        slots[num_slots++].tid = tid;
+    }
+    closedir(dir);
+    return num_slots;
+}
+#endif
+
+/**
+ * Take a backtrace of every thread of the process at (about) the same time, for example to find out why it hangs.
+ * Every other thread is interrupted with the real-time signal `SIGRTMIN + WANDER_CONFIG_SNAPSHOT_SIGNAL`,
+ * which must not be used by the application, and writes at most `max_depth` frames into a slot that was allocated for it.
+ * Threads that block the signal, or do not respond within `timeout_ms` milliseconds, are counted in `num_missed`.
+ * That includes a thread that is still writing its backtrace, the memory it writes to is leaked so that it can finish.
+ * Like any signal, this makes system calls such as `nanosleep` in the other threads fail with EINTR.
+ * At most `max_threads` threads are captured, the calling thread is always the first.
+ * Returns 0 on success, and -1 on failure or if this is not supported on the platform.
+ */
+WANDER_FUN(int) wander_snapshot(wander_snapshot_t *snapshot, size_t max_threads, size_t max_depth, unsigned timeout_ms)
+{
+    memset(snapshot, 0x00, sizeof(wander_snapshot_t));
+#if defined(__linux__)
+    if (max_threads == 0 || max_depth == 0) return -1;
+    struct snapshot_request *request = malloc(sizeof(struct snapshot_request));
+    struct snapshot_slot *slots = calloc(max_threads, sizeof(struct snapshot_slot));
+    void **frames = calloc(max_threads * max_depth, sizeof(void *));
+    snapshot->backtraces = calloc(max_threads, sizeof(wander_backtrace_t));
+    if (request == NULL || slots == NULL || frames == NULL || snapshot->backtraces == NULL) {
+        free(request);
+        free(slots);
+        free(frames);
+        free(snapshot->backtraces);
+        snapshot->backtraces = NULL;
+        return -1;
+    }
+
+    pthread_mutex_lock(&snapshot_global.lock);
+    pid_t self = syscall(SYS_gettid);
+    size_t num_slots = snapshot_install() ? snapshot_threads(&slots[1], max_threads - 1, self) + 1 : 1;
+    for (size_t i=0; i < num_slots; i++) {
+        slots[i].backtrace.frames = &frames[i * max_depth];
+        slots[i].backtrace.max_depth = max_depth;
+        atomic_init(&slots[i].state, SLOT_PENDING);
+    }
+    request->num_slots = num_slots;
+    request->slots = slots;
+    request->frames = frames;
+    atomic_store(&snapshot_global.request, request);
+
+    /* Signal everyone first, so the backtraces are taken close together */
+    pid_t pid = getpid();
+    for (size_t i=1; i < num_slots; i++) {
+        if (syscall(SYS_tgkill, pid, slots[i].tid, SIGRTMIN + WANDER_CONFIG_SNAPSHOT_SIGNAL) != 0) {
+            atomic_store(&slots[i].state, SLOT_ABANDONED); /* The thread is already gone */
+            slots[i].tid = 0;
+        }
+    }
+    slots[0].tid = self;
+    slots[0].backtrace = wander_backtrace_safe(slots[0].backtrace.frames, max_depth);
+    wander_backtrace_rebase(&slots[0].backtrace, __builtin_return_address(0)); /* Start at our caller */
+    atomic_store(&slots[0].state, SLOT_DONE);
+
+    /* Past the deadline, every thread that is not done is abandoned, even in the middle of writing its backtrace */
+    uint64_t deadline = snapshot_now_ms() + timeout_ms;
+    bool late_writers = false;
+    for (size_t i=1; i < num_slots; i++) {
+        struct snapshot_slot *slot = &slots[i];
+        for (;;) {
+            int state = atomic_load(&slot->state);
+            if (state == SLOT_DONE || state == SLOT_ABANDONED) break;
+            if (snapshot_now_ms() >= deadline) {
+                if (!atomic_compare_exchange_strong(&slot->state, &state, SLOT_ABANDONED)) continue;
+                late_writers |= state == SLOT_WRITING;
+                break;
+            }
+            struct timespec pause = { 0, 50000 };
+            nanosleep(&pause, NULL);
+        }
+    }
+
+    atomic_store(&snapshot_global.request, NULL);
+    while (atomic_load(&snapshot_global.active) != 0) {
+        if (snapshot_now_ms() >= deadline) {
+            late_writers = true; /* A handler still has the request */
+            break;
+        }
+        sched_yield();
+    }
+    pthread_mutex_unlock(&snapshot_global.lock);
+
+    if (late_writers) {
+        /* The request stays allocated for the threads that still write to it, the snapshot gets a copy of the frames */
+        void **copy = calloc(max_threads * max_depth, sizeof(void *));
+        if (copy == NULL) {
+            free(snapshot->backtraces);
+            snapshot->backtraces = NULL;
+            return -1;
+        }
+        for (size_t i=0; i < num_slots; i++) {
+            if (atomic_load(&slots[i].state) != SLOT_DONE) continue;
+            memcpy(&copy[i * max_depth], slots[i].backtrace.frames, max_depth * sizeof(void *));
+            slots[i].backtrace.frames = &copy[i * max_depth];
+        }
+        frames = copy;
+    }
+    snapshot->frames = frames;
+    for (size_t i=0; i < num_slots; i++) {
+        int state = atomic_load(&slots[i].state);
+        if (state == SLOT_DONE) {
+            wander_backtrace_t *backtrace = &snapshot->backtraces[snapshot->num_threads++];
+            *backtrace = slots[i].backtrace;
+            backtrace->free_fn = NULL; /* The frames belong to the snapshot */
+        } else if (slots[i].tid != 0) {
+            snapshot->num_missed++;
+        }
+    }
+    if (!late_writers) {
+        free(slots);
+        free(request);
+    }
+    return 0;
+#else
+    return -1;
+#endif
+}
+/**
+ * Release the memory used by a snapshot.
+ */
+WANDER_FUN(void) wander_snapshot_free(wander_snapshot_t *snapshot)
+{
+    free(snapshot->backtraces);
+    free(snapshot->frames);
+    memset(snapshot, 0x00, sizeof(wander_snapshot_t));
+}
+/**
+ * Resolve the frames of every thread in a snapshot at once, see `wander_resolve_batch`.
+ * The addresses are the frames of `snapshot->backtraces[0]` (from `offset` to `depth`), followed by those of the next thread, and so on.
+ * Each innermost frame is the instruction the thread was interrupted at, the other frames are return addresses,
+ * which are resolved at `address - 1` so that they fall in the call and not in the line or function after it.
+ */
+WANDER_FUN(int) wander_resolve_snapshot(wander_resolver_t *resolver, wander_snapshot_t *snapshot, wander_batch_t *batch)
+{
+    size_t num_addrs = 0;
+    for (size_t i=0; i < snapshot->num_threads; i++) {
+        num_addrs += snapshot->backtraces[i].depth - snapshot->backtraces[i].offset;
+    }
+    uintptr_t *addrs = malloc((num_addrs + 1) * sizeof(uintptr_t));
+    if (addrs == NULL) return -1;
+    size_t k = 0;
+    for (size_t i=0; i < snapshot->num_threads; i++) {
+        wander_backtrace_t *backtrace = &snapshot->backtraces[i];
+        for (size_t j=backtrace->offset; j < backtrace->depth; j++) {
+            addrs[k++] = (uintptr_t)backtrace->frames[j] - (j > backtrace->offset ? 1 : 0);
+        }
+    }
+    int res = wander_resolve_batch(resolver, addrs, num_addrs, batch);
+    free(addrs);
+    return res;
+}
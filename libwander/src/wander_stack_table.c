@@ -0,0 +1,93 @@
+#include <libwander/wander.h>
+
+#include <stdatomic.h>
+#include <stdlib.h> /* calloc, free */
+
+/* Stacks are kept by fingerprint in an open addressing table with linear probing, which is never more than half full.
+ * A slot is claimed by writing its key, the id of a stack is the index of its slot (plus one), so it never changes.
+ * Nothing is ever removed, so readers need no locks.
+ */
+struct wander_stack_table {
+    size_t            max_stacks;
+    size_t            num_slots; /* A power of two */
+    atomic_size_t     num_stacks;
+    _Atomic(uint64_t) *keys;     /* The fingerprint in each slot, or 0 */
+    atomic_size_t    *counts;
+};
+
+/**
+ * Create a table that remembers up to `max_stacks` different stacks, and how often each was seen.
+ * It is meant for logging many backtraces: only the first backtrace of a stack has to be resolved and printed,
+ * later ones can be logged by the id of their stack.
+ */
+WANDER_FUN(wander_stack_table_t*) wander_stack_table_create(size_t max_stacks)
+{
+    if (max_stacks == 0 || max_stacks > SIZE_MAX / 4) return NULL;
+    wander_stack_table_t *table = malloc(sizeof(wander_stack_table_t));
+    if (table == NULL) return NULL;
+    table->max_stacks = max_stacks;
+    table->num_slots = 1;
+    while (table->num_slots < 2 * max_stacks) table->num_slots *= 2;
+    atomic_init(&table->num_stacks, 0);
+    table->keys = calloc(table->num_slots, sizeof(*table->keys));
+    table->counts = calloc(table->num_slots, sizeof(*table->counts));
+    if (table->keys == NULL || table->counts == NULL) {
+        wander_stack_table_free(&table);
+        return NULL;
+    }
+    return table;
+}
+/**
+ * Count an occurrence of the stack of `backtrace` (see `wander_backtrace_fingerprint`), and return its id.
+ * The number of times the stack was seen, this one included, is stored in `count` unless it is NULL,
+ * so a count of 1 means the stack is new.
+ * Returns 0 (and a count of 0) if the stack is new but the table already holds `max_stacks` stacks.
+ * Different stacks with the same fingerprint share an id, which is unlikely enough to be ignored.
+ * This function is AS-safe, and can be called by several threads at once.
+ */
+WANDER_FUN(size_t) wander_stack_table_intern(wander_stack_table_t *table, wander_backtrace_t *backtrace, size_t *count)
+{
+    uint64_t fingerprint = wander_backtrace_fingerprint(backtrace);
+    size_t mask = table->num_slots - 1;
+    for (size_t n=0, i=fingerprint & mask; n < table->num_slots; n++, i = (i + 1) & mask) {
+        uint64_t key = atomic_load_explicit(&table->keys[i], memory_order_acquire);
+        if (key == 0) {
+            /* The stack is not in the table, or another thread is adding it right now */
+            if (atomic_fetch_add(&table->num_stacks, 1) >= table->max_stacks) {
+                atomic_fetch_sub(&table->num_stacks, 1);
+                break;
+            }
+            if (atomic_compare_exchange_strong(&table->keys[i], &key, fingerprint)) {
+                key = fingerprint;
+            } else {
+                atomic_fetch_sub(&table->num_stacks, 1);
+            }
+        }
+        if (key != fingerprint) continue;
+        size_t seen = atomic_fetch_add(&table->counts[i], 1) + 1;
+        if (count != NULL) *count = seen;
+        return i + 1;
+    }
+    if (count != NULL) *count = 0;
+    return 0;
+}
+/**
+ * Returns how often the stack with the given id was seen, or 0 if there is no such stack.
+ * This function is AS-safe.
+ */
+WANDER_FUN(size_t) wander_stack_table_count(wander_stack_table_t *table, size_t id)
+{
+    if (id == 0 || id > table->num_slots) return 0;
+    return atomic_load(&table->counts[id - 1]);
+}
+/**
+ * Release the memory used by a table, no other thread may use it anymore.
+ */
+WANDER_FUN(void) wander_stack_table_free(wander_stack_table_t **table)
+{
+    if (*table == NULL) return;
+    free((*table)->keys);
+    free((*table)->counts);
+    free(*table);
+    *table = NULL;
+}
@@ -0,0 +1,598 @@
+#include <libwander/wander.h>
+
+#include "wander_symbolized.h"
+#include "wander_debugfile.h"
+#include "wander_platform.h"
+
+#if defined(__unix__)
+# include <errno.h>
+# include <fcntl.h> /* fcntl */
+# include <link.h> /* dl_iterate_phdr */
+# include <poll.h>
+# include <stdio.h> /* snprintf */
+# include <sys/auxv.h> /* getauxval */
+# include <sys/socket.h>
+# include <sys/stat.h> /* mkdir, stat */
+# include <sys/time.h> /* struct timeval */
+# include <sys/un.h> /* struct sockaddr_un */
+# include <unistd.h>
+#endif
+#if defined(__linux__)
+# include <sys/sysmacros.h> /* major, minor */
+#endif
+
+#include <stdbool.h>
+#include <stdlib.h> /* malloc, free */
+#include <string.h> /* memcpy */
+
+#if defined(__unix__)
+static bool read_all(int fd, void *data, size_t size)
+{
+    char *ptr = data;
+    while (size > 0) {
+        ssize_t n = read(fd, ptr, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false; /* Also when `SO_RCVTIMEO` ran out */
+        ptr += n;
+        size -= n;
+    }
+    return true;
+}
+static bool write_all(int fd, const void *data, size_t size)
+{
+    const char *ptr = data;
+    while (size > 0) {
+        ssize_t n = send(fd, ptr, size, MSG_NOSIGNAL); /* A daemon that went away must not kill us */
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            /* The daemon's sockets are non-blocking, a client that does not read is given up on */
+            struct pollfd pfd = { fd, POLLOUT, 0 };
+            if (poll(&pfd, 1, SYMBOLIZED_TIMEOUT_MS) == 1) continue;
+            return false;
+        }
+        if (n <= 0) return false;
+        ptr += n;
+        size -= n;
+    }
+    return true;
+}
+/* Returns true if the header has the expected magic and version, and a payload that is not too large */
+static bool check_header(const struct symbolized_header *header)
+{
+    return header->magic == SYMBOLIZED_MAGIC && header->version == SYMBOLIZED_VERSION && header->size <= SYMBOLIZED_MAX_SIZE;
+}
+/* Reads a header with the expected magic and version, and the payload after it into a new buffer */
+static void *read_message(int fd, struct symbolized_header *header)
+{
+    if (!read_all(fd, header, sizeof(struct symbolized_header))) return NULL;
+    if (!check_header(header)) return NULL;
+    char *payload = malloc(header->size + 1);
+    if (payload == NULL) return NULL;
+    if (!read_all(fd, payload, header->size)) {
+        free(payload);
+        return NULL;
+    }
+    return payload;
+}
+/* Returns the user of the process at the other end of the connection, or -1 */
+static uid_t peer_uid(int fd, pid_t *pid)
+{
+#if defined(__linux__)
+    struct ucred cred;
+    socklen_t size = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &size) == -1 || size != sizeof(cred)) return (uid_t)-1;
+    if (pid != NULL) *pid = cred.pid;
+    return cred.uid;
+#else
+    uid_t uid;
+    gid_t gid;
+    if (pid != NULL) *pid = 0;
+    return getpeereid(fd, &uid, &gid) == 0 ? uid : (uid_t)-1;
+#endif
+}
+#endif
+
+/**
+ * Write where `dweller-symbolized` listens by default to `path`: `WANDER_CONFIG_SYMBOLIZED_SOCKET` in $XDG_RUNTIME_DIR,
+ * or in /tmp/dweller-<uid> if that is not set. Either directory has to be owned by us and closed to everyone else,
+ * with `create` the one in /tmp is created if it does not exist yet.
+ * Returns 0 on success and -1 if the directory can not be used or the path does not fit in `size` bytes.
+ */
+WANDER_FUN(int) wander_symbolized_socket_path(char *path, size_t size, int create)
+{
+#if defined(__unix__)
+    const char *dir = getenv("XDG_RUNTIME_DIR");
+    char fallback[64];
+    if (dir == NULL || dir[0] != '/') {
+        snprintf(fallback, sizeof(fallback), "/tmp/dweller-%lu", (unsigned long)geteuid());
+        dir = fallback;
+        if (create && mkdir(dir, 0700) == -1 && errno != EEXIST) return -1;
+    }
+    /* lstat, so that nobody else can point us elsewhere with a symlink */
+    struct stat st;
+    if (lstat(dir, &st) == -1 || !S_ISDIR(st.st_mode) || st.st_uid != geteuid() || (st.st_mode & 0077) != 0) return -1;
+    int n = snprintf(path, size, "%s/%s", dir, WANDER_CONFIG_SYMBOLIZED_SOCKET);
+    return n >= 0 && (size_t)n < size ? 0 : -1;
+#else
+    return -1;
+#endif
+}
+
+#if defined(__unix__)
+/**
+ * Connect to `dweller-symbolized` at `socket_path`, or at `wander_symbolized_socket_path` if it is NULL.
+ * The daemon has to run as the same user, and every request gives up after `SYMBOLIZED_TIMEOUT_MS` without progress.
+ * Returns a file descriptor, or -1 if it is not running.
+ */
+WANDER_FUN(int) wander_symbolized_connect(const char *socket_path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0x00, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path == NULL) {
+        if (wander_symbolized_socket_path(addr.sun_path, sizeof(addr.sun_path), 0) != 0) return -1;
+    } else {
+        if (strlen(socket_path) >= sizeof(addr.sun_path)) return -1;
+        strcpy(addr.sun_path, socket_path);
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) return -1;
+    struct timeval timeout = { SYMBOLIZED_TIMEOUT_MS / 1000, (SYMBOLIZED_TIMEOUT_MS % 1000) * 1000 };
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == -1
+        || setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) == -1
+        || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1
+        || peer_uid(fd, NULL) != geteuid()) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+struct symbolized_module {
+    uintptr_t   base;
+    uintptr_t   start;
+    uintptr_t   end;
+    char       *name;
+    char        build_id[WANDER_BUILD_ID_SIZE];
+    uint32_t    object; /* Index in the request, or UINT32_MAX if no address is in this module */
+};
+struct symbolized_modules {
+    size_t                    num_modules;
+    size_t                    max_modules;
+    struct symbolized_module *modules;
+    bool                      failed;
+};
+static int module_callback(struct dl_phdr_info *info, size_t size, void *ud)
+{
+    (void)size;
+    struct symbolized_modules *modules = ud;
+    uintptr_t start = UINTPTR_MAX, end = 0;
+    for (size_t k=0; k < info->dlpi_phnum; k++) {
+        const ElfW(Phdr) *phdr = &info->dlpi_phdr[k];
+        if (phdr->p_type != PT_LOAD || (phdr->p_flags & PF_X) == 0) continue; /* The same range as the resolver */
+        if (info->dlpi_addr + phdr->p_vaddr < start) start = info->dlpi_addr + phdr->p_vaddr;
+        if (info->dlpi_addr + phdr->p_vaddr + phdr->p_memsz > end) end = info->dlpi_addr + phdr->p_vaddr + phdr->p_memsz;
+    }
+    if (start >= end) return 0;
+    if (modules->num_modules + 1 > modules->max_modules) {
+        size_t max_modules = modules->max_modules == 0 ? 64 : modules->max_modules * 2;
+        struct symbolized_module *new_modules = realloc(modules->modules, max_modules * sizeof(struct symbolized_module));
+        if (new_modules == NULL) {
+            modules->failed = true;
+            return 1;
+        }
+        modules->modules = new_modules;
+        modules->max_modules = max_modules;
+    }
+    /* Same naming as the resolver, the daemon has to be able to open it */
+    const char *name = info->dlpi_name;
+    if (!name || name[0] == '\0') name = (const char *)getauxval(AT_EXECFN);
+    if (!name || name[0] == '\0') name = "/proc/self/exe";
+    struct symbolized_module *module = &modules->modules[modules->num_modules];
+    module->base = info->dlpi_addr;
+    module->start = start;
+    module->end = end;
+    module->name = strdup(name);
+    module->object = UINT32_MAX;
+    wander_debugfile_build_id(info, module->build_id, sizeof(module->build_id));
+    if (module->name == NULL) {
+        modules->failed = true;
+        return 1;
+    }
+    modules->num_modules++;
+    return 0;
+}
+static int module_compare(const void *a, const void *b)
+{
+    const struct symbolized_module *lhs = a, *rhs = b;
+    if (lhs->start != rhs->start) return lhs->start < rhs->start ? -1 : 1;
+    return 0;
+}
+/* Serialize a request for the sorted addresses, `owners[i]` is set to the module of `addrs[i]` or NULL */
+static char *build_request(struct symbolized_modules *modules, const uintptr_t addrs[], size_t num_addrs, struct symbolized_module **owners, size_t *psize)
+{
+    uint32_t num_objects = 0;
+    size_t size = sizeof(struct symbolized_header) + num_addrs * sizeof(struct symbolized_frame);
+    size_t m = 0;
+    for (size_t i=0; i < num_addrs; i++) {
+        while (m < modules->num_modules && modules->modules[m].end <= addrs[i]) m++;
+        struct symbolized_module *module = m < modules->num_modules && modules->modules[m].start <= addrs[i] ? &modules->modules[m] : NULL;
+        owners[i] = module;
+        if (module == NULL || module->object != UINT32_MAX) continue;
+        module->object = num_objects++;
+        size += sizeof(struct symbolized_object) + strlen(module->build_id) + strlen(module->name);
+    }
+    if (size - sizeof(struct symbolized_header) > SYMBOLIZED_MAX_SIZE) return NULL;
+    char *request = malloc(size);
+    if (request == NULL) return NULL;
+    struct symbolized_header header = { SYMBOLIZED_MAGIC, SYMBOLIZED_VERSION, num_objects, num_addrs, size - sizeof(struct symbolized_header) };
+    char *ptr = request;
+    memcpy(ptr, &header, sizeof(header));
+    ptr += sizeof(header);
+    for (size_t i=0; i < modules->num_modules; i++) {
+        struct symbolized_module *module = &modules->modules[i];
+        if (module->object == UINT32_MAX) continue;
+        /* Modules are numbered in order of address, which is their order here too */
+        struct symbolized_object object = { strlen(module->build_id), strlen(module->name) };
+        memcpy(ptr, &object, sizeof(object));
+        ptr += sizeof(object);
+        memcpy(ptr, module->build_id, object.build_id_size);
+        ptr += object.build_id_size;
+        memcpy(ptr, module->name, object.path_size);
+        ptr += object.path_size;
+    }
+    for (size_t i=0; i < num_addrs; i++) {
+        struct symbolized_frame frame = { 0, UINT32_MAX, 0 };
+        if (owners[i] != NULL) {
+            frame.offset = addrs[i] - owners[i]->base;
+            frame.object = owners[i]->object;
+        }
+        memcpy(ptr, &frame, sizeof(frame));
+        ptr += sizeof(frame);
+    }
+    *psize = size;
+    return request;
+}
+/* Turn a response into a batch with one location per address */
+static bool parse_response(const struct symbolized_header *header, char *payload, const uintptr_t addrs[], size_t num_addrs, struct symbolized_module **owners, wander_batch_t *batch)
+{
+    size_t num_strings = header->num_objects;
+    size_t fixed_size = num_addrs * sizeof(struct symbolized_location) + num_strings * sizeof(uint32_t);
+    if (header->num_items != num_addrs || num_strings == 0 || header->size < fixed_size + 1) return false;
+    const char *data = payload + fixed_size;
+    size_t data_size = header->size - fixed_size;
+    if (data[data_size - 1] != '\0') return false; /* Every string is terminated within the data */
+
+    batch->ids = malloc((num_addrs + 1) * sizeof(uint32_t));
+    batch->locations = malloc((num_addrs + 1) * sizeof(wander_location_t));
+    char **pointers = malloc(num_strings * sizeof(char *) + data_size);
+    batch->strings = (const char **)pointers;
+    if (batch->ids == NULL || batch->locations == NULL || pointers == NULL) return false;
+    char *strings = (char *)&pointers[num_strings];
+    memcpy(strings, data, data_size);
+    pointers[0] = NULL;
+    for (size_t i=1; i < num_strings; i++) {
+        uint32_t offset;
+        memcpy(&offset, payload + num_addrs * sizeof(struct symbolized_location) + i * sizeof(uint32_t), sizeof(offset));
+        if (offset >= data_size) return false;
+        pointers[i] = &strings[offset];
+    }
+    batch->num_strings = num_strings;
+    for (size_t i=0; i < num_addrs; i++) {
+        struct symbolized_location in;
+        memcpy(&in, payload + i * sizeof(struct symbolized_location), sizeof(in));
+        if (in.object >= num_strings || in.symbol >= num_strings || in.function >= num_strings || in.filename >= num_strings || in.directory >= num_strings) return false;
+        wander_location_t *location = &batch->locations[i];
+        uintptr_t base = owners[i] != NULL ? owners[i]->base : 0;
+        location->address = addrs[i];
+        location->object_base = base;
+        location->symbol_addr = (in.flags & SYMBOLIZED_HAVE_SYMBOL) ? base + in.symbol_offset : 0;
+        location->object = in.object;
+        location->symbol = in.symbol;
+        location->function = in.function;
+        location->filename = in.filename;
+        location->directory = in.directory;
+        location->lineno = in.lineno;
+        location->column = in.column;
+        batch->ids[i] = i;
+    }
+    batch->num_locations = num_addrs;
+    batch->num_addresses = num_addrs;
+    return true;
+}
+/**
+ * Let `dweller-symbolized` resolve the sorted addresses `addrs`, into a batch with a location for each of them.
+ * Returns 0 on success and -1 if the connection or the daemon failed, the connection should not be used after that.
+ */
+WANDER_FUN(int) wander_symbolized_resolve(int fd, const uintptr_t addrs[], size_t num_addrs, wander_batch_t *batch)
+{
+    memset(batch, 0x00, sizeof(wander_batch_t));
+    if (num_addrs >= UINT32_MAX) return -1;
+    struct symbolized_modules modules;
+    memset(&modules, 0x00, sizeof(modules));
+    dl_iterate_phdr(module_callback, &modules);
+    qsort(modules.modules, modules.num_modules, sizeof(struct symbolized_module), module_compare);
+
+    bool ok = false;
+    size_t size = 0;
+    char *request = NULL, *response = NULL;
+    struct symbolized_module **owners = malloc((num_addrs + 1) * sizeof(struct symbolized_module *));
+    if (modules.failed || owners == NULL) goto done;
+    request = build_request(&modules, addrs, num_addrs, owners, &size);
+    if (request == NULL || !write_all(fd, request, size)) goto done;
+    struct symbolized_header header;
+    response = read_message(fd, &header);
+    if (response == NULL) goto done;
+    ok = parse_response(&header, response, addrs, num_addrs, owners, batch);
+
+done:
+    if (!ok) wander_batch_free(batch);
+    for (size_t i=0; i < modules.num_modules; i++) free(modules.modules[i].name);
+    free(modules.modules);
+    free(owners);
+    free(request);
+    free(response);
+    return ok ? 0 : -1;
+}
+#endif
+
+#if defined(__unix__)
+struct wander_symbolized_client {
+    int                      fd;
+    pid_t                    pid;
+    struct symbolized_header header;
+    size_t                   received; /* Bytes of the current request so far, including the header */
+    char                    *request;  /* Its payload, once the header is complete */
+};
+
+#if defined(__linux__)
+struct peer_file {
+    unsigned long dev_major;
+    unsigned long dev_minor;
+    unsigned long inode;
+};
+struct peer_files {
+    size_t            num_files;
+    size_t            max_files;
+    struct peer_file *files;
+};
+static bool peer_file_callback(void *ud, const struct wander_mapping *mapping)
+{
+    struct peer_files *files = ud;
+    if (mapping->inode == 0) return false; /* Anonymous */
+    struct peer_file file = { mapping->dev_major, mapping->dev_minor, mapping->inode };
+    if (files->num_files > 0 && memcmp(&files->files[files->num_files - 1], &file, sizeof(file)) == 0) return false;
+    if (files->num_files + 1 > files->max_files) {
+        size_t max_files = files->max_files == 0 ? 64 : files->max_files * 2;
+        struct peer_file *new_files = realloc(files->files, max_files * sizeof(struct peer_file));
+        if (new_files == NULL) return true;
+        files->files = new_files;
+        files->max_files = max_files;
+    }
+    files->files[files->num_files++] = file;
+    return false;
+}
+#else
+struct peer_files {
+    size_t num_files;
+    void  *files;
+};
+#endif
+/* Collect the files the client has mapped, which are the only ones it may have us open */
+static void load_peer_files(pid_t pid, struct peer_files *files)
+{
+    memset(files, 0x00, sizeof(struct peer_files));
+#if defined(__linux__)
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%ld/maps", (long)pid);
+    wander_platform_maps_file(path, peer_file_callback, files);
+#else
+    (void)pid; /* The mappings of another process can not be checked here */
+#endif
+}
+static bool peer_has_file(const struct peer_files *files, const char *path)
+{
+#if defined(__linux__)
+    struct stat st;
+    if (stat(path, &st) == -1) return false;
+    for (size_t i=0; i < files->num_files; i++) {
+        const struct peer_file *file = &files->files[i];
+        if (file->inode == st.st_ino && file->dev_major == major(st.st_dev) && file->dev_minor == minor(st.st_dev)) return true;
+    }
+#else
+    (void)files;
+    (void)path;
+#endif
+    return false;
+}
+/* Answer the request that `client` has received completely */
+static int answer(wander_resolver_t *resolver, wander_symbolized_client_t *client)
+{
+    struct symbolized_header header = client->header;
+    char *request = client->request;
+    int fd = client->fd;
+    struct peer_files files;
+    load_peer_files(client->pid, &files);
+
+    int res = -1;
+    char *response = NULL;
+    uintptr_t *bases = malloc(((size_t)header.num_objects + 1) * sizeof(uintptr_t));
+    uintptr_t *addrs = malloc(((size_t)header.num_items + 1) * sizeof(uintptr_t));
+    uint32_t *objects = malloc(((size_t)header.num_items + 1) * sizeof(uint32_t));
+    wander_batch_t batch;
+    memset(&batch, 0x00, sizeof(batch));
+    if (bases == NULL || addrs == NULL || objects == NULL) goto done;
+
+    char *ptr = request, *end = request + header.size;
+    for (size_t i=0; i < header.num_objects; i++) {
+        struct symbolized_object object;
+        if ((size_t)(end - ptr) < sizeof(object)) goto done;
+        memcpy(&object, ptr, sizeof(object));
+        ptr += sizeof(object);
+        if ((size_t)(end - ptr) < (size_t)object.build_id_size + object.path_size || object.build_id_size >= WANDER_BUILD_ID_SIZE) goto done;
+        char build_id[WANDER_BUILD_ID_SIZE];
+        memcpy(build_id, ptr, object.build_id_size);
+        build_id[object.build_id_size] = '\0';
+        ptr += object.build_id_size;
+        char *path = malloc(object.path_size + 1);
+        if (path == NULL) goto done;
+        memcpy(path, ptr, object.path_size);
+        path[object.path_size] = '\0';
+        ptr += object.path_size;
+        bases[i] = 0;
+        if (peer_has_file(&files, path) && wander_resolver_add_file(resolver, path, build_id, &bases[i]) != 0) bases[i] = 0;
+        free(path);
+    }
+    if ((size_t)(end - ptr) != (size_t)header.num_items * sizeof(struct symbolized_frame)) goto done;
+    for (size_t i=0; i < header.num_items; i++) {
+        struct symbolized_frame frame;
+        memcpy(&frame, ptr + i * sizeof(frame), sizeof(frame));
+        bool known = frame.object < header.num_objects && bases[frame.object] != 0;
+        objects[i] = known ? frame.object : UINT32_MAX;
+        addrs[i] = known ? bases[frame.object] + frame.offset : 0;
+    }
+    if (wander_resolve_batch(resolver, addrs, header.num_items, &batch) != 0) goto done;
+
+    size_t data_size = 1;
+    for (size_t i=1; i < batch.num_strings; i++) data_size += strlen(batch.strings[i]) + 1;
+    size_t size = header.num_items * sizeof(struct symbolized_location) + batch.num_strings * sizeof(uint32_t) + data_size;
+    response = malloc(sizeof(struct symbolized_header) + size);
+    if (response == NULL) goto done;
+    struct symbolized_header out = { SYMBOLIZED_MAGIC, SYMBOLIZED_VERSION, batch.num_strings, header.num_items, size };
+    memcpy(response, &out, sizeof(out));
+    ptr = response + sizeof(out);
+    for (size_t i=0; i < header.num_items; i++) {
+        wander_location_t *location = &batch.locations[batch.ids[i]];
+        struct symbolized_location loc;
+        memset(&loc, 0x00, sizeof(loc));
+        if (location->symbol_addr != 0 && objects[i] != UINT32_MAX) {
+            loc.symbol_offset = location->symbol_addr - bases[objects[i]];
+            loc.flags |= SYMBOLIZED_HAVE_SYMBOL;
+        }
+        loc.object = location->object;
+        loc.symbol = location->symbol;
+        loc.function = location->function;
+        loc.filename = location->filename;
+        loc.directory = location->directory;
+        loc.lineno = location->lineno;
+        loc.column = location->column;
+        memcpy(ptr, &loc, sizeof(loc));
+        ptr += sizeof(loc);
+    }
+    char *data = ptr + batch.num_strings * sizeof(uint32_t);
+    uint32_t offset = 0;
+    data[offset++] = '\0';
+    for (size_t i=0; i < batch.num_strings; i++) {
+        uint32_t string_offset = 0;
+        if (i != 0) {
+            size_t len = strlen(batch.strings[i]) + 1;
+            memcpy(&data[offset], batch.strings[i], len);
+            string_offset = offset;
+            offset += len;
+        }
+        memcpy(ptr + i * sizeof(uint32_t), &string_offset, sizeof(uint32_t));
+    }
+    res = write_all(fd, response, sizeof(out) + size) ? 0 : -1;
+
+done:
+    wander_batch_free(&batch);
+    free(response);
+    free(objects);
+    free(addrs);
+    free(bases);
+    free(files.files);
+    return res;
+}
+#endif
+
+/**
+ * Accept a connection on `listen_fd`, for `wander_symbolized_serve`.
+ * The connection is non-blocking, and it is closed right away if the client runs as another user.
+ * Returns the new client, or NULL if there was none or it was turned away.
+ */
+WANDER_FUN(wander_symbolized_client_t*) wander_symbolized_accept(int listen_fd)
+{
+#if defined(__unix__)
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd == -1) return NULL;
+    pid_t pid = 0;
+    wander_symbolized_client_t *client = NULL;
+    if (peer_uid(fd, &pid) != geteuid() || fcntl(fd, F_SETFD, FD_CLOEXEC) == -1
+        || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == -1 || (client = malloc(sizeof(wander_symbolized_client_t))) == NULL) {
+        close(fd);
+        return NULL;
+    }
+    memset(client, 0x00, sizeof(wander_symbolized_client_t));
+    client->fd = fd;
+    client->pid = pid;
+    return client;
+#else
+    (void)listen_fd;
+    return NULL;
+#endif
+}
+/* Returns the connection of `client`, to poll it for input. */
+WANDER_FUN(int) wander_symbolized_client_fd(wander_symbolized_client_t *client)
+{
+#if defined(__unix__)
+    return client->fd;
+#else
+    (void)client;
+    return -1;
+#endif
+}
+/**
+ * Read what a client has sent, and answer its request once it is complete, using a resolver created with
+ * `wander_resolver_create_detached`. This does not wait for the rest of a request, call it again when there is more input.
+ * The object files in the request are added to the resolver if it does not know them yet, as long as the client
+ * has mapped them itself.
+ * Returns 0 on success and -1 if the connection should be closed with `wander_symbolized_close`.
+ */
+WANDER_FUN(int) wander_symbolized_serve(wander_resolver_t *resolver, wander_symbolized_client_t *client)
+{
+#if defined(__unix__)
+    const size_t header_size = sizeof(struct symbolized_header);
+    for (;;) {
+        char *ptr;
+        size_t size;
+        if (client->received < header_size) {
+            ptr = (char *)&client->header + client->received;
+            size = header_size - client->received;
+        } else {
+            ptr = client->request + (client->received - header_size);
+            size = header_size + client->header.size - client->received;
+        }
+        if (size == 0) break;
+        ssize_t n = read(client->fd, ptr, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0; /* The rest comes later */
+        if (n <= 0) return -1;
+        client->received += n;
+        if (client->received == header_size) {
+            if (!check_header(&client->header)) return -1;
+            client->request = malloc(client->header.size + 1);
+            if (client->request == NULL) return -1;
+        }
+    }
+    int res = answer(resolver, client);
+    free(client->request);
+    client->request = NULL;
+    client->received = 0;
+    return res;
+#else
+    (void)resolver;
+    (void)client;
+    return -1;
+#endif
+}
+/* Close the connection of `client` and free it. */
+WANDER_FUN(void) wander_symbolized_close(wander_symbolized_client_t **client)
+{
+#if defined(__unix__)
+    if (*client == NULL) return;
+    close((*client)->fd);
+    free((*client)->request);
+    free(*client);
+    *client = NULL;
+#endif
+}
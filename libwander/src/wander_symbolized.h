@@ -0,0 +1,56 @@
+#ifndef WANDER_SYMBOLIZED_H
+#define WANDER_SYMBOLIZED_H
+
+#include <libwander/wander.h>
+
+#include <stdint.h>
+
+/* The protocol between `wander_resolver_create_client` and `dweller-symbolized`.
+ * Both ends are on the same host, so everything is in native byte order.
+ *
+ * A request is a header followed by `num_objects` objects (each a `struct symbolized_object`, its build-id and its path,
+ * without terminators) and `num_items` frames.
+ * The response is a header followed by `num_items` locations (one for every frame, in order), `num_objects` string
+ * offsets and the NUL-terminated strings they point to. String 0 is NULL, like in `wander_batch_t`.
+ * `size` is the number of bytes after the header.
+ */
+#define SYMBOLIZED_MAGIC    0x6d797344u /* "Dsym" */
+#define SYMBOLIZED_VERSION  1
+#define SYMBOLIZED_MAX_SIZE (64u << 20)
+#define SYMBOLIZED_TIMEOUT_MS 5000 /* Either end gives up on the other after this long without progress */
+
+struct symbolized_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_objects; /* The number of strings in a response */
+    uint32_t num_items;
+    uint64_t size;
+};
+struct symbolized_object {
+    uint32_t build_id_size;
+    uint32_t path_size;
+};
+struct symbolized_frame {
+    uint64_t offset; /* Relative to the load address of the object */
+    uint32_t object; /* UINT32_MAX if the address is not in any object */
+    uint32_t reserved;
+};
+struct symbolized_location {
+    uint64_t symbol_offset; /* Relative to the load address of the object */
+    uint32_t object;
+    uint32_t symbol;
+    uint32_t function;
+    uint32_t filename;
+    uint32_t directory;
+    uint32_t lineno;
+    uint32_t column;
+    uint32_t flags;
+};
+#define SYMBOLIZED_HAVE_SYMBOL 0x1
+
+#if defined(__unix__)
+WANDER_INTERNAL(int) wander_symbolized_connect(const char *socket_path);
+WANDER_INTERNAL(int) wander_symbolized_resolve(int fd, const uintptr_t addrs[], size_t num_addrs, wander_batch_t *batch);
+#endif
+
+#endif /* !defined(WANDER_SYMBOLIZED_H) */
@@ -40,6 +40,8 @@
 #include "dwarf_stream.c"
 #include "dwarf_read.c"
 #include "dwarf_iter.c"
+#include "dwarf_arena.c"
+#include "dwarf_cfi.c"
 
 static bool dwarf_parse_aranges_section(struct dwarf *dwarf, struct dwarf_section_aranges *aranges, struct dwarf_errinfo *errinfo)
 {
@@ -101,330 +103,140 @@ static bool dwarf_parse_line_section_line_program(struct dwarf *dwarf, struct dw
 {
     dw_stream_t stream;
     dw_stream_initfrom(&stream, DWARF_SECTION_LINE, line->section, line->section_provider, lineprg->section_offset);
-    dw_u32_t length = dw_stream_get32(&stream);
+    dw_u64_t length = lineprg->length;
+    if (!dwarf_read_line_program_header(dwarf, &stream, lineprg, errinfo)) return false;
     assert(lineprg->length == length);
-    lineprg->version = dw_stream_get16(&stream);
-    switch (lineprg->version) {
-    case 2:
-    case 3:
-    case 4: /* TODO: Test version 4 better */
-    case 5: /* TODO: Test version 5 better */
-        if (lineprg->version >= 5) {
-            lineprg->address_size = dw_stream_get8(&stream);
-            lineprg->segment_selector_size = dw_stream_get8(&stream);
-        }
-        lineprg->header_length = dw_stream_get32(&stream); /* TODO: 64 bits in dwarf64 */
-        lineprg->instruction_size = dw_stream_get8(&stream);
-        if (lineprg->version >= 4) {
-            lineprg->maximum_operations_per_instruction = dw_stream_get8(&stream);
-        }
-        lineprg->default_is_stmt = dw_stream_get8(&stream);
-        lineprg->line_base = dw_stream_get8(&stream);
-        lineprg->line_range = dw_stream_get8(&stream);
-        lineprg->first_special_opcode = dw_stream_get8(&stream);
-        uint8_t num_basic_opcodes = lineprg->first_special_opcode - 1;
-        lineprg->basic_opcode_argcount = dw_malloc(dwarf, num_basic_opcodes * sizeof(uint8_t));
-        size_t i;
-        for (i=0; i < num_basic_opcodes; i++) {
-            lineprg->basic_opcode_argcount[i] = dw_stream_get8(&stream);
-        }
-        if (lineprg->version >= 5) {
-            /* FIXME: Much of this code is duplicated for version < 5 */
-            dwarf_attr_t attr;
-            lineprg->directorydata_format_count = dw_stream_get8(&stream);
-            lineprg->directorydata_format = dw_malloc(dwarf, lineprg->directorydata_format_count * sizeof(struct dwarf_line_program_format));
-            for (i=0; i < lineprg->directorydata_format_count; i++) {
-                lineprg->directorydata_format[i].name = dw_stream_getleb128_unsigned(&stream, NULL);
-                lineprg->directorydata_format[i].form = dw_stream_getleb128_unsigned(&stream, NULL);
+    if (dwarf->line_cb) {
+        dwarf->errinfo = errinfo;
+        /* DW_CB_NEXT skips the rows of this program */
+        if (dwarf->line_cb(dwarf, lineprg) == DW_CB_NEXT) return true;
+    }
+    dw_stream_isdone(&stream);
+    struct dwarf_line_program_state state;
+    reset_state(dwarf, lineprg, &state);
+    struct dwarf_line_program_state last_state = state;
+    last_state.file = 0;
+    last_state.line = 0;
+    last_state.column = 0;
+    while (stream.off < lineprg->section_offset + lineprg->length + dwarf_header_length_size(lineprg->dwarf64)) {
+        int basic_opcode = dw_stream_get8(&stream);
+        if (basic_opcode >= lineprg->first_special_opcode) { /* This is a special opcode, it takes no arguments */
+            int special_opcode = basic_opcode - lineprg->first_special_opcode;
+            int line_increment = lineprg->line_base + (special_opcode % lineprg->line_range);
+            int address_increment = (special_opcode / lineprg->line_range) * lineprg->instruction_size;
+            state.line += line_increment;
+            state.address += address_increment;
+            dw_i64_t off = dw_stream_tell(&stream);
+            append_row(dwarf, lineprg, &state, &last_state, errinfo);
+            dw_stream_seek(&stream, off);
+            state.basic_block = false;
+            state.prologue_end = false;
+            state.epilogue_begin = false;
+            state.discriminator = false;
+        } else if (basic_opcode == DW_LNS_fixed_advance_pc) { /* See docs */
+            int address_increment = dw_stream_get16(&stream);
+            state.address += address_increment;
+        } else if (basic_opcode) { /* This is a basic opcode */
+            uint8_t i;
+            uint64_t nargs = lineprg->basic_opcode_argcount[basic_opcode - 1]; /* Array is 1-indexed */
+            uint64_t *args = dw_malloc(dwarf, nargs * sizeof(uint64_t));
+            dw_i64_t argoff = dw_stream_tell(&stream);
+            for (i=0; i < nargs; i++) {
+                /* Getting the offsets to arguments other than the first one is
+                 * trivial with the second argument to dw_stream_getleb128_unsigned.
+                 * We only need to reparse the first one
+                 */
+                args[i] = dw_stream_getleb128_unsigned(&stream, NULL);
             }
-            for (i=0; i < lineprg->directorydata_format_count; i++) {
-                attr.name = lineprg->directorydata_format[i].name;
-                attr.form = lineprg->directorydata_format[i].form;
-                dwarf_read_attr(dwarf, &stream, &attr);
-                switch (attr.name) {
-                case DW_LNCT_path:
-                    switch (attr.form) {
-                    case DW_FORM_string:
-                    case DW_FORM_strp:
-                    case DW_FORM_line_strp:
-                        lineprg->include_directories[i].form = attr.form;
-                        lineprg->include_directories[i].value = attr.value;
-                        break;
-                    case DW_FORM_strp_sup:
-                        /* TODO */
-                        break;
-                    default:
-                        assert(false); /* TODO */
-                        break;
-                    }
-                    break;
-                    break;
-                default:
-                    break;
+            switch (basic_opcode) {
+            /* Same as basic opcode with `line_increment` and
+             * `address_increment` as zero
+             */
+            case DW_LNS_copy:
+                append_row(dwarf, lineprg, &state, &last_state, errinfo);
+                state.basic_block = false;
+                break;
+            case DW_LNS_advance_pc:
+                {
+                    assert(nargs == 1); /* TODO: Do this test when the basic_opcode_argcount gets filled? */
+                    int address_increment = args[0] * lineprg->instruction_size;
+                    state.address += address_increment;
                 }
-            }
-            lineprg->num_include_directories = dw_stream_getleb128_unsigned(&stream, NULL);
-            lineprg->include_directories = dw_malloc(dwarf, lineprg->num_include_directories * sizeof(dw_str_t));
-            for (i=0; i < lineprg->num_include_directories; i++) {
-                attr.name = lineprg->directorydata_format[i].name;
-                attr.form = lineprg->directorydata_format[i].form;
-                dwarf_read_attr(dwarf, &stream, &attr);
-            }
-            lineprg->filedata_format_count = dw_stream_get8(&stream);
-            lineprg->filedata_format = dw_malloc(dwarf, lineprg->filedata_format_count * sizeof(struct dwarf_line_program_format));
-            for (i=0; i < lineprg->filedata_format_count; i++) {
-                lineprg->directorydata_format[i].name = dw_stream_getleb128_unsigned(&stream, NULL);
-                lineprg->directorydata_format[i].form = dw_stream_getleb128_unsigned(&stream, NULL);
-            }
-            lineprg->num_files = dw_stream_getleb128_unsigned(&stream, NULL);
-            lineprg->files = dw_malloc(dwarf, lineprg->num_files * sizeof(struct dwarf_fileinfo));
-            for (i=0; i < lineprg->num_files; i++) {
-                attr.name = lineprg->directorydata_format[i].name;
-                attr.form = lineprg->directorydata_format[i].form;
-                dwarf_read_attr(dwarf, &stream, &attr);
-                switch (attr.name) {
-                case DW_LNCT_path:
-                    switch (attr.form) {
-                    case DW_FORM_string:
-                        lineprg->files[i].name.section = DWARF_SECTION_LINE;
-                        lineprg->files[i].name.off = attr.value.str.off;
-                        abort(); /* FIXME: Not fully implemented, but really easy */
-                        break;
-                    case DW_FORM_strp:
-                    lineprg->files[i].name.section = DWARF_SECTION_STR;
-                        lineprg->files[i].name.off = attr.value.stroff;
-                        lineprg->files[i].name.len = -1;
-                        break;
-                    case DW_FORM_line_strp:
-                        lineprg->files[i].name.section = DWARF_SECTION_LINESTR;
-                        lineprg->files[i].name.off = attr.value.stroff;
-                        lineprg->files[i].name.len = -1;
-                        break;
-                    case DW_FORM_strp_sup:
-                        /* TODO */
-                        break;
-                    default:
-                        assert(false); /* TODO */
-                        break;
-                    }
-                    break;
-                case DW_LNCT_directory_index:
-                    switch (attr.form) {
-                    case DW_FORM_data1:
-                    case DW_FORM_data2:
-                    case DW_FORM_udata:
-                        lineprg->files[i].include_directory_idx = attr.value.val;
-                        break;
-                    default:
-                        assert(false); /* TODO */
-                        break;
-                    }
-                    break;
-                case DW_LNCT_timestamp:
-                    switch (attr.form) {
-                    case DW_FORM_data4:
-                    case DW_FORM_data8:
-                    case DW_FORM_udata:
-                        lineprg->files[i].last_modification_time = attr.value.val;
-                        break;
-                    case DW_FORM_block:
-                        assert(false); /* TODO */
-                        break;
-                    default:
-                        assert(false); /* TODO */
-                        break;
-                    }
-                    break;
-                case DW_LNCT_size:
-                    switch (attr.form) {
-                    case DW_FORM_data1:
-                    case DW_FORM_data2:
-                    case DW_FORM_data4:
-                    case DW_FORM_data8:
-                    case DW_FORM_udata:
-                        lineprg->files[i].file_size = attr.value.val;
-                        break;
-                    default:
-                        assert(false); /* TODO */
-                        break;
-                    }
-                    break;
-                case DW_LNCT_MD5:
-                    break;
-                default:
-                    break;
+                break;
+            case DW_LNS_advance_line:
+                {
+                    dw_i64_t off = dw_stream_tell(&stream);
+                    dw_stream_seek(&stream, argoff);
+                    state.line += dw_stream_getleb128_signed(&stream, NULL);
+                    dw_stream_seek(&stream, off);
                 }
+                break;
+            case DW_LNS_set_file:
+                state.file = args[0];
+                break;
+            case DW_LNS_set_column:
+                state.column = args[0];
+                break;
+            case DW_LNS_negate_stmt:
+                state.is_stmt = !state.is_stmt;
+                break;
+            case DW_LNS_set_basic_block:
+                state.basic_block = true;
+                break;
+            case DW_LNS_const_add_pc:
+                {
+                    int address_increment = ((255 - lineprg->first_special_opcode) / lineprg->line_range) * lineprg->instruction_size;
+                    state.address += address_increment;
+                }
+                break;
+            case DW_LNS_set_prologue_end:
+                state.prologue_end = true;
+                break;
+            case DW_LNS_set_epilogue_begin:
+                state.epilogue_begin = true;
+                break;
+            case DW_LNS_set_isa:
+                state.isa = args[0];
+                break;
+            case DW_LNS_fixed_advance_pc: /* This is already handled and just to shut up compiler warnings */
+            default:
+                break;
             }
-            /* TODO: call callback for attr? */
-        } else {
-            lineprg->directorydata_format_count = 0;
-            lineprg->directorydata_format = NULL;
-            lineprg->filedata_format_count = 0;
-            lineprg->filedata_format = NULL;
-            lineprg->directorydata = NULL;
-            lineprg->filedata = NULL;
-            while (dw_stream_peak8(&stream)) {
-                dw_i64_t start = dw_stream_tell(&stream);
-                struct dwarf_pathinfo path;
-                path.form = DW_FORM_string,
-                path.value.str.section = DWARF_SECTION_LINE;
-                path.value.str.off = start;
-                while (dw_stream_get8(&stream));
-                path.value.str.len = dw_stream_tell(&stream) - start - 1;
-                lineprg->total_include_path_size += path.value.str.len;
-                /* TODO: Allocate as OBSTACK */
-                lineprg->include_directories = dw_realloc(dwarf, lineprg->include_directories, (lineprg->num_include_directories + 1) * sizeof(struct dwarf_pathinfo));
-                lineprg->include_directories[lineprg->num_include_directories++] = path;
-            }
-            dw_stream_get8(&stream);
-            while (dw_stream_peak8(&stream)) {
-                struct dwarf_fileinfo info;
-                dw_i64_t start = dw_stream_tell(&stream);
-                info.name.section = DWARF_SECTION_LINE;
-                info.name.off = start;
-                while (dw_stream_get8(&stream));
-                info.name.len = dw_stream_tell(&stream) - start - 1; /* FIXME: This will be overwritten on the next call to dw_stream!!! */
-                lineprg->total_file_path_size += info.name.len;
-                info.include_directory_idx = dw_stream_getleb128_unsigned(&stream, NULL);
-                info.last_modification_time = dw_stream_getleb128_unsigned(&stream, NULL);
-                info.file_size = dw_stream_getleb128_unsigned(&stream, NULL);
-                /* TODO: Allocate as OBSTACK */
-                lineprg->files = dw_realloc(dwarf, lineprg->files, (lineprg->num_files + 1) * sizeof(struct dwarf_fileinfo));
-                lineprg->files[lineprg->num_files++] = info;
+            dw_free(dwarf, args);
+        } else { /* This is an extended opcode */
+            uint64_t i;
+            uint64_t extended_opcode_length = dw_stream_getleb128_unsigned(&stream, NULL);
+            uint8_t extended_opcode = dw_stream_get8(&stream);
+            assert(extended_opcode_length != 0);
+            uint8_t *args = dw_malloc(dwarf, extended_opcode_length - 1);
+            for (i=0; i < extended_opcode_length - 1; i++) {
+                args[i] = dw_stream_get8(&stream);
             }
-            dw_stream_get8(&stream); /* Skip NUL */
-        }
-        lineprg->header_size = dw_stream_tell(&stream) - lineprg->section_offset;
-        if (dwarf->line_cb) {
-            dwarf->errinfo = errinfo;
-            dwarf->line_cb(dwarf, lineprg);
-        }
-        dw_stream_isdone(&stream);
-        struct dwarf_line_program_state state;
-        reset_state(dwarf, lineprg, &state);
-        struct dwarf_line_program_state last_state = state;
-        last_state.file = 0;
-        last_state.line = 0;
-        last_state.column = 0;
-        while (stream.off < lineprg->section_offset + lineprg->length + sizeof(dw_u32_t)) {
-            int basic_opcode = dw_stream_get8(&stream);
-            if (basic_opcode >= lineprg->first_special_opcode) { /* This is a special opcode, it takes no arguments */
-                int special_opcode = basic_opcode - lineprg->first_special_opcode;
-                int line_increment = lineprg->line_base + (special_opcode % lineprg->line_range);
-                int address_increment = (special_opcode / lineprg->line_range) * lineprg->instruction_size;
-                state.line += line_increment;
-                state.address += address_increment;
-                dw_i64_t off = dw_stream_tell(&stream);
+            switch (extended_opcode) {
+            case DW_LNE_end_sequence:
+                state.end_sequence = true;
                 append_row(dwarf, lineprg, &state, &last_state, errinfo);
-                dw_stream_seek(&stream, off);
-                state.basic_block = false;
-                state.prologue_end = false;
-                state.epilogue_begin = false;
-                state.discriminator = false;
-            } else if (basic_opcode == DW_LNS_fixed_advance_pc) { /* See docs */
-                int address_increment = dw_stream_get16(&stream);
-                state.address += address_increment;
-            } else if (basic_opcode) { /* This is a basic opcode */
-                uint8_t i;
-                uint64_t nargs = lineprg->basic_opcode_argcount[basic_opcode - 1]; /* Array is 1-indexed */
-                uint64_t *args = dw_malloc(dwarf, nargs * sizeof(uint64_t));
-                dw_i64_t argoff = dw_stream_tell(&stream);
-                for (i=0; i < nargs; i++) {
-                    /* Getting the offsets to arguments other than the first one is
-                     * trivial with the second argument to dw_stream_getleb128_unsigned.
-                     * We only need to reparse the first one
-                     */
-                    args[i] = dw_stream_getleb128_unsigned(&stream, NULL);
-                }
-                switch (basic_opcode) {
-                /* Same as basic opcode with `line_increment` and
-                 * `address_increment` as zero
-                 */
-                case DW_LNS_copy:
-                    append_row(dwarf, lineprg, &state, &last_state, errinfo);
-                    state.basic_block = false;
-                    break;
-                case DW_LNS_advance_pc:
-                    {
-                        assert(nargs == 1); /* TODO: Do this test when the basic_opcode_argcount gets filled? */
-                        int address_increment = args[0] * lineprg->instruction_size;
-                        state.address += address_increment;
-                    }
-                    break;
-                case DW_LNS_advance_line:
-                    {
-                        dw_i64_t off = dw_stream_tell(&stream);
-                        dw_stream_seek(&stream, argoff);
-                        state.line += dw_stream_getleb128_signed(&stream, NULL);
-                        dw_stream_seek(&stream, off);
-                    }
-                    break;
-                case DW_LNS_set_file:
-                    state.file = args[0];
-                    break;
-                case DW_LNS_set_column:
-                    state.column = args[0];
-                    break;
-                case DW_LNS_negate_stmt:
-                    state.is_stmt = !state.is_stmt;
-                    break;
-                case DW_LNS_set_basic_block:
-                    state.basic_block = true;
-                    break;
-                case DW_LNS_const_add_pc:
-                    {
-                        int address_increment = ((255 - lineprg->first_special_opcode) / lineprg->line_range) * lineprg->instruction_size;
-                        state.address += address_increment;
-                    }
-                    break;
-                case DW_LNS_set_prologue_end:
-                    state.prologue_end = true;
-                    break;
-                case DW_LNS_set_epilogue_begin:
-                    state.epilogue_begin = true;
-                    break;
-                case DW_LNS_set_isa:
-                    state.isa = args[0];
-                    break;
-                case DW_LNS_fixed_advance_pc: /* This is already handled and just to shut up compiler warnings */
-                default:
-                    break;
-                }
-                dw_free(dwarf, args);
-            } else { /* This is an extended opcode */
-                uint64_t i;
-                uint64_t extended_opcode_length = dw_stream_getleb128_unsigned(&stream, NULL);
-                uint8_t extended_opcode = dw_stream_get8(&stream);
-                assert(extended_opcode_length != 0);
-                uint8_t *args = dw_malloc(dwarf, extended_opcode_length - 1);
-                for (i=0; i < extended_opcode_length - 1; i++) {
-                    args[i] = dw_stream_get8(&stream);
+                reset_state(dwarf, lineprg, &state);
+                break;
+            case DW_LNE_set_address:
+                /* The operand is as wide as an address on the target (no matter what the header says before DWARF5) */
+                state.address = 0;
+                for (i=0; i < extended_opcode_length - 1 && i < 8; i++) {
+                    state.address |= (dw_u64_t)args[i] << (i * 8);
                 }
-                switch (extended_opcode) {
-                case DW_LNE_end_sequence:
-                    state.end_sequence = true;
-                    append_row(dwarf, lineprg, &state, &last_state, errinfo);
-                    reset_state(dwarf, lineprg, &state);
-                    break;
-                case DW_LNE_set_address: /* FIXME: Check that args is actually an address */
-                    state.address = *(uint64_t *)args;
-                    break;
-                case DW_LNE_define_file:
-                    /* TODO */
-                    break;
-                case DW_LNE_set_discriminator:
-                    {
-                        state.discriminator = dw_leb128_parse_unsigned(args, extended_opcode_length - 1, NULL);
-                    }
-                    break;
-                default:
-                    break;
+                break;
+            case DW_LNE_define_file:
+                /* TODO */
+                break;
+            case DW_LNE_set_discriminator:
+                {
+                    state.discriminator = dw_leb128_parse_unsigned(args, extended_opcode_length - 1, NULL);
                 }
+                break;
+            default:
+                break;
             }
         }
-        break;
-    default:
-        error(runtime_error("unsupported line program version: %1", "I", lineprg->version));
     }
     return true;
 }
@@ -439,7 +251,7 @@ static bool dwarf_parse_line_section(struct dwarf *dwarf, struct dwarf_section_l
         struct dwarf_line_program lineprg;
         memset(&lineprg, 0x00, sizeof(lineprg));
         lineprg.section_offset = stream.off;
-        lineprg.length = dw_stream_get32(&stream);
+        lineprg.length = dw_stream_getlen(&stream, NULL);
         if (!dwarf_parse_line_section_line_program(dwarf, line, &lineprg, errinfo)) return false;
         dw_stream_offset(&stream, lineprg.length);
     }
@@ -476,6 +288,10 @@ static bool dwarf_parse_abbrev_section(struct dwarf *dwarf, struct dwarf_section
                 dwarf_abbrev_attr_t abbrev_attr;
                 abbrev_attr.name = dw_stream_getleb128_unsigned(&stream, NULL);
                 abbrev_attr.form = dw_stream_getleb128_unsigned(&stream, NULL);
+                abbrev_attr.implicit_const = 0;
+                if (abbrev_attr.form == DW_FORM_implicit_const) {
+                    abbrev_attr.implicit_const = dw_stream_getleb128_signed(&stream, NULL);
+                }
                 dw_i64_t off = dw_stream_tell(&stream);
                 if (dwarf->abbrev_attr_cb) {
                     dwarf->errinfo = errinfo;
@@ -549,9 +365,8 @@ bool dwarf_parse_die(struct dwarf *dwarf, dwarf_unit_t *unit, dw_stream_t *strea
         dw_stream_seek(&abstream, aboff);
         dwarf_attr_t attr;
         while (dw_stream_peak16(&abstream)) {
-            attr.name = dw_stream_getleb128_unsigned(&abstream, NULL);
-            attr.form = dw_stream_getleb128_unsigned(&abstream, NULL);
-            dwarf_read_attr(dwarf, stream, &attr);
+            dwarf_read_attr_spec(&abstream, &attr);
+            if (!dwarf_read_attr(dwarf, unit, stream, &attr, errinfo)) return false;
             dw_i64_t off = dw_stream_tell(stream);
             if (dwarf->attr_cb && attr_cb_status != DW_CB_DONE) {
                 dwarf->errinfo = errinfo;
@@ -667,9 +482,8 @@ static bool dwarf_parse_compilation_unit_from_abreviation_table(struct dwarf *dw
         dw_stream_seek(&abstream, aboff);
         dwarf_attr_t attr;
         while (dw_stream_peak16(&abstream)) {
-            attr.name = dw_stream_getleb128_unsigned(&abstream, NULL);
-            attr.form = dw_stream_getleb128_unsigned(&abstream, NULL);
-            dwarf_read_attr(dwarf, stream, &attr);
+            dwarf_read_attr_spec(&abstream, &attr);
+            if (!dwarf_read_attr(dwarf, &cu->unit, stream, &attr, errinfo)) return false;
             dw_i64_t off = dw_stream_tell(stream);
             if (dwarf->attr_cb && attr_cb_status != DW_CB_DONE) {
                 dwarf->errinfo = errinfo;
@@ -706,7 +520,7 @@ static bool dwarf_parse_info_section_cu(struct dwarf *dwarf, struct dwarf_sectio
 {
     dw_stream_t stream;
     dw_stream_initfrom(&stream, DWARF_SECTION_INFO, info->section, info->section_provider, cu->unit.die.section_offset);
-    dwarf_unit_parseheader(dwarf, &stream, &cu->unit, errinfo); // TODO: Error handling
+    if (!dwarf_unit_parseheader(dwarf, &stream, &cu->unit, errinfo)) return false;
     return dwarf_parse_compilation_unit_from_abreviation_table(dwarf, cu, cu->unit.abbrev_table, &stream, errinfo);
 }
 static bool dwarf_parse_info_section(struct dwarf *dwarf, struct dwarf_section_info *info, struct dwarf_errinfo *errinfo)
@@ -818,6 +632,32 @@ bool dwarf_load_section(struct dwarf *dwarf, enum dwarf_section_namespace ns, st
         dwarf->str.section = section;
         dwarf->str.section_provider = NULL;
         break;
+    case DWARF_SECTION_STROFFSETS:
+        dwarf->str_offsets.section = section;
+        dwarf->str_offsets.section_provider = NULL;
+        break;
+    case DWARF_SECTION_ADDR:
+        dwarf->addr.section = section;
+        dwarf->addr.section_provider = NULL;
+        break;
+    case DWARF_SECTION_RANGELISTS:
+        dwarf->rnglists.section = section;
+        dwarf->rnglists.section_provider = NULL;
+        break;
+    case DWARF_SECTION_RANGES:
+        dwarf->ranges.section = section;
+        dwarf->ranges.section_provider = NULL;
+        break;
+    case DWARF_SECTION_LOCATIONLISTS:
+        dwarf->loclists.section = section;
+        dwarf->loclists.section_provider = NULL;
+        break;
+    case DWARF_SECTION_LINESTR:
+        dwarf->line_str.section = section;
+        dwarf->line_str.section_provider = NULL;
+        break;
+    default: /* TODO: More sections... */
+        break;
     }
 
     return true;
@@ -843,6 +683,26 @@ bool dwarf_add_section(struct dwarf *dwarf, enum dwarf_section_namespace ns, str
     case DWARF_SECTION_STR:
         dwarf->str.section_provider = provider;
         break;
+    case DWARF_SECTION_STROFFSETS:
+        dwarf->str_offsets.section_provider = provider;
+        break;
+    case DWARF_SECTION_ADDR:
+        dwarf->addr.section_provider = provider;
+        break;
+    case DWARF_SECTION_RANGELISTS:
+        dwarf->rnglists.section_provider = provider;
+        break;
+    case DWARF_SECTION_RANGES:
+        dwarf->ranges.section_provider = provider;
+        break;
+    case DWARF_SECTION_LOCATIONLISTS:
+        dwarf->loclists.section_provider = provider;
+        break;
+    case DWARF_SECTION_LINESTR:
+        dwarf->line_str.section_provider = provider;
+        break;
+    default: /* TODO: More sections... */
+        break;
     }
 
     return true;
@@ -859,6 +719,12 @@ bool dwarf_has_section(struct dwarf *dwarf, enum dwarf_section_namespace ns, str
     case DWARF_SECTION_LINE:    return dwarf->line.section.base != NULL || dwarf->line.section_provider != NULL;
     case DWARF_SECTION_ABBREV:  return dwarf->abbrev.section.base != NULL || dwarf->abbrev.section_provider != NULL;
     case DWARF_SECTION_STR:     return dwarf->str.section.base != NULL || dwarf->str.section_provider != NULL;
+    case DWARF_SECTION_STROFFSETS: return dwarf->str_offsets.section.base != NULL || dwarf->str_offsets.section_provider != NULL;
+    case DWARF_SECTION_ADDR:    return dwarf->addr.section.base != NULL || dwarf->addr.section_provider != NULL;
+    case DWARF_SECTION_RANGELISTS: return dwarf->rnglists.section.base != NULL || dwarf->rnglists.section_provider != NULL;
+    case DWARF_SECTION_RANGES:  return dwarf->ranges.section.base != NULL || dwarf->ranges.section_provider != NULL;
+    case DWARF_SECTION_LOCATIONLISTS: return dwarf->loclists.section.base != NULL || dwarf->loclists.section_provider != NULL;
+    case DWARF_SECTION_LINESTR: return dwarf->line_str.section.base != NULL || dwarf->line_str.section_provider != NULL;
     default:
         break;
     }
@@ -0,0 +1,114 @@
+/****************************************************************************
+ *
+ * Copyright 2020 The libdweller project contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ****************************************************************************/
+#include <dweller/arena.h>
+
+/* Every block starts with a header, so it can be grown and freed */
+struct dweller_arena_block {
+    size_t capacity;
+    size_t prev; /* `last` before this block was allocated */
+};
+#define DWELLER_ARENA_ALIGN(n) (((n) + DW_MAXALIGN - 1) & ~(size_t)(DW_MAXALIGN - 1))
+#define DWELLER_ARENA_HEADER DWELLER_ARENA_ALIGN(sizeof(struct dweller_arena_block))
+#define DWELLER_ARENA_NONE ((size_t)-1)
+
+DWSTATIC(dw_u8_t *) dweller_arena_push(struct dweller_arena *arena, size_t capacity)
+{
+    capacity = DWELLER_ARENA_ALIGN(capacity);
+    if (capacity > arena->size || arena->size - arena->used < DWELLER_ARENA_HEADER + capacity) return NULL;
+    struct dweller_arena_block *block = (struct dweller_arena_block *)(arena->base + arena->used);
+    block->capacity = capacity;
+    block->prev = arena->last;
+    arena->last = arena->used;
+    arena->used += DWELLER_ARENA_HEADER + capacity;
+    return (dw_u8_t *)block + DWELLER_ARENA_HEADER;
+}
+DWSTATIC(int) dweller_arena_cb(dw_alloc_t *self, struct dwarf_alloc_req *req, void **pointer)
+{
+    struct dweller_arena *arena = (struct dweller_arena *)self;
+    if (!req || !pointer) return -1; /* The arena is released by its owner, not by `dwarf_fini` */
+
+    dw_u8_t *ptr = *pointer;
+    if (ptr != NULL && (ptr < arena->base || ptr >= arena->base + arena->size)) {
+        /* Only the fallback allocator can have handed this out, but it might be switched off for now */
+        if (!arena->fallback) return -1;
+        return (*arena->fallback)(arena->fallback, req, pointer);
+    }
+    size_t offset = ptr != NULL ? (size_t)(ptr - arena->base) - DWELLER_ARENA_HEADER : DWELLER_ARENA_NONE;
+    struct dweller_arena_block *block = ptr != NULL ? (struct dweller_arena_block *)(ptr - DWELLER_ARENA_HEADER) : NULL;
+
+    if (req->req_bytesize == 0) {
+        /* Only the latest block is given back, the rest waits for `dweller_arena_release` */
+        if (ptr != NULL && offset == arena->last) {
+            arena->used = arena->last;
+            arena->last = block->prev;
+        }
+        *pointer = NULL;
+        return 0;
+    }
+    if (req->req_type == DWARF_ALLOC_BUFFER) {
+        /* The unused end of the arena, which stays valid until the next request */
+        size_t start = arena->used + DWELLER_ARENA_HEADER;
+        if (start >= arena->size) return -1;
+        if (req->req_bytesize > arena->size - start) req->req_bytesize = arena->size - start;
+        *pointer = arena->base + start;
+        return 0;
+    }
+
+    size_t capacity = req->req_bytesize;
+    if (block != NULL) {
+        if (req->req_bytesize <= block->capacity) return 0;
+        if (offset == arena->last && arena->size - offset - DWELLER_ARENA_HEADER >= DWELLER_ARENA_ALIGN(req->req_bytesize)) {
+            block->capacity = DWELLER_ARENA_ALIGN(req->req_bytesize);
+            arena->used = offset + DWELLER_ARENA_HEADER + block->capacity;
+            return 0;
+        }
+        /* Leave room to grow, so tables that grow one item at a time are not copied every time */
+        if (capacity < 2 * block->capacity) capacity = 2 * block->capacity;
+    }
+    void *newptr = dweller_arena_push(arena, capacity);
+    if (newptr == NULL && capacity != req->req_bytesize) newptr = dweller_arena_push(arena, req->req_bytesize);
+    if (newptr == NULL) {
+        if (!arena->fallback) return -1;
+        struct dwarf_alloc_req fallback_req = *req;
+        if ((*arena->fallback)(arena->fallback, &fallback_req, &newptr) < 0) return -1;
+    }
+    if (block != NULL) memcpy(newptr, ptr, block->capacity);
+    *pointer = newptr;
+    return 0;
+}
+
+void dweller_arena_init(struct dweller_arena *arena, void *memory, size_t size, dw_alloc_t *fallback)
+{
+    arena->allocator = &dweller_arena_cb;
+    arena->fallback = fallback;
+    arena->base = memory;
+    arena->size = memory != NULL ? size : 0;
+    arena->used = 0;
+    arena->last = DWELLER_ARENA_NONE;
+}
+size_t dweller_arena_mark(struct dweller_arena *arena)
+{
+    arena->last = DWELLER_ARENA_NONE; /* The latest block may not grow past the mark */
+    return arena->used;
+}
+void dweller_arena_release(struct dweller_arena *arena, size_t mark)
+{
+    if (mark > arena->used) return;
+    arena->used = mark;
+    arena->last = DWELLER_ARENA_NONE;
+}
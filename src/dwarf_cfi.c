@@ -0,0 +1,783 @@
+/****************************************************************************
+ *
+ * Copyright 2020 The libdweller project contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ****************************************************************************/
+#include <dweller/cfi.h>
+
+/* A bounds-checked position in a section, `ok` turns false on the first read past `end` */
+struct dweller_cfi_cursor {
+    const dw_u8_t *pos;
+    const dw_u8_t *end;
+    const dw_u8_t *base;
+    dw_u64_t base_address; /* Where `base` is loaded */
+    bool ok;
+};
+struct dweller_cfi_cie {
+    dw_u64_t code_align;
+    dw_i64_t data_align;
+    unsigned ra_reg;
+    dw_u8_t fde_encoding;
+    dw_u8_t address_size;
+    bool has_augmentation_data;
+    bool signal_frame;
+    const dw_u8_t *instructions;
+    const dw_u8_t *end;
+};
+struct dweller_cfi_fde {
+    dw_u64_t pc_begin;
+    dw_u64_t pc_end;
+    const dw_u8_t *instructions;
+    const dw_u8_t *end;
+};
+#define DWELLER_CFI_EXPR_STACK 64
+#define DWELLER_CFI_NONE ((dw_u64_t)-1)
+
+DWSTATIC(struct dweller_cfi_cursor) dweller_cfi_cursor(const struct dweller_cfi *cfi, const dw_u8_t *pos, const dw_u8_t *end)
+{
+    struct dweller_cfi_cursor cursor = { pos, end, cfi->base, cfi->address, pos <= end };
+    return cursor;
+}
+DWSTATIC(const dw_u8_t *) dweller_cfi_take(struct dweller_cfi_cursor *cursor, size_t n)
+{
+    if (!cursor->ok || (size_t)(cursor->end - cursor->pos) < n) {
+        cursor->ok = false;
+        return NULL;
+    }
+    const dw_u8_t *pos = cursor->pos;
+    cursor->pos += n;
+    return pos;
+}
+/* The `n` byte value at `p`, in the byte order of the host like the code that is unwound */
+DWSTATIC(dw_u64_t) dweller_cfi_value(const dw_u8_t *p, size_t n)
+{
+    dw_u64_t value = 0;
+    for (size_t i=0; i < n; i++) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        value = value << 8 | p[i];
+#else
+        value |= (dw_u64_t)p[i] << (i * 8);
+#endif
+    }
+    return value;
+}
+DWSTATIC(dw_u64_t) dweller_cfi_get(struct dweller_cfi_cursor *cursor, size_t n)
+{
+    const dw_u8_t *p = dweller_cfi_take(cursor, n);
+    return p != NULL ? dweller_cfi_value(p, n) : 0;
+}
+DWSTATIC(dw_i64_t) dweller_cfi_get_signed(struct dweller_cfi_cursor *cursor, size_t n)
+{
+    dw_u64_t value = dweller_cfi_get(cursor, n);
+    if (n < 8 && (value >> (n * 8 - 1)) & 1) value |= ~(dw_u64_t)0 << (n * 8);
+    return (dw_i64_t)value;
+}
+DWSTATIC(dw_u64_t) dweller_cfi_uleb128(struct dweller_cfi_cursor *cursor)
+{
+    dw_u64_t value = 0;
+    for (int shift=0;; shift += 7) {
+        const dw_u8_t *p = dweller_cfi_take(cursor, 1);
+        if (p == NULL) return 0;
+        if (shift < 64) value |= (dw_u64_t)(*p & 0x7f) << shift;
+        if ((*p & 0x80) == 0) return value;
+    }
+}
+DWSTATIC(dw_i64_t) dweller_cfi_sleb128(struct dweller_cfi_cursor *cursor)
+{
+    dw_u64_t value = 0;
+    for (int shift=0;; shift += 7) {
+        const dw_u8_t *p = dweller_cfi_take(cursor, 1);
+        if (p == NULL) return 0;
+        if (shift < 64) value |= (dw_u64_t)(*p & 0x7f) << shift;
+        if ((*p & 0x80) == 0) {
+            if (shift + 7 < 64 && (*p & 0x40)) value |= ~(dw_u64_t)0 << (shift + 7); /* sign extend */
+            return (dw_i64_t)value;
+        }
+    }
+}
+/* Read a pointer in one of the `DW_EH_PE_*` encodings.
+ * `datarel` is the base of `DW_EH_PE_datarel`, which only `.eh_frame_hdr` uses.
+ * Indirect pointers are returned as the address they point to, they are not dereferenced.
+ */
+DWSTATIC(dw_u64_t) dweller_cfi_pointer(struct dweller_cfi_cursor *cursor, dw_u8_t encoding, dw_u8_t address_size, dw_u64_t datarel)
+{
+    dw_u64_t address = cursor->base_address + (dw_u64_t)(cursor->pos - cursor->base);
+    dw_u64_t value;
+    if (encoding == DW_EH_PE_omit) return 0;
+    switch (encoding & 0x0f) {
+    case DW_EH_PE_absptr:  value = dweller_cfi_get(cursor, address_size); break;
+    case DW_EH_PE_uleb128: value = dweller_cfi_uleb128(cursor); break;
+    case DW_EH_PE_udata2:  value = dweller_cfi_get(cursor, 2); break;
+    case DW_EH_PE_udata4:  value = dweller_cfi_get(cursor, 4); break;
+    case DW_EH_PE_udata8:  value = dweller_cfi_get(cursor, 8); break;
+    case DW_EH_PE_sleb128: value = dweller_cfi_sleb128(cursor); break;
+    case DW_EH_PE_sdata2:  value = dweller_cfi_get_signed(cursor, 2); break;
+    case DW_EH_PE_sdata4:  value = dweller_cfi_get_signed(cursor, 4); break;
+    case DW_EH_PE_sdata8:  value = dweller_cfi_get(cursor, 8); break;
+    default:
+        cursor->ok = false;
+        return 0;
+    }
+    switch (encoding & 0x70) {
+    case DW_EH_PE_absptr:  break;
+    case DW_EH_PE_pcrel:   value += address; break;
+    case DW_EH_PE_datarel: value += datarel; break;
+    default: /* textrel and funcrel are not used for the pointers we need */
+        cursor->ok = false;
+        return 0;
+    }
+    return value;
+}
+/* Read the header of the CIE or FDE at `offset`.
+ * Sets `id` to DWELLER_CFI_NONE for a CIE, and to the offset of the CIE for an FDE.
+ * Returns the offset of the next entry, or 0 at the end of the section.
+ */
+DWSTATIC(dw_u64_t) dweller_cfi_entry(const struct dweller_cfi *cfi, dw_u64_t offset, struct dweller_cfi_cursor *body, dw_u64_t *id)
+{
+    if (offset >= cfi->size) return 0;
+    struct dweller_cfi_cursor cursor = dweller_cfi_cursor(cfi, cfi->base + offset, cfi->base + cfi->size);
+    dw_u64_t length = dweller_cfi_get(&cursor, 4);
+    bool dwarf64 = length == 0xffffffff;
+    if (dwarf64) length = dweller_cfi_get(&cursor, 8);
+    if (!cursor.ok || length == 0 || length > (dw_u64_t)(cursor.end - cursor.pos)) return 0;
+    const dw_u8_t *end = cursor.pos + length;
+    const dw_u8_t *id_pos = cursor.pos;
+    dw_u64_t value = dweller_cfi_get(&cursor, dwarf64 ? 8 : 4);
+    if (!cursor.ok) return 0;
+    if (cfi->is_eh_frame) {
+        /* The CIE pointer is relative to itself */
+        *id = value == 0 ? DWELLER_CFI_NONE : (dw_u64_t)(id_pos - cfi->base) - value;
+    } else {
+        *id = value == (dwarf64 ? ~(dw_u64_t)0 : 0xffffffff) ? DWELLER_CFI_NONE : value;
+    }
+    *body = dweller_cfi_cursor(cfi, cursor.pos, end);
+    return (dw_u64_t)(end - cfi->base);
+}
+DWSTATIC(bool) dweller_cfi_parse_cie(const struct dweller_cfi *cfi, dw_u64_t offset, struct dweller_cfi_cie *cie)
+{
+    struct dweller_cfi_cursor cursor;
+    dw_u64_t id;
+    if (dweller_cfi_entry(cfi, offset, &cursor, &id) == 0 || id != DWELLER_CFI_NONE) return false;
+
+    dw_u8_t version = dweller_cfi_get(&cursor, 1);
+    const char *augmentation = (const char *)cursor.pos;
+    while (cursor.ok && *dweller_cfi_take(&cursor, 1) != '\0');
+    if (!cursor.ok || (version != 1 && version != 3 && version != 4)) return false;
+    cie->address_size = cfi->address_size;
+    if (version == 4) {
+        cie->address_size = dweller_cfi_get(&cursor, 1);
+        if (dweller_cfi_get(&cursor, 1) != 0) return false; /* Segmented addresses */
+    }
+    cie->code_align = dweller_cfi_uleb128(&cursor);
+    cie->data_align = dweller_cfi_sleb128(&cursor);
+    cie->ra_reg = version == 1 ? dweller_cfi_get(&cursor, 1) : dweller_cfi_uleb128(&cursor);
+    cie->fde_encoding = DW_EH_PE_absptr;
+    cie->has_augmentation_data = augmentation[0] == 'z';
+    cie->signal_frame = false;
+    if (cie->has_augmentation_data) {
+        dw_u64_t length = dweller_cfi_uleb128(&cursor);
+        struct dweller_cfi_cursor data = cursor;
+        if (!dweller_cfi_take(&cursor, length)) return false;
+        data.end = cursor.pos;
+        for (const char *c = &augmentation[1]; *c; c++) {
+            switch (*c) {
+            case 'R':
+                cie->fde_encoding = dweller_cfi_get(&data, 1);
+                break;
+            case 'P': {
+                dw_u8_t encoding = dweller_cfi_get(&data, 1);
+                dweller_cfi_pointer(&data, encoding & ~DW_EH_PE_indirect, cie->address_size, 0);
+                break;
+            }
+            case 'L':
+                dweller_cfi_get(&data, 1);
+                break;
+            case 'S':
+                cie->signal_frame = true;
+                break;
+            case 'B': /* AArch64 branch target identification, nothing to do */
+                break;
+            default: /* The rest of the data is unknown, but its length is */
+                goto done;
+            }
+        }
+    done:
+        if (!data.ok) return false;
+    } else if (augmentation[0] != '\0') {
+        return false; /* "eh" and others without a length can not be skipped */
+    }
+    cie->instructions = cursor.pos;
+    cie->end = cursor.end;
+    return cursor.ok;
+}
+DWSTATIC(bool) dweller_cfi_parse_fde(const struct dweller_cfi *cfi, dw_u64_t offset, struct dweller_cfi_fde *fde, struct dweller_cfi_cie *cie)
+{
+    struct dweller_cfi_cursor cursor;
+    dw_u64_t cie_offset;
+    if (dweller_cfi_entry(cfi, offset, &cursor, &cie_offset) == 0 || cie_offset == DWELLER_CFI_NONE) return false;
+    if (!dweller_cfi_parse_cie(cfi, cie_offset, cie)) return false;
+    fde->pc_begin = dweller_cfi_pointer(&cursor, cie->fde_encoding, cie->address_size, 0);
+    fde->pc_end = fde->pc_begin + dweller_cfi_pointer(&cursor, cie->fde_encoding & 0x0f, cie->address_size, 0);
+    if (cie->has_augmentation_data) {
+        dw_u64_t length = dweller_cfi_uleb128(&cursor);
+        dweller_cfi_take(&cursor, length);
+    }
+    fde->instructions = cursor.pos;
+    fde->end = cursor.end;
+    return cursor.ok;
+}
+
+DWSTATIC(void) dweller_cfi_set(struct dweller_cfi_row *row, dw_u64_t reg, dw_u8_t kind, dw_i64_t offset)
+{
+    if (reg >= DWELLER_CFI_MAX_REGS) return; /* Vector registers and such, not needed for unwinding */
+    row->regs[reg].kind = kind;
+    row->regs[reg].offset = offset;
+}
+DWSTATIC(void) dweller_cfi_set_expr(struct dweller_cfi_rule *rule, dw_u8_t kind, struct dweller_cfi_cursor *cursor)
+{
+    dw_u64_t size = dweller_cfi_uleb128(cursor);
+    const dw_u8_t *expr = dweller_cfi_take(cursor, size);
+    if (rule == NULL) return;
+    rule->kind = kind;
+    rule->expr = expr;
+    rule->expr_size = size;
+}
+DWSTATIC(bool) dweller_cfi_execute(const struct dweller_cfi *cfi, const struct dweller_cfi_cie *cie, struct dweller_cfi_cursor cursor, dw_u64_t pc, struct dweller_cfi_row *row, bool in_fde);
+
+/* `DW_CFA_restore` brings back the rule of the CIE instructions.
+ * It is rare enough to run those again, instead of keeping a copy of every row.
+ */
+DWSTATIC(void) dweller_cfi_restore(const struct dweller_cfi *cfi, const struct dweller_cfi_cie *cie, struct dweller_cfi_row *row, dw_u64_t reg)
+{
+    if (reg >= DWELLER_CFI_MAX_REGS) return;
+    struct dweller_cfi_row initial;
+    memset(&initial, 0x00, sizeof(struct dweller_cfi_row));
+    if (dweller_cfi_execute(cfi, cie, dweller_cfi_cursor(cfi, cie->instructions, cie->end), DWELLER_CFI_NONE, &initial, false)) {
+        row->regs[reg] = initial.regs[reg];
+    }
+}
+/* Run the instructions from `cursor` until the location passes `pc` */
+DWSTATIC(bool) dweller_cfi_execute(const struct dweller_cfi *cfi, const struct dweller_cfi_cie *cie, struct dweller_cfi_cursor cursor, dw_u64_t pc, struct dweller_cfi_row *row, bool in_fde)
+{
+    struct {
+        struct dweller_cfi_rule cfa;
+        struct dweller_cfi_rule regs[DWELLER_CFI_MAX_REGS];
+    } states[DWELLER_CFI_MAX_STATES];
+    size_t num_states = 0;
+    dw_u64_t loc = row->pc_begin;
+
+    while (cursor.ok && cursor.pos < cursor.end) {
+        dw_u8_t op = *dweller_cfi_take(&cursor, 1);
+        dw_u64_t reg = op & 0x3f, next_loc;
+        switch (op & 0xc0) {
+        case DW_CFA_advance_loc:
+            next_loc = loc + reg * cie->code_align;
+            goto advance;
+        case DW_CFA_offset:
+            dweller_cfi_set(row, reg, DWELLER_CFI_OFFSET, (dw_i64_t)dweller_cfi_uleb128(&cursor) * cie->data_align);
+            continue;
+        case DW_CFA_restore:
+            if (in_fde) dweller_cfi_restore(cfi, cie, row, reg);
+            continue;
+        }
+        switch (op) {
+        case DW_CFA_nop:
+            break;
+        case DW_CFA_set_loc:
+            next_loc = dweller_cfi_pointer(&cursor, cie->fde_encoding, cie->address_size, 0);
+            goto advance;
+        case DW_CFA_advance_loc1:
+            next_loc = loc + dweller_cfi_get(&cursor, 1) * cie->code_align;
+            goto advance;
+        case DW_CFA_advance_loc2:
+            next_loc = loc + dweller_cfi_get(&cursor, 2) * cie->code_align;
+            goto advance;
+        case DW_CFA_advance_loc4:
+            next_loc = loc + dweller_cfi_get(&cursor, 4) * cie->code_align;
+            goto advance;
+        case DW_CFA_offset_extended:
+            reg = dweller_cfi_uleb128(&cursor);
+            dweller_cfi_set(row, reg, DWELLER_CFI_OFFSET, (dw_i64_t)dweller_cfi_uleb128(&cursor) * cie->data_align);
+            break;
+        case DW_CFA_offset_extended_sf:
+            reg = dweller_cfi_uleb128(&cursor);
+            dweller_cfi_set(row, reg, DWELLER_CFI_OFFSET, dweller_cfi_sleb128(&cursor) * cie->data_align);
+            break;
+        case 0x2f: /* DW_CFA_GNU_negative_offset_extended */
+            reg = dweller_cfi_uleb128(&cursor);
+            dweller_cfi_set(row, reg, DWELLER_CFI_OFFSET, -(dw_i64_t)dweller_cfi_uleb128(&cursor) * cie->data_align);
+            break;
+        case DW_CFA_val_offset:
+            reg = dweller_cfi_uleb128(&cursor);
+            dweller_cfi_set(row, reg, DWELLER_CFI_VAL_OFFSET, (dw_i64_t)dweller_cfi_uleb128(&cursor) * cie->data_align);
+            break;
+        case DW_CFA_val_offset_sf:
+            reg = dweller_cfi_uleb128(&cursor);
+            dweller_cfi_set(row, reg, DWELLER_CFI_VAL_OFFSET, dweller_cfi_sleb128(&cursor) * cie->data_align);
+            break;
+        case DW_CFA_restore_extended:
+            reg = dweller_cfi_uleb128(&cursor);
+            if (in_fde) dweller_cfi_restore(cfi, cie, row, reg);
+            break;
+        case DW_CFA_undefined:
+            dweller_cfi_set(row, dweller_cfi_uleb128(&cursor), DWELLER_CFI_UNDEFINED, 0);
+            break;
+        case DW_CFA_same_value:
+            dweller_cfi_set(row, dweller_cfi_uleb128(&cursor), DWELLER_CFI_SAME_VALUE, 0);
+            break;
+        case DW_CFA_register:
+            reg = dweller_cfi_uleb128(&cursor);
+            dweller_cfi_set(row, reg, DWELLER_CFI_REGISTER, 0);
+            if (reg < DWELLER_CFI_MAX_REGS) row->regs[reg].reg = dweller_cfi_uleb128(&cursor);
+            else dweller_cfi_uleb128(&cursor);
+            break;
+        case DW_CFA_remember_state:
+            if (num_states == DWELLER_CFI_MAX_STATES) return false;
+            states[num_states].cfa = row->cfa;
+            memcpy(states[num_states].regs, row->regs, sizeof(row->regs));
+            num_states++;
+            break;
+        case DW_CFA_restore_state:
+            if (num_states == 0) return false;
+            num_states--;
+            row->cfa = states[num_states].cfa;
+            memcpy(row->regs, states[num_states].regs, sizeof(row->regs));
+            break;
+        case DW_CFA_def_cfa:
+            row->cfa.kind = DWELLER_CFI_VAL_OFFSET;
+            row->cfa.reg = dweller_cfi_uleb128(&cursor);
+            row->cfa.offset = dweller_cfi_uleb128(&cursor);
+            break;
+        case DW_CFA_def_cfa_sf:
+            row->cfa.kind = DWELLER_CFI_VAL_OFFSET;
+            row->cfa.reg = dweller_cfi_uleb128(&cursor);
+            row->cfa.offset = dweller_cfi_sleb128(&cursor) * cie->data_align;
+            break;
+        case DW_CFA_def_cfa_register:
+            row->cfa.kind = DWELLER_CFI_VAL_OFFSET;
+            row->cfa.reg = dweller_cfi_uleb128(&cursor);
+            break;
+        case DW_CFA_def_cfa_offset:
+            row->cfa.offset = dweller_cfi_uleb128(&cursor);
+            break;
+        case DW_CFA_def_cfa_offset_sf:
+            row->cfa.offset = dweller_cfi_sleb128(&cursor) * cie->data_align;
+            break;
+        case DW_CFA_def_cfa_expression:
+            dweller_cfi_set_expr(&row->cfa, DWELLER_CFI_VAL_EXPRESSION, &cursor);
+            break;
+        case DW_CFA_expression:
+            reg = dweller_cfi_uleb128(&cursor);
+            dweller_cfi_set_expr(reg < DWELLER_CFI_MAX_REGS ? &row->regs[reg] : NULL, DWELLER_CFI_EXPRESSION, &cursor);
+            break;
+        case DW_CFA_val_expression:
+            reg = dweller_cfi_uleb128(&cursor);
+            dweller_cfi_set_expr(reg < DWELLER_CFI_MAX_REGS ? &row->regs[reg] : NULL, DWELLER_CFI_VAL_EXPRESSION, &cursor);
+            break;
+        case 0x2d: /* DW_CFA_GNU_window_save, or DW_CFA_AARCH64_negate_ra_state */
+            break;
+        case 0x2e: /* DW_CFA_GNU_args_size */
+            dweller_cfi_uleb128(&cursor);
+            break;
+        default:
+            return false;
+        }
+        continue;
+    advance:
+        if (next_loc > pc) {
+            row->pc_end = next_loc;
+            return cursor.ok;
+        }
+        loc = next_loc;
+        row->pc_begin = loc;
+    }
+    return cursor.ok;
+}
+
+void dweller_cfi_init(struct dweller_cfi *cfi, const void *section, size_t size, dw_u64_t address, bool is_eh_frame)
+{
+    memset(cfi, 0x00, sizeof(struct dweller_cfi));
+    cfi->base = section;
+    cfi->size = section != NULL ? size : 0;
+    cfi->address = address;
+    cfi->is_eh_frame = is_eh_frame;
+    cfi->address_size = sizeof(void *);
+}
+bool dweller_cfi_init_eh_frame_hdr(struct dweller_cfi *cfi, const void *hdr, size_t size, dw_u64_t address, dw_u64_t eh_frame_end)
+{
+    struct dweller_cfi cfi_hdr;
+    dweller_cfi_init(&cfi_hdr, hdr, size, address, true);
+    struct dweller_cfi_cursor cursor = dweller_cfi_cursor(&cfi_hdr, cfi_hdr.base, cfi_hdr.base + cfi_hdr.size);
+    dw_u8_t version = dweller_cfi_get(&cursor, 1);
+    dw_u8_t eh_frame_ptr_encoding = dweller_cfi_get(&cursor, 1);
+    dw_u8_t fde_count_encoding = dweller_cfi_get(&cursor, 1);
+    dw_u8_t table_encoding = dweller_cfi_get(&cursor, 1);
+    dw_u64_t eh_frame = dweller_cfi_pointer(&cursor, eh_frame_ptr_encoding, cfi_hdr.address_size, address);
+    if (!cursor.ok || version != 1 || eh_frame_ptr_encoding == DW_EH_PE_omit || eh_frame >= eh_frame_end) return false;
+    /* `.eh_frame` is in the same segment as `.eh_frame_hdr`, so it is as far away in memory as in the address space */
+    dweller_cfi_init(cfi, (const dw_u8_t *)hdr + (dw_i64_t)(eh_frame - address), eh_frame_end - eh_frame, eh_frame, true);
+
+    dw_u64_t fde_count = dweller_cfi_pointer(&cursor, fde_count_encoding, cfi_hdr.address_size, address);
+    if (!cursor.ok || fde_count_encoding == DW_EH_PE_omit) return true;
+    /* Everyone uses pairs of 4-byte offsets from the start of `.eh_frame_hdr` */
+    if (table_encoding != (DW_EH_PE_datarel | DW_EH_PE_sdata4)) return true;
+    if (fde_count > (dw_u64_t)(cursor.end - cursor.pos) / 8) return true;
+    cfi->hdr_table = cursor.pos;
+    cfi->hdr_count = fde_count;
+    cfi->hdr_address = address;
+    return true;
+}
+DWSTATIC(int) dweller_cfi_compare(const void *a, const void *b)
+{
+    const struct dweller_cfi_entry *lhs = a, *rhs = b;
+    return lhs->pc < rhs->pc ? -1 : lhs->pc > rhs->pc;
+}
+bool dweller_cfi_index(struct dweller_cfi *cfi, dw_alloc_t *allocator)
+{
+    size_t max_entries = 0;
+    dw_u64_t offset = 0, next, id;
+    struct dweller_cfi_cursor cursor;
+    cfi->allocator = allocator;
+    while ((next = dweller_cfi_entry(cfi, offset, &cursor, &id)) != 0) {
+        struct dweller_cfi_fde fde;
+        struct dweller_cfi_cie cie;
+        if (id != DWELLER_CFI_NONE && dweller_cfi_parse_fde(cfi, offset, &fde, &cie) && fde.pc_end > fde.pc_begin) {
+            if (cfi->num_entries == max_entries) {
+                max_entries = max_entries ? 2 * max_entries : 256;
+                struct dwarf_alloc_req req = {
+                    max_entries * sizeof(struct dweller_cfi_entry),
+                    DWARF_ALLOC_DYNAMIC,
+                    DW_MAXALIGN,
+                    sizeof(struct dweller_cfi_entry)
+                };
+                void *entries = cfi->entries;
+                if ((*allocator)(allocator, &req, &entries) < 0) return false;
+                cfi->entries = entries;
+            }
+            cfi->entries[cfi->num_entries].pc = fde.pc_begin;
+            cfi->entries[cfi->num_entries].fde = offset;
+            cfi->num_entries++;
+        }
+        offset = next;
+    }
+    qsort(cfi->entries, cfi->num_entries, sizeof(struct dweller_cfi_entry), dweller_cfi_compare);
+    return true;
+}
+void dweller_cfi_fini(struct dweller_cfi *cfi)
+{
+    if (cfi->entries != NULL) {
+        struct dwarf_alloc_req req = {
+            0,
+            DWARF_ALLOC_DYNAMIC,
+            DW_MAXALIGN,
+            sizeof(struct dweller_cfi_entry)
+        };
+        void *entries = cfi->entries;
+        DW_USE((*cfi->allocator)(cfi->allocator, &req, &entries));
+    }
+    cfi->entries = NULL;
+    cfi->num_entries = 0;
+}
+/* Find the offset of the FDE that would hold `pc`, the one with the highest start at or below it */
+DWSTATIC(dw_u64_t) dweller_cfi_search(const struct dweller_cfi *cfi, dw_u64_t pc)
+{
+    if (cfi->hdr_table != NULL) {
+        size_t lo = 0, hi = cfi->hdr_count;
+        struct dweller_cfi_cursor cursor = dweller_cfi_cursor(cfi, cfi->hdr_table, cfi->hdr_table + 8 * cfi->hdr_count);
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            cursor.pos = cfi->hdr_table + 8 * mid;
+            if (cfi->hdr_address + dweller_cfi_get_signed(&cursor, 4) <= pc) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo == 0) return DWELLER_CFI_NONE;
+        cursor.pos = cfi->hdr_table + 8 * (lo - 1) + 4;
+        dw_u64_t fde = cfi->hdr_address + dweller_cfi_get_signed(&cursor, 4);
+        return fde - cfi->address;
+    }
+    if (cfi->entries != NULL) {
+        size_t lo = 0, hi = cfi->num_entries;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (cfi->entries[mid].pc <= pc) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo == 0 ? DWELLER_CFI_NONE : cfi->entries[lo - 1].fde;
+    }
+    /* No index, look at every FDE */
+    dw_u64_t offset = 0, next, id;
+    struct dweller_cfi_cursor cursor;
+    while ((next = dweller_cfi_entry(cfi, offset, &cursor, &id)) != 0) {
+        struct dweller_cfi_fde fde;
+        struct dweller_cfi_cie cie;
+        if (id != DWELLER_CFI_NONE && dweller_cfi_parse_fde(cfi, offset, &fde, &cie) && fde.pc_begin <= pc && pc < fde.pc_end) return offset;
+        offset = next;
+    }
+    return DWELLER_CFI_NONE;
+}
+bool dweller_cfi_find(const struct dweller_cfi *cfi, dw_u64_t pc, struct dweller_cfi_row *row)
+{
+    dw_u64_t offset = dweller_cfi_search(cfi, pc);
+    struct dweller_cfi_fde fde;
+    struct dweller_cfi_cie cie;
+    if (offset == DWELLER_CFI_NONE || !dweller_cfi_parse_fde(cfi, offset, &fde, &cie)) return false;
+    if (pc < fde.pc_begin || pc >= fde.pc_end) return false;
+
+    memset(row, 0x00, sizeof(struct dweller_cfi_row));
+    row->ra_reg = cie.ra_reg;
+    row->signal_frame = cie.signal_frame;
+    row->pc_begin = fde.pc_begin;
+    row->pc_end = fde.pc_end;
+    if (!dweller_cfi_execute(cfi, &cie, dweller_cfi_cursor(cfi, cie.instructions, cie.end), DWELLER_CFI_NONE, row, false)) return false;
+    return dweller_cfi_execute(cfi, &cie, dweller_cfi_cursor(cfi, fde.instructions, fde.end), pc, row, true);
+}
+
+DWSTATIC(bool) dweller_cfi_register(const struct dweller_cfi_regs *regs, dw_u64_t reg, dw_u64_t *value)
+{
+    if (reg >= DWELLER_CFI_MAX_REGS || !(regs->valid & ((dw_u64_t)1 << reg))) return false;
+    *value = regs->regs[reg];
+    return true;
+}
+/* The caller's stack pointer is the CFA, and its pc the return address.
+ * An undefined return address marks the outermost frame.
+ */
+DWSTATIC(bool) dweller_cfi_return(struct dweller_cfi_regs *caller, struct dweller_cfi_regs *regs, unsigned ra_reg, unsigned sp_reg)
+{
+    if (sp_reg < DWELLER_CFI_MAX_REGS) {
+        caller->regs[sp_reg] = regs->cfa;
+        caller->valid |= (dw_u64_t)1 << sp_reg;
+    }
+    if (!dweller_cfi_register(caller, ra_reg, &caller->pc) || caller->pc == 0) return false;
+    *regs = *caller;
+    return true;
+}
+/* Read the `size` byte value at `address` with the callback */
+DWSTATIC(bool) dweller_cfi_read(dweller_cfi_read_t read, void *data, dw_u64_t address, size_t size, dw_u64_t *value)
+{
+    dw_u8_t bytes[8];
+    if (!read(data, address, bytes, size)) return false;
+    *value = dweller_cfi_value(bytes, size);
+    return true;
+}
+/* Evaluate the subset of DWARF expressions that CFI needs */
+DWSTATIC(bool) dweller_cfi_eval(const struct dweller_cfi_rule *rule, const struct dweller_cfi_regs *regs, dweller_cfi_read_t read, void *data, bool push_cfa, dw_u64_t *result)
+{
+    dw_u64_t stack[DWELLER_CFI_EXPR_STACK];
+    size_t depth = 0;
+    if (push_cfa) stack[depth++] = regs->cfa;
+    struct dweller_cfi_cursor cursor = { rule->expr, rule->expr + rule->expr_size, rule->expr, 0, rule->expr != NULL };
+#define DWELLER_CFI_NEED(n) if (depth < (n)) return false
+#define DWELLER_CFI_PUSH(v) do { if (depth == DWELLER_CFI_EXPR_STACK) return false; dw_u64_t v_ = (v); stack[depth++] = v_; } while (0)
+#define DWELLER_CFI_BINARY(expr) do { DWELLER_CFI_NEED(2); dw_u64_t b = stack[--depth], a = stack[depth - 1]; stack[depth - 1] = (expr); } while (0)
+    while (cursor.ok && cursor.pos < cursor.end) {
+        dw_u8_t op = *dweller_cfi_take(&cursor, 1);
+        dw_u64_t value;
+        if (op >= DW_OP_lit0 && op <= DW_OP_lit0 + 31) {
+            DWELLER_CFI_PUSH(op - DW_OP_lit0);
+            continue;
+        }
+        if (op >= DW_OP_breg0 && op <= DW_OP_breg31) {
+            dw_i64_t offset = dweller_cfi_sleb128(&cursor);
+            if (!dweller_cfi_register(regs, op - DW_OP_breg0, &value)) return false;
+            DWELLER_CFI_PUSH(value + offset);
+            continue;
+        }
+        switch (op) {
+        case DW_OP_addr:     DWELLER_CFI_PUSH(dweller_cfi_get(&cursor, sizeof(void *))); break;
+        case DW_OP_const1u:  DWELLER_CFI_PUSH(dweller_cfi_get(&cursor, 1)); break;
+        case DW_OP_const1s:  DWELLER_CFI_PUSH(dweller_cfi_get_signed(&cursor, 1)); break;
+        case DW_OP_const2u:  DWELLER_CFI_PUSH(dweller_cfi_get(&cursor, 2)); break;
+        case DW_OP_const2s:  DWELLER_CFI_PUSH(dweller_cfi_get_signed(&cursor, 2)); break;
+        case DW_OP_const4u:  DWELLER_CFI_PUSH(dweller_cfi_get(&cursor, 4)); break;
+        case DW_OP_const4s:  DWELLER_CFI_PUSH(dweller_cfi_get_signed(&cursor, 4)); break;
+        case DW_OP_const8u:
+        case DW_OP_const8s:  DWELLER_CFI_PUSH(dweller_cfi_get(&cursor, 8)); break;
+        case DW_OP_constu:   DWELLER_CFI_PUSH(dweller_cfi_uleb128(&cursor)); break;
+        case DW_OP_consts:   DWELLER_CFI_PUSH(dweller_cfi_sleb128(&cursor)); break;
+        case DW_OP_bregx: {
+            dw_u64_t reg = dweller_cfi_uleb128(&cursor);
+            dw_i64_t offset = dweller_cfi_sleb128(&cursor);
+            if (!dweller_cfi_register(regs, reg, &value)) return false;
+            DWELLER_CFI_PUSH(value + offset);
+            break;
+        }
+        case DW_OP_dup:      DWELLER_CFI_NEED(1); DWELLER_CFI_PUSH(stack[depth - 1]); break;
+        case DW_OP_drop:     DWELLER_CFI_NEED(1); depth--; break;
+        case DW_OP_over:     DWELLER_CFI_NEED(2); DWELLER_CFI_PUSH(stack[depth - 2]); break;
+        case DW_OP_pick:
+            value = dweller_cfi_get(&cursor, 1);
+            DWELLER_CFI_NEED(value + 1);
+            DWELLER_CFI_PUSH(stack[depth - 1 - value]);
+            break;
+        case DW_OP_swap:
+            DWELLER_CFI_NEED(2);
+            value = stack[depth - 1], stack[depth - 1] = stack[depth - 2], stack[depth - 2] = value;
+            break;
+        case DW_OP_rot:
+            DWELLER_CFI_NEED(3);
+            value = stack[depth - 1], stack[depth - 1] = stack[depth - 2], stack[depth - 2] = stack[depth - 3], stack[depth - 3] = value;
+            break;
+        case DW_OP_deref:
+            DWELLER_CFI_NEED(1);
+            if (!dweller_cfi_read(read, data, stack[depth - 1], 8, &stack[depth - 1])) return false;
+            break;
+        case DW_OP_deref_size: {
+            dw_u64_t size = dweller_cfi_get(&cursor, 1);
+            DWELLER_CFI_NEED(1);
+            if (size == 0 || size > 8 || !dweller_cfi_read(read, data, stack[depth - 1], size, &stack[depth - 1])) return false;
+            break;
+        }
+        case DW_OP_abs:      DWELLER_CFI_NEED(1); if ((dw_i64_t)stack[depth - 1] < 0) stack[depth - 1] = -stack[depth - 1]; break;
+        case DW_OP_neg:      DWELLER_CFI_NEED(1); stack[depth - 1] = -stack[depth - 1]; break;
+        case DW_OP_not:      DWELLER_CFI_NEED(1); stack[depth - 1] = ~stack[depth - 1]; break;
+        case DW_OP_plus_uconst: DWELLER_CFI_NEED(1); stack[depth - 1] += dweller_cfi_uleb128(&cursor); break;
+        case DW_OP_and:      DWELLER_CFI_BINARY(a & b); break;
+        case DW_OP_or:       DWELLER_CFI_BINARY(a | b); break;
+        case DW_OP_xor:      DWELLER_CFI_BINARY(a ^ b); break;
+        case DW_OP_plus:     DWELLER_CFI_BINARY(a + b); break;
+        case DW_OP_minus:    DWELLER_CFI_BINARY(a - b); break;
+        case DW_OP_mul:      DWELLER_CFI_BINARY(a * b); break;
+        case DW_OP_shl:      DWELLER_CFI_BINARY(b < 64 ? a << b : 0); break;
+        case DW_OP_shr:      DWELLER_CFI_BINARY(b < 64 ? a >> b : 0); break;
+        case DW_OP_shra:     DWELLER_CFI_BINARY(b < 64 ? (dw_u64_t)((dw_i64_t)a >> b) : ((dw_i64_t)a < 0 ? ~(dw_u64_t)0 : 0)); break;
+        case DW_OP_div:
+            DWELLER_CFI_NEED(2);
+            if (stack[depth - 1] == 0) return false;
+            DWELLER_CFI_BINARY((dw_u64_t)((dw_i64_t)a / (dw_i64_t)b));
+            break;
+        case DW_OP_mod:
+            DWELLER_CFI_NEED(2);
+            if (stack[depth - 1] == 0) return false;
+            DWELLER_CFI_BINARY(a % b);
+            break;
+        case DW_OP_eq:       DWELLER_CFI_BINARY(a == b); break;
+        case DW_OP_ne:       DWELLER_CFI_BINARY(a != b); break;
+        case DW_OP_lt:       DWELLER_CFI_BINARY((dw_i64_t)a < (dw_i64_t)b); break;
+        case DW_OP_le:       DWELLER_CFI_BINARY((dw_i64_t)a <= (dw_i64_t)b); break;
+        case DW_OP_gt:       DWELLER_CFI_BINARY((dw_i64_t)a > (dw_i64_t)b); break;
+        case DW_OP_ge:       DWELLER_CFI_BINARY((dw_i64_t)a >= (dw_i64_t)b); break;
+        case DW_OP_skip:
+        case DW_OP_bra: {
+            dw_i64_t offset = dweller_cfi_get_signed(&cursor, 2);
+            if (op == DW_OP_bra) {
+                DWELLER_CFI_NEED(1);
+                if (stack[--depth] == 0) break;
+            }
+            if (offset < cursor.base - cursor.pos || offset > cursor.end - cursor.pos) return false;
+            cursor.pos += offset;
+            break;
+        }
+        case DW_OP_nop:
+            break;
+        default:
+            return false;
+        }
+    }
+#undef DWELLER_CFI_BINARY
+#undef DWELLER_CFI_PUSH
+#undef DWELLER_CFI_NEED
+    if (!cursor.ok || depth == 0) return false;
+    *result = stack[depth - 1];
+    return true;
+}
+bool dweller_cfi_step(const struct dweller_cfi_row *row, struct dweller_cfi_regs *regs, unsigned sp_reg, dweller_cfi_read_t read, void *data)
+{
+    dw_u64_t cfa;
+    if (row->cfa.kind == DWELLER_CFI_VAL_EXPRESSION) {
+        if (!dweller_cfi_eval(&row->cfa, regs, read, data, false, &cfa)) return false;
+    } else {
+        if (!dweller_cfi_register(regs, row->cfa.reg, &cfa)) return false;
+        cfa += row->cfa.offset;
+    }
+    regs->cfa = cfa;
+
+    struct dweller_cfi_regs caller = *regs;
+    for (unsigned reg=0; reg < DWELLER_CFI_MAX_REGS; reg++) {
+        const struct dweller_cfi_rule *rule = &row->regs[reg];
+        dw_u64_t bit = (dw_u64_t)1 << reg, value = 0, address;
+        bool ok;
+        switch (rule->kind) {
+        case DWELLER_CFI_SAME_VALUE:
+            continue;
+        case DWELLER_CFI_OFFSET:
+            ok = dweller_cfi_read(read, data, cfa + rule->offset, 8, &value);
+            break;
+        case DWELLER_CFI_VAL_OFFSET:
+            ok = true;
+            value = cfa + rule->offset;
+            break;
+        case DWELLER_CFI_REGISTER:
+            ok = dweller_cfi_register(regs, rule->reg, &value);
+            break;
+        case DWELLER_CFI_EXPRESSION:
+            ok = dweller_cfi_eval(rule, regs, read, data, true, &address) && dweller_cfi_read(read, data, address, 8, &value);
+            break;
+        case DWELLER_CFI_VAL_EXPRESSION:
+            ok = dweller_cfi_eval(rule, regs, read, data, true, &value);
+            break;
+        default:
+            ok = false;
+            break;
+        }
+        caller.regs[reg] = value;
+        caller.valid = ok ? caller.valid | bit : caller.valid & ~bit;
+    }
+    return dweller_cfi_return(&caller, regs, row->ra_reg, sp_reg);
+}
+bool dweller_cfi_compact(const struct dweller_cfi_row *row, struct dweller_cfi_compact *compact)
+{
+    if (row->cfa.kind != DWELLER_CFI_VAL_OFFSET || row->cfa.reg >= DWELLER_CFI_MAX_REGS || row->ra_reg > 0xff) return false;
+    if (row->cfa.offset < INT32_MIN || row->cfa.offset > INT32_MAX) return false;
+    compact->cfa_offset = row->cfa.offset;
+    compact->cfa_reg = row->cfa.reg;
+    compact->ra_reg = row->ra_reg;
+    compact->signal_frame = row->signal_frame;
+    compact->num_saved = 0;
+    for (unsigned reg=0; reg < DWELLER_CFI_MAX_REGS; reg++) {
+        const struct dweller_cfi_rule *rule = &row->regs[reg];
+        if (rule->kind == DWELLER_CFI_SAME_VALUE) continue;
+        if (rule->kind != DWELLER_CFI_OFFSET && rule->kind != DWELLER_CFI_VAL_OFFSET && rule->kind != DWELLER_CFI_UNDEFINED) return false;
+        if (rule->kind != DWELLER_CFI_UNDEFINED && (rule->offset < INT16_MIN || rule->offset > INT16_MAX)) return false;
+        if (compact->num_saved == DWELLER_CFI_COMPACT_SAVED) return false;
+        compact->saved[compact->num_saved].reg = reg;
+        compact->saved[compact->num_saved].kind = rule->kind;
+        compact->saved[compact->num_saved].offset = rule->kind != DWELLER_CFI_UNDEFINED ? rule->offset : 0;
+        compact->num_saved++;
+    }
+    return true;
+}
+bool dweller_cfi_step_compact(const struct dweller_cfi_compact *compact, struct dweller_cfi_regs *regs, unsigned sp_reg, dweller_cfi_read_t read, void *data)
+{
+    dw_u64_t cfa;
+    if (!dweller_cfi_register(regs, compact->cfa_reg, &cfa)) return false;
+    cfa += compact->cfa_offset;
+    regs->cfa = cfa;
+
+    struct dweller_cfi_regs caller = *regs;
+    for (unsigned i=0; i < compact->num_saved; i++) {
+        unsigned reg = compact->saved[i].reg;
+        dw_u64_t bit = (dw_u64_t)1 << reg, value = 0;
+        bool ok = false;
+        if (compact->saved[i].kind == DWELLER_CFI_OFFSET) {
+            ok = dweller_cfi_read(read, data, cfa + compact->saved[i].offset, 8, &value);
+        } else if (compact->saved[i].kind == DWELLER_CFI_VAL_OFFSET) {
+            ok = true;
+            value = cfa + compact->saved[i].offset;
+        }
+        caller.regs[reg] = value;
+        caller.valid = ok ? caller.valid | bit : caller.valid & ~bit;
+    }
+    return dweller_cfi_return(&caller, regs, compact->ra_reg, sp_reg);
+}
@@ -106,7 +106,7 @@ DWSTATIC(void *) dwarf_unit_iter_next(dwarf_iter_t *viter)
     dwarf_unit_iter_t *iter = (dwarf_unit_iter_t *)viter;
     dw_stream_seek(&iter->stream, iter->offset);
     if (dw_stream_isdone(&iter->stream)) goto done;
-    dwarf_unit_parseheader(viter->dwarf, &iter->stream, &iter->unit, viter->errinfo); // TODO: Error handling
+    if (!dwarf_unit_parseheader(viter->dwarf, &iter->stream, &iter->unit, viter->errinfo)) goto done;
     dw_i64_t header_length_size = dwarf_header_length_size(iter->unit.dwarf64); /* The size of the length field of the header */
     iter->offset = dw_stream_tell(&iter->stream) - (iter->unit.header_size - header_length_size) + iter->unit.die.length;
     return &iter->unit;
@@ -151,9 +151,8 @@ DWSTATIC(void *) dwarf_attr_iter_next(dwarf_iter_t *viter)
     if (dw_stream_isdone(iter->stream)) goto done;
     if (dw_stream_isdone(&iter->abstream)) goto done;
     if (!dw_stream_peak16(&iter->abstream)) goto done;
-    iter->attr.name = dw_stream_getleb128_unsigned(&iter->abstream, NULL);
-    iter->attr.form = dw_stream_getleb128_unsigned(&iter->abstream, NULL);
-    dwarf_read_attr(viter->dwarf, iter->stream, &iter->attr);
+    dwarf_read_attr_spec(&iter->abstream, &iter->attr);
+    if (!dwarf_read_attr(viter->dwarf, iter->unit, iter->stream, &iter->attr, viter->errinfo)) goto done;
     return &iter->attr;
 
 done:
@@ -18,43 +18,147 @@
 
 #define dwarf_header_length_size(dwarf64) (dwarf64 == 64 ? 4 + 8 : 4)
 
-DWSTATIC(bool) dwarf_read_attr(struct dwarf *dwarf, dw_stream_t *stream, dwarf_attr_t *attr)
+#define dwarf_offset_size(dwarf64) (dwarf64 == 64 ? 8 : 4)
+
+DWSTATIC(dw_u64_t) dwarf_read_offset(dw_stream_t *stream, int dwarf64)
 {
-    size_t i;
+    return dwarf64 == 64 ? dw_stream_get64(stream) : dw_stream_get32(stream);
+}
+DWSTATIC(struct dwarf_section *) dwarf_get_section(struct dwarf *dwarf, enum dwarf_section_namespace ns, struct dwarf_section_provider **provider)
+{
+    switch (ns) {
+    case DWARF_SECTION_STROFFSETS:
+        *provider = dwarf->str_offsets.section_provider;
+        return &dwarf->str_offsets.section;
+    case DWARF_SECTION_ADDR:
+        *provider = dwarf->addr.section_provider;
+        return &dwarf->addr.section;
+    case DWARF_SECTION_RANGELISTS:
+        *provider = dwarf->rnglists.section_provider;
+        return &dwarf->rnglists.section;
+    case DWARF_SECTION_RANGES:
+        *provider = dwarf->ranges.section_provider;
+        return &dwarf->ranges.section;
+    case DWARF_SECTION_LOCATIONLISTS:
+        *provider = dwarf->loclists.section_provider;
+        return &dwarf->loclists.section;
+    default:
+        *provider = NULL;
+        return NULL;
+    }
+}
+/* Read a single little-endian value of `size` bytes at `off` in an indexed
+ * section. When the section is mapped this is a plain load.
+ */
+DWSTATIC(bool) dwarf_read_indexed(struct dwarf *dwarf, enum dwarf_section_namespace ns, dw_off_t off, int size, dw_u64_t *value, struct dwarf_errinfo *errinfo)
+{
+    struct dwarf_section_provider *provider;
+    struct dwarf_section *section = dwarf_get_section(dwarf, ns, &provider);
+    if (!provider) {
+        if (!section || !section->base) error(runtime_error("indexed form used, but section %1 is not loaded", "I", ns));
+        if (off + size > section->size) error(runtime_error("index at offset %1 is out of bounds for section %2", "QI", off, ns));
+        const dw_u8_t *p = section->base + off;
+        dw_u64_t result = 0;
+        int i;
+        /* TODO: Big endian support */
+        for (i=0; i < size; i++) result |= (dw_u64_t)p[i] << (i * 8);
+        *value = result;
+        return true;
+    }
+    dw_stream_t stream;
+    dw_stream_init(&stream, ns, *section, provider);
+    if (!dw_stream_seek(&stream, off)) error(runtime_error("failed to seek to offset %1 in section %2", "QI", off, ns));
+    *value = dw_stream_getaddr(&stream, size * 8);
+    return true;
+}
+/* Read the attribute name and form from an abbreviation, including the value
+ * of `DW_FORM_implicit_const`, which lives in the abbreviation itself.
+ */
+DWSTATIC(void) dwarf_read_attr_spec(dw_stream_t *abstream, dwarf_attr_t *attr)
+{
+    attr->name = dw_stream_getleb128_unsigned(abstream, NULL);
+    attr->form = dw_stream_getleb128_unsigned(abstream, NULL);
+    if (attr->form == DW_FORM_implicit_const) {
+        attr->value.val = dw_stream_getleb128_signed(abstream, NULL);
+    }
+}
+DWSTATIC(void) dwarf_read_block(dw_stream_t *stream, dwarf_attr_t *attr, size_t len)
+{
+    attr->value.block.section = stream->section;
+    attr->value.block.off = dw_stream_tell(stream);
+    attr->value.block.len = len;
+    dw_stream_offset(stream, len);
+}
+/* Read the encoded value of an attribute without resolving indexed forms.
+ * For those, `value.val` holds the raw index.
+ * `unit` may be `NULL` for attributes outside of any unit, in that case
+ * 32-bit DWARF and 8-byte addresses are assumed.
+ */
+DWSTATIC(bool) dwarf_read_attr_raw(struct dwarf *dwarf, const dwarf_unit_t *unit, dw_stream_t *stream, dwarf_attr_t *attr, struct dwarf_errinfo *errinfo)
+{
+    int dwarf64 = unit ? unit->dwarf64 : 32;
+    int address_size = unit ? unit->address_size : 8;
+again:
     switch (attr->form) {
     case DW_FORM_flag_present:
         attr->value.b = true;
         break;
+    case DW_FORM_implicit_const:
+        /* Already read from the abbreviation by `dwarf_read_attr_spec` */
+        break;
     case DW_FORM_flag:
         attr->value.b = dw_stream_get8(stream);
         break;
     case DW_FORM_data1:
     case DW_FORM_ref1:
+    case DW_FORM_strx1:
+    case DW_FORM_addrx1:
         attr->value.val = dw_stream_get8(stream);
         break;
     case DW_FORM_data2:
     case DW_FORM_ref2:
+    case DW_FORM_strx2:
+    case DW_FORM_addrx2:
         attr->value.val = dw_stream_get16(stream);
         break;
+    case DW_FORM_strx3:
+    case DW_FORM_addrx3:
+        attr->value.val = dw_stream_get16(stream);
+        attr->value.val |= (dw_u64_t)dw_stream_get8(stream) << 16;
+        break;
     case DW_FORM_data4:
     case DW_FORM_ref4:
+    case DW_FORM_ref_sup4:
+    case DW_FORM_strx4:
+    case DW_FORM_addrx4:
         attr->value.val = dw_stream_get32(stream);
         break;
     case DW_FORM_data8:
     case DW_FORM_ref8:
+    case DW_FORM_ref_sig8:
+    case DW_FORM_ref_sup8:
         attr->value.val = dw_stream_get64(stream);
         break;
+    case DW_FORM_data16:
+        dwarf_read_block(stream, attr, 16);
+        break;
     case DW_FORM_udata:
+    case DW_FORM_ref_udata:
+    case DW_FORM_strx:
+    case DW_FORM_addrx:
+    case DW_FORM_rnglistx:
+    case DW_FORM_loclistx:
         attr->value.val = dw_stream_getleb128_unsigned(stream, NULL);
         break;
     case DW_FORM_sdata:
         attr->value.val = dw_stream_getleb128_signed(stream, NULL);
         break;
     case DW_FORM_addr:
-        attr->value.addr = (void *)dw_stream_getaddr(stream, 64); /* TODO: Test if we are in 32 or 64 bit binary */
+        attr->value.addr = (void *)dw_stream_getaddr(stream, address_size * 8);
         break;
     case DW_FORM_sec_offset:
-        attr->value.off = dw_stream_get32(stream); /* TODO: Test if dwarf64 */
+    case DW_FORM_ref_addr: /* DWARF2 used the address size here, nobody emits that anymore */
+        attr->value.off = dwarf_read_offset(stream, dwarf64);
         break;
     case DW_FORM_string:
         attr->value.str.section = stream->section;
@@ -63,52 +167,190 @@ DWSTATIC(bool) dwarf_read_attr(struct dwarf *dwarf, dw_stream_t *stream, dwarf_a
         attr->value.str.len = dw_stream_tell(stream) - attr->value.str.off - 1;
         break;
     case DW_FORM_strp:
-        attr->value.stroff = dw_stream_get32(stream);
+    case DW_FORM_line_strp:
+    case DW_FORM_strp_sup:
+        attr->value.stroff = dwarf_read_offset(stream, dwarf64);
         break;
-    case DW_FORM_block1: /* TODO: Add struct member for these... We just discarding right now */
-        {
-            size_t len = dw_stream_get8(stream);
-            for (i=0; i < len; i++) dw_stream_get8(stream);
-        }
+    case DW_FORM_block1:
+        dwarf_read_block(stream, attr, dw_stream_get8(stream));
         break;
     case DW_FORM_block2:
-        {
-            size_t len = dw_stream_get16(stream);
-            for (i=0; i < len; i++) dw_stream_get8(stream);
-        }
+        dwarf_read_block(stream, attr, dw_stream_get16(stream));
         break;
     case DW_FORM_block4:
-        {
-            size_t len = dw_stream_get32(stream);
-            for (i=0; i < len; i++) dw_stream_get8(stream);
-        }
+        dwarf_read_block(stream, attr, dw_stream_get32(stream));
         break;
     case DW_FORM_block:
-        {
-            size_t len = dw_stream_getleb128_unsigned(stream, NULL);
-            for (i=0; i < len; i++) dw_stream_get8(stream);
-        }
+    case DW_FORM_exprloc: /* TODO: Evaluate this and store it somehow */
+        dwarf_read_block(stream, attr, dw_stream_getleb128_unsigned(stream, NULL));
         break;
-    case DW_FORM_exprloc:
-        { /* TODO: Evaluate this and store it somehow */
-            uint64_t len = dw_stream_getleb128_unsigned(stream, NULL);
-            while (len) {
-                dw_stream_get8(stream);
-                len--;
-            }
-        }
+    case DW_FORM_indirect:
+        attr->form = dw_stream_getleb128_unsigned(stream, NULL);
+        if (attr->form == DW_FORM_indirect || attr->form == DW_FORM_implicit_const) error(runtime_error("invalid form %1 for DW_FORM_indirect", "I", attr->form));
+        goto again;
+    default:
+        error(runtime_error("unsupported attribute form: %1", "S", dwarf_get_symbol_name(DW_FORM, attr->form)));
+    }
+
+    return true;
+}
+/* Turn the raw index of an indexed form into the value it refers to.
+ * Every lookup is a single load at `base + index * entry_size`.
+ */
+DWSTATIC(bool) dwarf_resolve_attr(struct dwarf *dwarf, const dwarf_unit_t *unit, dwarf_attr_t *attr, struct dwarf_errinfo *errinfo)
+{
+    dw_u64_t index = attr->value.val;
+    dw_u64_t value;
+    int offset_size;
+    switch (attr->form) {
+    case DW_FORM_strx:
+    case DW_FORM_strx1:
+    case DW_FORM_strx2:
+    case DW_FORM_strx3:
+    case DW_FORM_strx4:
+        if (!unit) error(runtime_error("indexed form %1 used outside of a unit", "S", dwarf_get_symbol_name(DW_FORM, attr->form)));
+        offset_size = dwarf_offset_size(unit->dwarf64);
+        if (!dwarf_read_indexed(dwarf, DWARF_SECTION_STROFFSETS, unit->str_offsets_base + index * offset_size, offset_size, &value, errinfo)) return false;
+        attr->value.stroff = value;
+        break;
+    case DW_FORM_addrx:
+    case DW_FORM_addrx1:
+    case DW_FORM_addrx2:
+    case DW_FORM_addrx3:
+    case DW_FORM_addrx4:
+        if (!unit) error(runtime_error("indexed form %1 used outside of a unit", "S", dwarf_get_symbol_name(DW_FORM, attr->form)));
+        if (!dwarf_read_indexed(dwarf, DWARF_SECTION_ADDR, unit->addr_base + index * unit->address_size, unit->address_size, &value, errinfo)) return false;
+        attr->value.addr = (void *)value;
+        break;
+    case DW_FORM_rnglistx:
+        if (!unit) error(runtime_error("indexed form %1 used outside of a unit", "S", dwarf_get_symbol_name(DW_FORM, attr->form)));
+        offset_size = dwarf_offset_size(unit->dwarf64);
+        /* The offset table entries are relative to the base */
+        if (!dwarf_read_indexed(dwarf, DWARF_SECTION_RANGELISTS, unit->rnglists_base + index * offset_size, offset_size, &value, errinfo)) return false;
+        attr->value.off = unit->rnglists_base + value;
+        break;
+    case DW_FORM_loclistx:
+        if (!unit) error(runtime_error("indexed form %1 used outside of a unit", "S", dwarf_get_symbol_name(DW_FORM, attr->form)));
+        offset_size = dwarf_offset_size(unit->dwarf64);
+        if (!dwarf_read_indexed(dwarf, DWARF_SECTION_LOCATIONLISTS, unit->loclists_base + index * offset_size, offset_size, &value, errinfo)) return false;
+        attr->value.off = unit->loclists_base + value;
+        break;
+    default:
         break;
-    default: /* FIXME */
-        fprintf(stderr, "sorry, unimplemented: %s\n", dwarf_get_symbol_name(DW_FORM, attr->form));
-        abort();
     }
+    return true;
+}
+DWSTATIC(bool) dwarf_read_attr(struct dwarf *dwarf, const dwarf_unit_t *unit, dw_stream_t *stream, dwarf_attr_t *attr, struct dwarf_errinfo *errinfo)
+{
+    if (!dwarf_read_attr_raw(dwarf, unit, stream, attr, errinfo)) return false;
+    return dwarf_resolve_attr(dwarf, unit, attr, errinfo);
+}
+/* Cache the `DW_AT_*_base` attributes of the unit DIE.
+ * These may appear after attributes that use them, so this has to be done
+ * before any attribute of the unit gets resolved.
+ */
+DWSTATIC(bool) dwarf_unit_read_bases(struct dwarf *dwarf, dwarf_unit_t *unit, struct dwarf_errinfo *errinfo)
+{
+    unit->str_offsets_base = 0;
+    unit->addr_base = 0;
+    unit->rnglists_base = 0;
+    unit->loclists_base = 0;
+    unit->line_offset = -1;
+    if (unit->version < 5) return true;
+    /* Defaults for split units, which have no base attributes and a single
+     * contribution per section: skip over the section header.
+     */
+    unit->str_offsets_base = unit->dwarf64 == 64 ? 16 : 8;
+    unit->addr_base = unit->dwarf64 == 64 ? 16 : 8;
+    unit->rnglists_base = unit->dwarf64 == 64 ? 20 : 12;
+    unit->loclists_base = unit->dwarf64 == 64 ? 20 : 12;
 
+    dw_stream_t stream;
+    dw_stream_initfrom(&stream, DWARF_SECTION_INFO, dwarf->info.section, dwarf->info.section_provider, unit->die.section_offset + unit->header_size);
+    if (dw_stream_isdone(&stream)) return true;
+    dw_symval_t abbrev_code = dw_stream_getleb128_unsigned(&stream, NULL);
+    if (!abbrev_code) return true; /* Empty unit */
+    dwarf_abbrev_t *abbrev = dwarf_abbrev_table_find_abbrev_from_code(dwarf, unit->abbrev_table, abbrev_code);
+    if (!abbrev) error(runtime_error("couldn't find abbreviation code %1 (for unit at offset %2)", "II", abbrev_code, unit->die.section_offset));
+    dw_stream_t abstream;
+    dw_stream_initfrom(&abstream, DWARF_SECTION_ABBREV, dwarf->abbrev.section, dwarf->abbrev.section_provider, abbrev->offset);
+    dw_stream_getleb128_unsigned(&abstream, NULL); /* Abbreviation code */
+    dw_stream_getleb128_unsigned(&abstream, NULL); /* Tag */
+    dw_stream_get8(&abstream); /* Has children */
+    while (dw_stream_peak16(&abstream)) {
+        dwarf_attr_t attr;
+        dwarf_read_attr_spec(&abstream, &attr);
+        if (!dwarf_read_attr_raw(dwarf, unit, &stream, &attr, errinfo)) return false;
+        switch (attr.name) {
+        case DW_AT_str_offsets_base:
+            unit->str_offsets_base = attr.value.off;
+            break;
+        case DW_AT_addr_base:
+            unit->addr_base = attr.value.off;
+            break;
+        case DW_AT_rnglists_base:
+            unit->rnglists_base = attr.value.off;
+            break;
+        case DW_AT_loclists_base:
+            unit->loclists_base = attr.value.off;
+            break;
+        case DW_AT_stmt_list:
+            unit->line_offset = attr.value.off;
+            break;
+        default:
+            break;
+        }
+    }
     return true;
 }
+/* Line programs have no `DW_AT_str_offsets_base` of their own, `DW_FORM_strx*` in their header
+ * index the contribution of the unit that refers to the program with `DW_AT_stmt_list`.
+ * Falls back to the first contribution if there is no such unit.
+ */
+DWSTATIC(dw_off_t) dwarf_line_program_str_offsets_base(struct dwarf *dwarf, const struct dwarf_line_program *line_program)
+{
+    dw_off_t base = line_program->dwarf64 == 64 ? 16 : 8;
+    if (!dwarf->info.section.base && !dwarf->info.section_provider) return base;
+    struct dwarf_errinfo errinfo = DWARF_ERRINFO_INIT;
+    dw_stream_t stream = dw_stream_new(DWARF_SECTION_INFO, dwarf->info.section, dwarf->info.section_provider);
+    while (!dw_stream_isdone(&stream)) {
+        dwarf_unit_t unit;
+        memset(&unit, 0x00, sizeof(unit));
+        if (!dwarf_unit_parseheader(dwarf, &stream, &unit, &errinfo)) break;
+        if (unit.line_offset == line_program->section_offset) return unit.str_offsets_base;
+        if (!dw_stream_seek(&stream, unit.die.section_offset + dwarf_header_length_size(unit.dwarf64) + unit.die.length)) break;
+    }
+    return base;
+}
+/* Read an entry of the directory or file table, `unit` stands in for the unit of the program */
+DWSTATIC(bool) dwarf_read_line_program_attr(struct dwarf *dwarf, struct dwarf_line_program *line_program, dwarf_unit_t *unit, dw_stream_t *stream, dwarf_attr_t *attr, struct dwarf_errinfo *errinfo)
+{
+    if (!dwarf_read_attr_raw(dwarf, unit, stream, attr, errinfo)) return false;
+    switch (attr->form) {
+    case DW_FORM_strx:
+    case DW_FORM_strx1:
+    case DW_FORM_strx2:
+    case DW_FORM_strx3:
+    case DW_FORM_strx4:
+        if (unit->str_offsets_base == (dw_off_t)-1) {
+            dw_off_t off = dw_stream_tell(stream);
+            unit->str_offsets_base = dwarf_line_program_str_offsets_base(dwarf, line_program);
+            dw_stream_seek(stream, off);
+        }
+        if (!dwarf_resolve_attr(dwarf, unit, attr, errinfo)) return false;
+        /* Resolved to an offset into .debug_str, which is what users of the tables know how to read */
+        attr->form = DW_FORM_strp;
+        return true;
+    default:
+        return dwarf_resolve_attr(dwarf, unit, attr, errinfo);
+    }
+}
 DWSTATIC(bool) dwarf_read_line_program_header(struct dwarf *dwarf, dw_stream_t *stream, struct dwarf_line_program *line_program, struct dwarf_errinfo *errinfo)
 {
+    int dwarf64;
     line_program->section_offset = dw_stream_tell(stream);
-    line_program->length = dw_stream_get32(stream);
+    line_program->length = dw_stream_getlen(stream, &dwarf64);
+    line_program->dwarf64 = dwarf64;
     line_program->version = dw_stream_get16(stream);
     switch (line_program->version) {
     case 2:
@@ -123,7 +365,7 @@ DWSTATIC(bool) dwarf_read_line_program_header(struct dwarf *dwarf, dw_stream_t *
         line_program->address_size = dw_stream_get8(stream);
         line_program->segment_selector_size = dw_stream_get8(stream);
     }
-    line_program->header_length = dw_stream_get32(stream); /* TODO: 64 bits in dwarf64 */
+    line_program->header_length = dwarf_read_offset(stream, dwarf64);
     line_program->instruction_size = dw_stream_get8(stream);
     if (line_program->version >= 4) {
         line_program->maximum_operations_per_instruction = dw_stream_get8(stream);
@@ -139,130 +381,83 @@ DWSTATIC(bool) dwarf_read_line_program_header(struct dwarf *dwarf, dw_stream_t *
         line_program->basic_opcode_argcount[i] = dw_stream_get8(stream);
     }
     if (line_program->version >= 5) {
-        /* FIXME: Much of this code is duplicated for version < 5 */
         dwarf_attr_t attr;
+        dwarf_unit_t unit;
+        size_t j;
+        memset(&unit, 0x00, sizeof(unit));
+        unit.version = line_program->version;
+        unit.dwarf64 = dwarf64;
+        unit.address_size = line_program->address_size;
+        unit.str_offsets_base = -1; /* Looked up when first needed */
         line_program->directorydata_format_count = dw_stream_get8(stream);
         line_program->directorydata_format = dw_malloc(dwarf, line_program->directorydata_format_count * sizeof(struct dwarf_line_program_format));
         for (i=0; i < line_program->directorydata_format_count; i++) {
             line_program->directorydata_format[i].name = dw_stream_getleb128_unsigned(stream, NULL);
             line_program->directorydata_format[i].form = dw_stream_getleb128_unsigned(stream, NULL);
         }
-        for (i=0; i < line_program->directorydata_format_count; i++) {
-            attr.name = line_program->directorydata_format[i].name;
-            attr.form = line_program->directorydata_format[i].form;
-            dwarf_read_attr(dwarf, stream, &attr);
-            switch (attr.name) {
-            case DW_LNCT_path:
-                switch (attr.form) {
-                case DW_FORM_string:
-                case DW_FORM_strp:
-                case DW_FORM_line_strp:
+        line_program->num_include_directories = dw_stream_getleb128_unsigned(stream, NULL);
+        line_program->include_directories = dw_malloc(dwarf, line_program->num_include_directories * sizeof(struct dwarf_pathinfo));
+        for (i=0; i < line_program->num_include_directories; i++) {
+            memset(&line_program->include_directories[i], 0x00, sizeof(struct dwarf_pathinfo));
+            for (j=0; j < line_program->directorydata_format_count; j++) {
+                attr.name = line_program->directorydata_format[j].name;
+                attr.form = line_program->directorydata_format[j].form;
+                if (!dwarf_read_line_program_attr(dwarf, line_program, &unit, stream, &attr, errinfo)) return false;
+                if (attr.name == DW_LNCT_path) {
                     line_program->include_directories[i].form = attr.form;
                     line_program->include_directories[i].value = attr.value;
-                    break;
-                case DW_FORM_strp_sup:
-                    /* TODO */
-                    break;
-                default:
-                    assert(false); /* TODO */
-                    break;
                 }
-                break;
-                break;
-            default:
-                break;
             }
         }
-        line_program->num_include_directories = dw_stream_getleb128_unsigned(stream, NULL);
-        line_program->include_directories = dw_malloc(dwarf, line_program->num_include_directories * sizeof(dw_str_t));
-        for (i=0; i < line_program->num_include_directories; i++) {
-            attr.name = line_program->directorydata_format[i].name;
-            attr.form = line_program->directorydata_format[i].form;
-            dwarf_read_attr(dwarf, stream, &attr);
-        }
         line_program->filedata_format_count = dw_stream_get8(stream);
         line_program->filedata_format = dw_malloc(dwarf, line_program->filedata_format_count * sizeof(struct dwarf_line_program_format));
         for (i=0; i < line_program->filedata_format_count; i++) {
-            line_program->directorydata_format[i].name = dw_stream_getleb128_unsigned(stream, NULL);
-            line_program->directorydata_format[i].form = dw_stream_getleb128_unsigned(stream, NULL);
+            line_program->filedata_format[i].name = dw_stream_getleb128_unsigned(stream, NULL);
+            line_program->filedata_format[i].form = dw_stream_getleb128_unsigned(stream, NULL);
         }
         line_program->num_files = dw_stream_getleb128_unsigned(stream, NULL);
         line_program->files = dw_malloc(dwarf, line_program->num_files * sizeof(struct dwarf_fileinfo));
         for (i=0; i < line_program->num_files; i++) {
-            attr.name = line_program->directorydata_format[i].name;
-            attr.form = line_program->directorydata_format[i].form;
-            dwarf_read_attr(dwarf, stream, &attr);
-            switch (attr.name) {
-            case DW_LNCT_path:
-                switch (attr.form) {
-                case DW_FORM_string:
-                    line_program->files[i].name.section = DWARF_SECTION_LINE;
-                    line_program->files[i].name.off = attr.value.str.off;
-                    abort(); /* FIXME: Not fully implemented, but really easy */
-                    break;
-                case DW_FORM_strp:
-                line_program->files[i].name.section = DWARF_SECTION_STR;
-                    line_program->files[i].name.off = attr.value.stroff;
-                    line_program->files[i].name.len = -1;
-                    break;
-                case DW_FORM_line_strp:
-                    line_program->files[i].name.section = DWARF_SECTION_LINESTR;
-                    line_program->files[i].name.off = attr.value.stroff;
-                    line_program->files[i].name.len = -1;
-                    break;
-                case DW_FORM_strp_sup:
-                    /* TODO */
-                    break;
-                default:
-                    assert(false); /* TODO */
-                    break;
-                }
-                break;
-            case DW_LNCT_directory_index:
-                switch (attr.form) {
-                case DW_FORM_data1:
-                case DW_FORM_data2:
-                case DW_FORM_udata:
-                    line_program->files[i].include_directory_idx = attr.value.val;
-                    break;
-                default:
-                    assert(false); /* TODO */
+            struct dwarf_fileinfo *info = &line_program->files[i];
+            memset(info, 0x00, sizeof(struct dwarf_fileinfo));
+            for (j=0; j < line_program->filedata_format_count; j++) {
+                attr.name = line_program->filedata_format[j].name;
+                attr.form = line_program->filedata_format[j].form;
+                if (!dwarf_read_line_program_attr(dwarf, line_program, &unit, stream, &attr, errinfo)) return false;
+                switch (attr.name) {
+                case DW_LNCT_path:
+                    switch (attr.form) {
+                    case DW_FORM_string:
+                        info->name = attr.value.str;
+                        line_program->total_file_path_size += info->name.len;
+                        break;
+                    case DW_FORM_strp:
+                        info->name.section = DWARF_SECTION_STR;
+                        info->name.off = attr.value.stroff;
+                        info->name.len = -1;
+                        break;
+                    case DW_FORM_line_strp:
+                        info->name.section = DWARF_SECTION_LINESTR;
+                        info->name.off = attr.value.stroff;
+                        info->name.len = -1;
+                        break;
+                    default: /* TODO: DW_FORM_strp_sup */
+                        break;
+                    }
                     break;
-                }
-                break;
-            case DW_LNCT_timestamp:
-                switch (attr.form) {
-                case DW_FORM_data4:
-                case DW_FORM_data8:
-                case DW_FORM_udata:
-                    line_program->files[i].last_modification_time = attr.value.val;
+                case DW_LNCT_directory_index:
+                    info->include_directory_idx = attr.value.val;
                     break;
-                case DW_FORM_block:
-                    assert(false); /* TODO */
+                case DW_LNCT_timestamp:
+                    if (attr.form != DW_FORM_block) info->last_modification_time = attr.value.val;
                     break;
-                default:
-                    assert(false); /* TODO */
-                    break;
-                }
-                break;
-            case DW_LNCT_size:
-                switch (attr.form) {
-                case DW_FORM_data1:
-                case DW_FORM_data2:
-                case DW_FORM_data4:
-                case DW_FORM_data8:
-                case DW_FORM_udata:
-                    line_program->files[i].file_size = attr.value.val;
+                case DW_LNCT_size:
+                    info->file_size = attr.value.val;
                     break;
+                case DW_LNCT_MD5:
                 default:
-                    assert(false); /* TODO */
                     break;
                 }
-                break;
-            case DW_LNCT_MD5:
-                break;
-            default:
-                break;
             }
         }
         /* TODO: call callback for attr? */
@@ -311,6 +506,98 @@ DWSTATIC(bool) dwarf_read_line_program_header(struct dwarf *dwarf, dw_stream_t *
     line_program->header_size = dw_stream_tell(stream) - line_program->section_offset;
     return true;
 }
+DWFUN(struct dwarf_fileinfo *) dwarf_line_program_file(struct dwarf_line_program *program, dw_u64_t index)
+{
+    if (program->version < 5) {
+        if (index == 0) return NULL;
+        index--;
+    }
+    if (index >= program->num_files) return NULL;
+    return &program->files[index];
+}
+DWFUN(struct dwarf_pathinfo *) dwarf_line_program_include_directory(struct dwarf_line_program *program, dw_u64_t index)
+{
+    if (program->version < 5) {
+        if (index == 0) return NULL;
+        index--;
+    }
+    if (index >= program->num_include_directories) return NULL;
+    return &program->include_directories[index];
+}
+DWFUN(bool) dwarf_read_ranges(struct dwarf *dwarf, const dwarf_unit_t *unit, const dwarf_attr_t *attr, dw_u64_t base, dw_range_cb_t range_cb, void *data, struct dwarf_errinfo *errinfo)
+{
+    if (has_error(errinfo)) return false;
+    if (dw_unlikely(dw_isnull(dwarf))) error(argument_error(1, "dwarf", __func__, "pointer is NULL"));
+
+    enum dwarf_section_namespace ns = unit->version < 5 ? DWARF_SECTION_RANGES : DWARF_SECTION_RANGELISTS;
+    struct dwarf_section_provider *provider;
+    struct dwarf_section *section = dwarf_get_section(dwarf, ns, &provider);
+    if (!provider && !section->base) error(runtime_error("range list used, but section %1 is not loaded", "I", ns));
+    if (!provider && attr->value.off >= section->size) error(runtime_error("range list at offset %1 is out of bounds for section %2", "QI", attr->value.off, ns));
+    dw_stream_t stream;
+    dw_stream_initfrom(&stream, ns, *section, provider, attr->value.off);
+
+    int address_size = unit->address_size;
+    dw_u64_t low_pc, high_pc;
+    if (ns == DWARF_SECTION_RANGES) {
+        dw_u64_t base_selector = address_size == 4 ? 0xffffffffu : (dw_u64_t)-1;
+        while (!dw_stream_isdone(&stream)) {
+            low_pc = dw_stream_getaddr(&stream, address_size * 8);
+            high_pc = dw_stream_getaddr(&stream, address_size * 8);
+            if (low_pc == 0 && high_pc == 0) break; /* End of list */
+            if (low_pc == base_selector) {
+                base = high_pc;
+                continue;
+            }
+            if (low_pc == high_pc) continue;
+            if (range_cb(dwarf, unit, base + low_pc, base + high_pc, data) == DW_CB_DONE) break;
+        }
+        return true;
+    }
+    while (!dw_stream_isdone(&stream)) {
+        dw_u8_t kind = dw_stream_get8(&stream);
+        dw_u64_t index;
+        switch (kind) {
+        case DW_RLE_end_of_list:
+            return true;
+        case DW_RLE_base_addressx:
+            index = dw_stream_getleb128_unsigned(&stream, NULL);
+            if (!dwarf_read_indexed(dwarf, DWARF_SECTION_ADDR, unit->addr_base + index * address_size, address_size, &base, errinfo)) return false;
+            continue;
+        case DW_RLE_startx_endx:
+            index = dw_stream_getleb128_unsigned(&stream, NULL);
+            if (!dwarf_read_indexed(dwarf, DWARF_SECTION_ADDR, unit->addr_base + index * address_size, address_size, &low_pc, errinfo)) return false;
+            index = dw_stream_getleb128_unsigned(&stream, NULL);
+            if (!dwarf_read_indexed(dwarf, DWARF_SECTION_ADDR, unit->addr_base + index * address_size, address_size, &high_pc, errinfo)) return false;
+            break;
+        case DW_RLE_startx_length:
+            index = dw_stream_getleb128_unsigned(&stream, NULL);
+            if (!dwarf_read_indexed(dwarf, DWARF_SECTION_ADDR, unit->addr_base + index * address_size, address_size, &low_pc, errinfo)) return false;
+            high_pc = low_pc + dw_stream_getleb128_unsigned(&stream, NULL);
+            break;
+        case DW_RLE_offset_pair:
+            low_pc = base + dw_stream_getleb128_unsigned(&stream, NULL);
+            high_pc = base + dw_stream_getleb128_unsigned(&stream, NULL);
+            break;
+        case DW_RLE_base_address:
+            base = dw_stream_getaddr(&stream, address_size * 8);
+            continue;
+        case DW_RLE_start_end:
+            low_pc = dw_stream_getaddr(&stream, address_size * 8);
+            high_pc = dw_stream_getaddr(&stream, address_size * 8);
+            break;
+        case DW_RLE_start_length:
+            low_pc = dw_stream_getaddr(&stream, address_size * 8);
+            high_pc = low_pc + dw_stream_getleb128_unsigned(&stream, NULL);
+            break;
+        default:
+            error(runtime_error("unknown range list entry kind %1 at offset %2", "IQ", kind, dw_stream_tell(&stream) - 1));
+        }
+        if (low_pc == high_pc) continue;
+        if (range_cb(dwarf, unit, low_pc, high_pc, data) == DW_CB_DONE) break;
+    }
+    return true;
+}
 DWSTATIC(void) dwarf_line_program_init(struct dwarf *dwarf, struct dwarf_line_program *line_program)
 {
     memset(line_program, 0x00, sizeof(*line_program));
@@ -40,6 +40,7 @@
 #define DW_SYMNAME_END(NAME, VALUE)        [VALUE] = DW_SYMPREFIX("DW_END_")        #NAME,
 #define DW_SYMNAME_UT(NAME, VALUE)         [VALUE] = DW_SYMPREFIX("DW_UT_")         #NAME,
 #define DW_SYMNAME_LNCT(NAME, VALUE)       [VALUE] = DW_SYMPREFIX("DW_LNCT_")       #NAME,
+#define DW_SYMNAME_RLE(NAME, VALUE)        [VALUE] = DW_SYMPREFIX("DW_RLE_")        #NAME,
 
 #define DW_SYMCASE_AT(NAME, VALUE)         case VALUE: return DW_SYMPREFIX("DW_AT_")         #NAME;
 #define DW_SYMCASE_LANG(NAME, VALUE)       case VALUE: return DW_SYMPREFIX("DW_LANG_")       #NAME;
@@ -64,6 +65,7 @@
 #define DW_SYMCASE_END(NAME, VALUE)        case VALUE: return DW_SYMPREFIX("DW_END_")        #NAME;
 #define DW_SYMCASE_UT(NAME, VALUE)         case VALUE: return DW_SYMPREFIX("DW_UT_")         #NAME;
 #define DW_SYMCASE_LNCT(NAME, VALUE)       case VALUE: return DW_SYMPREFIX("DW_LNCT_")       #NAME;
+#define DW_SYMCASE_RLE(NAME, VALUE)        case VALUE: return DW_SYMPREFIX("DW_RLE_")        #NAME;
 
 #define DW_SYMNSCASE(NAME) case DW_##NAME: switch (value) { DW_##NAME##_SYMBOLS(DW_SYMCASE_##NAME) } break
 DWFUN(const char *)
@@ -94,6 +96,7 @@ dwarf_get_symbol_name_slow(enum dwarf_symbol_namespace ns, dw_symval_t value)
     DW_SYMNSCASE(END);
     DW_SYMNSCASE(UT);
     DW_SYMNSCASE(LNCT);
+    DW_SYMNSCASE(RLE);
     case DW_EH: break;
     }
     return NULL;
@@ -128,6 +131,7 @@ dwarf_get_symbol_shortname_slow(enum dwarf_symbol_namespace ns,
     DW_SYMNSCASE(END);
     DW_SYMNSCASE(UT);
     DW_SYMNSCASE(LNCT);
+    DW_SYMNSCASE(RLE);
     case DW_EH: break;
     }
     return NULL;
@@ -160,6 +164,7 @@ DW_SYMNAMES(DS);
 DW_SYMNAMES(END);
 DW_SYMNAMES(UT);
 DW_SYMNAMES(LNCT);
+DW_SYMNAMES(RLE);
 #undef DW_SYMNAMES
 #undef DW_SYMPREFIX
 
@@ -188,6 +193,7 @@ DW_SYMNAMES(DS);
 DW_SYMNAMES(END);
 DW_SYMNAMES(UT);
 DW_SYMNAMES(LNCT);
+DW_SYMNAMES(RLE);
 #undef DW_SYMNAMES
 #undef DW_SYMPREFIX
 
@@ -220,6 +226,7 @@ dwarf_get_symbol_name(enum dwarf_symbol_namespace ns, dw_symval_t value)
         DW_SYMNSCASE_FAST(END);
         DW_SYMNSCASE_FAST(UT);
         DW_SYMNSCASE_FAST(LNCT);
+        DW_SYMNSCASE_FAST(RLE);
         case DW_EH: break;
         }
     } else {
@@ -258,6 +265,7 @@ dwarf_get_symbol_shortname(enum dwarf_symbol_namespace ns, dw_symval_t value)
         DW_SYMNSCASE_FAST(END);
         DW_SYMNSCASE_FAST(UT);
         DW_SYMNSCASE_FAST(LNCT);
+        DW_SYMNSCASE_FAST(RLE);
         case DW_EH: break;
         }
     } else {
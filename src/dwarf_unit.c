@@ -23,26 +23,46 @@ DWSTATIC(bool) dwarf_unit_init(struct dwarf *dwarf, dwarf_unit_t *unit, struct d
     if (!dwarf_die_init(dwarf, &unit->die, errinfo)) return false;
     return true;
 }
+DWSTATIC(bool) dwarf_unit_read_bases(struct dwarf *dwarf, dwarf_unit_t *unit, struct dwarf_errinfo *errinfo);
 DWSTATIC(bool) dwarf_unit_parseheader(struct dwarf *dwarf, dw_stream_t *stream, dwarf_unit_t *unit, struct dwarf_errinfo *errinfo)
 {
+    int dwarf64;
     unit->die.section_offset = dw_stream_tell(stream);
-    unit->die.length = dw_stream_getlen(stream, &unit->dwarf64);
+    unit->die.length = dw_stream_getlen(stream, &dwarf64);
+    unit->dwarf64 = dwarf64;
     unit->version = dw_stream_get16(stream);
-    /*
-    TODO: Actually check version
-    assert(unit->version == 2 || unit->version == 4);
-
-    NOTE: AFAIK, format is exactly the same, only form/value conventions are different
-    The code as-is should be enough to just skip a section no matter the DWARF version
-    */
-    unit->type = DWARF_UNITTYPE_COMPILE; /* Version 4 and below only have compilation units */
-    unit->debug_abbrev_offset = dw_stream_get32(stream);
-    unit->address_size = dw_stream_get8(stream);
-    assert(unit->address_size == 4 || unit->address_size == 8); /* FIXME: Check if we are 32 or 64 bit */
+    if (unit->version < 2 || unit->version > 5) error(runtime_error("unsupported unit version %1 (for unit at offset %2)", "II", unit->version, unit->die.section_offset));
+    if (unit->version >= 5) {
+        /* DWARF5 moved the address size before the abbreviation offset */
+        unit->type = dw_stream_get8(stream);
+        unit->address_size = dw_stream_get8(stream);
+        unit->debug_abbrev_offset = dwarf64 == 64 ? dw_stream_get64(stream) : dw_stream_get32(stream);
+        switch (unit->type) {
+        case DWARF_UNITTYPE_COMPILE:
+        case DWARF_UNITTYPE_PARTIAL:
+            break;
+        case DWARF_UNITTYPE_SKELETON:
+        case DWARF_UNITTYPE_SPLITCOMPILE:
+            unit->unit_id = dw_stream_get64(stream);
+            break;
+        case DWARF_UNITTYPE_TYPE:
+        case DWARF_UNITTYPE_SPLITTYPE:
+            unit->unit_id = dw_stream_get64(stream);
+            unit->type_offset = dwarf64 == 64 ? dw_stream_get64(stream) : dw_stream_get32(stream);
+            break;
+        default:
+            error(runtime_error("unknown unit type %1 (for unit at offset %2)", "II", unit->type, unit->die.section_offset));
+        }
+    } else {
+        unit->type = DWARF_UNITTYPE_COMPILE; /* Version 4 and below only have compilation units in .debug_info */
+        unit->debug_abbrev_offset = dwarf64 == 64 ? dw_stream_get64(stream) : dw_stream_get32(stream);
+        unit->address_size = dw_stream_get8(stream);
+    }
+    if (unit->address_size != 4 && unit->address_size != 8) error(runtime_error("unsupported address size %1 (for unit at offset %2)", "II", unit->address_size, unit->die.section_offset));
     struct dwarf_abbreviation_table *abtable = dwarf_find_abbreviation_table_at_offset(dwarf, unit->debug_abbrev_offset);
     if (!abtable) error(runtime_error("couldn't find an abbreviation table at offset %1 (for compilation unit at offset %2)", "II", unit->debug_abbrev_offset, unit->die.section_offset));
     unit->abbrev_table = abtable;
     unit->header_size = dw_stream_tell(stream) - unit->die.section_offset;
 
-    return true;
+    return dwarf_unit_read_bases(dwarf, unit, errinfo);
 }
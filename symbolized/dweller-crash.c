@@ -0,0 +1,130 @@
+/****************************************************************************
+ *
+ * Copyright 2020 The libdweller project contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ****************************************************************************/
+#define _GNU_SOURCE
+#include <libwander/wander.h>
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Symbolizes the crash records written by processes that called `wander_set_crash_fd`.
+ * The object files are indexed once, by the first record that needs them, and shared by every record after that.
+ */
+
+static void printusage()
+{
+    puts("USAGE: dweller-crash [-r <sysroot>] [-d <debug directory>]... [<crash file>]...");
+}
+
+static void print_crash(wander_resolver_t *resolver, wander_crash_t *crash)
+{
+    printf("Thread %zu crashed with signal %d (%s), code %d, address %#" PRIxPTR "\n", (size_t)crash->thread_id, crash->signo, strsignal(crash->signo), crash->code, crash->fault_address);
+    wander_batch_t batch;
+    if (wander_resolve_batch(resolver, crash->addrs, crash->num_frames, &batch) != 0) {
+        fputs("Could not resolve the stack trace\n", stderr);
+        return;
+    }
+    puts("Stack trace (most recent call last):");
+    for (size_t i=crash->num_frames; i-- > 0;) {
+        printf("#%-3zu %#" PRIxPTR " ", i, crash->frames[i]);
+        if (crash->addrs[i] == 0) {
+            puts("???");
+            continue;
+        }
+        wander_location_t *location = &batch.locations[batch.ids[i]];
+        const char *object = batch.strings[location->object];
+        if (location->function) {
+            printf("in %s()", batch.strings[location->function]);
+        } else if (location->symbol) {
+            printf("in [%s + %#" PRIxPTR "]", batch.strings[location->symbol], location->address - location->symbol_addr);
+        } else if (object) {
+            printf("in %s(+%#" PRIxPTR ")", object, location->address - location->object_base);
+        } else {
+            printf("???");
+        }
+        if (location->filename && location->lineno) {
+            printf(" at ");
+            if (location->directory && batch.strings[location->filename][0] != '/') printf("%s/", batch.strings[location->directory]);
+            printf("%s:%zu", batch.strings[location->filename], location->lineno);
+            if (location->column) printf(":%zu", location->column);
+        } else if ((location->function || location->symbol) && object) {
+            printf(" from %s", object);
+        }
+        putchar('\n');
+    }
+    wander_batch_free(&batch);
+}
+
+static int symbolize(wander_resolver_t *resolver, const char *name, int fd, const char *sysroot)
+{
+    wander_crash_t crash;
+    int res;
+    while ((res = wander_read_crash(resolver, fd, sysroot, &crash)) == 1) {
+        print_crash(resolver, &crash);
+        wander_crash_free(&crash);
+    }
+    if (res != 0) fprintf(stderr, "%s: Not a crash record\n", name);
+    return res;
+}
+
+int main(int argc, const char *argv[])
+{
+    const char *sysroot = NULL;
+    int first_file = argc;
+    for (int i=1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            sysroot = argv[++i];
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            if (wander_add_debug_directory(argv[++i]) != 0) {
+                perror(argv[i]);
+                exit(1);
+            }
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            printusage();
+            exit(1);
+        } else {
+            first_file = i;
+            break;
+        }
+    }
+
+    wander_resolver_t *resolver = wander_resolver_create_detached(WANDER_CONFIG_MAX_STACK_DEPTH, WANDER_CONFIG_MAX_SOURCE_LOCATIONS);
+    if (resolver == NULL) {
+        fputs("Could not create a resolver\n", stderr);
+        exit(1);
+    }
+    int status = 0;
+    if (first_file == argc) {
+        if (symbolize(resolver, "<stdin>", STDIN_FILENO, sysroot) != 0) status = 1;
+    }
+    for (int i=first_file; i < argc; i++) {
+        int fd = strcmp(argv[i], "-") == 0 ? STDIN_FILENO : open(argv[i], O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            perror(argv[i]);
+            status = 1;
+            continue;
+        }
+        if (symbolize(resolver, argv[i], fd, sysroot) != 0) status = 1;
+        if (fd != STDIN_FILENO) close(fd);
+    }
+    wander_resolver_free(&resolver);
+    return status;
+}
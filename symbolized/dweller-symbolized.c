@@ -0,0 +1,143 @@
+/****************************************************************************
+ *
+ * Copyright 2020 The libdweller project contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ****************************************************************************/
+#define _GNU_SOURCE
+#include <libwander/wander.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h> /* umask */
+#include <sys/un.h>
+#include <unistd.h>
+
+/* Symbolizes backtraces for processes using `wander_resolver_create_client`.
+ * Object files are indexed once, by the first client that needs them, and shared by every client after that.
+ * Clients are served one request at a time, and only clients of the same user are accepted.
+ */
+
+#define MAX_CLIENTS 256
+
+static void printusage()
+{
+    puts("USAGE: dweller-symbolized [-s <socket>] [-d <debug directory>]...");
+}
+
+static int listen_socket(const char *path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0x00, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) return -1;
+    unlink(path); /* Left behind by an earlier daemon */
+    mode_t mask = umask(0077); /* Others are turned away anyway, but should not even connect */
+    int res = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(mask);
+    if (res == -1 || listen(fd, 64) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, const char *argv[])
+{
+    const char *socket_path = NULL;
+    char default_path[sizeof(((struct sockaddr_un *)NULL)->sun_path)];
+    for (int i=1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            if (wander_add_debug_directory(argv[++i]) != 0) {
+                perror(argv[i]);
+                exit(1);
+            }
+        } else {
+            printusage();
+            exit(1);
+        }
+    }
+    if (socket_path == NULL) {
+        if (wander_symbolized_socket_path(default_path, sizeof(default_path), 1) != 0) {
+            fputs("No private directory for the socket, use -s\n", stderr);
+            exit(1);
+        }
+        socket_path = default_path;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    wander_resolver_t *resolver = wander_resolver_create_detached(WANDER_CONFIG_MAX_STACK_DEPTH, WANDER_CONFIG_MAX_SOURCE_LOCATIONS);
+    if (resolver == NULL) {
+        fputs("Could not create a resolver\n", stderr);
+        exit(1);
+    }
+    int listen_fd = listen_socket(socket_path);
+    if (listen_fd == -1) {
+        perror(socket_path);
+        exit(1);
+    }
+
+    struct pollfd fds[MAX_CLIENTS + 1];
+    wander_symbolized_client_t *clients[MAX_CLIENTS + 1];
+    nfds_t num_fds = 1;
+    fds[0].fd = listen_fd;
+    fds[0].events = POLLIN;
+    for (;;) {
+        if (poll(fds, num_fds, -1) == -1) {
+            if (errno == EINTR) continue;
+            perror("poll");
+            break;
+        }
+        for (nfds_t i=num_fds; i-- > 1;) {
+            if (!fds[i].revents) continue;
+            if (wander_symbolized_serve(resolver, clients[i]) == 0) continue;
+            wander_symbolized_close(&clients[i]);
+            num_fds--;
+            fds[i] = fds[num_fds];
+            clients[i] = clients[num_fds];
+        }
+        if (fds[0].revents & POLLIN) {
+            wander_symbolized_client_t *client = wander_symbolized_accept(listen_fd);
+            if (client == NULL) continue;
+            if (num_fds == MAX_CLIENTS + 1) {
+                wander_symbolized_close(&client); /* The client falls back to resolving by itself */
+                continue;
+            }
+            clients[num_fds] = client;
+            fds[num_fds].fd = wander_symbolized_client_fd(client);
+            fds[num_fds].events = POLLIN;
+            fds[num_fds].revents = 0;
+            num_fds++;
+        }
+    }
+
+    for (nfds_t i=1; i < num_fds; i++) wander_symbolized_close(&clients[i]);
+    close(listen_fd);
+    unlink(socket_path);
+    wander_resolver_free(&resolver);
+    return 1;
+}
@@ -0,0 +1,71 @@
+/* The CFI unwinder steps out of a handler that runs on an alternate signal stack in the heap,
+ * back onto the stack of the thread that was interrupted.
+ */
+#define _GNU_SOURCE
+#include "test.h"
+
+#include <libwander/wander.h>
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+
+static wander_backtrace_t backtrace;
+
+static void handler(int signo)
+{
+    (void)signo;
+    backtrace = wander_backtrace(64);
+}
+
+__attribute__((noinline)) static void interrupted_function(void)
+{
+    raise(SIGUSR1);
+    __asm__ volatile("" ::: "memory");
+}
+
+static void *thread_main(void *arg)
+{
+    (void)arg;
+    stack_t altstack;
+    altstack.ss_sp = malloc(SIGSTKSZ * 4);
+    altstack.ss_size = SIGSTKSZ * 4;
+    altstack.ss_flags = 0;
+    CHECK(altstack.ss_sp != NULL);
+    CHECK(sigaltstack(&altstack, NULL) == 0);
+    interrupted_function();
+    return NULL;
+}
+
+int main(void)
+{
+    CHECK(wander_init() == 0);
+    struct sigaction action;
+    memset(&action, 0x00, sizeof(action));
+    action.sa_handler = handler;
+    action.sa_flags = SA_ONSTACK;
+    CHECK(sigaction(SIGUSR1, &action, NULL) == 0);
+    pthread_t thread;
+    CHECK(pthread_create(&thread, NULL, thread_main, NULL) == 0);
+    CHECK(pthread_join(thread, NULL) == 0);
+    CHECK(backtrace.depth > 0);
+
+    wander_resolver_t *resolver = wander_resolver_create(64, 16);
+    CHECK(resolver != NULL);
+    CHECK(wander_resolver_load(resolver, &backtrace) == 0);
+    bool found_handler = false, found_thread = false;
+    for (size_t i=0; i < backtrace.depth; i++) {
+        wander_resolution_t *resolution = wander_resolve_frame(resolver, wander_backtrace_frame(&backtrace, i));
+        if (resolution == NULL) continue;
+        if (resolution->symbol.name != NULL) {
+            found_handler |= strcmp(resolution->symbol.name, "handler") == 0;
+            found_thread |= strcmp(resolution->symbol.name, "thread_main") == 0;
+        }
+        wander_destroy_resolution(&resolution);
+    }
+    CHECK(found_handler);
+    CHECK(found_thread);
+    wander_resolver_free(&resolver);
+    wander_backtrace_free(&backtrace);
+    return 0;
+}
@@ -0,0 +1,47 @@
+/* The arena allocator never hands a block it did not make to a fallback that is switched off,
+ * and the tables that parsing builds can be dropped with the arena and built again.
+ */
+#include "test.h"
+
+#include <dweller/dwarf.h>
+#include <dweller/arena.h>
+#include <dweller/libc.h>
+
+static dw_u8_t memory[64 * 1024];
+
+static void *request(struct dweller_arena *arena, void *ptr, size_t size)
+{
+    struct dwarf_alloc_req req = { size, DWARF_ALLOC_DYNAMIC, 8, 1 };
+    return arena->allocator(&arena->allocator, &req, &ptr) == 0 ? ptr : (void *)-1;
+}
+
+int main(void)
+{
+    struct dweller_arena arena;
+    dweller_arena_init(&arena, memory, sizeof(memory), &dweller_libc_allocator);
+
+    /* Too large for the arena, so it comes from malloc */
+    void *outside = request(&arena, NULL, 2 * sizeof(memory));
+    CHECK(outside != NULL && outside != (void *)-1);
+    CHECK((dw_u8_t *)outside < memory || (dw_u8_t *)outside >= memory + sizeof(memory));
+
+    /* Switched off, like in a signal handler: the block can not grow, but nothing crashes */
+    arena.fallback = NULL;
+    CHECK(request(&arena, outside, 4 * sizeof(memory)) == (void *)-1);
+    CHECK(request(&arena, NULL, 2 * sizeof(memory)) == (void *)-1);
+    arena.fallback = &dweller_libc_allocator;
+    CHECK(request(&arena, outside, 0) != (void *)-1);
+
+    /* Blocks in the arena still work without the fallback */
+    arena.fallback = NULL;
+    size_t mark = dweller_arena_mark(&arena);
+    void *inside = request(&arena, NULL, 100);
+    CHECK(inside != NULL && inside != (void *)-1);
+    void *grown = request(&arena, inside, 200);
+    CHECK(grown == inside);
+    dweller_arena_release(&arena, mark);
+    CHECK(arena.used == mark);
+    void *again = request(&arena, NULL, 100);
+    CHECK(again == inside);
+    return 0;
+}
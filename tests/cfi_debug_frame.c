@@ -0,0 +1,140 @@
+/* FDEs are found in a .debug_frame written by hand, with and without the index,
+ * and DW_OP_deref_size reads no more than it is asked to.
+ */
+#include "test.h"
+
+#include <dweller/dwarf.h>
+#include <dweller/cfi.h>
+#include <dweller/libc.h>
+
+#define SP 7
+#define RA 16
+
+struct stack {
+    dw_u64_t slots[4];
+    size_t max_size;
+};
+
+static bool read_stack(void *data, dw_u64_t address, void *bytes, size_t size)
+{
+    struct stack *stack = data;
+    dw_u64_t base = (dw_u64_t)(uintptr_t)stack->slots;
+    if (address < base || address + size > base + sizeof(stack->slots)) return false;
+    memcpy(bytes, (void *)(uintptr_t)address, size);
+    if (size > stack->max_size) stack->max_size = size;
+    return true;
+}
+
+static void put_fde(struct bytes *b, uint64_t cie, uint64_t pc, uint64_t range, const struct bytes *instructions)
+{
+    size_t start = b->size;
+    put_uint(b, 0, 4);
+    put_uint(b, cie, 4);
+    put_uint(b, pc, sizeof(void *));
+    put_uint(b, range, sizeof(void *));
+    put_bytes(b, instructions->data, instructions->size);
+    patch_uint(b, start, b->size - start - 4, 4);
+}
+
+static void check_rows(const struct dweller_cfi *cfi)
+{
+    struct dweller_cfi_row row;
+    CHECK(dweller_cfi_find(cfi, 0x2008, &row));
+    CHECK(row.pc_begin == 0x2000 && row.pc_end == 0x2010);
+    CHECK(row.cfa.reg == SP && row.cfa.offset == 8);
+    CHECK(row.ra_reg == RA && row.regs[RA].kind == DWELLER_CFI_OFFSET && row.regs[RA].offset == -8);
+
+    CHECK(dweller_cfi_find(cfi, 0x1002, &row));
+    CHECK(row.pc_begin == 0x1000 && row.pc_end == 0x1004);
+    CHECK(row.cfa.offset == 8 && row.regs[3].kind == DWELLER_CFI_SAME_VALUE);
+    CHECK(dweller_cfi_find(cfi, 0x1008, &row));
+    CHECK(row.pc_begin == 0x1004 && row.pc_end == 0x1010);
+    CHECK(row.cfa.offset == 16 && row.regs[3].kind == DWELLER_CFI_VAL_EXPRESSION);
+
+    CHECK(!dweller_cfi_find(cfi, 0x0fff, &row));
+    CHECK(!dweller_cfi_find(cfi, 0x1800, &row));
+    CHECK(!dweller_cfi_find(cfi, 0x2010, &row));
+}
+
+int main(void)
+{
+    struct bytes section = { .size = 0 };
+
+    /* The CIE: the CFA is sp + 8, where the return address is right below */
+    put_uint(&section, 0, 4);
+    put_uint(&section, 0xffffffff, 4);
+    put_uint(&section, 1, 1);
+    put_str(&section, "");
+    put_uleb(&section, 1);
+    put_uint(&section, 0x78, 1); /* -8 */
+    put_uint(&section, RA, 1);
+    put_uint(&section, DW_CFA_def_cfa, 1);
+    put_uleb(&section, SP);
+    put_uleb(&section, 8);
+    put_uint(&section, DW_CFA_offset | RA, 1);
+    put_uleb(&section, 1);
+    patch_uint(&section, 0, section.size - 4, 4);
+
+    /* Out of order, so the index has to sort them */
+    struct bytes none = { .size = 0 };
+    put_fde(&section, 0, 0x2000, 0x10, &none);
+
+    /* After 4 bytes the CFA moves, and register 3 is the 2 bytes at the stack pointer */
+    struct bytes instructions = { .size = 0 };
+    put_uint(&instructions, DW_CFA_advance_loc | 4, 1);
+    put_uint(&instructions, DW_CFA_def_cfa_offset, 1);
+    put_uleb(&instructions, 16);
+    put_uint(&instructions, DW_CFA_val_expression, 1);
+    put_uleb(&instructions, 3);
+    put_uleb(&instructions, 4);
+    put_uint(&instructions, DW_OP_breg0 + SP, 1);
+    put_uint(&instructions, 0, 1);
+    put_uint(&instructions, DW_OP_deref_size, 1);
+    put_uint(&instructions, 2, 1);
+    put_fde(&section, 0, 0x1000, 0x10, &instructions);
+
+    struct dweller_cfi cfi;
+    dweller_cfi_init(&cfi, section.data, section.size, 0, false);
+    check_rows(&cfi);
+    CHECK(dweller_cfi_index(&cfi, &dweller_libc_allocator));
+    CHECK(cfi.num_entries == 2);
+    CHECK(cfi.entries[0].pc == 0x1000 && cfi.entries[1].pc == 0x2000);
+    check_rows(&cfi);
+
+    /* The expression reads only 2 bytes, in the byte order of the host */
+    struct stack stack = { { 0x1122334455667788, 0x2004, 0, 0 }, 0 };
+    struct dweller_cfi_regs regs;
+    memset(&regs, 0x00, sizeof(regs));
+    regs.pc = 0x1008;
+    regs.regs[SP] = (dw_u64_t)(uintptr_t)stack.slots;
+    regs.valid = (dw_u64_t)1 << SP;
+    struct dweller_cfi_row row;
+    CHECK(dweller_cfi_find(&cfi, regs.pc, &row));
+    uint16_t low;
+    memcpy(&low, stack.slots, sizeof(low));
+    CHECK(dweller_cfi_step(&row, &regs, SP, read_stack, &stack));
+    CHECK(regs.pc == 0x2004);
+    CHECK(regs.regs[SP] == (dw_u64_t)(uintptr_t)stack.slots + 16);
+    CHECK(((regs.valid >> 3) & 1) != 0 && regs.regs[3] == low);
+
+    /* Only the return address is read whole */
+    stack.max_size = 0;
+    regs.pc = 0x1002;
+    regs.regs[SP] = (dw_u64_t)(uintptr_t)&stack.slots[1];
+    CHECK(dweller_cfi_find(&cfi, regs.pc, &row));
+    CHECK(dweller_cfi_step(&row, &regs, SP, read_stack, &stack));
+    CHECK(regs.pc == 0x2004 && stack.max_size == 8);
+
+    /* A deref_size at the very end of what can be read */
+    stack.max_size = 0;
+    regs.pc = 0x1008;
+    regs.regs[SP] = (dw_u64_t)(uintptr_t)stack.slots + sizeof(stack.slots) - 2;
+    regs.valid = (dw_u64_t)1 << SP;
+    CHECK(dweller_cfi_find(&cfi, regs.pc, &row));
+    CHECK(!dweller_cfi_step(&row, &regs, SP, read_stack, &stack)); /* The return address is past the end */
+    CHECK(stack.max_size == 2);
+
+    dweller_cfi_fini(&cfi);
+    CHECK(cfi.entries == NULL && cfi.num_entries == 0);
+    return 0;
+}
@@ -0,0 +1,89 @@
+/* A process that crashes writes a crash record instead of a backtrace,
+ * which is symbolized afterwards with a detached resolver.
+ */
+#define _GNU_SOURCE
+#include "test.h"
+
+#include <libwander/wander.h>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define NUM_FILE_MAPPINGS 2000
+
+__attribute__((noinline)) static void crashing_function(void)
+{
+    *(volatile int *)NULL = 1;
+}
+enum { CALL_LINE = __LINE__ + 3 };
+__attribute__((noinline)) static void crashing_caller(void)
+{
+    crashing_function();
+    __asm__ volatile ("");
+}
+
+int main(int argc, char *argv[])
+{
+    (void)argc;
+    FILE *file = tmpfile();
+    CHECK(file != NULL);
+    int fd = fileno(file);
+    pid_t pid = fork();
+    CHECK(pid >= 0);
+    if (pid == 0) {
+        static const int signals[] = { SIGSEGV, 0 };
+        CHECK(wander_init() == 0);
+        CHECK(wander_set_crash_fd(fd) == 0);
+        CHECK(wander_install_handlers(signals) != NULL);
+        /* Object files that are only mapped to be read are not modules, and do not crowd out the real ones */
+        int self = open(argv[0], O_RDONLY | O_CLOEXEC);
+        CHECK(self != -1);
+        for (int i=0; i < NUM_FILE_MAPPINGS; i++) CHECK(mmap(NULL, 4096, PROT_READ, MAP_PRIVATE, self, 0) != MAP_FAILED);
+        crashing_caller();
+        _exit(0);
+    }
+    int status;
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV);
+
+    CHECK(lseek(fd, 0, SEEK_SET) == 0);
+    wander_resolver_t *resolver = wander_resolver_create_detached(64, 16);
+    CHECK(resolver != NULL);
+    wander_crash_t crash;
+    CHECK(wander_read_crash(resolver, fd, NULL, &crash) == 1);
+    CHECK(crash.signo == SIGSEGV);
+    CHECK(crash.fault_address == 0);
+    CHECK(crash.num_frames > 0);
+    wander_batch_t batch;
+    CHECK(wander_resolve_batch(resolver, crash.addrs, crash.num_frames, &batch) == 0);
+    bool found_crash = false, found_caller = false, found_main = false, found_libc = false;
+    for (size_t i=0; i < crash.num_frames; i++) {
+        if (crash.addrs[i] == 0) continue;
+        wander_location_t *location = &batch.locations[batch.ids[i]];
+        found_libc |= location->object != 0 && strstr(batch.strings[location->object], "libc") != NULL;
+        const char *name = location->function ? batch.strings[location->function] : location->symbol ? batch.strings[location->symbol] : NULL;
+        if (name == NULL) continue;
+        found_crash |= strcmp(name, "crashing_function") == 0;
+        found_main |= strcmp(name, "main") == 0;
+        if (strcmp(name, "crashing_caller") == 0) {
+            /* At the call, not after it */
+            CHECK(location->lineno == CALL_LINE);
+            found_caller = true;
+        }
+    }
+    CHECK(found_crash);
+    CHECK(found_caller);
+    CHECK(found_main);
+    CHECK(found_libc);
+    wander_batch_free(&batch);
+    wander_crash_free(&crash);
+    CHECK(wander_read_crash(resolver, fd, NULL, &crash) == 0);
+    wander_resolver_free(&resolver);
+    fclose(file);
+    return 0;
+}
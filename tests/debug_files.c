@@ -0,0 +1,111 @@
+/* The debug information of a stripped program is found in a separate debug file,
+ * next to it through .gnu_debuglink, or by build-id in a directory added with `wander_add_debug_directory`.
+ * The stripped copies are made with objcopy, the test is skipped without it.
+ */
+#define _GNU_SOURCE
+#include "test.h"
+
+#include <libwander/wander.h>
+
+#include <elf.h>
+#include <link.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+__attribute__((noinline)) static int debug_function(int x)
+{
+    return x * 7;
+}
+
+/* Run as a stripped copy: `expect` is "source" if the debug file must be found, "none" if there is none */
+static int check_copy(const char *expect, const char *debug_dir)
+{
+    if (debug_dir != NULL) CHECK(wander_add_debug_directory(debug_dir) == 0);
+    CHECK(wander_init() == 0);
+    CHECK(debug_function(1) == 7);
+    wander_resolver_t *resolver = wander_resolver_create(16, 16);
+    CHECK(resolver != NULL);
+    wander_resolution_t *resolution = wander_resolve_addr(resolver, (uintptr_t)debug_function);
+    CHECK(resolution != NULL);
+    SKIP_WITHOUT_INDEX(resolution);
+    CHECK(resolution->symbol.name != NULL && strcmp(resolution->symbol.name, "debug_function") == 0);
+    if (strcmp(expect, "source") == 0) {
+        CHECK(resolution->source.function != NULL && strcmp(resolution->source.function, "debug_function") == 0);
+        CHECK(resolution->source.filename != NULL && strstr(resolution->source.filename, "debug_files.c") != NULL);
+    } else {
+        CHECK(resolution->source.function == NULL && resolution->source.filename == NULL);
+    }
+    wander_destroy_resolution(&resolution);
+    wander_resolver_free(&resolver);
+    wander_fini();
+    return 0;
+}
+
+/* The build-id of this program as a hexadecimal string */
+static int build_id_callback(struct dl_phdr_info *info, size_t size, void *data)
+{
+    (void)size;
+    char *build_id = data;
+    for (size_t i=0; i < info->dlpi_phnum; i++) {
+        if (info->dlpi_phdr[i].p_type != PT_NOTE) continue;
+        const uint8_t *note = (const uint8_t *)(info->dlpi_addr + info->dlpi_phdr[i].p_vaddr);
+        const uint8_t *end = note + info->dlpi_phdr[i].p_memsz;
+        while (note + sizeof(ElfW(Nhdr)) <= end) {
+            const ElfW(Nhdr) *nhdr = (const ElfW(Nhdr) *)note;
+            const uint8_t *desc = note + sizeof(ElfW(Nhdr)) + ((nhdr->n_namesz + 3) & ~3u);
+            if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4 && memcmp(note + sizeof(ElfW(Nhdr)), "GNU", 4) == 0) {
+                for (size_t k=0; k < nhdr->n_descsz && k < 64; k++) sprintf(build_id + 2 * k, "%02x", desc[k]);
+                return 1;
+            }
+            note = desc + ((nhdr->n_descsz + 3) & ~3u);
+        }
+    }
+    return 1; /* The program comes first */
+}
+
+static int run(const char *command)
+{
+    int status = system(command);
+    CHECK(status != -1 && WIFEXITED(status));
+    return WEXITSTATUS(status);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc >= 2) return check_copy(argv[1], argc >= 3 ? argv[2] : NULL);
+
+    if (run("objcopy --version > /dev/null 2>&1") != 0) return 77;
+    char build_id[129] = "";
+    dl_iterate_phdr(build_id_callback, build_id);
+    CHECK(strlen(build_id) > 2);
+
+    /* Next to the test rather than in /tmp, which may not allow running programs */
+    char dir[1024];
+    CHECK(strlen(argv[0]) + sizeof("-XXXXXX") <= sizeof(dir));
+    snprintf(dir, sizeof(dir), "%s-XXXXXX", argv[0]);
+    CHECK(mkdtemp(dir) != NULL);
+    char command[8192];
+    /* Found next to the program through .gnu_debuglink */
+    snprintf(command, sizeof(command), "objcopy --only-keep-debug '%s' '%s/debug_files.debug' && "
+             "objcopy --strip-debug --add-gnu-debuglink='%s/debug_files.debug' '%s' '%s/debug_files'",
+             argv[0], dir, dir, argv[0], dir);
+    CHECK(run(command) == 0);
+    snprintf(command, sizeof(command), "'%s/debug_files' source", dir);
+    int result = run(command);
+    if (result == 0) {
+        /* Found by build-id, and not at all once it is gone */
+        snprintf(command, sizeof(command), "mkdir -p '%s/debug/.build-id/%.2s' && mv '%s/debug_files.debug' '%s/debug/.build-id/%.2s/%s.debug' && "
+                 "objcopy --strip-debug '%s' '%s/debug_files'",
+                 dir, build_id, dir, dir, build_id, build_id + 2, argv[0], dir);
+        CHECK(run(command) == 0);
+        snprintf(command, sizeof(command), "'%s/debug_files' source '%s/debug'", dir, dir);
+        CHECK(run(command) == 0);
+        snprintf(command, sizeof(command), "'%s/debug_files' none", dir);
+        CHECK(run(command) == 0);
+    }
+    snprintf(command, sizeof(command), "rm -rf '%s'", dir);
+    CHECK(run(command) == 0);
+    CHECK(result == 0 || result == 77);
+    return result;
+}
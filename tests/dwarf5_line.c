@@ -0,0 +1,144 @@
+/* Parse a DWARF5 line program in the 64-bit DWARF format for a target with 4-byte addresses,
+ * with a file table that names its files with DW_FORM_strx1 (through the unit that refers to the program)
+ * and a directory table that uses DW_FORM_line_strp.
+ */
+#include <dweller/dwarf.h>
+#include <dweller/libc.h>
+
+#include "test.h"
+
+static struct bytes abbrev, info, line, str, line_str, str_offsets;
+static int num_programs, num_rows;
+
+static void build_sections(void)
+{
+    /* Abbreviation 1: a compilation unit without children, with a line program and a string offsets table */
+    put_uleb(&abbrev, 1);
+    put_uleb(&abbrev, DW_TAG_compile_unit);
+    put_uint(&abbrev, 0, 1);
+    put_uleb(&abbrev, DW_AT_stmt_list);
+    put_uleb(&abbrev, DW_FORM_sec_offset);
+    put_uleb(&abbrev, DW_AT_str_offsets_base);
+    put_uleb(&abbrev, DW_FORM_sec_offset);
+    put_uint(&abbrev, 0, 2);
+    put_uint(&abbrev, 0, 1);
+
+    put_str(&str, "/src");   /* 0 */
+    put_str(&str, "file.c"); /* 5 */
+    put_str(&line_str, "/line_str"); /* 0 */
+
+    /* A 64-bit contribution to .debug_str_offsets, the base is past its 16-byte header */
+    put_uint(&str_offsets, 0xffffffff, 4);
+    put_uint(&str_offsets, 4 + 2 * 8, 8);
+    put_uint(&str_offsets, 5, 2);
+    put_uint(&str_offsets, 0, 2);
+    put_uint(&str_offsets, 0, 8);
+    put_uint(&str_offsets, 5, 8);
+
+    /* A 64-bit unit that refers to the line program at offset 0 */
+    put_uint(&info, 0xffffffff, 4);
+    size_t unit_length = info.size;
+    put_uint(&info, 0, 8);
+    put_uint(&info, 5, 2);
+    put_uint(&info, DWARF_UNITTYPE_COMPILE, 1);
+    put_uint(&info, 4, 1);
+    put_uint(&info, 0, 8);
+    put_uleb(&info, 1);
+    put_uint(&info, 0, 8);
+    put_uint(&info, 16, 8);
+    patch_uint(&info, unit_length, info.size - unit_length - 8, 8);
+
+    put_uint(&line, 0xffffffff, 4);
+    size_t program_length = line.size;
+    put_uint(&line, 0, 8);
+    put_uint(&line, 5, 2);
+    put_uint(&line, 4, 1); /* Address size */
+    put_uint(&line, 0, 1);
+    size_t header_length = line.size;
+    put_uint(&line, 0, 8);
+    put_uint(&line, 1, 1);    /* Minimum instruction length */
+    put_uint(&line, 1, 1);    /* Maximum operations per instruction */
+    put_uint(&line, 1, 1);    /* Default is_stmt */
+    put_uint(&line, -5, 1);   /* Line base */
+    put_uint(&line, 14, 1);   /* Line range */
+    put_uint(&line, 13, 1);   /* Opcode base */
+    static const uint8_t opcode_lengths[] = { 0, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 1 };
+    put_bytes(&line, opcode_lengths, sizeof(opcode_lengths));
+    put_uint(&line, 1, 1);
+    put_uleb(&line, DW_LNCT_path);
+    put_uleb(&line, DW_FORM_line_strp);
+    put_uleb(&line, 1);
+    put_uint(&line, 0, 8);
+    put_uint(&line, 2, 1);
+    put_uleb(&line, DW_LNCT_path);
+    put_uleb(&line, DW_FORM_strx1);
+    put_uleb(&line, DW_LNCT_directory_index);
+    put_uleb(&line, DW_FORM_udata);
+    put_uleb(&line, 2);
+    put_uint(&line, 1, 1);
+    put_uleb(&line, 0);
+    put_uint(&line, 1, 1);
+    put_uleb(&line, 0);
+    patch_uint(&line, header_length, line.size - header_length - 8, 8);
+    /* DW_LNE_set_address with a 4-byte operand, a row, and the end of the sequence */
+    put_uint(&line, 0, 1);
+    put_uleb(&line, 5);
+    put_uint(&line, DW_LNE_set_address, 1);
+    put_uint(&line, 0x12345678, 4);
+    put_uint(&line, DW_LNS_copy, 1);
+    put_uint(&line, DW_LNS_advance_pc, 1);
+    put_uleb(&line, 16);
+    put_uint(&line, 0, 1);
+    put_uleb(&line, 1);
+    put_uint(&line, DW_LNE_end_sequence, 1);
+    patch_uint(&line, program_length, line.size - program_length - 8, 8);
+}
+
+static enum dw_cb_status line_row_cb(struct dwarf *dwarf, struct dwarf_line_program *program, struct dwarf_line_program_state *state, struct dwarf_line_program_state *last_state)
+{
+    (void)dwarf; (void)program; (void)last_state;
+    CHECK(state->address == (num_rows == 0 ? 0x12345678 : 0x12345688));
+    CHECK(state->end_sequence == (num_rows == 1));
+    num_rows++;
+    return DW_CB_OK;
+}
+static enum dw_cb_status line_cb(struct dwarf *dwarf, struct dwarf_line_program *program)
+{
+    (void)dwarf;
+    num_programs++;
+    CHECK(program->dwarf64 == 64);
+    CHECK(program->address_size == 4);
+    CHECK(program->num_include_directories == 1);
+    CHECK(program->include_directories[0].form == DW_FORM_line_strp);
+    CHECK(program->include_directories[0].value.stroff == 0);
+    CHECK(program->num_files == 2);
+    struct dwarf_fileinfo *file = dwarf_line_program_file(program, 1);
+    CHECK(file != NULL);
+    CHECK(file->name.section == DWARF_SECTION_STR);
+    CHECK(file->name.off == 5);
+    CHECK(file->include_directory_idx == 0);
+    program->line_row_cb = line_row_cb;
+    return DW_CB_OK;
+}
+
+int main(void)
+{
+    build_sections();
+    struct dwarf *dwarf;
+    struct dwarf_errinfo errinfo = DWARF_ERRINFO_INIT;
+    CHECK(dwarf_init(&dwarf, &dweller_libc_allocator, &errinfo));
+    dwarf_load_section(dwarf, DWARF_SECTION_ABBREV, (struct dwarf_section){ abbrev.data, abbrev.size }, &errinfo);
+    dwarf_load_section(dwarf, DWARF_SECTION_INFO, (struct dwarf_section){ info.data, info.size }, &errinfo);
+    dwarf_load_section(dwarf, DWARF_SECTION_LINE, (struct dwarf_section){ line.data, line.size }, &errinfo);
+    dwarf_load_section(dwarf, DWARF_SECTION_STR, (struct dwarf_section){ str.data, str.size }, &errinfo);
+    dwarf_load_section(dwarf, DWARF_SECTION_LINESTR, (struct dwarf_section){ line_str.data, line_str.size }, &errinfo);
+    dwarf_load_section(dwarf, DWARF_SECTION_STROFFSETS, (struct dwarf_section){ str_offsets.data, str_offsets.size }, &errinfo);
+    dwarf->line_cb = line_cb;
+    CHECK(dwarf_parse_section(dwarf, DWARF_SECTION_ABBREV, &errinfo));
+    CHECK(dwarf_parse_section(dwarf, DWARF_SECTION_LINE, &errinfo));
+    CHECK(!dwarf_has_error(&errinfo));
+    CHECK(num_programs == 1);
+    CHECK(num_rows == 2);
+    dwarf_fini(&dwarf, &errinfo);
+    return 0;
+}
@@ -0,0 +1,150 @@
+/* dwarfdump prints the same with worker threads as without, and as the serial dwarfdump that has no writer thread,
+ * on the debug information of this program and on a string that does not fit in one output buffer.
+ * Run with the paths of dwarfdump and dwarfdump-serial.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "test.h"
+
+#include <elf.h>
+#include <unistd.h>
+
+#define LONG_STRING_SIZE (17 * 1024 * 1024) /* More than BUFFER_SIZE in dwarfdump.c */
+
+/* The output of running `command`, which must succeed, with a NUL after it */
+static char *run(const char *command, size_t *psize)
+{
+    FILE *pipe = popen(command, "r");
+    CHECK(pipe != NULL);
+    size_t size = 0, cap = 1 << 16;
+    char *data = malloc(cap);
+    CHECK(data != NULL);
+    size_t n;
+    while ((n = fread(data + size, 1, cap - size, pipe)) > 0) {
+        size += n;
+        if (size == cap) {
+            cap *= 2;
+            data = realloc(data, cap);
+            CHECK(data != NULL);
+        }
+    }
+    CHECK(pclose(pipe) == 0);
+    data[size] = '\0';
+    *psize = size;
+    return data;
+}
+
+/* Run every dwarfdump on `path`, and return the output they agree on */
+static char *run_all(const char *dwarfdump, const char *serial_dwarfdump, const char *path, int num_runs, size_t *psize)
+{
+    char command[4096];
+    size_t serial_size, size;
+    snprintf(command, sizeof(command), "'%s' '%s'", serial_dwarfdump, path);
+    char *serial = run(command, &serial_size);
+    CHECK(serial_size > 0);
+    snprintf(command, sizeof(command), "'%s' '%s'", dwarfdump, path);
+    char *output = run(command, &size);
+    CHECK(size == serial_size && memcmp(output, serial, serial_size) == 0);
+    free(output);
+    for (int i=0; i < num_runs; i++) {
+        snprintf(command, sizeof(command), "'%s' -j 4 '%s'", dwarfdump, path);
+        output = run(command, &size);
+        CHECK(size == serial_size && memcmp(output, serial, serial_size) == 0);
+        free(output);
+    }
+    *psize = serial_size;
+    return serial;
+}
+
+static void write_all(FILE *file, const void *data, size_t size)
+{
+    CHECK(fwrite(data, 1, size, file) == size);
+}
+
+/* An object file with a single compilation unit, whose name is a string of `LONG_STRING_SIZE` x's in .debug_str.
+ * dwarfdump wants .debug_aranges and .debug_line too, they are empty.
+ */
+static void write_long_string(FILE *file)
+{
+    static const char names[] = "\0.shstrtab\0.debug_abbrev\0.debug_info\0.debug_str\0.debug_aranges\0.debug_line";
+    struct bytes abbrev = { .size = 0 }, info = { .size = 0 };
+    put_uleb(&abbrev, 1);
+    put_uleb(&abbrev, 0x11); /* DW_TAG_compile_unit */
+    put_uint(&abbrev, 0, 1); /* DW_CHILDREN_no */
+    put_uleb(&abbrev, 0x03); /* DW_AT_name */
+    put_uleb(&abbrev, 0x0e); /* DW_FORM_strp */
+    put_uleb(&abbrev, 0);
+    put_uleb(&abbrev, 0);
+    put_uleb(&abbrev, 0);
+    put_uint(&info, 0, 4);
+    put_uint(&info, 4, 2);
+    put_uint(&info, 0, 4);
+    put_uint(&info, 8, 1);
+    put_uleb(&info, 1);
+    put_uint(&info, 0, 4);
+    patch_uint(&info, 0, info.size - 4, 4);
+
+    Elf64_Ehdr ehdr;
+    memset(&ehdr, 0x00, sizeof(ehdr));
+    memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+    ehdr.e_ident[EI_CLASS] = ELFCLASS64;
+    ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+    ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+    ehdr.e_type = ET_REL;
+    ehdr.e_version = EV_CURRENT;
+    ehdr.e_ehsize = sizeof(Elf64_Ehdr);
+    ehdr.e_shentsize = sizeof(Elf64_Shdr);
+    ehdr.e_shnum = 7;
+    ehdr.e_shstrndx = 1;
+    ehdr.e_shoff = sizeof(Elf64_Ehdr);
+
+    Elf64_Shdr shdrs[7];
+    memset(shdrs, 0x00, sizeof(shdrs));
+    Elf64_Off offset = sizeof(Elf64_Ehdr) + sizeof(shdrs);
+    const size_t sizes[7] = { 0, sizeof(names), abbrev.size, info.size, LONG_STRING_SIZE + 1, 0, 0 };
+    const Elf64_Word name_offsets[7] = { 0, 1, 11, 25, 37, 48, 63 };
+    for (int i=1; i < 7; i++) {
+        shdrs[i].sh_name = name_offsets[i];
+        shdrs[i].sh_type = i == 1 ? SHT_STRTAB : SHT_PROGBITS;
+        shdrs[i].sh_offset = offset;
+        shdrs[i].sh_size = sizes[i];
+        shdrs[i].sh_addralign = 1;
+        offset += sizes[i];
+    }
+    write_all(file, &ehdr, sizeof(ehdr));
+    write_all(file, shdrs, sizeof(shdrs));
+    write_all(file, names, sizeof(names));
+    write_all(file, abbrev.data, abbrev.size);
+    write_all(file, info.data, info.size);
+    char *string = malloc(LONG_STRING_SIZE + 1);
+    CHECK(string != NULL);
+    memset(string, 'x', LONG_STRING_SIZE);
+    string[LONG_STRING_SIZE] = '\0';
+    write_all(file, string, LONG_STRING_SIZE + 1);
+    free(string);
+}
+
+int main(int argc, char *argv[])
+{
+    CHECK(argc == 3);
+    size_t size;
+    free(run_all(argv[1], argv[2], argv[0], 10, &size));
+
+    char path[] = "/tmp/dwarfdump_jobs.XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd != -1);
+    FILE *file = fdopen(fd, "wb");
+    CHECK(file != NULL);
+    write_long_string(file);
+    CHECK(fclose(file) == 0);
+    char *output = run_all(argv[1], argv[2], path, 2, &size);
+    unlink(path);
+
+    /* The whole string, quoted */
+    CHECK(size > LONG_STRING_SIZE);
+    char *start = strstr(output, "'xxxx");
+    CHECK(start != NULL && (size_t)(start - output) + LONG_STRING_SIZE + 2 <= size);
+    for (size_t i=1; i <= LONG_STRING_SIZE; i++) CHECK(start[i] == 'x');
+    CHECK(start[LONG_STRING_SIZE + 1] == '\'');
+    free(output);
+    return 0;
+}
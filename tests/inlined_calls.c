@@ -0,0 +1,63 @@
+/* A frame in a function with calls inlined two levels deep resolves to the innermost one,
+ * followed by the functions it was inlined into, innermost first, each at the line of its call.
+ */
+#include "test.h"
+
+#include <libwander/wander.h>
+
+static wander_resolver_t *resolver;
+static int leaf_line, middle_line, outer_line;
+static wander_resolution_t *outer_resolution;
+
+static inline __attribute__((always_inline)) void inlined_leaf(void)
+{
+    wander_backtrace_t backtrace = wander_backtrace(8); leaf_line = __LINE__;
+    CHECK(wander_resolver_load(resolver, &backtrace) == 0);
+    for (size_t i=0; i < backtrace.depth && outer_resolution == NULL; i++) {
+        wander_resolution_t *resolution = wander_resolve_frame(resolver, wander_backtrace_frame(&backtrace, i));
+        CHECK(resolution != NULL);
+        if (resolution->symbol.name != NULL && strcmp(resolution->symbol.name, "inlined_outer") == 0) {
+            outer_resolution = resolution;
+        } else {
+            wander_destroy_resolution(&resolution);
+        }
+    }
+    wander_backtrace_free(&backtrace);
+}
+static inline __attribute__((always_inline)) void inlined_middle(void)
+{
+    inlined_leaf(); middle_line = __LINE__;
+    __asm__ volatile ("");
+}
+__attribute__((noinline)) static void inlined_outer(void)
+{
+    inlined_middle(); outer_line = __LINE__;
+    __asm__ volatile ("");
+}
+
+static void check_source(const wander_source_t *source, const char *function, int lineno)
+{
+    CHECK(source->function != NULL && strcmp(source->function, function) == 0);
+    CHECK(source->filename != NULL && strstr(source->filename, "inlined_calls.c") != NULL);
+    CHECK(source->lineno == (size_t)lineno);
+}
+
+int main(void)
+{
+    CHECK(wander_init() == 0);
+    resolver = wander_resolver_create(16, 16);
+    CHECK(resolver != NULL);
+    inlined_outer();
+    CHECK(outer_resolution != NULL);
+    /* Without an index (WANDER_CONFIG_RESOLVER_INDEX=0), inlined calls are not expanded */
+    if (outer_resolution->num_inlines == 0) return 77;
+
+    check_source(&outer_resolution->source, "inlined_leaf", leaf_line);
+    CHECK(outer_resolution->num_inlines == 2);
+    check_source(&outer_resolution->inlines[0], "inlined_middle", middle_line);
+    check_source(&outer_resolution->inlines[1], "inlined_outer", outer_line);
+
+    wander_destroy_resolution(&outer_resolution);
+    wander_resolver_free(&resolver);
+    return 0;
+}
@@ -0,0 +1,140 @@
+/* Code that has no file is resolved from memory: the vDSO, and object files that a JIT
+ * registers through the GDB JIT interface, which are dropped again once it unregisters them.
+ */
+#define _GNU_SOURCE
+#include "test.h"
+
+#include <dlfcn.h>
+#include <elf.h>
+#include <libwander/wander.h>
+#include <stddef.h>
+#include <sys/mman.h>
+
+/* The JIT interface, see "JIT Compilation Interface" in the GDB manual */
+struct jit_code_entry {
+    struct jit_code_entry *next_entry;
+    struct jit_code_entry *prev_entry;
+    const char            *symfile_addr;
+    uint64_t               symfile_size;
+};
+struct jit_descriptor {
+    uint32_t               version;
+    uint32_t               action_flag;
+    struct jit_code_entry *relevant_entry;
+    struct jit_code_entry *first_entry;
+};
+struct jit_descriptor __jit_debug_descriptor = { 1, 0, NULL, NULL };
+__attribute__((noinline)) void __jit_debug_register_code(void)
+{
+    __asm__ volatile ("");
+}
+
+#define CODE_SIZE 64
+
+static void put_section(struct bytes *b, uint32_t name, uint32_t type, uint64_t flags, uint64_t addr, uint64_t offset, uint64_t size, uint32_t link, uint32_t info, uint64_t entsize)
+{
+    Elf64_Shdr shdr = { name, type, flags, addr, offset, size, link, info, 8, entsize };
+    put_bytes(b, &shdr, sizeof(shdr));
+}
+static void align8(struct bytes *b)
+{
+    while (b->size % 8 != 0) put_uint(b, 0, 1);
+}
+/* A relocatable object with the function `jit_function` at `code`, the way a JIT would describe what it placed there */
+static void build_object(struct bytes *b, uintptr_t code)
+{
+    static const char strtab[] = "\0jit_function";
+    static const char shstrtab[] = "\0.text\0.symtab\0.strtab\0.shstrtab";
+    Elf64_Ehdr ehdr = { .e_type = ET_REL, .e_version = EV_CURRENT, .e_ehsize = sizeof(Elf64_Ehdr),
+                        .e_shentsize = sizeof(Elf64_Shdr), .e_shnum = 5, .e_shstrndx = 4 };
+    memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+    ehdr.e_ident[EI_CLASS] = ELFCLASS64;
+    ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+    ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+#if defined(__x86_64__)
+    ehdr.e_machine = EM_X86_64;
+#elif defined(__aarch64__)
+    ehdr.e_machine = EM_AARCH64;
+#endif
+    put_bytes(b, &ehdr, sizeof(ehdr));
+
+    size_t symtab = b->size;
+    Elf64_Sym syms[2] = {
+        { 0 },
+        { .st_name = 1, .st_info = ELF64_ST_INFO(STB_GLOBAL, STT_FUNC), .st_shndx = 1, .st_value = 0, .st_size = CODE_SIZE },
+    };
+    put_bytes(b, syms, sizeof(syms));
+    size_t strs = b->size;
+    put_bytes(b, strtab, sizeof(strtab));
+    size_t shstrs = b->size;
+    put_bytes(b, shstrtab, sizeof(shstrtab));
+    align8(b);
+
+    size_t shoff = b->size;
+    put_section(b, 0, SHT_NULL, 0, 0, 0, 0, 0, 0, 0);
+    put_section(b, 1, SHT_NOBITS, SHF_ALLOC | SHF_EXECINSTR, code, 0, CODE_SIZE, 0, 0, 0);
+    put_section(b, 7, SHT_SYMTAB, 0, 0, symtab, sizeof(syms), 3, 1, sizeof(Elf64_Sym));
+    put_section(b, 15, SHT_STRTAB, 0, 0, strs, sizeof(strtab), 0, 0, 0);
+    put_section(b, 23, SHT_STRTAB, 0, 0, shstrs, sizeof(shstrtab), 0, 0, 0);
+    memcpy(b->data + offsetof(Elf64_Ehdr, e_shoff), &shoff, sizeof(shoff));
+}
+
+static const char *resolve_symbol(wander_resolver_t *resolver, uintptr_t addr, char *object, size_t max_object)
+{
+    static char name[64];
+    wander_resolution_t *resolution = wander_resolve_addr(resolver, addr);
+    CHECK(resolution != NULL);
+    const char *result = NULL;
+    if (resolution->symbol.name != NULL) {
+        snprintf(name, sizeof(name), "%s", resolution->symbol.name);
+        result = name;
+    }
+    snprintf(object, max_object, "%s", resolution->object != NULL ? resolution->object : "");
+    wander_destroy_resolution(&resolution);
+    return result;
+}
+
+int main(void)
+{
+    char object[256];
+    wander_resolver_t *resolver = wander_resolver_create(16, 16);
+    CHECK(resolver != NULL);
+
+    /* Its name depends on the architecture */
+    static const char *const vdso_functions[] = { "__vdso_clock_gettime", "__kernel_clock_gettime" };
+    void *vdso = dlopen("linux-vdso.so.1", RTLD_NOW | RTLD_NOLOAD);
+    for (size_t i=0; vdso != NULL && i < sizeof(vdso_functions) / sizeof(vdso_functions[0]); i++) {
+        void *function = dlsym(vdso, vdso_functions[i]);
+        if (function == NULL) continue;
+        const char *name = resolve_symbol(resolver, (uintptr_t)function + 1, object, sizeof(object));
+        CHECK(name != NULL && strcmp(name, vdso_functions[i]) == 0);
+    }
+
+    void *code = mmap(NULL, CODE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    CHECK(code != MAP_FAILED);
+    uintptr_t addr = (uintptr_t)code + CODE_SIZE / 2;
+    CHECK(resolve_symbol(resolver, addr, object, sizeof(object)) == NULL);
+
+    static struct bytes image;
+    build_object(&image, (uintptr_t)code);
+    struct jit_code_entry entry = { NULL, NULL, (const char *)image.data, image.size };
+    __jit_debug_descriptor.first_entry = &entry;
+    __jit_debug_descriptor.relevant_entry = &entry;
+    __jit_debug_descriptor.action_flag = 1; /* JIT_REGISTER_FN */
+    __jit_debug_register_code();
+    const char *name = resolve_symbol(resolver, addr, object, sizeof(object));
+    CHECK(name != NULL && strcmp(name, "jit_function") == 0);
+    CHECK(strncmp(object, "<in-memory@", strlen("<in-memory@")) == 0);
+
+    __jit_debug_descriptor.first_entry = NULL;
+    __jit_debug_descriptor.action_flag = 2; /* JIT_UNREGISTER_FN */
+    __jit_debug_register_code();
+    memset(&image, 0x00, sizeof(image)); /* The resolver made a copy */
+    /* Its address is still in a known object, so `wander_resolve_addr` would only look again a while later */
+    CHECK(wander_resolver_refresh(resolver) == 1);
+    CHECK(resolve_symbol(resolver, addr, object, sizeof(object)) == NULL);
+
+    wander_resolver_free(&resolver);
+    munmap(code, CODE_SIZE);
+    return 0;
+}
@@ -0,0 +1,59 @@
+/* Resolving addresses in turn from several object files, which a lazy resolver
+ * (WANDER_CONFIG_RESOLVER_LAZY=1 with WANDER_CONFIG_RESOLVER_MAX_MAPPED=1) maps and unmaps again every time.
+ * An address resolved before its object file was mapped is not remembered as unknown once it is.
+ */
+#include "test.h"
+
+#include <dlfcn.h>
+#include <libwander/wander.h>
+
+static int local_function(int x)
+{
+    return x + 1;
+}
+
+static void check_symbol(const wander_resolution_t *resolution, const char *name)
+{
+    CHECK(resolution->symbol.name != NULL);
+    CHECK(strcmp(resolution->symbol.name, name) == 0);
+}
+
+int main(int argc, char *argv[])
+{
+    CHECK(argc == 2);
+    CHECK(local_function(1) == 2);
+    void *module = dlopen(argv[1], RTLD_NOW);
+    CHECK(module != NULL);
+    void *module_function = dlsym(module, "refresh_module_function");
+    CHECK(module_function != NULL);
+
+    wander_resolver_t *resolver = wander_resolver_create(16, 16);
+    CHECK(resolver != NULL);
+    const struct {
+        uintptr_t   addr;
+        const char *name;
+    } functions[] = {
+        { (uintptr_t)local_function, "local_function" },
+        { (uintptr_t)wander_resolver_create, "wander_resolver_create" },
+        { (uintptr_t)module_function, "refresh_module_function" },
+    };
+    for (int i=0; i < 100; i++) {
+        for (size_t k=0; k < sizeof(functions) / sizeof(functions[0]); k++) {
+            wander_resolution_t safe;
+            /* Maybe only the object, if it is not mapped yet */
+            wander_resolve_addr_safe(resolver, functions[k].addr, &safe);
+            CHECK(safe.object != NULL);
+
+            wander_resolution_t *resolution = wander_resolve_addr(resolver, functions[k].addr);
+            CHECK(resolution != NULL);
+            check_symbol(resolution, functions[k].name);
+            wander_destroy_resolution(&resolution);
+
+            wander_resolve_addr_safe(resolver, functions[k].addr, &safe);
+            check_symbol(&safe, functions[k].name);
+        }
+    }
+    wander_resolver_free(&resolver);
+    dlclose(module);
+    return 0;
+}
@@ -0,0 +1,109 @@
+/* Addresses are attributed to the object file they are in: this program, libwander, libc and a
+ * module loaded with dlopen, with and without an index, and nothing for addresses outside of all of them.
+ * Files added to a detached resolver are found again by path.
+ * Run with the path of refresh_module.
+ */
+#define _GNU_SOURCE
+#include "test.h"
+
+#include <dlfcn.h>
+#include <libwander/wander.h>
+
+#include <stdbool.h>
+
+static wander_resolver_t *resolver;
+static bool found_compare, found_libc;
+
+/* The object file that `addr` is in according to the dynamic linker, without its directory */
+static const char *object_of(uintptr_t addr)
+{
+    Dl_info info;
+    CHECK(dladdr((void *)addr, &info) != 0 && info.dli_fname != NULL);
+    const char *slash = strrchr(info.dli_fname, '/');
+    return slash != NULL ? slash + 1 : info.dli_fname;
+}
+static void check_object(const char *object, uintptr_t addr)
+{
+    CHECK(object != NULL);
+    const char *expected = object_of(addr);
+    size_t length = strlen(object), expected_length = strlen(expected);
+    CHECK(length >= expected_length && strcmp(object + length - expected_length, expected) == 0);
+}
+
+static int compare(const void *a, const void *b)
+{
+    wander_backtrace_t backtrace = wander_backtrace(32);
+    while (wander_resolver_load(resolver, &backtrace) != 0);
+    for (size_t i=0; i < backtrace.depth; i++) {
+        wander_frame_t frame = wander_backtrace_frame(&backtrace, i);
+        wander_resolution_t *resolution = wander_resolve_frame(resolver, frame);
+        CHECK(resolution != NULL);
+        if (resolution->symbol.name != NULL && strcmp(resolution->symbol.name, "compare") == 0) {
+            check_object(resolution->object, (uintptr_t)frame.return_address - 1);
+            found_compare = true;
+        }
+        if (resolution->object != NULL && strstr(resolution->object, "libc") != NULL) {
+            check_object(resolution->object, (uintptr_t)frame.return_address - 1);
+            found_libc = true;
+        }
+        wander_destroy_resolution(&resolution);
+    }
+    wander_backtrace_free(&backtrace);
+    return *(const int *)a - *(const int *)b;
+}
+
+int main(int argc, char *argv[])
+{
+    CHECK(argc == 2);
+    CHECK(wander_init() == 0);
+    void *module = dlopen(argv[1], RTLD_NOW);
+    CHECK(module != NULL);
+    void *module_function = dlsym(module, "refresh_module_function");
+    CHECK(module_function != NULL);
+    resolver = wander_resolver_create(32, 16);
+    CHECK(resolver != NULL);
+
+    /* Frames of a backtrace through libc, found by `wander_resolver_load` */
+    int values[] = { 3, 1, 2 };
+    qsort(values, 3, sizeof(int), compare);
+    CHECK(found_compare && found_libc);
+
+    /* Arbitrary addresses, only with an index (WANDER_CONFIG_RESOLVER_INDEX=1) */
+    const uintptr_t addrs[] = {
+        (uintptr_t)compare, (uintptr_t)wander_resolver_create, (uintptr_t)qsort, (uintptr_t)module_function,
+    };
+    wander_resolution_t *resolution = wander_resolve_addr(resolver, (uintptr_t)main);
+    CHECK(resolution != NULL);
+    bool indexed = resolution->object != NULL;
+    wander_destroy_resolution(&resolution);
+    for (size_t i=0; indexed && i < sizeof(addrs) / sizeof(addrs[0]); i++) {
+        resolution = wander_resolve_addr(resolver, addrs[i]);
+        CHECK(resolution != NULL);
+        check_object(resolution->object, addrs[i]);
+        wander_destroy_resolution(&resolution);
+    }
+    resolution = wander_resolve_addr(resolver, 16);
+    CHECK(resolution != NULL && resolution->object == NULL);
+    wander_destroy_resolution(&resolution);
+    wander_resolver_free(&resolver);
+
+    resolver = wander_resolver_create_detached(16, 16);
+    CHECK(resolver != NULL);
+    uintptr_t base, again, other;
+    if (wander_resolver_add_file(resolver, argv[1], NULL, &base) == 0) {
+        CHECK(wander_resolver_add_file(resolver, argv[0], NULL, &other) == 0 && other != base);
+        CHECK(wander_resolver_add_file(resolver, argv[1], NULL, &again) == 0 && again == base);
+        CHECK(wander_resolver_add_file(resolver, argv[0], NULL, &again) == 0 && again == other);
+        Dl_info info;
+        CHECK(dladdr(module_function, &info) != 0);
+        resolution = wander_resolve_addr(resolver, base + ((uintptr_t)module_function - (uintptr_t)info.dli_fbase));
+        CHECK(resolution != NULL && resolution->object != NULL && strcmp(resolution->object, argv[1]) == 0);
+        CHECK(resolution->symbol.name != NULL && strcmp(resolution->symbol.name, "refresh_module_function") == 0);
+        wander_destroy_resolution(&resolution);
+    } else {
+        CHECK(!indexed); /* Detached resolvers need an index */
+    }
+    wander_resolver_free(&resolver);
+    dlclose(module);
+    return 0;
+}
@@ -0,0 +1,74 @@
+/* Backtraces are printed with snippets of the source, one write at a time as long as the output
+ * fits into the buffer, also from a signal handler on a small alternate stack.
+ */
+#define _GNU_SOURCE
+#include "test.h"
+
+#include <libwander/wander.h>
+#include <libwander/wander_printer.h>
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static char output[1 << 16];
+static size_t output_size;
+static size_t num_writes;
+
+static int capture_writer(WANDER_SELF *self, const void *data, size_t size)
+{
+    (void)self;
+    if (size > sizeof(output) - 1 - output_size) size = sizeof(output) - 1 - output_size;
+    memcpy(output + output_size, data, size);
+    output_size += size;
+    output[output_size] = '\0';
+    num_writes++;
+    return size;
+}
+
+static void print_here(void)
+{
+    output_size = 0;
+    num_writes = 0;
+    wander_printer_t printer = wander_safe_printer(capture_writer, 0);
+    printer.snippet_context = 2;
+    wander_backtrace_t backtrace = wander_backtrace(16);
+    CHECK(wander_print_safe(&printer, &backtrace) == 0); /* The marked line */
+    wander_backtrace_free(&backtrace);
+}
+
+static void handler(int signo)
+{
+    (void)signo;
+    print_here();
+}
+
+int main(void)
+{
+    CHECK(wander_init() == 0);
+    print_here();
+    CHECK(strstr(output, "Stack trace (most recent call last):\n") == output);
+    CHECK(strstr(output, " | ") != NULL);
+    CHECK(strstr(output, "CHECK(wander_print_safe(&printer, &backtrace) == 0); /* The marked line */") != NULL);
+    CHECK(output_size < 4096 && num_writes == 1);
+
+    /* A small stack, with a guard page below it */
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    stack_t altstack;
+    altstack.ss_size = 12 * 1024; /* Less than the buffers of wander_print used to take on the stack */
+    char *mapped = mmap(NULL, page_size + altstack.ss_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    CHECK(mapped != MAP_FAILED);
+    CHECK(mprotect(mapped, page_size, PROT_NONE) == 0);
+    altstack.ss_sp = mapped + page_size;
+    altstack.ss_flags = 0;
+    CHECK(sigaltstack(&altstack, NULL) == 0);
+    struct sigaction action;
+    memset(&action, 0x00, sizeof(action));
+    action.sa_handler = handler;
+    action.sa_flags = SA_ONSTACK;
+    CHECK(sigaction(SIGUSR1, &action, NULL) == 0);
+    raise(SIGUSR1);
+    CHECK(strstr(output, "handler") != NULL);
+    CHECK(strstr(output, "/* The marked line */") != NULL);
+    return 0;
+}
@@ -0,0 +1,38 @@
+/* Printing and resolving more than once in a process, which parses the object files again
+ * in the same arena when there is no index (WANDER_CONFIG_RESOLVER_INDEX=0).
+ */
+#include "test.h"
+
+#include <libwander/wander.h>
+
+#include <stdbool.h>
+
+static int printed_function(void)
+{
+    return wander_print_backtrace();
+}
+
+int main(void)
+{
+    CHECK(wander_init() == 0);
+    wander_resolver_t *resolver = wander_resolver_create(16, 16);
+    CHECK(resolver != NULL);
+    for (int i=0; i < 5; i++) {
+        wander_backtrace_t backtrace = wander_backtrace(16);
+        CHECK(backtrace.depth > 0);
+        CHECK(wander_resolver_load(resolver, &backtrace) == 0);
+        bool found = false;
+        for (size_t k=0; k < backtrace.depth; k++) {
+            wander_resolution_t *resolution = wander_resolve_frame(resolver, wander_backtrace_frame(&backtrace, k));
+            CHECK(resolution != NULL);
+            found |= resolution->symbol.name != NULL && strcmp(resolution->symbol.name, "main") == 0;
+            wander_destroy_resolution(&resolution);
+        }
+        CHECK(found);
+        wander_backtrace_free(&backtrace);
+    }
+    wander_resolver_free(&resolver);
+
+    for (int i=0; i < 5; i++) CHECK(printed_function() >= 0);
+    return 0;
+}
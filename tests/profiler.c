@@ -0,0 +1,68 @@
+/* The sampling profiler sees the function a thread spends its CPU time in. */
+#define _POSIX_C_SOURCE 200809L
+#include "test.h"
+
+#include <libwander/wander.h>
+#include <libwander/wander_profiler.h>
+
+#include <setjmp.h>
+#include <time.h>
+
+struct buffer_writer {
+    wander_writer_t write;
+    char            data[1 << 16];
+    size_t          size;
+};
+static int buffer_write(WANDER_SELF *self, const void *data, size_t size)
+{
+    struct buffer_writer *writer = (struct buffer_writer *)self;
+    if (size > sizeof(writer->data) - 1 - writer->size) size = sizeof(writer->data) - 1 - writer->size;
+    memcpy(writer->data + writer->size, data, size);
+    writer->size += size;
+    writer->data[writer->size] = '\0';
+    return 0;
+}
+
+__attribute__((noinline)) static unsigned long busy_function(void)
+{
+    volatile unsigned long sum = 0;
+    struct timespec start, now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+    do {
+        for (int i=0; i < 100000; i++) sum += i;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    } while ((now.tv_sec - start.tv_sec) * 1000000000L + (now.tv_nsec - start.tv_nsec) < 300000000L);
+    return sum;
+}
+
+/* The call in `profiled_caller` is its last instruction, so its return address is already past its end */
+static jmp_buf done;
+__attribute__((noinline, noreturn)) static void busy_then_return(void)
+{
+    busy_function();
+    longjmp(done, 1);
+}
+__attribute__((noinline)) static void profiled_caller(void)
+{
+    busy_then_return();
+}
+
+int main(void)
+{
+    CHECK(wander_init() == 0);
+    wander_profiler_t *profiler = wander_profiler_start(1000);
+    CHECK(profiler != NULL);
+    if (setjmp(done) == 0) profiled_caller();
+    wander_profiler_stop(profiler);
+
+    wander_resolver_t *resolver = wander_resolver_create(64, 16);
+    CHECK(resolver != NULL);
+    static struct buffer_writer writer = { buffer_write, { 0 }, 0 };
+    CHECK(wander_profiler_write_folded(profiler, resolver, &writer.write) == 0);
+    CHECK(writer.size > 0);
+    CHECK(strstr(writer.data, "main;profiled_caller;busy_then_return;busy_function") != NULL);
+
+    wander_resolver_free(&resolver);
+    wander_profiler_free(&profiler);
+    return 0;
+}
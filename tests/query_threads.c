@@ -0,0 +1,103 @@
+/* Resolving on several threads at once with the functions that take the resolver itself,
+ * which each use a query of the calling thread, so the inlined calls and loaded frames of one thread
+ * are never overwritten by another.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "test.h"
+
+#include <libwander/wander.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+
+#define NUM_THREADS 4
+#define NUM_ROUNDS  500
+
+static wander_resolver_t *resolver;
+static pthread_barrier_t barrier;
+
+/* Check a resolution of the frame in `outer`, where `helper` was inlined */
+static bool check_resolution(const wander_resolution_t *resolution, const char *outer, const char *helper)
+{
+    if (resolution->symbol.name == NULL || strcmp(resolution->symbol.name, outer) != 0) return false;
+    if (resolution->num_inlines == 0) return true; /* Without an index, only the symbol */
+    return resolution->source.function != NULL && strcmp(resolution->source.function, helper) == 0
+        && resolution->inlines[0].function != NULL && strcmp(resolution->inlines[0].function, outer) == 0;
+}
+
+static void resolve_round(wander_backtrace_t *backtrace, const char *outer, const char *helper)
+{
+    /* Without an index, only one thread at a time can load */
+    while (wander_resolver_load(resolver, backtrace) != 0) sched_yield();
+    bool found = false;
+    for (size_t i=0; i < backtrace->depth; i++) {
+        wander_frame_t frame = wander_backtrace_frame(backtrace, i);
+        wander_resolution_t resolution;
+        wander_resolve_frame_safe(resolver, frame, &resolution);
+        if (resolution.symbol.name == NULL || strcmp(resolution.symbol.name, outer) != 0) continue;
+        found = true;
+        CHECK(check_resolution(&resolution, outer, helper));
+
+        for (int k=0; k < 100; k++) {
+            wander_resolution_t by_addr;
+            wander_resolve_addr_safe(resolver, (uintptr_t)frame.return_address - 1, &by_addr);
+            CHECK(by_addr.symbol.name == NULL || check_resolution(&by_addr, outer, helper));
+            /* The inlined calls of the first resolution are still there */
+            CHECK(check_resolution(&resolution, outer, helper));
+            wander_resolve_frame_safe(resolver, frame, &resolution);
+            CHECK(check_resolution(&resolution, outer, helper));
+        }
+
+        wander_resolution_t *owned = wander_resolve_frame(resolver, frame);
+        CHECK(owned != NULL);
+        CHECK(check_resolution(owned, outer, helper));
+        wander_destroy_resolution(&owned);
+    }
+    CHECK(found);
+}
+
+#define THREAD_FUNCTIONS(n) \
+    static inline __attribute__((always_inline)) void helper_##n(void) \
+    { \
+        wander_backtrace_t backtrace = wander_backtrace(32); \
+        resolve_round(&backtrace, "outer_" #n, "helper_" #n); \
+        wander_backtrace_free(&backtrace); \
+    } \
+    __attribute__((noinline)) void outer_##n(void) \
+    { \
+        helper_##n(); \
+        __asm__ volatile (""); \
+    }
+THREAD_FUNCTIONS(0)
+THREAD_FUNCTIONS(1)
+THREAD_FUNCTIONS(2)
+THREAD_FUNCTIONS(3)
+
+static void (*const outer_functions[NUM_THREADS])(void) = { outer_0, outer_1, outer_2, outer_3 };
+
+static void *thread_main(void *arg)
+{
+    void (*outer)(void) = outer_functions[(size_t)arg];
+    pthread_barrier_wait(&barrier);
+    for (int i=0; i < NUM_ROUNDS; i++) outer();
+    return NULL;
+}
+
+int main(void)
+{
+    CHECK(wander_init() == 0);
+    resolver = wander_resolver_create(32, 16);
+    CHECK(resolver != NULL);
+    CHECK(pthread_barrier_init(&barrier, NULL, NUM_THREADS) == 0);
+    pthread_t threads[NUM_THREADS];
+    for (size_t i=0; i < NUM_THREADS; i++) {
+        CHECK(pthread_create(&threads[i], NULL, thread_main, (void *)i) == 0);
+    }
+    for (size_t i=0; i < NUM_THREADS; i++) {
+        CHECK(pthread_join(threads[i], NULL) == 0);
+    }
+    pthread_barrier_destroy(&barrier);
+    wander_resolver_free(&resolver);
+    return 0;
+}
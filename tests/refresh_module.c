@@ -0,0 +1,5 @@
+/* Loaded with dlopen by resolver_refresh.c */
+int refresh_module_function(int x)
+{
+    return x * 3 + 1;
+}
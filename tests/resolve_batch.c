@@ -0,0 +1,77 @@
+/* A batch of addresses, with duplicates and in no particular order, resolves each distinct
+ * address once, sorted, and to the same location as resolving it on its own.
+ */
+#include "test.h"
+
+#include <libwander/wander.h>
+
+#include <stdbool.h>
+
+#define NUM_ADDRS 4096
+
+static int batch_function(int x)
+{
+    return x * 5;
+}
+
+static bool same_string(const char *a, const char *b)
+{
+    return a == b || (a != NULL && b != NULL && strcmp(a, b) == 0);
+}
+
+int main(void)
+{
+    CHECK(batch_function(1) == 5);
+    const uintptr_t bases[] = {
+        (uintptr_t)batch_function, (uintptr_t)main, (uintptr_t)wander_resolve_batch, (uintptr_t)qsort, (uintptr_t)strcmp, 16,
+    };
+    const size_t num_bases = sizeof(bases) / sizeof(bases[0]);
+    static uintptr_t addrs[NUM_ADDRS];
+    srand(1);
+    for (size_t i=0; i < NUM_ADDRS; i++) {
+        addrs[i] = bases[(size_t)rand() % num_bases] + (uintptr_t)(rand() % 64);
+    }
+    addrs[NUM_ADDRS / 2] = (uintptr_t)batch_function;
+
+    wander_resolver_t *resolver = wander_resolver_create(16, 16);
+    CHECK(resolver != NULL);
+    wander_batch_t batch;
+    CHECK(wander_resolve_batch(resolver, addrs, NUM_ADDRS, &batch) == 0);
+    CHECK(batch.num_addresses == NUM_ADDRS);
+    CHECK(batch.num_locations > 0 && batch.num_locations <= num_bases * 64);
+    CHECK(batch.num_strings > 0 && batch.strings[0] == NULL);
+    for (size_t i=1; i < batch.num_locations; i++) {
+        CHECK(batch.locations[i - 1].address < batch.locations[i].address);
+    }
+
+    for (size_t i=0; i < NUM_ADDRS; i++) {
+        CHECK(batch.ids[i] < batch.num_locations);
+        const wander_location_t *location = &batch.locations[batch.ids[i]];
+        CHECK(location->address == addrs[i]);
+        CHECK(location->object < batch.num_strings && location->symbol < batch.num_strings);
+        CHECK(location->function < batch.num_strings && location->filename < batch.num_strings);
+        CHECK(location->directory < batch.num_strings);
+
+        wander_resolution_t *resolution = wander_resolve_addr(resolver, addrs[i]);
+        CHECK(resolution != NULL);
+        CHECK(same_string(batch.strings[location->object], resolution->object));
+        CHECK(same_string(batch.strings[location->symbol], resolution->symbol.name));
+        CHECK(same_string(batch.strings[location->function], resolution->source.function));
+        CHECK(same_string(batch.strings[location->filename], resolution->source.filename));
+        CHECK(same_string(batch.strings[location->directory], resolution->source.directory));
+        CHECK(location->symbol_addr == (uintptr_t)resolution->symbol.addr);
+        CHECK(location->lineno == resolution->source.lineno && location->column == resolution->source.column);
+        wander_destroy_resolution(&resolution);
+    }
+    /* Without an index (WANDER_CONFIG_RESOLVER_INDEX=0), nothing but the addresses */
+    const wander_location_t *location = &batch.locations[batch.ids[NUM_ADDRS / 2]];
+    if (location->object != 0) {
+        CHECK(location->symbol_addr == (uintptr_t)batch_function);
+        CHECK(same_string(batch.strings[location->symbol], "batch_function"));
+        CHECK(same_string(batch.strings[location->function], "batch_function"));
+    }
+
+    wander_batch_free(&batch);
+    wander_resolver_free(&resolver);
+    return 0;
+}
@@ -0,0 +1,62 @@
+/* Addresses are resolved from the index inside a signal handler, with symbols and source locations. */
+#define _POSIX_C_SOURCE 200809L
+#include "test.h"
+
+#include <libwander/wander.h>
+
+#include <signal.h>
+#include <stdbool.h>
+
+static wander_resolver_t *resolver;
+static wander_resolution_t handler_resolution;
+
+enum { FIRST_LINE = __LINE__ };
+__attribute__((noinline)) static int resolved_function(int x)
+{
+    return x * 3 + 1;
+}
+enum { LAST_LINE = __LINE__ };
+
+static void handler(int signo)
+{
+    (void)signo;
+    wander_resolve_addr_safe(resolver, (uintptr_t)resolved_function, &handler_resolution);
+}
+
+static void check_resolution(const wander_resolution_t *resolution)
+{
+    CHECK(resolution->object != NULL);
+    CHECK(resolution->symbol.name != NULL && strcmp(resolution->symbol.name, "resolved_function") == 0);
+    CHECK(resolution->symbol.addr == (void *)(uintptr_t)resolved_function);
+    CHECK(resolution->source.function != NULL && strcmp(resolution->source.function, "resolved_function") == 0);
+    CHECK(resolution->source.filename != NULL && strstr(resolution->source.filename, "resolve_safe.c") != NULL);
+    CHECK(resolution->source.lineno > FIRST_LINE && resolution->source.lineno < LAST_LINE);
+}
+
+int main(void)
+{
+    CHECK(resolved_function(1) == 4);
+    resolver = wander_resolver_create(16, 16);
+    CHECK(resolver != NULL);
+    CHECK(wander_resolver_ready(resolver));
+
+    wander_resolution_t resolution;
+    RESOLVE_SAFE_MAPPED(resolver, (uintptr_t)resolved_function, &resolution);
+    SKIP_WITHOUT_INDEX(&resolution);
+    check_resolution(&resolution);
+
+    struct sigaction action;
+    memset(&action, 0x00, sizeof(action));
+    action.sa_handler = handler;
+    sigemptyset(&action.sa_mask);
+    CHECK(sigaction(SIGUSR1, &action, NULL) == 0);
+    CHECK(raise(SIGUSR1) == 0);
+    check_resolution(&handler_resolution);
+
+    /* In no object file at all */
+    wander_resolve_addr_safe(resolver, 16, &resolution);
+    CHECK(resolution.object == NULL && resolution.symbol.name == NULL && resolution.source.function == NULL);
+
+    wander_resolver_free(&resolver);
+    return 0;
+}
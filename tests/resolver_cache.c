@@ -0,0 +1,90 @@
+/* Resolving the same address again, from the cache or after it was evicted by many others,
+ * gives the same location and inlined calls as the first time.
+ */
+#include "test.h"
+
+#include <libwander/wander.h>
+
+#include <stdbool.h>
+
+static wander_resolver_t *resolver;
+static uintptr_t frame_addrs[8];
+static size_t num_frames;
+
+static bool same_string(const char *a, const char *b)
+{
+    return a == b || (a != NULL && b != NULL && strcmp(a, b) == 0);
+}
+static bool same_source(const wander_source_t *a, const wander_source_t *b)
+{
+    return same_string(a->function, b->function) && same_string(a->filename, b->filename)
+        && same_string(a->directory, b->directory) && a->lineno == b->lineno && a->column == b->column;
+}
+static void check_same(const wander_resolution_t *a, const wander_resolution_t *b)
+{
+    CHECK(same_string(a->object, b->object) && a->object_base == b->object_base);
+    CHECK(same_string(a->symbol.name, b->symbol.name) && a->symbol.addr == b->symbol.addr);
+    CHECK(same_source(&a->source, &b->source));
+    CHECK(a->num_inlines == b->num_inlines);
+    for (size_t i=0; i < a->num_inlines; i++) {
+        CHECK(same_source(&a->inlines[i], &b->inlines[i]));
+    }
+}
+
+static inline __attribute__((always_inline)) void cached_helper(void)
+{
+    wander_backtrace_t backtrace = wander_backtrace(8);
+    for (num_frames=0; num_frames < backtrace.depth; num_frames++) {
+        frame_addrs[num_frames] = (uintptr_t)wander_backtrace_frame(&backtrace, num_frames).return_address - 1;
+    }
+    wander_backtrace_free(&backtrace);
+}
+__attribute__((noinline)) static void cached_function(void)
+{
+    cached_helper();
+    __asm__ volatile ("");
+}
+
+int main(void)
+{
+    CHECK(wander_init() == 0);
+    cached_function();
+    resolver = wander_resolver_create(16, 16);
+    CHECK(resolver != NULL);
+
+    /* The frame of `cached_function`, where `cached_helper` took the backtrace */
+    uintptr_t inlined_addr = 0;
+    wander_resolution_t first;
+    for (size_t i=0; i < num_frames && inlined_addr == 0; i++) {
+        RESOLVE_SAFE_MAPPED(resolver, frame_addrs[i], &first);
+        SKIP_WITHOUT_INDEX(&first);
+        if (first.symbol.name != NULL && strcmp(first.symbol.name, "cached_function") == 0) inlined_addr = frame_addrs[i];
+    }
+    CHECK(inlined_addr != 0);
+    CHECK(first.source.function != NULL && strcmp(first.source.function, "cached_helper") == 0);
+    CHECK(first.num_inlines == 1);
+    /* The inlined calls of safe resolutions are handed out again, keep a copy */
+    wander_source_t first_inline = first.inlines[0];
+    first.inlines = &first_inline;
+
+    for (int i=0; i < 100; i++) {
+        wander_resolution_t again;
+        wander_resolve_addr_safe(resolver, inlined_addr, &again);
+        check_same(&first, &again);
+    }
+    /* More addresses than the cache holds */
+    for (uintptr_t addr=(uintptr_t)main - 8192; addr < (uintptr_t)main + 8192; addr++) {
+        wander_resolution_t other;
+        wander_resolve_addr_safe(resolver, addr, &other);
+    }
+    wander_resolution_t evicted;
+    wander_resolve_addr_safe(resolver, inlined_addr, &evicted);
+    check_same(&first, &evicted);
+    wander_resolution_t *owned = wander_resolve_addr(resolver, inlined_addr);
+    CHECK(owned != NULL);
+    check_same(&first, owned);
+    wander_destroy_resolution(&owned);
+
+    wander_resolver_free(&resolver);
+    return 0;
+}
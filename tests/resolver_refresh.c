@@ -0,0 +1,46 @@
+/* An object loaded after the resolver was created is picked up by the first address in it,
+ * without a full rescan on every lookup.
+ */
+#include "test.h"
+
+#include <dlfcn.h>
+#include <libwander/wander.h>
+
+static int local_function(int x)
+{
+    return x + 1;
+}
+
+int main(int argc, char *argv[])
+{
+    CHECK(argc == 2);
+    wander_resolver_t *resolver = wander_resolver_create(16, 16);
+    CHECK(resolver != NULL);
+
+    /* Nothing changed, so a refresh finds nothing to do */
+    CHECK(wander_resolver_refresh(resolver) == 0);
+    for (int i=0; i < 1000; i++) {
+        wander_resolution_t *resolution = wander_resolve_addr(resolver, (uintptr_t)local_function);
+        CHECK(resolution != NULL && resolution->symbol.name != NULL);
+        CHECK(strcmp(resolution->symbol.name, "local_function") == 0);
+        wander_destroy_resolution(&resolution);
+    }
+
+    void *module = dlopen(argv[1], RTLD_NOW);
+    CHECK(module != NULL);
+    int (*function)(int);
+    *(void **)&function = dlsym(module, "refresh_module_function");
+    CHECK(function != NULL && function(1) == 4);
+    /* Right after a lookup, but the address is in no known object */
+    wander_resolution_t *resolution = wander_resolve_addr(resolver, (uintptr_t)function);
+    CHECK(resolution != NULL && resolution->symbol.name != NULL);
+    CHECK(strcmp(resolution->symbol.name, "refresh_module_function") == 0);
+    wander_destroy_resolution(&resolution);
+
+    dlclose(module);
+    CHECK(wander_resolver_refresh(resolver) == 1);
+    CHECK(wander_resolver_refresh(resolver) == 0);
+
+    wander_resolver_free(&resolver);
+    return 0;
+}
@@ -0,0 +1,51 @@
+/* A resolver that builds its index on a background thread resolves nothing but the address
+ * until it is ready, and everything after; one freed right away cancels the warmup.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "test.h"
+
+#include <libwander/wander.h>
+
+#include <time.h>
+
+__attribute__((noinline)) static int warm_function(int x)
+{
+    return x * 3;
+}
+
+int main(void)
+{
+    CHECK(warm_function(1) == 3);
+    uintptr_t addr = (uintptr_t)warm_function + 1;
+    wander_resolver_t *resolver = wander_resolver_create_async(16, 16);
+    CHECK(resolver != NULL);
+
+    wander_resolution_t resolution;
+    wander_resolve_addr_safe(resolver, addr, &resolution);
+    CHECK(resolution.frame.return_address == (void *)addr);
+    if (!wander_resolver_ready(resolver)) {
+        CHECK(resolution.object == NULL && resolution.symbol.name == NULL && resolution.source.function == NULL);
+    }
+
+    /* Give it ten seconds at most */
+    struct timespec wait = { 0, 1000000 };
+    for (int i=0; i < 10000 && !wander_resolver_ready(resolver); i++) nanosleep(&wait, NULL);
+    CHECK(wander_resolver_ready(resolver));
+    wander_resolution_t *ready = wander_resolve_addr(resolver, addr);
+    CHECK(ready != NULL);
+    /* Without an index (WANDER_CONFIG_RESOLVER_INDEX=0), there is nothing to warm up and only the address */
+    if (ready->object != NULL) {
+        CHECK(ready->symbol.name != NULL && strcmp(ready->symbol.name, "warm_function") == 0);
+        CHECK(ready->source.function != NULL && strcmp(ready->source.function, "warm_function") == 0);
+    }
+    wander_destroy_resolution(&ready);
+    wander_resolver_free(&resolver);
+    CHECK(resolver == NULL);
+
+    for (int i=0; i < 10; i++) {
+        resolver = wander_resolver_create_async(16, 16);
+        CHECK(resolver != NULL);
+        wander_resolver_free(&resolver);
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+/* wander_snapshot captures every thread, and gives up on the ones that do not answer within the timeout. */
+#define _GNU_SOURCE
+#include "test.h"
+
+#include <libwander/wander.h>
+
+#include <pthread.h>
+#include <signal.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NUM_SLEEPERS 3
+
+static atomic_int num_started;
+static atomic_bool stop;
+static atomic_int sleep_line;
+
+static void *sleeper_main(void *arg)
+{
+    if (arg != NULL) {
+        /* This one never sees the signal */
+        sigset_t set;
+        sigfillset(&set);
+        pthread_sigmask(SIG_BLOCK, &set, NULL);
+    }
+    atomic_store(&sleep_line, __LINE__ + 4); /* The call to nanosleep below */
+    atomic_fetch_add(&num_started, 1);
+    while (!atomic_load(&stop)) {
+        struct timespec pause = { 0, 1000000 };
+        nanosleep(&pause, NULL);
+    }
+    return NULL;
+}
+
+static long long now_ms(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+int main(void)
+{
+    CHECK(wander_init() == 0);
+    pthread_t threads[NUM_SLEEPERS + 1];
+    for (int i=0; i < NUM_SLEEPERS; i++) CHECK(pthread_create(&threads[i], NULL, sleeper_main, NULL) == 0);
+    while (atomic_load(&num_started) != NUM_SLEEPERS) sched_yield();
+
+    wander_snapshot_t snapshot;
+    CHECK(wander_snapshot(&snapshot, 16, 64, 5000) == 0);
+    CHECK(snapshot.num_threads == NUM_SLEEPERS + 1);
+    CHECK(snapshot.num_missed == 0);
+    wander_resolver_t *resolver = wander_resolver_create(64, 16);
+    CHECK(resolver != NULL);
+    wander_batch_t batch;
+    CHECK(wander_resolve_snapshot(resolver, &snapshot, &batch) == 0);
+    size_t num_sleepers = 0;
+    for (size_t i=0; i < batch.num_addresses; i++) {
+        const char *symbol = batch.strings[batch.locations[batch.ids[i]].symbol];
+        if (symbol == NULL || strcmp(symbol, "sleeper_main") != 0) continue;
+        /* At the call, not after it */
+        CHECK(batch.locations[batch.ids[i]].lineno == (size_t)atomic_load(&sleep_line));
+        num_sleepers++;
+    }
+    CHECK(num_sleepers == NUM_SLEEPERS);
+    wander_batch_free(&batch);
+    wander_snapshot_free(&snapshot);
+
+    /* The thread that blocks the signal is missed, and the timeout is kept */
+    CHECK(pthread_create(&threads[NUM_SLEEPERS], NULL, sleeper_main, &stop) == 0);
+    while (atomic_load(&num_started) != NUM_SLEEPERS + 1) sched_yield();
+    long long start = now_ms();
+    CHECK(wander_snapshot(&snapshot, 16, 64, 200) == 0);
+    long long elapsed = now_ms() - start;
+    CHECK(elapsed >= 200 && elapsed < 2000);
+    CHECK(snapshot.num_threads == NUM_SLEEPERS + 1);
+    CHECK(snapshot.num_missed == 1);
+    wander_snapshot_free(&snapshot);
+
+    atomic_store(&stop, true);
+    for (int i=0; i < NUM_SLEEPERS + 1; i++) pthread_join(threads[i], NULL);
+    wander_resolver_free(&resolver);
+    return 0;
+}
@@ -0,0 +1,105 @@
+/* Backtraces of the same stack have the same fingerprint and share an id in a stack table,
+ * which counts them, also when several threads add them at once, and takes no more stacks once full.
+ */
+#include "test.h"
+
+#include <libwander/wander.h>
+
+#include <pthread.h>
+
+#define NUM_THREADS 4
+#define NUM_ROUNDS  1000
+
+static void *frames_a[] = { (void *)0x1000, (void *)0x2000, (void *)0x3000 };
+static void *frames_b[] = { (void *)0x1000, (void *)0x2000, (void *)0x3004 };
+static void *frames_c[] = { (void *)0x1000, (void *)0x2000 };
+/* The stack of `frames_a` below a frame that is skipped */
+static void *frames_skipped[] = { (void *)0x9000, (void *)0x1000, (void *)0x2000, (void *)0x3000 };
+
+static wander_stack_table_t *table;
+
+static wander_backtrace_t make_backtrace(void **frames, size_t offset, size_t depth)
+{
+    wander_backtrace_t backtrace;
+    memset(&backtrace, 0x00, sizeof(backtrace));
+    backtrace.frames = frames;
+    backtrace.offset = offset;
+    backtrace.depth = depth;
+    backtrace.max_depth = depth;
+    return backtrace;
+}
+
+__attribute__((noinline)) static size_t intern_here(size_t *count)
+{
+    wander_backtrace_t backtrace = wander_backtrace(16);
+    size_t id = wander_stack_table_intern(table, &backtrace, count);
+    wander_backtrace_free(&backtrace);
+    return id;
+}
+
+static void *thread_main(void *arg)
+{
+    (void)arg;
+    wander_backtrace_t a = make_backtrace(frames_a, 0, 3);
+    wander_backtrace_t b = make_backtrace(frames_b, 0, 3);
+    for (int i=0; i < NUM_ROUNDS; i++) {
+        CHECK(wander_stack_table_intern(table, &a, NULL) != 0);
+        CHECK(wander_stack_table_intern(table, &b, NULL) != 0);
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    CHECK(wander_init() == 0);
+    wander_backtrace_t a = make_backtrace(frames_a, 0, 3);
+    wander_backtrace_t b = make_backtrace(frames_b, 0, 3);
+    wander_backtrace_t c = make_backtrace(frames_c, 0, 2);
+    wander_backtrace_t skipped = make_backtrace(frames_skipped, 1, 4);
+    wander_backtrace_t empty = make_backtrace(frames_a, 0, 0);
+
+    uint64_t fingerprint = wander_backtrace_fingerprint(&a);
+    CHECK(fingerprint != 0 && wander_backtrace_fingerprint(&empty) != 0);
+    CHECK(wander_backtrace_fingerprint(&a) == fingerprint);
+    CHECK(wander_backtrace_fingerprint(&skipped) == fingerprint);
+    CHECK(wander_backtrace_fingerprint(&b) != fingerprint);
+    CHECK(wander_backtrace_fingerprint(&c) != fingerprint);
+
+    table = wander_stack_table_create(3);
+    CHECK(table != NULL);
+    size_t count = 0;
+    size_t id_a = wander_stack_table_intern(table, &a, &count);
+    CHECK(id_a != 0 && count == 1);
+    CHECK(wander_stack_table_intern(table, &skipped, &count) == id_a && count == 2);
+    CHECK(wander_stack_table_count(table, id_a) == 2);
+    size_t id_b = wander_stack_table_intern(table, &b, &count);
+    CHECK(id_b != 0 && id_b != id_a && count == 1);
+    CHECK(wander_stack_table_count(table, 0) == 0);
+
+    pthread_t threads[NUM_THREADS];
+    for (size_t i=0; i < NUM_THREADS; i++) {
+        CHECK(pthread_create(&threads[i], NULL, thread_main, NULL) == 0);
+    }
+    for (size_t i=0; i < NUM_THREADS; i++) {
+        CHECK(pthread_join(threads[i], NULL) == 0);
+    }
+    CHECK(wander_stack_table_count(table, id_a) == 2 + NUM_THREADS * NUM_ROUNDS);
+    CHECK(wander_stack_table_count(table, id_b) == 1 + NUM_THREADS * NUM_ROUNDS);
+
+    /* The same call site twice, with the last room in the table */
+    size_t id_here = 0;
+    for (size_t i=1; i <= 2; i++) {
+        size_t id = intern_here(&count);
+        CHECK(id != 0 && id != id_a && id != id_b && count == i);
+        CHECK(id_here == 0 || id == id_here);
+        id_here = id;
+    }
+    /* Full: new stacks are not taken, known ones still counted */
+    count = 1;
+    CHECK(wander_stack_table_intern(table, &c, &count) == 0 && count == 0);
+    CHECK(wander_stack_table_intern(table, &a, &count) == id_a && count == 3 + NUM_THREADS * NUM_ROUNDS);
+
+    wander_stack_table_free(&table);
+    CHECK(table == NULL);
+    return 0;
+}
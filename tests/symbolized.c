@@ -0,0 +1,88 @@
+/* dweller-symbolized resolves batches for a client of the same user,
+ * and a client that stops in the middle of a request does not hold up the others.
+ */
+#define _GNU_SOURCE
+#include "test.h"
+
+#include <libwander/wander.h>
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static int symbolized_function(int x)
+{
+    return x * 2;
+}
+
+static int connect_to(const char *path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0x00, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    CHECK(fd != -1);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char *argv[])
+{
+    CHECK(argc == 2);
+    char dir[] = "/tmp/dweller-test-XXXXXX";
+    CHECK(mkdtemp(dir) != NULL);
+    char path[64];
+    snprintf(path, sizeof(path), "%s/socket", dir);
+
+    pid_t daemon = fork();
+    CHECK(daemon != -1);
+    if (daemon == 0) {
+        execl(argv[1], argv[1], "-s", path, (char *)NULL);
+        _exit(127);
+    }
+    int stalled = -1;
+    for (int i=0; i < 500 && stalled == -1; i++) {
+        stalled = connect_to(path);
+        if (stalled == -1) usleep(10000);
+    }
+    CHECK(stalled != -1);
+    /* Only a part of the header */
+    CHECK(write(stalled, "Dsym", 4) == 4);
+
+    /* Nobody but the owner can connect */
+    struct stat st;
+    CHECK(stat(path, &st) == 0 && (st.st_mode & 0077) == 0);
+
+    wander_resolver_t *resolver = wander_resolver_create_client(16, 16, path);
+    CHECK(resolver != NULL);
+    uintptr_t addrs[] = { (uintptr_t)symbolized_function, (uintptr_t)main };
+    for (int round=0; round < 2; round++) {
+        wander_batch_t batch;
+        CHECK(wander_resolve_batch(resolver, addrs, 2, &batch) == 0);
+        CHECK(batch.num_addresses == 2);
+        const char *symbol = batch.strings[batch.locations[batch.ids[0]].symbol];
+        CHECK(symbol != NULL && strcmp(symbol, "symbolized_function") == 0);
+        symbol = batch.strings[batch.locations[batch.ids[1]].symbol];
+        CHECK(symbol != NULL && strcmp(symbol, "main") == 0);
+        wander_batch_free(&batch);
+    }
+    /* It was the daemon that answered, so this process did not have to index anything */
+    wander_resolution_t resolution;
+    CHECK(wander_resolve_addr_safe(resolver, (uintptr_t)symbolized_function, &resolution) != NULL);
+    CHECK(resolution.symbol.name == NULL);
+    wander_resolver_free(&resolver);
+
+    close(stalled);
+    kill(daemon, SIGTERM);
+    waitpid(daemon, NULL, 0);
+    unlink(path);
+    rmdir(dir);
+    return symbolized_function(0);
+}
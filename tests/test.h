@@ -0,0 +1,78 @@
+/* Helpers shared by the regression tests
+ * A test is a program that exits with 0 when it passes, see tests/meson.build
+ */
+#ifndef DWELLER_TEST_H
+#define DWELLER_TEST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1); \
+        } \
+    } while (0)
+
+/* Little-endian byte buffer, for writing DWARF sections by hand */
+struct bytes {
+    uint8_t data[4096];
+    size_t  size;
+};
+static inline void put_bytes(struct bytes *b, const void *data, size_t size)
+{
+    CHECK(b->size + size <= sizeof(b->data));
+    memcpy(b->data + b->size, data, size);
+    b->size += size;
+}
+static inline void put_uint(struct bytes *b, uint64_t value, int size)
+{
+    for (int i=0; i < size; i++) {
+        uint8_t byte = value >> (i * 8);
+        put_bytes(b, &byte, 1);
+    }
+}
+static inline void put_uleb(struct bytes *b, uint64_t value)
+{
+    do {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        if (value) byte |= 0x80;
+        put_bytes(b, &byte, 1);
+    } while (value);
+}
+static inline void put_str(struct bytes *b, const char *str)
+{
+    put_bytes(b, str, strlen(str) + 1);
+}
+/* Overwrite a value written earlier, like a length that was not known yet */
+static inline void patch_uint(struct bytes *b, size_t off, uint64_t value, int size)
+{
+    for (int i=0; i < size; i++) b->data[off + i] = value >> (i * 8);
+}
+
+/* Exit with 77 (skipped) if `resolution` is not even in an object file,
+ * which is all a resolver without an index (WANDER_CONFIG_RESOLVER_INDEX=0) gives AS-safely
+ */
+#define SKIP_WITHOUT_INDEX(resolution) \
+    do { \
+        if ((resolution)->object == NULL) exit(77); \
+    } while (0)
+/* `wander_resolve_addr_safe`, after mapping the object file with `wander_resolve_addr` if a lazy
+ * resolver (WANDER_CONFIG_RESOLVER_LAZY=1) only knows its name so far
+ */
+#define RESOLVE_SAFE_MAPPED(resolver, addr, resolution) \
+    do { \
+        wander_resolve_addr_safe((resolver), (addr), (resolution)); \
+        if ((resolution)->object != NULL && (resolution)->symbol.name == NULL) { \
+            wander_resolution_t *mapped_ = wander_resolve_addr((resolver), (addr)); \
+            CHECK(mapped_ != NULL); \
+            wander_destroy_resolution(&mapped_); \
+            wander_resolve_addr_safe((resolver), (addr), (resolution)); \
+        } \
+    } while (0)
+
+#endif /* DWELLER_TEST_H */
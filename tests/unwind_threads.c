@@ -0,0 +1,80 @@
+/* Threads that unwind at the same time, while another one loads and unloads a library,
+ * all get their whole backtrace, from the unwind cache or not.
+ */
+#define _GNU_SOURCE
+#include "test.h"
+
+#include <libwander/wander.h>
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define NUM_THREADS    4
+#define NUM_BACKTRACES 2000
+#define NUM_PROCESSES  50
+
+static pthread_barrier_t barrier;
+static atomic_bool stop;
+
+__attribute__((noinline)) static size_t unwinding_function(void)
+{
+    wander_backtrace_t backtrace = wander_backtrace(64);
+    size_t depth = backtrace.depth;
+    wander_backtrace_free(&backtrace);
+    __asm__ volatile("" ::: "memory");
+    return depth;
+}
+
+static void *thread_main(void *arg)
+{
+    (void)arg;
+    pthread_barrier_wait(&barrier);
+    size_t first_depth = unwinding_function();
+    CHECK(first_depth > 2);
+    for (int i=0; i < NUM_BACKTRACES; i++) CHECK(unwinding_function() == first_depth);
+    return NULL;
+}
+
+static void *loader_main(void *arg)
+{
+    while (!atomic_load(&stop)) {
+        void *module = dlopen(arg, RTLD_NOW);
+        CHECK(module != NULL);
+        dlclose(module);
+    }
+    return NULL;
+}
+
+/* The first backtraces of a process find the mappings unread, so they all want to read them */
+static void run(const char *module)
+{
+    CHECK(wander_init() == 0);
+    pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+    pthread_t threads[NUM_THREADS], loader;
+    CHECK(pthread_create(&loader, NULL, loader_main, (void *)module) == 0);
+    for (int i=0; i < NUM_THREADS; i++) CHECK(pthread_create(&threads[i], NULL, thread_main, NULL) == 0);
+    for (int i=0; i < NUM_THREADS; i++) CHECK(pthread_join(threads[i], NULL) == 0);
+    atomic_store(&stop, true);
+    CHECK(pthread_join(loader, NULL) == 0);
+}
+
+int main(int argc, char *argv[])
+{
+    CHECK(argc == 2);
+    for (int i=0; i < NUM_PROCESSES; i++) {
+        pid_t pid = fork();
+        CHECK(pid >= 0);
+        if (pid == 0) {
+            run(argv[1]);
+            _exit(0);
+        }
+        int status;
+        CHECK(waitpid(pid, &status, 0) == pid);
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    return 0;
+}